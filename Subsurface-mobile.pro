@@ -41,6 +41,9 @@ SOURCES += subsurface-mobile-main.cpp \
 	core/qt-init.cpp \
 	core/subsurfacesysinfo.cpp \
 	core/windowtitleupdate.cpp \
+	core/workqueue.cpp \
+	core/parallelimport.cpp \
+	core/replay.cpp \
 	core/file.c \
 	core/fulltext.cpp \
 	core/subsurfacestartup.c \
@@ -50,6 +53,7 @@ SOURCES += subsurface-mobile-main.cpp \
 	core/dive.c \
 	core/divecomputer.c \
 	core/divefilter.cpp \
+	core/divesummarytable.cpp \
 	core/event.c \
 	core/eventname.cpp \
 	core/filterconstraint.cpp \
@@ -226,6 +230,7 @@ HEADERS += \
 	core/datatrak.h \
 	core/deco.h \
 	core/divefilter.h \
+	core/divesummarytable.h \
 	core/filterconstraint.h \
 	core/filterpreset.h \
 	core/divelist.h \
@@ -252,6 +257,8 @@ HEADERS += \
 	core/uemis.h \
 	core/webservice.h \
 	core/windowtitleupdate.h \
+	core/workqueue.h \
+	core/parallelimport.h \
 	core/worldmap-options.h \
 	core/worldmap-save.h \
 	core/downloadfromdcthread.h \
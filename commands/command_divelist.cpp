@@ -21,11 +21,10 @@ static void remove_trip_from_backend(dive_trip *trip)
 	remove_trip(trip, divelog.trips);	// Remove trip from backend
 }
 
-// This helper function removes a dive, takes ownership of the dive and adds it to a DiveToAdd structure.
-// If the trip the dive belongs to becomes empty, it is removed and added to the tripsToAdd vector.
-// It is crucial that dives are added in reverse order of deletion, so that the indices are correctly
-// set and that the trips are added before they are used!
-DiveToAdd DiveListBase::removeDive(struct dive *d, std::vector<OwningTripPtr> &tripsToAdd)
+// This helper function removes a dive from its trip and site and adds it to a DiveToAdd structure.
+// The dive stays in the dive table. If the trip the dive belongs to becomes empty, it is removed
+// and added to the tripsToAdd vector.
+DiveToAdd DiveListBase::unlinkDive(struct dive *d, std::vector<OwningTripPtr> &tripsToAdd)
 {
 	// If the dive was the current dive, reset the current dive. The calling
 	// command is responsible of finding a new dive.
@@ -44,12 +43,22 @@ DiveToAdd DiveListBase::removeDive(struct dive *d, std::vector<OwningTripPtr> &t
 		tripsToAdd.emplace_back(res.trip);	// Take ownership of trip
 	}
 
+	DiveFilter::instance()->diveRemoved(d);
+
+	return res;
+}
+
+// This helper function removes a dive, takes ownership of the dive and adds it to a DiveToAdd structure.
+// If the trip the dive belongs to becomes empty, it is removed and added to the tripsToAdd vector.
+// It is crucial that dives are added in reverse order of deletion, so that the indices are correctly
+// set and that the trips are added before they are used!
+DiveToAdd DiveListBase::removeDive(struct dive *d, std::vector<OwningTripPtr> &tripsToAdd)
+{
 	int idx = get_divenr(d);
 	if (idx < 0)
 		qWarning("Deletion of unknown dive!");
 
-	DiveFilter::instance()->diveRemoved(d);
-
+	DiveToAdd res = unlinkDive(d, tripsToAdd);
 	res.dive.reset(unregister_dive(idx));		// Remove dive from backend
 
 	return res;
@@ -61,10 +70,9 @@ void DiveListBase::diveSiteCountChanged(struct dive_site *ds)
 		sitesCountChanged.push_back(ds);
 }
 
-// This helper function adds a dive and returns ownership to the backend. It may also add a dive trip.
-// It is crucial that dives are added in reverse order of deletion (see comment above)!
-// Returns pointer to added dive (which is owned by the backend!)
-dive *DiveListBase::addDive(DiveToAdd &d)
+// This helper function adds a dive to its trip and site, but not to the dive table.
+// Returns pointer to the dive, which the caller has to add to the dive table.
+dive *DiveListBase::linkDive(DiveToAdd &d)
 {
 	if (d.trip)
 		add_dive_to_trip(d.dive.get(), d.trip);
@@ -78,14 +86,23 @@ dive *DiveListBase::addDive(DiveToAdd &d)
 	// dives have been added, their status will be updated.
 	res->hidden_by_filter = true;
 
-	int idx = dive_table_get_insertion_index(divelog.dives, res);
 	fulltext_register(res);				// Register the dive's fulltext cache
-	add_to_dive_table(divelog.dives, idx, res);	// Return ownership to backend
 	invalidate_dive_cache(res);		// Ensure that dive is written in git_save()
 
 	return res;
 }
 
+// This helper function adds a dive and returns ownership to the backend. It may also add a dive trip.
+// It is crucial that dives are added in reverse order of deletion (see comment above)!
+// Returns pointer to added dive (which is owned by the backend!)
+dive *DiveListBase::addDive(DiveToAdd &d)
+{
+	dive *res = linkDive(d);
+	int idx = dive_table_get_insertion_index(divelog.dives, res);
+	add_to_dive_table(divelog.dives, idx, res);	// Return ownership to backend
+	return res;
+}
+
 // Some signals are sent in batches per trip. To avoid writing the same loop
 // twice, this template takes a vector of trip / dive pairs, sorts it
 // by trip and then calls a function-object with trip and a QVector of dives in that trip.
@@ -121,7 +138,9 @@ void processByTrip(std::vector<std::pair<dive_trip *, dive *>> &dives, Function
 // returns a vector of corresponding DiveToAdd objects, which can later be readded.
 // Moreover, a vector of deleted trips is returned, if trips became empty.
 // The passed in vector is cleared.
-DivesAndTripsToAdd DiveListBase::removeDives(DivesAndSitesToRemove &divesAndSitesToDelete)
+// In bulk mode, the dives are removed from the dive table in one go and no
+// divesDeleted() signals are sent. The caller has to send divesBulkChanged().
+DivesAndTripsToAdd DiveListBase::removeDives(DivesAndSitesToRemove &divesAndSitesToDelete, bool bulk)
 {
 	std::vector<DiveToAdd> divesToAdd;
 	std::vector<OwningTripPtr> tripsToAdd;
@@ -137,8 +156,16 @@ DivesAndTripsToAdd DiveListBase::removeDives(DivesAndSitesToRemove &divesAndSite
 	// in the core list.
 	std::sort(divesAndSitesToDelete.dives.begin(), divesAndSitesToDelete.dives.end(), dive_less_than);
 
-	for (dive *d: divesAndSitesToDelete.dives)
-		divesToAdd.push_back(removeDive(d, tripsToAdd));
+	if (bulk) {
+		for (dive *d: divesAndSitesToDelete.dives) {
+			divesToAdd.push_back(unlinkDive(d, tripsToAdd));
+			divesToAdd.back().dive.reset(d);
+		}
+		unregister_dives(divesAndSitesToDelete.dives.data(), (int)divesAndSitesToDelete.dives.size());
+	} else {
+		for (dive *d: divesAndSitesToDelete.dives)
+			divesToAdd.push_back(removeDive(d, tripsToAdd));
+	}
 	divesAndSitesToDelete.dives.clear();
 
 	for (dive_site *ds: divesAndSitesToDelete.sites) {
@@ -150,19 +177,21 @@ DivesAndTripsToAdd DiveListBase::removeDives(DivesAndSitesToRemove &divesAndSite
 
 	// We send one dives-deleted signal per trip (see comments in divelistnotifier.h).
 	// Therefore, collect all dives in an array and sort by trip.
-	std::vector<std::pair<dive_trip *, dive *>> dives;
-	dives.reserve(divesToAdd.size());
-	for (const DiveToAdd &entry: divesToAdd)
-		dives.push_back({ entry.trip, entry.dive.get() });
-
-	// Send signals.
-	processByTrip(dives, [&](dive_trip *trip, const QVector<dive *> &divesInTrip) {
-		// Check if this trip is supposed to be deleted, by checking if it was marked as "add it".
-		bool deleteTrip = trip &&
-				  std::find_if(tripsToAdd.begin(), tripsToAdd.end(), [trip](const OwningTripPtr &ptr)
-					       { return ptr.get() == trip; }) != tripsToAdd.end();
-		emit diveListNotifier.divesDeleted(trip, deleteTrip, divesInTrip);
-	});
+	if (!bulk) {
+		std::vector<std::pair<dive_trip *, dive *>> dives;
+		dives.reserve(divesToAdd.size());
+		for (const DiveToAdd &entry: divesToAdd)
+			dives.push_back({ entry.trip, entry.dive.get() });
+
+		// Send signals.
+		processByTrip(dives, [&](dive_trip *trip, const QVector<dive *> &divesInTrip) {
+			// Check if this trip is supposed to be deleted, by checking if it was marked as "add it".
+			bool deleteTrip = trip &&
+					  std::find_if(tripsToAdd.begin(), tripsToAdd.end(), [trip](const OwningTripPtr &ptr)
+						       { return ptr.get() == trip; }) != tripsToAdd.end();
+			emit diveListNotifier.divesDeleted(trip, deleteTrip, divesInTrip);
+		});
+	}
 
 	if (oldShown != DiveFilter::instance()->shownDives())
 		emit diveListNotifier.numShownChanged();
@@ -174,7 +203,9 @@ DivesAndTripsToAdd DiveListBase::removeDives(DivesAndSitesToRemove &divesAndSite
 // of dives to be (re)added and returns a vector of the added dives. It does this in reverse
 // order, so that trips are created appropriately and indexing is correct.
 // The passed in vector is cleared.
-DivesAndSitesToRemove DiveListBase::addDives(DivesAndTripsToAdd &toAdd)
+// In bulk mode, the dives are merged into the dive table in one go and no
+// divesAdded() signals are sent. The caller has to send divesBulkChanged().
+DivesAndSitesToRemove DiveListBase::addDives(DivesAndTripsToAdd &toAdd, bool bulk)
 {
 	std::vector<dive *> res;
 	std::vector<dive_site *> sites;
@@ -197,11 +228,13 @@ DivesAndSitesToRemove DiveListBase::addDives(DivesAndTripsToAdd &toAdd)
 	QVector<dive *> divesToFilter;
 	divesToFilter.reserve(toAdd.dives.size());
 	for (auto it = toAdd.dives.rbegin(); it != toAdd.dives.rend(); ++it, ++it2) {
-		*it2 = addDive(*it);
+		*it2 = bulk ? linkDive(*it) : addDive(*it);
 		dives.push_back({ (*it2)->divetrip, *it2 });
 		divesToFilter.push_back(*it2);
 	}
 	toAdd.dives.clear();
+	if (bulk)
+		insert_dives(divelog.dives, res.data(), (int)res.size());	// Return ownership to backend
 
 	ShownChange change = DiveFilter::instance()->update(divesToFilter);
 
@@ -224,12 +257,14 @@ DivesAndSitesToRemove DiveListBase::addDives(DivesAndTripsToAdd &toAdd)
 	toAdd.sites.clear();
 
 	// Send signals by trip.
-	processByTrip(dives, [&](dive_trip *trip, const QVector<dive *> &divesInTrip) {
-		// Now, let's check if this trip is supposed to be created, by checking if it was marked as "add it".
-		bool createTrip = trip && std::find(addedTrips.begin(), addedTrips.end(), trip) != addedTrips.end();
-		// Finally, emit the signal
-		emit diveListNotifier.divesAdded(trip, createTrip, divesInTrip);
-	});
+	if (!bulk) {
+		processByTrip(dives, [&](dive_trip *trip, const QVector<dive *> &divesInTrip) {
+			// Now, let's check if this trip is supposed to be created, by checking if it was marked as "add it".
+			bool createTrip = trip && std::find(addedTrips.begin(), addedTrips.end(), trip) != addedTrips.end();
+			// Finally, emit the signal
+			emit diveListNotifier.divesAdded(trip, createTrip, divesInTrip);
+		});
+	}
 
 	if (!change.newShown.empty() || !change.newHidden.empty())
 		emit diveListNotifier.numShownChanged();
@@ -468,6 +503,9 @@ void AddDive::undoit()
 	setSelection(selection, currentDive, -1);
 }
 
+// Imports of at least this many dives are processed in bulk
+static const size_t bulkImportThreshold = 100;
+
 ImportDives::ImportDives(struct divelog *log, int flags, const QString &source)
 {
 	setText(Command::Base::tr("import %n dive(s) from %1", "", log->dives->nr).arg(source));
@@ -511,6 +549,18 @@ ImportDives::ImportDives(struct divelog *log, int flags, const QString &source)
 	for (int i = 0; i < dives_to_remove.nr; ++i)
 		divesAndSitesToRemove.dives.push_back(dives_to_remove.dives[i]);
 
+	// Adding or removing dives one by one costs time proportional to the size of the
+	// dive list and the models react to every batch of dives. For large imports,
+	// update the dive table in one go and let the models rebuild themselves once.
+	bulk = divesToAdd.dives.size() + divesAndSitesToRemove.dives.size() >= bulkImportThreshold;
+
+	// The CNS of the imported dives depends on the dives before them. For bulk
+	// imports, it is calculated in parallel once the dives are in the dive list.
+	if (!bulk) {
+		for (const DiveToAdd &d: divesToAdd.dives)
+			update_cylinder_related_info(d.dive.get());
+	}
+
 	// When encountering filter presets with equal names, check whether they are
 	// the same. If they are, ignore them.
 	for (const filter_preset &preset: *log->filter_presets) {
@@ -534,10 +584,15 @@ void ImportDives::redoit()
 	currentDive = current_dive;
 
 	// Add new dives and sites
-	DivesAndSitesToRemove divesAndSitesToRemoveNew = addDives(divesToAdd);
+	DivesAndSitesToRemove divesAndSitesToRemoveNew = addDives(divesToAdd, bulk);
 
 	// Remove old dives and sites
-	divesToAdd = removeDives(divesAndSitesToRemove);
+	divesToAdd = removeDives(divesAndSitesToRemove, bulk);
+
+	if (bulk) {
+		calculate_derived_dive_data(false);
+		emit diveListNotifier.divesBulkChanged();
+	}
 
 	// Select the newly added dives
 	setSelection(divesAndSitesToRemoveNew.dives, divesAndSitesToRemoveNew.dives.back(), -1);
@@ -562,10 +617,13 @@ void ImportDives::redoit()
 void ImportDives::undoit()
 {
 	// Add new dives and sites
-	DivesAndSitesToRemove divesAndSitesToRemoveNew = addDives(divesToAdd);
+	DivesAndSitesToRemove divesAndSitesToRemoveNew = addDives(divesToAdd, bulk);
 
 	// Remove old dives and sites
-	divesToAdd = removeDives(divesAndSitesToRemove);
+	divesToAdd = removeDives(divesAndSitesToRemove, bulk);
+
+	if (bulk)
+		emit diveListNotifier.divesBulkChanged();
 
 	// Remember dives and sites to remove
 	divesAndSitesToRemove = std::move(divesAndSitesToRemoveNew);
@@ -60,13 +60,16 @@ protected:
 	// These are helper functions to add / remove dive from the C-core structures.
 	DiveToAdd removeDive(struct dive *d, std::vector<OwningTripPtr> &tripsToAdd);
 	dive *addDive(DiveToAdd &d);
-	DivesAndTripsToAdd removeDives(DivesAndSitesToRemove &divesAndSitesToDelete);
-	DivesAndSitesToRemove addDives(DivesAndTripsToAdd &toAdd);
+	DivesAndTripsToAdd removeDives(DivesAndSitesToRemove &divesAndSitesToDelete, bool bulk = false);
+	DivesAndSitesToRemove addDives(DivesAndTripsToAdd &toAdd, bool bulk = false);
 
 	// Register dive sites where counts changed so that we can signal the frontend later.
 	void diveSiteCountChanged(struct dive_site *ds);
 
 private:
+	DiveToAdd unlinkDive(struct dive *d, std::vector<OwningTripPtr> &tripsToAdd);
+	dive *linkDive(DiveToAdd &d);
+
 	// Keep track of dive sites where the number of dives changed
 	std::vector<dive_site *> sitesCountChanged;
 	void initWork();
@@ -109,6 +112,7 @@ private:
 	DivesAndTripsToAdd	divesToAdd;
 	DivesAndSitesToRemove	divesAndSitesToRemove;
 	struct device_table	devicesToAddAndRemove;
+	bool			bulk;	// Many dives: update the dive table in one go and send a single signal
 
 	// For redo
 	std::vector<OwningDiveSitePtr>	sitesToAdd;
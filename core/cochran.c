@@ -805,13 +805,15 @@ int try_to_open_cochran(const char *filename, struct memblock *mem, struct divel
 	UNUSED(filename);
 	unsigned int i;
 	unsigned int mod;
-	unsigned int *offsets, dive1, dive2;
-	unsigned char *decode = mem->buffer + 0x40001;
+	const unsigned int *offsets;
+	unsigned int dive1, dive2;
+	const unsigned char *buf = mem->buffer;
+	const unsigned char *decode = buf + 0x40001;
 
-	if (mem->size < 0x40000)
+	if (mem->size < 0x40000 + 0x102)
 		return 0;
 
-	offsets = (unsigned int *) mem->buffer;
+	offsets = (const unsigned int *) buf;
 	dive1 = offsets[0];
 	dive2 = offsets[1];
 
@@ -819,7 +821,7 @@ int try_to_open_cochran(const char *filename, struct memblock *mem, struct divel
 		return 0;
 
 	mod = decode[0x100] + 1;
-	cochran_parse_header(decode, mod, mem->buffer + 0x40000, dive1 - 0x40000);
+	cochran_parse_header(decode, mod, buf + 0x40000, dive1 - 0x40000);
 
 	// Decode each dive
 	for (i = 0; i < 65534; i++) {
@@ -830,7 +832,7 @@ int try_to_open_cochran(const char *filename, struct memblock *mem, struct divel
 		if (dive2 > mem->size)
 			break;
 
-		cochran_parse_dive(decode, mod, mem->buffer + dive1,
+		cochran_parse_dive(decode, mod, buf + dive1,
 						dive2 - dive1, log->dives);
 	}
 
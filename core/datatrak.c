@@ -89,7 +89,7 @@ static char *to_utf8(unsigned char *in_string)
  * dives; zero on error (meaning this isn't a datatrak file).
  * All other info in the header is useless for Subsurface.
  */
-static int read_file_header(unsigned char *buffer)
+static int read_file_header(const unsigned char *buffer)
 {
 	int n = 0;
 
@@ -145,7 +145,7 @@ static const char *cyl_type_by_size(int size)
  * libdivecomputer parsing. Puts the completed buffer in a pre-allocated
  * compl_buffer, and returns status.
  */
-static dc_status_t dt_libdc_buffer(unsigned char *ptr, int prf_length, int dc_model, unsigned char *compl_buffer)
+static dc_status_t dt_libdc_buffer(const unsigned char *ptr, int prf_length, int dc_model, unsigned char *compl_buffer)
 {
 	if (compl_buffer == NULL)
 		return DC_STATUS_NOMEMORY;
@@ -158,15 +158,15 @@ static dc_status_t dt_libdc_buffer(unsigned char *ptr, int prf_length, int dc_mo
  * Parses a mem buffer extracting its data and filling a subsurface's dive structure.
  * Returns a pointer to last position in buffer, or NULL on failure.
  */
-static unsigned char *dt_dive_parser(unsigned char *runner, struct dive *dt_dive, struct divelog *log, long maxbuf)
+static const unsigned char *dt_dive_parser(const unsigned char *runner, struct dive *dt_dive, struct divelog *log, long maxbuf)
 {
 	int  rc, profile_length, libdc_model;
 	char *tmp_notes_str = NULL;
 	unsigned char *tmp_string1 = NULL,
 		      *locality = NULL,
 		      *dive_point = NULL,
-		      *compl_buffer,
-		      *membuf = runner;
+		      *compl_buffer;
+	const unsigned char *membuf = runner;
 	char buffer[1024];
 	unsigned char tmp_1byte;
 	unsigned int tmp_2bytes;
@@ -180,7 +180,10 @@ static unsigned char *dt_dive_parser(unsigned char *runner, struct dive *dt_dive
 	/*
 	 * Parse byte to byte till next dive entry
 	 */
-	while (membuf[0] != 0xA0 || membuf[1] != 0x00) {
+	for (;;) {
+		CHECK(membuf, 2);
+		if (membuf[0] == 0xA0 && membuf[1] == 0x00)
+			break;
 		JUMP(membuf, 1);
 	}
 	JUMP(membuf, 2);
@@ -585,8 +588,8 @@ bail:
 static int wlog_header_parser (struct memblock *mem)
 {
 	int tmp;
-	unsigned char *runner = (unsigned char *) mem->buffer;
-	if (!runner)
+	const unsigned char *runner = (const unsigned char *) mem->buffer;
+	if (!runner || mem->size < 10)
 		return -1;
 	if (!memcmp(runner, "\x52\x02", 2)) {
 		runner += 8;
@@ -608,7 +611,10 @@ static void wlog_compl_parser(struct memblock *wl_mem, struct dive *dt_dive, int
 	    pos_tank_init = offset + 266,
 	    pos_suit = offset + 268;
 	char *wlog_notes = NULL, *wlog_suit = NULL, *buffer = NULL;
-	unsigned char *runner = (unsigned char *) wl_mem->buffer;
+	const unsigned char *runner = (const unsigned char *) wl_mem->buffer;
+
+	if ((size_t)pos_suit + SUIT_LENGTH > wl_mem->size)
+		return;
 
 	/*
 	 * Extended notes string. Fixed length 256 bytes. 0 padded if not complete
@@ -680,13 +686,13 @@ static void wlog_compl_parser(struct memblock *wl_mem, struct dive *dt_dive, int
  */
 int datatrak_import(struct memblock *mem, struct memblock *wl_mem, struct divelog *log)
 {
-	unsigned char *runner;
+	const unsigned char *runner;
 	int i = 0, numdives = 0, rc = 0;
 
 	long maxbuf = (long) mem->buffer + mem->size;
 
 	// Verify fileheader,  get number of dives in datatrak divelog, zero on error
-	numdives = read_file_header((unsigned char *)mem->buffer);
+	numdives = mem->size < 12 ? 0 : read_file_header((const unsigned char *)mem->buffer);
 	if (!numdives) {
 		report_error(translate("gettextFromC", "[Error] File is not a DataTrak file. Aborted"));
 		goto bail;
@@ -696,13 +702,11 @@ int datatrak_import(struct memblock *mem, struct memblock *wl_mem, struct divelo
 		int compl_dives_n = wlog_header_parser(wl_mem);
 		if (compl_dives_n != numdives) {
 			report_error("ERROR: Not the same number of dives in .log %d and .add file %d.\nWill not parse .add file", numdives , compl_dives_n);
-			free(wl_mem->buffer);
-			wl_mem->buffer = NULL;
 			wl_mem = NULL;
 		}
 	}
 	// Point to the expected begining of 1st. dive data
-	runner = (unsigned char *)mem->buffer;
+	runner = (const unsigned char *)mem->buffer;
 	JUMP(runner, 12);
 
 	// Secuential parsing. Abort if received NULL from dt_dive_parser.
@@ -153,15 +153,6 @@ struct gasmix get_gasmix_from_event(const struct dive *dive, const struct event
 	return gasmix_air;
 }
 
-// we need this to be uniq. oh, and it has no meaning whatsoever
-// - that's why we have the silly initial number and increment by 3 :-)
-int dive_getUniqID()
-{
-	static int maxId = 83529;
-	maxId += 3;
-	return maxId;
-}
-
 struct dive *alloc_dive(void)
 {
 	struct dive *dive;
@@ -266,7 +257,9 @@ static void copy_dive_nodc(const struct dive *s, struct dive *d)
 	memset(&d->weightsystems, 0, sizeof(d->weightsystems));
 	memset(&d->pictures, 0, sizeof(d->pictures));
 	d->full_text = NULL;
-	invalidate_dive_cache(d);
+	/* Not invalidate_dive_cache(): the copy is not (yet) part of the
+	 * dive list and copies may be made on worker threads. */
+	memset(d->git_id, 0, 20);
 	d->buddy = copy_string(s->buddy);
 	d->diveguide = copy_string(s->diveguide);
 	d->notes = copy_string(s->notes);
@@ -1272,7 +1265,7 @@ static void fixup_dive_dc(struct dive *dive, struct divecomputer *dc)
 		fake_dc(dc);
 }
 
-struct dive *fixup_dive(struct dive *dive)
+static struct dive *fixup_dive_data(struct dive *dive, bool cns)
 {
 	int i;
 	struct divecomputer *dc;
@@ -1305,7 +1298,10 @@ struct dive *fixup_dive(struct dive *dive)
 		if (same_rounded_pressure(cyl->sample_end, cyl->end))
 			cyl->end.mbar = 0;
 	}
-	update_cylinder_related_info(dive);
+	if (cns)
+		update_cylinder_related_info(dive);
+	else
+		update_sac_and_otu(dive);
 	for (i = 0; i < dive->weightsystems.nr; i++) {
 		weightsystem_t *ws = &dive->weightsystems.weightsystems[i];
 		add_weightsystem_description(ws);
@@ -1318,6 +1314,18 @@ struct dive *fixup_dive(struct dive *dive)
 	return dive;
 }
 
+struct dive *fixup_dive(struct dive *dive)
+{
+	return fixup_dive_data(dive, true);
+}
+
+/* The CNS depends on the previous dives in the dive list. For dives that
+ * are not in the dive list yet, it is calculated when they are added. */
+struct dive *fixup_dive_nocns(struct dive *dive)
+{
+	return fixup_dive_data(dive, false);
+}
+
 /* Don't pick a zero for MERGE_MIN() */
 #define MERGE_MAX(res, a, b, n) res->n = MAX(a->n, b->n)
 #define MERGE_MIN(res, a, b, n) res->n = (a->n) ? (b->n) ? MIN(a->n, b->n) : (a->n) : (b->n)
@@ -2064,13 +2072,12 @@ static struct dive_trip *get_preferred_trip(const struct dive *a, const struct d
 	return btrip;
 }
 
-#if CURRENTLY_NOT_USED
 /*
  * Sample 's' is between samples 'a' and 'b'. It is 'offset' seconds before 'b'.
  *
  * If 's' and 'a' are at the same time, offset is 0, and b is NULL.
  */
-static int compare_sample(struct sample *s, struct sample *a, struct sample *b, int offset)
+static int compare_sample(const struct sample *s, const struct sample *a, const struct sample *b, int offset)
 {
 	unsigned int depth = a->depth.mm;
 	int diff;
@@ -2101,12 +2108,12 @@ static int compare_sample(struct sample *s, struct sample *a, struct sample *b,
  * the offset in seconds between them. Use this to find the best
  * match of samples between two different dive computers.
  */
-static unsigned long sample_difference(struct divecomputer *a, struct divecomputer *b, int offset)
+static unsigned long sample_difference(const struct divecomputer *a, const struct divecomputer *b, int offset)
 {
 	int asamples = a->samples;
 	int bsamples = b->samples;
-	struct sample *as = a->sample;
-	struct sample *bs = b->sample;
+	const struct sample *as = a->sample;
+	const struct sample *bs = b->sample;
 	unsigned long error = 0;
 	int start = -1;
 
@@ -2173,6 +2180,60 @@ static unsigned long sample_difference(struct divecomputer *a, struct divecomput
 	return error;
 }
 
+/*
+ * Resample the depths of a dive computer to a grid of 'step' seconds,
+ * interpolating linearly between samples. Returns the number of grid
+ * points. The depths are returned in a newly allocated array.
+ */
+static int resample_depths(const struct divecomputer *dc, int step, int **res)
+{
+	const struct sample *s = dc->sample;
+	int nr = MAX(s[dc->samples - 1].time.seconds / step, 0) + 1;
+	int *depths = malloc(nr * sizeof(*depths));
+	int i, j = 0;
+
+	for (i = 0; i < nr; i++) {
+		int t = i * step;
+
+		while (j + 1 < dc->samples && s[j + 1].time.seconds <= t)
+			j++;
+		if (j + 1 < dc->samples && s[j].time.seconds < t) {
+			int interval = s[j + 1].time.seconds - s[j].time.seconds;
+			long delta = (long)(s[j + 1].depth.mm - s[j].depth.mm) * (t - s[j].time.seconds);
+			depths[i] = s[j].depth.mm + delta / interval;
+		} else {
+			depths[i] = s[j].depth.mm;
+		}
+	}
+	*res = depths;
+	return nr;
+}
+
+/*
+ * Mean difference of two resampled depth profiles, where grid point 'k'
+ * of 'b' is compared to grid point 'k + shift' of 'a'. Like compare_sample(),
+ * the difference is cut off at one meter. If the profiles overlap by less
+ * than half of the shorter one, the shift is not considered at all.
+ */
+static unsigned long grid_difference(const int *a, int anr, const int *b, int bnr, int shift)
+{
+	unsigned long error = 0;
+	int k, count = 0;
+
+	for (k = shift < 0 ? -shift : 0; k < bnr && k + shift < anr; k++) {
+		int diff = abs(a[k + shift] - b[k]);
+		if (diff > 1000)
+			diff = 1000;
+		error += diff * diff;
+		count++;
+	}
+	if (!count || count * 2 < MIN(anr, bnr))
+		return ULONG_MAX;
+	return error / count;
+}
+
+#define SAMPLE_OFFSET_STEP 5
+
 /*
  * Dive 'a' is 'offset' seconds before dive 'b'
  *
@@ -2186,12 +2247,19 @@ static unsigned long sample_difference(struct divecomputer *a, struct divecomput
  * when the dive started). And other dive computers have different
  * depths that they activate at, etc etc.
  *
+ * Looking at every single offset with sample_difference() is slow and
+ * limits us to a small window. Therefore, first do a coarse search over
+ * the whole 'window' (in seconds) on profiles resampled to a common grid
+ * and then refine the result with sample_difference() around the best
+ * coarse offset.
+ *
  * If we cannot find a shared offset, don't try to merge.
  */
-static int find_sample_offset(struct divecomputer *a, struct divecomputer *b)
+int find_sample_offset(const struct divecomputer *a, const struct divecomputer *b, int window)
 {
-	int offset, best;
-	unsigned long max;
+	int offset, best, coarse, shift;
+	int anr, bnr, *adepths, *bdepths;
+	unsigned long max, coarse_max;
 
 	/* No samples? Merge at any time (0 offset) */
 	if (!a->samples)
@@ -2210,11 +2278,26 @@ static int find_sample_offset(struct divecomputer *a, struct divecomputer *b)
 	if (!max)
 		return 0;
 
+	/* Coarse search on the resampled profiles */
+	anr = resample_depths(a, SAMPLE_OFFSET_STEP, &adepths);
+	bnr = resample_depths(b, SAMPLE_OFFSET_STEP, &bdepths);
+	coarse = 0;
+	coarse_max = ULONG_MAX;
+	for (shift = -window / SAMPLE_OFFSET_STEP; shift <= window / SAMPLE_OFFSET_STEP; shift++) {
+		unsigned long diff = grid_difference(adepths, anr, bdepths, bnr, shift);
+		if (diff >= coarse_max)
+			continue;
+		coarse = shift * SAMPLE_OFFSET_STEP;
+		coarse_max = diff;
+	}
+	free(adepths);
+	free(bdepths);
+
 	/*
-	 * Otherwise, look if we can find anything better within
-	 * a thirty second window..
+	 * Otherwise, look if we can find anything better around
+	 * the best coarse offset.
 	 */
-	for (offset = -30; offset <= 30; offset++) {
+	for (offset = coarse - SAMPLE_OFFSET_STEP; offset <= coarse + SAMPLE_OFFSET_STEP; offset++) {
 		unsigned long diff;
 
 		diff = sample_difference(a, b, offset);
@@ -2226,7 +2309,6 @@ static int find_sample_offset(struct divecomputer *a, struct divecomputer *b)
 
 	return best;
 }
-#endif
 
 /*
  * Are a and b "similar" values, when given a reasonable lower end expected
@@ -3201,9 +3283,20 @@ fraction_t best_he(depth_t depth, const struct dive *dive, bool o2narcotic, frac
 	return fhe;
 }
 
+/* Incremented whenever a dive is marked as modified. Caches of data
+ * derived from the dives, such as the statistics summary, compare it to
+ * detect edits. Dives are only edited from the UI thread. */
+static unsigned int dive_data_generation;
+
 void invalidate_dive_cache(struct dive *dive)
 {
 	memset(dive->git_id, 0, 20);
+	++dive_data_generation;
+}
+
+unsigned int get_dive_data_generation(void)
+{
+	return dive_data_generation;
 }
 
 bool dive_cache_is_valid(const struct dive *dive)
@@ -7,6 +7,9 @@
 #include "qthelper.h"
 #include "selection.h"
 #include "subsurface-qt/divelistnotifier.h"
+#include <QFutureWatcher>
+#include <QTimer>
+#include <QtConcurrent>
 #if !defined(SUBSURFACE_MOBILE) && !defined(SUBSURFACE_DOWNLOADER)
 #include "desktop-widgets/mapwidget.h"
 #include "desktop-widgets/mainwindow.h"
@@ -57,12 +60,14 @@ ShownChange DiveFilter::update(const QVector<dive *> &dives) const
 	ShownChange res;
 	bool doDS = diveSiteMode();
 	bool doFullText = filterData.fullText.doit();
+	FullTextWords fullTextWords = doFullText ? fulltext_find_words(filterData.fullText, filterData.fulltextStringMode)
+						 : FullTextWords();
 	std::vector<dive *> selection = getDiveSelection();
 	std::vector<dive *> removeFromSelection;
 	for (dive *d: dives) {
 		// There are three modes: divesite, fulltext, normal
 		bool newStatus = doDS        ? dive_sites.contains(d->dive_site) :
-				 doFullText  ? fulltext_dive_matches(d, filterData.fullText, filterData.fulltextStringMode) && showDive(d) :
+				 doFullText  ? fulltext_dive_matches(d, fullTextWords) && showDive(d) :
 					       showDive(d);
 		updateDiveStatus(d, newStatus, res, removeFromSelection);
 	}
@@ -75,6 +80,8 @@ void DiveFilter::reset()
 {
 	int i;
 	dive *d;
+	cancelJob();
+	hasPendingChange = false;
 	shown_dives = divelog.dives->nr;
 	for_each_dive(i, d)
 		d->hidden_by_filter = false;
@@ -83,6 +90,13 @@ void DiveFilter::reset()
 
 ShownChange DiveFilter::updateAll() const
 {
+	if (hasPendingChange) {
+		hasPendingChange = false;
+		return std::move(pendingChange);
+	}
+	// A synchronous update supersedes a running job
+	cancelJob();
+
 	ShownChange res;
 	int i;
 	dive *d;
@@ -96,21 +110,37 @@ ShownChange DiveFilter::updateAll() const
 		}
 	} else if (filterData.fullText.doit()) {
 		FullTextResult ft = fulltext_find_dives(filterData.fullText, filterData.fulltextStringMode);
+		std::vector<unsigned char> show = showAllDives();
 		for_each_dive(i, d) {
-			bool newStatus = ft.dive_matches(d) && showDive(d);
+			bool newStatus = show[i] && ft.dive_matches(d);
 			updateDiveStatus(d, newStatus, res, removeFromSelection);
 		}
 	} else {
-		for_each_dive(i, d) {
-			bool newStatus = showDive(d);
-			updateDiveStatus(d, newStatus, res, removeFromSelection);
-		}
+		std::vector<unsigned char> show = showAllDives();
+		for_each_dive(i, d)
+			updateDiveStatus(d, show[i], res, removeFromSelection);
 	}
 	updateSelection(selection, std::vector<dive *>(), removeFromSelection);
 	res.currentChanged = setSelectionKeepCurrent(selection);
 	return res;
 }
 
+bool DiveFilter::dependsOn(const DiveField &field) const
+{
+	// The invalid flag is always taken into account
+	int fields = DiveField::INVALID;
+	if (diveSiteMode()) {
+		fields |= DiveField::DIVESITE;
+	} else {
+		if (filterData.fullText.doit())
+			fields |= DiveField::NOTES | DiveField::DIVEGUIDE | DiveField::BUDDY |
+				  DiveField::SUIT | DiveField::TAGS | DiveField::DIVESITE;
+		for (const filter_constraint &c: filterData.constraints)
+			fields |= filter_constraint_dive_fields(c.type);
+	}
+	return (field.flags() & fields) != 0;
+}
+
 DiveFilter *DiveFilter::instance()
 {
 	static DiveFilter self;
@@ -119,8 +149,75 @@ DiveFilter *DiveFilter::instance()
 
 DiveFilter::DiveFilter() :
 	shown_dives(0),
+	summary(std::make_shared<DiveSummaryTable>()),
 	diveSiteRefCount(0)
 {
+	// Added, removed and reordered dives are detected by the summary table itself.
+	// Here, listen to changes of the dives' data.
+	auto updateDives = [this](const QVector<dive *> &dives) { writableSummary().updateDives(dives); };
+	auto updateDive = [this](dive *d) { writableSummary().updateDive(d); };
+	QObject::connect(&diveListNotifier, &DiveListNotifier::dataReset, [this]() { invalidateSummary(); });
+	QObject::connect(&diveListNotifier, &DiveListNotifier::diveComputerEdited, [this]() { invalidateSummary(); });
+	QObject::connect(&diveListNotifier, &DiveListNotifier::divesChanged, updateDives);
+	QObject::connect(&diveListNotifier, &DiveListNotifier::divesTimeChanged, [updateDives](timestamp_t, const QVector<dive *> &dives) { updateDives(dives); });
+	QObject::connect(&diveListNotifier, &DiveListNotifier::divesMovedBetweenTrips, [updateDives](dive_trip *, dive_trip *, bool, bool, const QVector<dive *> &dives) { updateDives(dives); });
+	QObject::connect(&diveListNotifier, &DiveListNotifier::cylindersReset, updateDives);
+	QObject::connect(&diveListNotifier, &DiveListNotifier::cylinderAdded, updateDive);
+	QObject::connect(&diveListNotifier, &DiveListNotifier::cylinderRemoved, updateDive);
+	QObject::connect(&diveListNotifier, &DiveListNotifier::cylinderEdited, updateDive);
+	QObject::connect(&diveListNotifier, &DiveListNotifier::weightsystemsReset, updateDives);
+	QObject::connect(&diveListNotifier, &DiveListNotifier::weightAdded, updateDive);
+	QObject::connect(&diveListNotifier, &DiveListNotifier::weightRemoved, updateDive);
+	QObject::connect(&diveListNotifier, &DiveListNotifier::weightEdited, updateDive);
+	QObject::connect(&diveListNotifier, &DiveListNotifier::eventsChanged, updateDive);
+	QObject::connect(&diveListNotifier, &DiveListNotifier::diveSiteChanged, [this](dive_site *ds) { writableSummary().updateDiveSite(ds); });
+	QObject::connect(&diveListNotifier, &DiveListNotifier::tripChanged, [this](dive_trip *trip) { writableSummary().updateTrip(trip); });
+
+	// A running filter job works on a snapshot of the dive table. If the dives change, start over.
+	auto restart = [this]() { if (job) startJob(); };
+	QObject::connect(&diveListNotifier, &DiveListNotifier::dataReset, restart);
+	QObject::connect(&diveListNotifier, &DiveListNotifier::divesAdded, restart);
+	QObject::connect(&diveListNotifier, &DiveListNotifier::divesDeleted, restart);
+	QObject::connect(&diveListNotifier, &DiveListNotifier::divesBulkChanged, restart);
+	QObject::connect(&diveListNotifier, &DiveListNotifier::divesChanged, restart);
+	QObject::connect(&diveListNotifier, &DiveListNotifier::divesTimeChanged, restart);
+	QObject::connect(&diveListNotifier, &DiveListNotifier::divesMovedBetweenTrips, restart);
+	QObject::connect(&diveListNotifier, &DiveListNotifier::cylindersReset, restart);
+	QObject::connect(&diveListNotifier, &DiveListNotifier::cylinderAdded, restart);
+	QObject::connect(&diveListNotifier, &DiveListNotifier::cylinderRemoved, restart);
+	QObject::connect(&diveListNotifier, &DiveListNotifier::cylinderEdited, restart);
+	QObject::connect(&diveListNotifier, &DiveListNotifier::weightsystemsReset, restart);
+	QObject::connect(&diveListNotifier, &DiveListNotifier::weightAdded, restart);
+	QObject::connect(&diveListNotifier, &DiveListNotifier::weightRemoved, restart);
+	QObject::connect(&diveListNotifier, &DiveListNotifier::weightEdited, restart);
+	QObject::connect(&diveListNotifier, &DiveListNotifier::diveSiteChanged, restart);
+	QObject::connect(&diveListNotifier, &DiveListNotifier::tripChanged, restart);
+}
+
+const DiveSummaryTable &DiveFilter::currentSummary() const
+{
+	if (!summary->upToDate()) {
+		// Don't rebuild a table that a running job reads
+		if (summary.use_count() > 1)
+			summary = std::make_shared<DiveSummaryTable>();
+		summary->ensureUpToDate();
+	}
+	return *summary;
+}
+
+DiveSummaryTable &DiveFilter::writableSummary() const
+{
+	if (summary.use_count() > 1)
+		summary = std::make_shared<DiveSummaryTable>(*summary);
+	return *summary;
+}
+
+void DiveFilter::invalidateSummary() const
+{
+	if (summary.use_count() > 1)
+		summary = std::make_shared<DiveSummaryTable>();
+	else
+		summary->invalidate();
 }
 
 void DiveFilter::diveRemoved(const dive *d) const
@@ -141,6 +238,53 @@ bool DiveFilter::showDive(const struct dive *d) const
 			   [d] (const filter_constraint &c) { return filter_constraint_match_dive(c, d); });
 }
 
+// Evaluate the constraints on numerical values column-wise on a summary table.
+// The constraints that have to be tested on the dives themselves are returned in perDive.
+// The result is indexed like the rows of the summary table. This doesn't access the
+// dives and can therefore be run on a worker thread.
+static std::vector<unsigned char> matchSummary(const DiveSummaryTable &summary, const FilterData &data, bool showInvalid,
+					       std::vector<const filter_constraint *> &perDive)
+{
+	int nr = summary.size();
+	std::vector<unsigned char> res(nr, 1);
+
+	if (!showInvalid) {
+		for (int i = 0; i < nr; ++i)
+			res[i] = !summary.invalid[i];
+	}
+
+	perDive.clear();
+	if (!data.validFilter())
+		return res;
+
+	for (const filter_constraint &c: data.constraints) {
+		if (!filter_constraint_match_summary(c, summary, res))
+			perDive.push_back(&c);
+	}
+	return res;
+}
+
+// Same as showDive(), but for all dives at once. The remaining
+// constraints are tested only on the dives that passed the columnar constraints.
+std::vector<unsigned char> DiveFilter::showAllDives() const
+{
+	const DiveSummaryTable &table = currentSummary();
+	std::vector<const filter_constraint *> perDive;
+	std::vector<unsigned char> res = matchSummary(table, filterData, prefs.display_invalid_dives, perDive);
+	if (perDive.empty())
+		return res;
+
+	int nr = (int)res.size();
+	for (int i = 0; i < nr; ++i) {
+		if (!res[i])
+			continue;
+		const dive *d = table.dives[i];
+		res[i] = std::all_of(perDive.begin(), perDive.end(),
+				     [d] (const filter_constraint *c) { return filter_constraint_match_dive(*c, d); });
+	}
+	return res;
+}
+
 #if !defined(SUBSURFACE_MOBILE) && !defined(SUBSURFACE_DOWNLOADER)
 void DiveFilter::startFilterDiveSites(QVector<dive_site *> ds)
 {
@@ -218,7 +362,111 @@ int DiveFilter::shownDives() const
 void DiveFilter::setFilter(const FilterData &data)
 {
 	filterData = data;
+
+	// In dive site mode, the filter data is not used.
+	if (diveSiteMode()) {
+		emit diveListNotifier.filterReset();
+		return;
+	}
+	startJob();
+}
+
+void DiveFilter::startJob()
+{
+	cancelJob();
+	hasPendingChange = false;
+	pendingChange = ShownChange();
+
+	auto run = std::make_shared<FilterJob>();
+	run->data = filterData;
+	currentSummary();
+	run->summary = summary;
+	run->showInvalid = prefs.display_invalid_dives;
+	job = run;
+
+	auto watcher = new QFutureWatcher<void>;
+	QObject::connect(watcher, &QFutureWatcher<void>::finished, watcher, [this, watcher, run]() {
+		watcher->deleteLater();
+		jobStep(run);
+	});
+	watcher->setFuture(QtConcurrent::run([run]() { run->match(); }));
+}
+
+void DiveFilter::FilterJob::match()
+{
+	show = matchSummary(*summary, data, showInvalid, perDive);
+	if (data.fullText.doit()) {
+		FullTextResult fullText = fulltext_find_dives(data.fullText, data.fulltextStringMode);
+		for (size_t i = 0; i < show.size(); ++i) {
+			if (show[i])
+				show[i] = fullText.dive_matches(summary->dives[i]);
+		}
+	}
+}
+
+// A job that is still running on the worker thread keeps its data alive.
+// Its result will be ignored.
+void DiveFilter::cancelJob() const
+{
+	job.reset();
+}
+
+// Test the next chunk of dives with the constraints that need the dive data in parallel.
+// Then return to the event loop.
+void DiveFilter::jobStep(std::shared_ptr<FilterJob> run)
+{
+	if (run != job)
+		return; // Cancelled or restarted
+
+	const size_t chunkSize = 8192;
+	const size_t blockSize = 512;
+	size_t size = run->show.size();
+	if (run->perDive.empty())
+		run->next = size;
+	size_t end = std::min(run->next + chunkSize, size);
+	std::vector<size_t> blocks;
+	for (size_t from = run->next; from < end; from += blockSize)
+		blocks.push_back(from);
+
+	FilterJob *j = run.get();
+	QtConcurrent::blockingMap(blocks, [j, end](size_t from) {
+		size_t to = std::min(from + blockSize, end);
+		for (size_t i = from; i < to; ++i) {
+			if (!j->show[i])
+				continue;
+			const dive *d = j->summary->dives[i];
+			j->show[i] = std::all_of(j->perDive.begin(), j->perDive.end(),
+						 [d] (const filter_constraint *c) { return filter_constraint_match_dive(*c, d); });
+		}
+	});
+	run->next = end;
+
+	if (run->next < size)
+		QTimer::singleShot(0, [this, run]() { jobStep(run); });
+	else
+		finishJob();
+}
+
+// Apply the result of the job and inform the models, which pick up the changes via updateAll().
+void DiveFilter::finishJob()
+{
+	std::shared_ptr<FilterJob> run = std::move(job);
+	ShownChange res;
+	std::vector<dive *> selection = getDiveSelection();
+	std::vector<dive *> removeFromSelection;
+	for (size_t i = 0; i < run->show.size(); ++i)
+		updateDiveStatus(run->summary->dives[i], run->show[i], res, removeFromSelection);
+	updateSelection(selection, std::vector<dive *>(), removeFromSelection);
+	res.currentChanged = setSelectionKeepCurrent(selection);
+
+	pendingChange = std::move(res);
+	hasPendingChange = true;
 	emit diveListNotifier.filterReset();
+
+	// The change is only valid for the listeners of the signal above.
+	// Anybody calling updateAll() later has to get a fresh result.
+	hasPendingChange = false;
+	pendingChange = ShownChange();
 }
 
 std::vector<dive *> DiveFilter::visibleDives() const
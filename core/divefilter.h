@@ -5,6 +5,8 @@
 
 #include "fulltext.h"
 #include "filterconstraint.h"
+#include "divesummarytable.h"
+#include <memory>
 #include <vector>
 #include <QVector>
 #include <QStringList>
@@ -12,12 +14,13 @@
 struct dive;
 struct dive_trip;
 struct dive_site;
+struct DiveField;
 
 // Structure describing changes of shown status upon applying the filter
 struct ShownChange {
 	QVector<dive *> newShown;
 	QVector<dive *> newHidden;
-	bool currentChanged;
+	bool currentChanged = false;
 };
 
 struct FilterData {
@@ -50,13 +53,24 @@ public:
 	void setFilterDiveSite(QVector<dive_site *> ds);
 	void stopFilterDiveSites();
 #endif
-	void setFilter(const FilterData &data);
+	void setFilter(const FilterData &data); // Applies the filter asynchronously, emits filterReset() when done
 	ShownChange update(const QVector<dive *> &dives) const; // Update filter status of given dives and return dives whose status changed
-	ShownChange updateAll() const; // Update filter status of all dives and return dives whose status changed
+	ShownChange updateAll() const; // Update filter status of all dives and return dives whose status changed.
+				       // If an asynchronous filter run finished, returns its result.
+	bool dependsOn(const DiveField &field) const; // Might a change of these fields change the filter status of a dive?
 	void diveRemoved(const dive *dive) const; // Dive was removed; update count accordingly
 private:
 	DiveFilter();
 	bool showDive(const struct dive *d) const; // Should that dive be shown?
+	std::vector<unsigned char> showAllDives() const; // Should the dives be shown? Indexed like the dive table.
+	const DiveSummaryTable &currentSummary() const; // Rebuilds the summary table if needed
+	DiveSummaryTable &writableSummary() const; // Copies the summary table if it is shared with a running job
+	void invalidateSummary() const;
+	struct FilterJob;
+	void startJob();
+	void cancelJob() const;
+	void jobStep(std::shared_ptr<FilterJob> run);
+	void finishJob();
 	bool setFilterStatus(struct dive *d, bool shown,
 			     std::vector<dive *> &removeFromSelection) const;
 	void updateDiveStatus(dive *d, bool newStatus, ShownChange &change,
@@ -65,6 +79,28 @@ private:
 	QVector<dive_site *> dive_sites;
 	FilterData filterData;
 	mutable int shown_dives;
+	// Values of all dives for filtering, kept up to date via the DiveListNotifier. Shared with
+	// a running filter job. Therefore, it is copied before being modified while a job runs.
+	mutable std::shared_ptr<DiveSummaryTable> summary;
+
+	// State of the asynchronous filter run started by setFilter(). First, the constraints that can be
+	// evaluated on the summary table and the fulltext search are run on a worker thread. The worker
+	// only accesses a snapshot of the summary table and the (locked) fulltext index, never the dives.
+	// The remaining constraints have to access the dives, which may be modified by the UI thread.
+	// Therefore, they are tested on the UI thread in chunks on the thread pool. Between chunks,
+	// control returns to the event loop. Any change to the filter or the dives restarts the job.
+	struct FilterJob {
+		FilterData data; // Copy of the filter data
+		std::shared_ptr<const DiveSummaryTable> summary; // Snapshot of the summary table
+		bool showInvalid = false;
+		std::vector<unsigned char> show; // Result, indexed like the rows of the summary table
+		std::vector<const filter_constraint *> perDive; // Constraints (into data) that have to be tested per dive
+		size_t next = 0; // First dive of the next chunk of per dive tests
+		void match(); // Run on the worker thread
+	};
+	mutable std::shared_ptr<FilterJob> job; // Null if no job is running
+	mutable bool hasPendingChange = false;
+	mutable ShownChange pendingChange; // Result of a finished job, to be picked up by updateAll()
 
 	// We use ref-counting for the dive site mode. The reason is that when switching
 	// between two tabs that both need dive site mode, the following course of
@@ -180,7 +180,7 @@ static int calculate_otu(const struct dive *dive)
    po2 for each segment. Empirical testing showed that, for large changes in depth, the cns calculation for the mean po2
    value is extremely close, if not identical to the additive calculations for 0.1 bar increments in po2 from the start
    to the end of the segment, assuming a constant rate of change in po2 (i.e. depth) with time. */
-static double calculate_cns_dive(const struct dive *dive)
+double calculate_cns_dive(const struct dive *dive)
 {
 	int n;
 	const struct divecomputer *dc = &dive->dc;
@@ -205,12 +205,21 @@ static double calculate_cns_dive(const struct dive *dive)
 	return cns;
 }
 
+/* The CNS of a single dive at the given index of the dive table. If a cache of
+ * single-dive values is passed in, use that instead of walking the samples.
+ * Negative entries of the cache were not calculated. */
+static double single_dive_cns(const struct dive *dive, int idx, const double *cns_cache)
+{
+	return cns_cache && idx >= 0 && cns_cache[idx] >= 0.0 ? cns_cache[idx] : calculate_cns_dive(dive);
+}
+
 /* this only gets called if dive->maxcns == 0 which means we know that
  * none of the divecomputers has tracked any CNS for us
- * so we calculated it "by hand" */
-static int calculate_cns(struct dive *dive)
+ * so we calculated it "by hand".
+ * divenr is the index of the dive in the dive table or -1 if not in the table. */
+static int calculate_cns_cached(struct dive *dive, int divenr, const double *cns_cache)
 {
-	int i, divenr;
+	int i;
 	double cns = 0.0;
 	timestamp_t last_starttime, last_endtime = 0;
 
@@ -218,7 +227,6 @@ static int calculate_cns(struct dive *dive)
 	if (dive->cns)
 		return dive->cns;
 
-	divenr = get_divenr(dive);
 	i = divenr >= 0 ? divenr : divelog.dives->nr;
 #if DECO_CALC_DEBUG & 2
 	if (i >= 0 && i < dive_table.nr)
@@ -309,7 +317,7 @@ static int calculate_cns(struct dive *dive)
 		printf("CNS after surface interval: %f\n", cns);
 #endif
 
-		cns += calculate_cns_dive(pdive);
+		cns += single_dive_cns(pdive, i, cns_cache);
 #if DECO_CALC_DEBUG & 2
 		printf("CNS after previous dive: %f\n", cns);
 #endif
@@ -325,7 +333,7 @@ static int calculate_cns(struct dive *dive)
 	printf("CNS after last surface interval: %f\n", cns);
 #endif
 
-	cns += calculate_cns_dive(dive);
+	cns += single_dive_cns(dive, divenr, cns_cache);
 #if DECO_CALC_DEBUG & 2
 	printf("CNS after dive: %f\n", cns);
 #endif
@@ -334,6 +342,11 @@ static int calculate_cns(struct dive *dive)
 	dive->cns = lrint(cns);
 	return dive->cns;
 }
+
+static int calculate_cns(struct dive *dive)
+{
+	return calculate_cns_cached(dive, get_divenr(dive), NULL);
+}
 /*
  * Return air usage (in liters).
  */
@@ -608,16 +621,37 @@ int init_decompression(struct deco_state *ds, const struct dive *dive, bool in_p
 	return surface_time;
 }
 
+/* SAC and OTU only depend on the dive itself */
+void update_sac_and_otu(struct dive *dive)
+{
+	dive->sac = calculate_sac(dive);
+	dive->otu = calculate_otu(dive);
+}
+
 void update_cylinder_related_info(struct dive *dive)
 {
 	if (dive != NULL) {
-		dive->sac = calculate_sac(dive);
-		dive->otu = calculate_otu(dive);
+		update_sac_and_otu(dive);
 		if (dive->maxcns == 0)
 			dive->maxcns = calculate_cns(dive);
 	}
 }
 
+/* Add up the CNS carried over from previous dives for all dives of the dive
+ * table. dive_cns is indexed like the dive table and contains the CNS of the
+ * single dives, i.e. the values of calculate_cns_dive(), or a negative value
+ * for dives that weren't calculated. */
+void update_dive_chained_info(const double *dive_cns)
+{
+	int i;
+	struct dive *dive;
+
+	for_each_dive(i, dive) {
+		if (dive->maxcns == 0)
+			dive->maxcns = calculate_cns_cached(dive, i, dive_cns);
+	}
+}
+
 /* Like strcmp(), but don't crash on null-pointers */
 static int safe_strcmp(const char *s1, const char *s2)
 {
@@ -688,23 +722,144 @@ int comp_dives(const struct dive *a, const struct dive *b)
 	return 0; /* this should not happen for a != b */
 }
 
-/* Dive table functions */
+/* Incremented whenever dives are added to or removed from the global dive
+ * table or the table is reordered. Caches of the dive table compare it to
+ * detect such changes. Comparing the dive pointers would not be sufficient,
+ * since a new dive may be allocated at the address of a deleted dive.
+ * Only the global dive table, which is only modified from the UI thread,
+ * is tracked. */
+static unsigned int dive_table_generation;
+
+static void dive_table_changed(const struct dive_table *table)
+{
+	if (table == divelog.dives)
+		++dive_table_generation;
+}
+
+unsigned int get_dive_table_generation()
+{
+	return dive_table_generation;
+}
+
+/* Dive table functions. The functions that modify the table
+ * are not generated, because they have to update the generation. */
 static MAKE_GROW_TABLE(dive_table, struct dive *, dives)
 MAKE_GET_INSERTION_INDEX(dive_table, struct dive *, dives, dive_less_than)
-MAKE_ADD_TO(dive_table, struct dive *, dives)
-static MAKE_REMOVE_FROM(dive_table, dives)
 static MAKE_GET_IDX(dive_table, struct dive *, dives)
-MAKE_SORT(dive_table, struct dive *, dives, comp_dives)
+
+void add_to_dive_table(struct dive_table *table, int idx, struct dive *dive)
+{
+	int i;
+	grow_dive_table(table);
+	table->nr++;
+
+	for (i = idx; i < table->nr; i++) {
+		struct dive *tmp = table->dives[i];
+		table->dives[i] = dive;
+		dive = tmp;
+	}
+	dive_table_changed(table);
+}
+
+static void remove_from_dive_table(struct dive_table *table, int idx)
+{
+	int i;
+	for (i = idx; i < table->nr - 1; i++)
+		table->dives[i] = table->dives[i + 1];
+	table->dives[--table->nr] = NULL;
+	dive_table_changed(table);
+}
+
+static int sortfn_dive_table(const void *_a, const void *_b)
+{
+	const struct dive *a = *(const struct dive **)_a;
+	const struct dive *b = *(const struct dive **)_b;
+	return comp_dives(a, b);
+}
+
+void sort_dive_table(struct dive_table *table)
+{
+	qsort(table->dives, table->nr, sizeof(struct dive *), sortfn_dive_table);
+	dive_table_changed(table);
+}
+
+void clear_dive_table(struct dive_table *table)
+{
+	for (int i = 0; i < table->nr; i++)
+		free_dive(table->dives[i]);
+	table->nr = 0;
+	dive_table_changed(table);
+}
+
 MAKE_REMOVE(dive_table, struct dive *, dive)
-MAKE_CLEAR_TABLE(dive_table, dives, dive)
 MAKE_MOVE_TABLE(dive_table, dives)
 
 void insert_dive(struct dive_table *table, struct dive *d)
 {
-	int idx = dive_table_get_insertion_index(table, d);
+	/* The table is sorted: dives that come after the last dive, as is
+	 * the case when dives are added in order, are simply appended. */
+	int idx = table->nr > 0 && dive_less_than(d, table->dives[table->nr - 1]) ?
+		dive_table_get_insertion_index(table, d) : table->nr;
 	add_to_dive_table(table, idx, d);
 }
 
+/* Insert a sorted array of dives into a table. Same as calling insert_dive()
+ * for each dive, but merges both in one pass from the back of the table. */
+void insert_dives(struct dive_table *table, struct dive **dives, int nr)
+{
+	int i, j, k;
+
+	if (nr <= 0)
+		return;
+	if (table->nr + nr > table->allocated) {
+		table->allocated = table->nr + nr;
+		table->dives = realloc(table->dives, table->allocated * sizeof(struct dive *));
+		if (!table->dives)
+			exit(1);
+	}
+	i = table->nr - 1;
+	j = nr - 1;
+	k = table->nr + nr - 1;
+	/* On equal dives, the new dive goes after the old one, like in insert_dive() */
+	while (j >= 0) {
+		if (i >= 0 && dive_less_than(dives[j], table->dives[i]))
+			table->dives[k--] = table->dives[i--];
+		else
+			table->dives[k--] = dives[j--];
+	}
+	table->nr += nr;
+	dive_table_changed(table);
+}
+
+static int comp_dive_pointers(const void *a, const void *b)
+{
+	const struct dive *d1 = *(const struct dive * const *)a;
+	const struct dive *d2 = *(const struct dive * const *)b;
+	return d1 < d2 ? -1 : d1 == d2 ? 0 : 1;
+}
+
+/* Remove dives from a table. Same as calling remove_dive() for each dive,
+ * but in one pass over the table. Dives that aren't in the table are ignored. */
+void remove_dives(struct dive_table *table, struct dive **dives, int nr)
+{
+	struct dive **sorted;
+	int i, j;
+
+	if (nr <= 0 || table->nr <= 0)
+		return;
+	sorted = malloc(nr * sizeof(struct dive *));
+	memcpy(sorted, dives, nr * sizeof(struct dive *));
+	qsort(sorted, nr, sizeof(struct dive *), comp_dive_pointers);
+	for (i = j = 0; i < table->nr; i++) {
+		if (!bsearch(&table->dives[i], sorted, nr, sizeof(struct dive *), comp_dive_pointers))
+			table->dives[j++] = table->dives[i];
+	}
+	memset(table->dives + j, 0, (table->nr - j) * sizeof(struct dive *));
+	table->nr = j;
+	free(sorted);
+	dive_table_changed(table);
+}
+
 /*
  * Walk the dives from the oldest dive in the given table, and see if we
  * can autogroup them. But only do this when the user selected autogrouping.
@@ -767,6 +922,20 @@ struct dive *unregister_dive(int idx)
 	return dive;
 }
 
+/* Same as calling unregister_dive() on each of the dives, but in
+ * one pass over the global dive table. */
+void unregister_dives(struct dive **dives, int nr)
+{
+	for (int i = 0; i < nr; i++) {
+		struct dive *dive = dives[i];
+		fulltext_unregister(dive);
+		if (dive->selected)
+			amount_selected--;
+		dive->selected = false;
+	}
+	remove_dives(divelog.dives, dives, nr);
+}
+
 /* this implements the mechanics of removing the dive from the global
  * dive table and the trip, but doesn't deal with updating dive trips, etc */
 void delete_single_dive(int idx)
@@ -787,6 +956,10 @@ void process_loaded_dives()
 	/* Autogroup dives if desired by user. */
 	autogroup_dives(divelog.dives, divelog.trips);
 
+	/* Calculate the CNS of the dives that were loaded without one, so
+	 * that the dive list and the statistics don't have to do it on the fly. */
+	calculate_derived_dive_data(true);
+
 	fulltext_populate();
 
 	/* Inform frontend of reset data. This should reset all the models. */
@@ -902,13 +1075,13 @@ static bool merge_dive_tables(struct dive_table *dives_from, struct dive_table *
 	 *  - New dive "connects" two old dives (turn three into one).
 	 *  - New dive can not be merged into adjacent but some further dive.
 	 */
+	if (delete_from)
+		remove_dives(delete_from, dives_from->dives, dives_from->nr);
+
 	j = 0; /* Index in dives_to */
 	for (i = 0; i < dives_from->nr; i++) {
 		struct dive *dive_to_add = dives_from->dives[i];
 
-		if (delete_from)
-			remove_dive(dive_to_add, delete_from);
-
 		/* Find insertion point. */
 		while (j < dives_to->nr && dive_less_than(dives_to->dives[j], dive_to_add))
 			j++;
@@ -960,7 +1133,7 @@ static bool merge_dive_tables(struct dive_table *dives_from, struct dive_table *
  * precedence */
 void add_imported_dives(struct divelog *import_log, int flags)
 {
-	int i, idx;
+	int i;
 	struct dive_table dives_to_add = empty_dive_table;
 	struct dive_table dives_to_remove = empty_dive_table;
 	struct trip_table trips_to_add = empty_trip_table;
@@ -986,16 +1159,20 @@ void add_imported_dives(struct divelog *import_log, int flags)
 		add_dive_to_dive_site(d, site);
 	}
 
-	/* Remove old dives */
+	/* Remove old dives. Like delete_single_dive(), but remove
+	 * them from the dive table in one go. */
 	for (i = 0; i < dives_to_remove.nr; i++) {
-		idx = get_divenr(dives_to_remove.dives[i]);
-		delete_single_dive(idx);
+		struct dive *d = dives_to_remove.dives[i];
+		remove_dive_from_trip(d, divelog.trips);
+		unregister_dive_from_dive_site(d);
 	}
+	remove_dives(divelog.dives, dives_to_remove.dives, dives_to_remove.nr);
+	for (i = 0; i < dives_to_remove.nr; i++)
+		free_dive(dives_to_remove.dives[i]);
 	dives_to_remove.nr = 0;
 
 	/* Add new dives */
-	for (i = 0; i < dives_to_add.nr; i++)
-		insert_dive(divelog.dives, dives_to_add.dives[i]);
+	insert_dives(divelog.dives, dives_to_add.dives, dives_to_add.nr);
 	dives_to_add.nr = 0;
 
 	/* Add new trips */
@@ -1020,6 +1197,8 @@ void add_imported_dives(struct divelog *import_log, int flags)
 
 	free_device_table(devices_to_add);
 
+	calculate_derived_dive_data(true);
+
 	/* Inform frontend of reset data. This should reset all the models. */
 	emit_reset_signal();
 }
@@ -1191,9 +1370,8 @@ void process_imported_dives(struct divelog *import_log, int flags,
 			/* Add dive to list of dives to-be-added. */
 			insert_dive(dives_to_add, d);
 			sequence_changed |= !dive_is_after_last(d);
-
-			remove_dive(d, import_log->dives);
 		}
+		remove_dives(import_log->dives, trip_import->dives.dives, trip_import->dives.nr);
 
 		/* Then, add trip to list of trips to add */
 		insert_trip(trip_import, trips_to_add);
@@ -26,6 +26,9 @@ static const struct dive_table empty_dive_table = { 0, 0, (struct dive **)0 };
 
 extern void sort_dive_table(struct dive_table *table);
 extern void update_cylinder_related_info(struct dive *);
+extern void update_sac_and_otu(struct dive *);
+extern double calculate_cns_dive(const struct dive *dive);
+extern void update_dive_chained_info(const double *dive_cns);
 extern int init_decompression(struct deco_state *ds, const struct dive *dive, bool in_planner);
 
 /* divelist core logic functions */
@@ -44,6 +47,8 @@ extern void process_imported_dives(struct divelog *import_log, int flags,
 extern int dive_table_get_insertion_index(struct dive_table *table, struct dive *dive);
 extern void add_to_dive_table(struct dive_table *table, int idx, struct dive *dive);
 extern void insert_dive(struct dive_table *table, struct dive *d);
+extern void insert_dives(struct dive_table *table, struct dive **dives, int nr);
+extern void remove_dives(struct dive_table *table, struct dive **dives, int nr);
 extern void get_dive_gas(const struct dive *dive, int *o2_p, int *he_p, int *o2low_p);
 extern int get_divenr(const struct dive *dive);
 extern int remove_dive(const struct dive *dive, struct dive_table *table);
@@ -60,8 +65,10 @@ void report_datafile_version(int version);
 int get_dive_id_closest_to(timestamp_t when);
 void clear_dive_file_data();
 void clear_dive_table(struct dive_table *table);
+unsigned int get_dive_table_generation();
 void move_dive_table(struct dive_table *src, struct dive_table *dst);
 struct dive *unregister_dive(int idx);
+void unregister_dives(struct dive **dives, int nr);
 extern void delete_single_dive(int idx);
 extern bool has_dive(unsigned int deviceid, unsigned int diveid);
 
@@ -63,6 +63,24 @@ struct divelog &divelog::operator=(divelog &&log)
 	return *this;
 }
 
+void divelog::append(divelog &&log)
+{
+	for (int i = 0; i < log.dives->nr; ++i)
+		add_to_dive_table(dives, dives->nr, log.dives->dives[i]);
+	log.dives->nr = 0;
+	for (int i = 0; i < log.trips->nr; ++i)
+		insert_trip(log.trips->trips[i], trips);
+	log.trips->nr = 0;
+	for (int i = 0; i < log.sites->nr; ++i)
+		add_dive_site_to_table(log.sites->dive_sites[i], sites);
+	log.sites->nr = 0;
+	for (const device &dev: log.devices->devices)
+		add_to_device_table(devices, &dev);
+	clear_device_table(log.devices);
+	filter_presets->insert(filter_presets->end(), log.filter_presets->begin(), log.filter_presets->end());
+	log.filter_presets->clear();
+}
+
 void divelog::clear()
 {
 	while (dives->nr)
@@ -24,6 +24,7 @@ struct divelog {
 	~divelog();
 	divelog(divelog &&log); // move constructor (argument is consumed).
 	divelog &operator=(divelog &&log); // move assignment (argument is consumed).
+	void append(divelog &&log); // add the contents of another log (argument is consumed).
 #endif
 };
 
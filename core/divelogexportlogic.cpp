@@ -75,11 +75,13 @@ static void exportHTMLstatistics(const QString filename, struct htmlExportSettin
 	QFile file(filename);
 	file.open(QIODevice::WriteOnly | QIODevice::Text);
 	QTextStream out(&file);
-	stats_summary_auto_free stats;
+	stats_summary_auto_free selected_stats;
+	if (hes.selectedOnly)
+		calculate_stats_summary(&selected_stats, true);
+	const stats_summary &stats = hes.selectedOnly ? selected_stats : *get_stats_summary();
 
 	stats_t total_stats;
 
-	calculate_stats_summary(&stats, hes.selectedOnly);
 	total_stats.selection_size = 0;
 	total_stats.total_time.seconds = 0;
 
@@ -0,0 +1,196 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include "divesummarytable.h"
+#include "dive.h"
+#include "divelist.h"
+#include "divelog.h"
+#include "divesite.h"
+#include "gas.h"
+#include "subsurface-time.h"
+#include "tag.h"
+#include "trip.h"
+#include <algorithm>
+#include <climits>
+
+DiveSummaryTable::DiveSummaryTable() : tagWords(1), dirty(true), generation(0)
+{
+}
+
+int DiveSummaryTable::size() const
+{
+	return (int)dives.size();
+}
+
+void DiveSummaryTable::invalidate()
+{
+	dirty = true;
+}
+
+void DiveSummaryTable::resize(int size)
+{
+	dives.resize(size);
+	when.resize(size);
+	endtime.resize(size);
+	year.resize(size);
+	weekday.resize(size);
+	rating.resize(size);
+	wavesize.resize(size);
+	current.resize(size);
+	visibility.resize(size);
+	surge.resize(size);
+	chill.resize(size);
+	maxdepth.resize(size);
+	duration.resize(size);
+	weight.resize(size);
+	watertemp.resize(size);
+	airtemp.resize(size);
+	density.resize(size);
+	sac.resize(size);
+	divemode.resize(size);
+	o2min.resize(size);
+	o2max.resize(size);
+	hemin.resize(size);
+	hemax.resize(size);
+	site.resize(size);
+	triplocation.resize(size);
+	tags.resize(size * tagWords);
+	logged.resize(size);
+	planned.resize(size);
+	invalid.resize(size);
+}
+
+int DiveSummaryTable::tagId(const QString &name)
+{
+	auto it = tagIds.find(name);
+	if (it != tagIds.end())
+		return *it;
+	tagNames.push_back(name);
+	return *tagIds.insert(name, (int)tagNames.size() - 1);
+}
+
+int DiveSummaryTable::locationId(const QString &name)
+{
+	auto it = locationIds.find(name);
+	if (it != locationIds.end())
+		return *it;
+	locations.push_back(name);
+	return *locationIds.insert(name, (int)locations.size() - 1);
+}
+
+// Returns false if the row couldn't be set because the dive has a new tag
+// that doesn't fit into the tag bitsets. In that case, the table has to be rebuilt.
+bool DiveSummaryTable::setRow(int row, dive *d)
+{
+	uint64_t *tagBits = &tags[row * tagWords];
+	std::fill(tagBits, tagBits + tagWords, 0);
+	for (const tag_entry *tag = d->tag_list; tag; tag = tag->next) {
+		int id = tagId(QString(tag->tag->name).trimmed());
+		if (id >= tagWords * 64)
+			return false;
+		tagBits[id / 64] |= 1ULL << (id % 64);
+	}
+
+	dives[row] = d;
+	when[row] = d->when;
+	endtime[row] = dive_endtime(d);
+	year[row] = utc_year(d->when);
+	weekday[row] = utc_weekday(d->when);
+	rating[row] = d->rating;
+	wavesize[row] = d->wavesize;
+	current[row] = d->current;
+	visibility[row] = d->visibility;
+	surge[row] = d->surge;
+	chill[row] = d->chill;
+	maxdepth[row] = d->maxdepth.mm;
+	duration[row] = d->duration.seconds;
+	weight[row] = total_weight(d);
+	watertemp[row] = d->watertemp.mkelvin;
+	airtemp[row] = d->airtemp.mkelvin;
+	density[row] = d->user_salinity ? d->user_salinity : d->salinity;
+	sac[row] = d->sac;
+	divemode[row] = (int)d->dc.divemode;
+	o2min[row] = hemin[row] = INT_MAX;
+	o2max[row] = hemax[row] = INT_MIN;
+	for (int i = 0; i < d->cylinders.nr; ++i) {
+		struct gasmix mix = get_cylinder(d, i)->gasmix;
+		int o2 = get_gas_component_fraction(mix, O2).permille;
+		int he = get_gas_component_fraction(mix, HE).permille;
+		o2min[row] = std::min(o2min[row], o2);
+		o2max[row] = std::max(o2max[row], o2);
+		hemin[row] = std::min(hemin[row], he);
+		hemax[row] = std::max(hemax[row], he);
+	}
+	site[row] = d->dive_site ? locationId(QString(d->dive_site->name).trimmed()) : -1;
+	triplocation[row] = d->divetrip ? locationId(QString(d->divetrip->location).trimmed()) : -1;
+	logged[row] = has_planned(d, false);
+	planned[row] = has_planned(d, true);
+	invalid[row] = d->invalid;
+	return true;
+}
+
+void DiveSummaryTable::rebuild()
+{
+	int nr = divelog.dives->nr;
+
+	// Collect the tags first, so that the bitsets can be sized accordingly.
+	// Leave some space for tags that are added later.
+	tagNames.clear();
+	tagIds.clear();
+	locations.clear();
+	locationIds.clear();
+	for (int i = 0; i < nr; ++i) {
+		for (const tag_entry *tag = divelog.dives->dives[i]->tag_list; tag; tag = tag->next)
+			tagId(QString(tag->tag->name).trimmed());
+	}
+	tagWords = (int)tagNames.size() / 64 + 1;
+	tags.clear();
+
+	resize(nr);
+	for (int i = 0; i < nr; ++i)
+		setRow(i, divelog.dives->dives[i]);
+	generation = get_dive_table_generation();
+	dirty = false;
+}
+
+bool DiveSummaryTable::upToDate() const
+{
+	// Added, removed or reordered dives are detected by the generation of the dive
+	// table, which is updated by the core when the table is modified. Thus, this
+	// doesn't depend on the order in which the DiveListNotifier signals are delivered.
+	return !dirty && generation == get_dive_table_generation();
+}
+
+void DiveSummaryTable::ensureUpToDate()
+{
+	if (!upToDate())
+		rebuild();
+}
+
+void DiveSummaryTable::updateDive(const dive *d)
+{
+	if (!upToDate())
+		return;
+	// The rows are sorted like the dive table. If the dive isn't found
+	// at its expected position, the table is out of order: rebuild it.
+	auto it = std::lower_bound(dives.begin(), dives.end(), d, &dive_less_than);
+	if (it == dives.end() || *it != d || !setRow(it - dives.begin(), *it))
+		dirty = true;
+}
+
+void DiveSummaryTable::updateDives(const QVector<dive *> &changed)
+{
+	for (const dive *d: changed)
+		updateDive(d);
+}
+
+void DiveSummaryTable::updateDiveSite(const dive_site *ds)
+{
+	for (int i = 0; i < ds->dives.nr; ++i)
+		updateDive(ds->dives.dives[i]);
+}
+
+void DiveSummaryTable::updateTrip(const dive_trip *trip)
+{
+	for (int i = 0; i < trip->dives.nr; ++i)
+		updateDive(trip->dives.dives[i]);
+}
@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: GPL-2.0
+// A columnar copy of the numerical dive data that the filter can test.
+// Keeping these values in contiguous arrays means that filtering all dives
+// doesn't have to chase dive pointers and doesn't have to recalculate derived
+// values such as the total weight. The rows are in the order of the dive table.
+#ifndef DIVE_SUMMARY_TABLE_H
+#define DIVE_SUMMARY_TABLE_H
+
+#include "units.h"
+#include <vector>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+struct dive;
+struct dive_site;
+struct dive_trip;
+
+struct DiveSummaryTable {
+	std::vector<dive *> dives;
+	std::vector<timestamp_t> when;
+	std::vector<timestamp_t> endtime;
+	std::vector<int> year;
+	std::vector<int> weekday;
+	std::vector<int> rating;
+	std::vector<int> wavesize;
+	std::vector<int> current;
+	std::vector<int> visibility;
+	std::vector<int> surge;
+	std::vector<int> chill;
+	std::vector<int> maxdepth;
+	std::vector<int> duration;
+	std::vector<int> weight;
+	std::vector<int> watertemp;
+	std::vector<int> airtemp;
+	std::vector<int> density;
+	std::vector<int> sac;
+	std::vector<int> divemode;
+	std::vector<int> o2min, o2max; // Over all cylinders in permille, INT_MAX and INT_MIN if there are no cylinders
+	std::vector<int> hemin, hemax;
+	std::vector<int> site; // Id of the dive site name, -1 if no dive site
+	std::vector<int> triplocation; // Id of the trip location, -1 if not in a trip
+	std::vector<uint64_t> tags; // Bitset of tag-ids, tagWords words per dive
+	std::vector<unsigned char> logged;
+	std::vector<unsigned char> planned;
+	std::vector<unsigned char> invalid;
+
+	// Tag names and locations are stored as ids into these lists of trimmed strings,
+	// so that string constraints can be tested once per distinct string.
+	std::vector<QString> tagNames;
+	std::vector<QString> locations;
+	int tagWords;
+
+	DiveSummaryTable();
+	int size() const;
+	bool upToDate() const; // False if invalidated or if dives were added, removed or reordered
+	void ensureUpToDate(); // Rebuild if not up to date
+	void invalidate(); // Rebuild on next access
+	void updateDive(const dive *d); // Refresh the row of a changed dive
+	void updateDives(const QVector<dive *> &changed);
+	void updateDiveSite(const dive_site *ds); // Refresh the rows of the dives of a dive site
+	void updateTrip(const dive_trip *trip); // Refresh the rows of the dives of a trip
+private:
+	bool dirty;
+	unsigned int generation; // Generation of the dive table at the last rebuild
+	QHash<QString, int> tagIds;
+	QHash<QString, int> locationIds;
+	void rebuild();
+	void resize(int size);
+	bool setRow(int row, dive *d);
+	int tagId(const QString &name);
+	int locationId(const QString &name);
+};
+
+#endif
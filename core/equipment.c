@@ -17,6 +17,7 @@
 #include "divelist.h"
 #include "divelog.h"
 #include "pref.h"
+#include "qthelper.h"
 #include "subsurface-string.h"
 #include "table.h"
 
@@ -114,12 +115,16 @@ void add_cylinder_description(const cylinder_type_t *type)
 	const char *desc = type->description;
 	if (empty_string(desc))
 		return;
+	lock_import_tables();
 	for (int i = 0; i < tank_info_table.nr; i++) {
-		if (strcmp(tank_info_table.infos[i].name, desc) == 0)
+		if (strcmp(tank_info_table.infos[i].name, desc) == 0) {
+			unlock_import_tables();
 			return;
+		}
 	}
 	add_tank_info_metric(&tank_info_table, desc, type->size.mliter,
 			     type->workingpressure.mbar / 1000);
+	unlock_import_tables();
 }
 
 void add_weightsystem_description(const weightsystem_t *weightsystem)
@@ -130,9 +135,11 @@ void add_weightsystem_description(const weightsystem_t *weightsystem)
 	desc = weightsystem->description;
 	if (!desc)
 		return;
+	lock_import_tables();
 	for (i = 0; i < MAX_WS_INFO && ws_info[i].name != NULL; i++) {
 		if (strcmp(ws_info[i].name, desc) == 0) {
 			ws_info[i].grams = weightsystem->weight.grams;
+			unlock_import_tables();
 			return;
 		}
 	}
@@ -141,6 +148,7 @@ void add_weightsystem_description(const weightsystem_t *weightsystem)
 		ws_info[i].name = strdup(desc);
 		ws_info[i].grams = weightsystem->weight.grams;
 	}
+	unlock_import_tables();
 }
 
 weightsystem_t clone_weightsystem(weightsystem_t ws)
@@ -41,7 +41,9 @@ int report_error(const char *fmt, ...)
 	/* if there is no error callback registered, don't produce errors */
 	if (!error_cb)
 		return -1;
+	lock_errors();
 	error_cb(detach_cstring(&buf));
+	unlock_errors();
 	return -1;
 }
 
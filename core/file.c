@@ -4,11 +4,15 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <string.h>
 #include <errno.h>
 #include "gettext.h"
 #include <zip.h>
 #include <time.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
 
 #include "dive.h"
 #include "divelog.h"
@@ -39,6 +43,7 @@ int readfile(const char *filename, struct memblock *mem)
 
 	mem->buffer = NULL;
 	mem->size = 0;
+	mem->mapped = false;
 
 	fd = subsurface_open(filename, O_RDONLY | O_BINARY, 0);
 	if (fd < 0)
@@ -76,6 +81,68 @@ out:
 	return ret;
 }
 
+/*
+ * Like readfile(), but maps the file instead of copying it into memory, so
+ * that even huge files cost hardly any memory. The buffer is read-only and,
+ * unlike the one from readfile(), not NUL-terminated: it is only useful for
+ * the binary importers. Falls back to readfile() where mmap() isn't available.
+ */
+int mapfile(const char *filename, struct memblock *mem)
+{
+#ifndef _WIN32
+	int ret, fd;
+	struct stat st;
+	void *buf;
+
+	mem->buffer = NULL;
+	mem->size = 0;
+	mem->mapped = false;
+
+	fd = subsurface_open(filename, O_RDONLY | O_BINARY, 0);
+	if (fd < 0)
+		return fd;
+	ret = fstat(fd, &st);
+	if (ret < 0)
+		goto out;
+	ret = -EINVAL;
+	if (!S_ISREG(st.st_mode))
+		goto out;
+	ret = 0;
+	if (!st.st_size)
+		goto out;
+	buf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (buf == MAP_FAILED) {
+		/* e.g. a file system that doesn't support mapping */
+		close(fd);
+		return readfile(filename, mem);
+	}
+	/* the importers walk the file from start to end */
+	madvise(buf, st.st_size, MADV_SEQUENTIAL);
+	mem->buffer = buf;
+	mem->size = st.st_size;
+	mem->mapped = true;
+	ret = mem->size > INT_MAX ? INT_MAX : (int)mem->size;
+out:
+	close(fd);
+	return ret;
+#else
+	return readfile(filename, mem);
+#endif
+}
+
+void free_memblock(struct memblock *mem)
+{
+#ifndef _WIN32
+	if (mem->mapped)
+		munmap(mem->buffer, mem->size);
+	else
+#endif
+		free(mem->buffer);
+	mem->buffer = NULL;
+	mem->size = 0;
+	mem->mapped = false;
+}
+
 
 static void zip_read(struct zip_file *file, const char *filename, struct divelog *log)
 {
@@ -261,12 +328,31 @@ static int parse_file_buffer(const char *filename, struct memblock *mem, struct
 	if (fmt && (ret = open_by_filename(filename, fmt + 1, mem, log)) != 0)
 		return ret;
 
+	/* The XML parser needs a NUL-terminated copy of a mapped file */
+	if (mem->mapped) {
+		free_memblock(mem);
+		if (readfile(filename, mem) < 0)
+			return report_error(translate("gettextFromC", "Failed to read '%s'"), filename);
+	}
+
 	if (!mem->size || !mem->buffer)
 		return report_error("Out of memory parsing file %s\n", filename);
 
 	return parse_xml_buffer(filename, mem->buffer, mem->size, log, NULL);
 }
 
+/* Formats whose importers only need a read-only view of the file */
+static bool is_binary_format(const char *fmt)
+{
+	static const char *formats[] = { "DB", "BAK", "SQL", "DLF", "LOG", "DIVE", "CAN", "LVD" };
+
+	for (unsigned int i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+		if (!strcasecmp(fmt, formats[i]))
+			return true;
+	}
+	return false;
+}
+
 bool remote_repo_uptodate(const char *filename, struct git_info *info)
 {
 	char *current_sha = copy_string(saved_git_id);
@@ -310,7 +396,16 @@ int parse_file(const char *filename, struct divelog *log)
 		return ret;
 	}
 
-	if ((ret = readfile(filename, &mem)) < 0) {
+	/*
+	 * The binary formats are parsed straight from a read-only mapping,
+	 * everything else needs a NUL-terminated copy of the file.
+	 */
+	fmt = strrchr(filename, '.');
+	if (fmt && is_binary_format(fmt + 1))
+		ret = mapfile(filename, &mem);
+	else
+		ret = readfile(filename, &mem);
+	if (ret < 0) {
 		/* we don't want to display an error if this was the default file  */
 		if (same_string(filename, prefs.default_filename))
 			return 0;
@@ -320,10 +415,9 @@ int parse_file(const char *filename, struct divelog *log)
 		return report_error(translate("gettextFromC", "Empty file '%s'"), filename);
 	}
 
-	fmt = strrchr(filename, '.');
 	if (fmt && (!strcasecmp(fmt + 1, "DB") || !strcasecmp(fmt + 1, "BAK") || !strcasecmp(fmt + 1, "SQL"))) {
 		if (!try_to_open_db(filename, &mem, log)) {
-			free(mem.buffer);
+			free_memblock(&mem);
 			return 0;
 		}
 	}
@@ -331,7 +425,7 @@ int parse_file(const char *filename, struct divelog *log)
 	/* Divesoft Freedom */
 	if (fmt && (!strcasecmp(fmt + 1, "DLF"))) {
 		ret = parse_dlf_buffer(mem.buffer, mem.size, log);
-		free(mem.buffer);
+		free_memblock(&mem);
 		return ret;
 	}
 
@@ -342,26 +436,26 @@ int parse_file(const char *filename, struct divelog *log)
 		char *wl_name = memcpy(calloc(t - filename + 1, 1), filename, t - filename);
 		wl_name = realloc(wl_name, strlen(wl_name) + 5);
 		wl_name = strcat(wl_name, ".add");
-		if((ret = readfile(wl_name, &wl_mem)) < 0) {
+		if((ret = mapfile(wl_name, &wl_mem)) < 0) {
 			fprintf(stderr, "No file %s found. No WLog extensions.\n", wl_name);
 			ret = datatrak_import(&mem, NULL, log);
 		} else {
 			ret = datatrak_import(&mem, &wl_mem, log);
-			free(wl_mem.buffer);
+			free_memblock(&wl_mem);
 		}
-		free(mem.buffer);
+		free_memblock(&mem);
 		free(wl_name);
 		return ret;
 	}
 
 	/* OSTCtools */
 	if (fmt && (!strcasecmp(fmt + 1, "DIVE"))) {
-		free(mem.buffer);
+		free_memblock(&mem);
 		ostctools_import(filename, log);
 		return 0;
 	}
 
 	ret = parse_file_buffer(filename, &mem, log);
-	free(mem.buffer);
+	free_memblock(&mem);
 	return ret;
 }
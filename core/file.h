@@ -6,10 +6,12 @@
 
 #include <sys/stat.h>
 #include <stdio.h>
+#include <stdbool.h>
 
 struct memblock {
 	void *buffer;
 	size_t size;
+	bool mapped;	// mapped read-only by mapfile(), release with free_memblock()
 };
 
 struct divelog;
@@ -24,6 +26,8 @@ extern int datatrak_import(struct memblock *mem, struct memblock *wl_mem, struct
 extern void ostctools_import(const char *file, struct divelog *log);
 
 extern int readfile(const char *filename, struct memblock *mem);
+extern int mapfile(const char *filename, struct memblock *mem);
+extern void free_memblock(struct memblock *mem);
 extern int parse_file(const char *filename, struct divelog *log);
 extern int try_to_open_zip(const char *filename, struct divelog *log);
 
@@ -2,6 +2,8 @@
 #include "filterconstraint.h"
 #include "dive.h"
 #include "divesite.h"
+#include "divesummarytable.h"
+#include "subsurface-qt/divelistnotifier.h"
 #include "errorhelper.h"
 #include "gettextfromc.h"
 #include "qthelper.h"
@@ -11,6 +13,7 @@
 #include "subsurface-string.h"
 #include "subsurface-time.h"
 #include <QDateTime>
+#include <limits>
 
 // We use the units enum only internally.
 // Therefore define it here, not in the header file.
@@ -803,9 +806,9 @@ static bool listContainsSuperstring(const QStringList &list, const QString &s, S
 			   { return strchk(s2, s); } );
 }
 
-// Check whether any of the items of the first list is in the second list as a super string.
-// The mode is controlled by the second argument
-static bool check(const filter_constraint &c, const QStringList &list)
+// Check whether any of the items of the constraint is in the list as a super string.
+// The mode is controlled by the constraint. Doesn't take negation into account.
+static bool matches_any(const filter_constraint &c, const QStringList &list)
 {
 	StrCheck strchk =
 		c.string_mode == FILTER_CONSTRAINT_SUBSTRING ?
@@ -816,7 +819,13 @@ static bool check(const filter_constraint &c, const QStringList &list)
 			[](const QString &s1, const QString &s2) { return s1.compare(s2, Qt::CaseInsensitive) == 0; };
 	return std::any_of(c.data.string_list->begin(), c.data.string_list->end(),
 			   [&list, strchk](const QString &item)
-			   { return listContainsSuperstring(list, item, strchk); }) != c.negate;
+			   { return listContainsSuperstring(list, item, strchk); });
+}
+
+// Same as matches_any(), but negated if the constraint is negated.
+static bool check(const filter_constraint &c, const QStringList &list)
+{
+	return matches_any(c, list) != c.negate;
 }
 
 static bool has_tags(const filter_constraint &c, const struct dive *d)
@@ -1035,6 +1044,58 @@ static bool check_multiple_choice(const filter_constraint &c, int v)
 	return has_bit != c.negate;
 }
 
+int filter_constraint_dive_fields(enum filter_constraint_type type)
+{
+	switch (type) {
+	case FILTER_CONSTRAINT_DATE:
+	case FILTER_CONSTRAINT_DATE_TIME:
+	case FILTER_CONSTRAINT_TIME_OF_DAY:
+	case FILTER_CONSTRAINT_YEAR:
+	case FILTER_CONSTRAINT_DAY_OF_WEEK:
+		return DiveField::DATETIME | DiveField::DURATION; // The end time depends on the duration
+	case FILTER_CONSTRAINT_RATING:
+		return DiveField::RATING;
+	case FILTER_CONSTRAINT_WAVESIZE:
+		return DiveField::WAVESIZE;
+	case FILTER_CONSTRAINT_CURRENT:
+		return DiveField::CURRENT;
+	case FILTER_CONSTRAINT_VISIBILITY:
+		return DiveField::VISIBILITY;
+	case FILTER_CONSTRAINT_SURGE:
+		return DiveField::SURGE;
+	case FILTER_CONSTRAINT_CHILL:
+		return DiveField::CHILL;
+	case FILTER_CONSTRAINT_DEPTH:
+		return DiveField::DEPTH;
+	case FILTER_CONSTRAINT_DURATION:
+		return DiveField::DURATION;
+	case FILTER_CONSTRAINT_WATER_TEMP:
+		return DiveField::WATER_TEMP;
+	case FILTER_CONSTRAINT_AIR_TEMP:
+		return DiveField::AIR_TEMP;
+	case FILTER_CONSTRAINT_WATER_DENSITY:
+		return DiveField::SALINITY;
+	case FILTER_CONSTRAINT_SAC:
+		return DiveField::DEPTH | DiveField::DURATION | DiveField::SALINITY | DiveField::ATM_PRESS;
+	case FILTER_CONSTRAINT_DIVE_MODE:
+		return DiveField::MODE;
+	case FILTER_CONSTRAINT_TAGS:
+		return DiveField::TAGS;
+	case FILTER_CONSTRAINT_PEOPLE:
+		return DiveField::BUDDY | DiveField::DIVEGUIDE;
+	case FILTER_CONSTRAINT_LOCATION:
+		return DiveField::DIVESITE;
+	case FILTER_CONSTRAINT_SUIT:
+		return DiveField::SUIT;
+	case FILTER_CONSTRAINT_NOTES:
+		return DiveField::NOTES;
+	default:
+		// Weights, cylinders and dive computers are not described by DiveFields.
+		// Their changes are signaled separately and always cause re-filtering.
+		return DiveField::NONE;
+	}
+}
+
 bool filter_constraint_match_dive(const filter_constraint &c, const struct dive *d)
 {
 	if (filter_constraint_is_string(c.type) && c.data.string_list->isEmpty())
@@ -1108,3 +1169,297 @@ bool filter_constraint_match_dive(const filter_constraint &c, const struct dive
 	}
 	return false;
 }
+
+// Functions to evaluate constraints on the columns of a DiveSummaryTable.
+// The checks are written as plain loops over contiguous arrays, which the
+// compiler can vectorize. They mirror the per-dive checks above.
+
+// Clear the entries of the match array for which the predicate (xor negate) is false.
+template <typename Pred>
+static void match_rows(std::vector<unsigned char> &match, bool negate, Pred pred)
+{
+	unsigned char *m = match.data();
+	size_t n = match.size();
+	for (size_t i = 0; i < n; ++i)
+		m[i] &= pred(i) != negate;
+}
+
+// Turn the range mode into inclusive lower and upper bounds.
+template <typename T>
+static void range_bounds(enum filter_constraint_range_mode mode, T from, T to, T &lo, T &hi)
+{
+	switch (mode) {
+	case FILTER_CONSTRAINT_EQUAL:
+	default:
+		lo = hi = from;
+		break;
+	case FILTER_CONSTRAINT_LESS:
+		lo = std::numeric_limits<T>::min();
+		hi = to;
+		break;
+	case FILTER_CONSTRAINT_GREATER:
+		lo = from;
+		hi = std::numeric_limits<T>::max();
+		break;
+	case FILTER_CONSTRAINT_RANGE:
+		lo = from;
+		hi = to;
+		break;
+	}
+}
+
+static void match_numerical_range(const filter_constraint &c, const std::vector<int> &column, std::vector<unsigned char> &match)
+{
+	int lo, hi;
+	range_bounds(c.range_mode, c.data.numerical_range.from, c.data.numerical_range.to, lo, hi);
+	const int *v = column.data();
+	match_rows(match, c.negate, [v, lo, hi](size_t i) { return v[i] >= lo && v[i] <= hi; });
+}
+
+// Consider a value of 0 as "not set", i.e. never in range.
+static void match_numerical_range_non_zero(const filter_constraint &c, const std::vector<int> &column, std::vector<unsigned char> &match)
+{
+	int lo, hi;
+	range_bounds(c.range_mode, c.data.numerical_range.from, c.data.numerical_range.to, lo, hi);
+	const int *v = column.data();
+	match_rows(match, c.negate, [v, lo, hi](size_t i) { return v[i] != 0 && v[i] >= lo && v[i] <= hi; });
+}
+
+static void match_multiple_choice(const filter_constraint &c, const std::vector<int> &column, std::vector<unsigned char> &match)
+{
+	uint64_t bits = c.data.multiple_choice;
+	const int *v = column.data();
+	match_rows(match, c.negate, [v, bits](size_t i) { return ((bits >> v[i]) & 1) != 0; });
+}
+
+static void match_flag(const filter_constraint &c, const std::vector<unsigned char> &column, std::vector<unsigned char> &match)
+{
+	const unsigned char *v = column.data();
+	match_rows(match, c.negate, [v](size_t i) { return v[i] != 0; });
+}
+
+static void match_date_range(const filter_constraint &c, const DiveSummaryTable &t, std::vector<unsigned char> &match)
+{
+	long lo, hi;
+	range_bounds(c.range_mode, days_since_epoch(c.data.timestamp_range.from), days_since_epoch(c.data.timestamp_range.to), lo, hi);
+	const timestamp_t *when = t.when.data();
+	match_rows(match, c.negate, [when, lo, hi](size_t i) { long day = days_since_epoch(when[i]);
+							       return day >= lo && day <= hi; });
+}
+
+static void match_datetime_range(const filter_constraint &c, const DiveSummaryTable &t, std::vector<unsigned char> &match)
+{
+	const timestamp_t *when = t.when.data();
+	const timestamp_t *end = t.endtime.data();
+	timestamp_t from = c.data.timestamp_range.from;
+	timestamp_t to = c.data.timestamp_range.to;
+	switch (c.range_mode) {
+	case FILTER_CONSTRAINT_EQUAL:
+		match_rows(match, c.negate, [when, end, from](size_t i) { return when[i] <= from && from <= end[i]; });
+		break;
+	case FILTER_CONSTRAINT_LESS:
+		match_rows(match, c.negate, [end, to](size_t i) { return end[i] <= to; });
+		break;
+	case FILTER_CONSTRAINT_GREATER:
+		match_rows(match, c.negate, [when, from](size_t i) { return when[i] >= from; });
+		break;
+	case FILTER_CONSTRAINT_RANGE:
+		match_rows(match, c.negate, [when, end, from, to](size_t i) { return when[i] >= from && end[i] <= to; });
+		break;
+	}
+}
+
+static void match_time_of_day_range(const filter_constraint &c, const DiveSummaryTable &t, std::vector<unsigned char> &match)
+{
+	// Same cyclic treatment as in check_time_of_day_range().
+	enum filter_constraint_range_mode mode = c.range_mode;
+	int from = c.data.numerical_range.from;
+	int to = c.data.numerical_range.to;
+	bool negate = c.negate;
+	if ((mode == FILTER_CONSTRAINT_EQUAL || mode == FILTER_CONSTRAINT_RANGE) && from > to) {
+		std::swap(from, to);
+		negate = !negate;
+	}
+	const timestamp_t *when = t.when.data();
+	const timestamp_t *end = t.endtime.data();
+	switch (mode) {
+	case FILTER_CONSTRAINT_EQUAL:
+		match_rows(match, negate, [when, end, from](size_t i) { return seconds_since_midnight(when[i]) <= from &&
+										      seconds_since_midnight(end[i]) >= from; });
+		break;
+	case FILTER_CONSTRAINT_LESS:
+		match_rows(match, negate, [end, to](size_t i) { return seconds_since_midnight(end[i]) <= to; });
+		break;
+	case FILTER_CONSTRAINT_GREATER:
+		match_rows(match, negate, [when, from](size_t i) { return seconds_since_midnight(when[i]) >= from; });
+		break;
+	case FILTER_CONSTRAINT_RANGE:
+		match_rows(match, negate, [when, end, from, to](size_t i) { return seconds_since_midnight(when[i]) >= from &&
+											  seconds_since_midnight(end[i]) <= to; });
+		break;
+	}
+}
+
+// Test the constraint once for every string of a list of strings.
+static std::vector<unsigned char> match_strings(const filter_constraint &c, const std::vector<QString> &strings)
+{
+	std::vector<unsigned char> res(strings.size());
+	for (size_t i = 0; i < strings.size(); ++i)
+		res[i] = matches_any(c, QStringList { strings[i] });
+	return res;
+}
+
+// Same as has_tags(): the dive mode counts as a tag.
+static void match_tags(const filter_constraint &c, const DiveSummaryTable &t, std::vector<unsigned char> &match)
+{
+	std::vector<unsigned char> tagMatches = match_strings(c, t.tagNames);
+	std::vector<uint64_t> mask(t.tagWords, 0);
+	for (size_t i = 0; i < tagMatches.size(); ++i) {
+		if (tagMatches[i])
+			mask[i / 64] |= 1ULL << (i % 64);
+	}
+	unsigned char modeMatches[NUM_DIVEMODE];
+	for (int i = 0; i < NUM_DIVEMODE; ++i)
+		modeMatches[i] = matches_any(c, QStringList { gettextFromC::tr(divemode_text_ui[i]).trimmed() });
+
+	const uint64_t *tags = t.tags.data();
+	const uint64_t *m = mask.data();
+	const int *divemode = t.divemode.data();
+	int words = t.tagWords;
+	match_rows(match, c.negate, [tags, m, words, divemode, &modeMatches](size_t i) {
+		if (divemode[i] >= 0 && divemode[i] < NUM_DIVEMODE && modeMatches[divemode[i]])
+			return true;
+		const uint64_t *bits = tags + i * words;
+		for (int w = 0; w < words; ++w) {
+			if (bits[w] & m[w])
+				return true;
+		}
+		return false;
+	});
+}
+
+// Same as has_locations(): the trip location and the dive site name are tested.
+static void match_locations(const filter_constraint &c, const DiveSummaryTable &t, std::vector<unsigned char> &match)
+{
+	std::vector<unsigned char> matches = match_strings(c, t.locations);
+	const unsigned char *l = matches.data();
+	const int *site = t.site.data();
+	const int *trip = t.triplocation.data();
+	match_rows(match, c.negate, [l, site, trip](size_t i) {
+		return (site[i] >= 0 && l[site[i]]) || (trip[i] >= 0 && l[trip[i]]);
+	});
+}
+
+// Same as check_gas_range(): is there a cylinder whose fraction is in the range
+// (or, if negated, not in the range)? Apart from the not negated "equal" and
+// "range" modes, this is decided by the minimum and maximum fraction. In these
+// two modes, the dives whose fractions are all outside of the range are removed
+// and the remaining dives have to be tested per dive. Returns false in that case.
+static bool match_gas_range(const filter_constraint &c, const std::vector<int> &min, const std::vector<int> &max, std::vector<unsigned char> &match)
+{
+	int lo, hi;
+	range_bounds(c.range_mode, c.data.numerical_range.from, c.data.numerical_range.to, lo, hi);
+	const int *vmin = min.data();
+	const int *vmax = max.data();
+	if (c.negate) {
+		match_rows(match, false, [vmin, vmax, lo, hi](size_t i) { return vmin[i] < lo || vmax[i] > hi; });
+		return true;
+	}
+	switch (c.range_mode) {
+	case FILTER_CONSTRAINT_LESS:
+		match_rows(match, false, [vmin, hi](size_t i) { return vmin[i] <= hi; });
+		return true;
+	case FILTER_CONSTRAINT_GREATER:
+		match_rows(match, false, [vmax, lo](size_t i) { return vmax[i] >= lo; });
+		return true;
+	default:
+		match_rows(match, false, [vmin, vmax, lo, hi](size_t i) { return vmin[i] <= hi && vmax[i] >= lo; });
+		return false;
+	}
+}
+
+bool filter_constraint_match_summary(const filter_constraint &c, const DiveSummaryTable &t, std::vector<unsigned char> &match)
+{
+	// Same as filter_constraint_match_dive(): a constraint without strings matches all dives.
+	if (filter_constraint_is_string(c.type) && c.data.string_list->isEmpty())
+		return true;
+
+	switch (c.type) {
+	case FILTER_CONSTRAINT_DATE:
+		match_date_range(c, t, match);
+		return true;
+	case FILTER_CONSTRAINT_DATE_TIME:
+		match_datetime_range(c, t, match);
+		return true;
+	case FILTER_CONSTRAINT_TIME_OF_DAY:
+		match_time_of_day_range(c, t, match);
+		return true;
+	case FILTER_CONSTRAINT_YEAR:
+		match_numerical_range(c, t.year, match);
+		return true;
+	case FILTER_CONSTRAINT_DAY_OF_WEEK:
+		match_multiple_choice(c, t.weekday, match);
+		return true;
+	case FILTER_CONSTRAINT_RATING:
+		match_numerical_range(c, t.rating, match);
+		return true;
+	case FILTER_CONSTRAINT_WAVESIZE:
+		match_numerical_range(c, t.wavesize, match);
+		return true;
+	case FILTER_CONSTRAINT_CURRENT:
+		match_numerical_range(c, t.current, match);
+		return true;
+	case FILTER_CONSTRAINT_VISIBILITY:
+		match_numerical_range(c, t.visibility, match);
+		return true;
+	case FILTER_CONSTRAINT_SURGE:
+		match_numerical_range(c, t.surge, match);
+		return true;
+	case FILTER_CONSTRAINT_CHILL:
+		match_numerical_range(c, t.chill, match);
+		return true;
+	case FILTER_CONSTRAINT_DEPTH:
+		match_numerical_range(c, t.maxdepth, match);
+		return true;
+	case FILTER_CONSTRAINT_DURATION:
+		match_numerical_range(c, t.duration, match);
+		return true;
+	case FILTER_CONSTRAINT_WEIGHT:
+		match_numerical_range(c, t.weight, match);
+		return true;
+	case FILTER_CONSTRAINT_WATER_TEMP:
+		match_numerical_range(c, t.watertemp, match);
+		return true;
+	case FILTER_CONSTRAINT_AIR_TEMP:
+		match_numerical_range(c, t.airtemp, match);
+		return true;
+	case FILTER_CONSTRAINT_WATER_DENSITY:
+		match_numerical_range(c, t.density, match);
+		return true;
+	case FILTER_CONSTRAINT_SAC:
+		match_numerical_range_non_zero(c, t.sac, match);
+		return true;
+	case FILTER_CONSTRAINT_LOGGED:
+		match_flag(c, t.logged, match);
+		return true;
+	case FILTER_CONSTRAINT_PLANNED:
+		match_flag(c, t.planned, match);
+		return true;
+	case FILTER_CONSTRAINT_DIVE_MODE:
+		match_multiple_choice(c, t.divemode, match);
+		return true;
+	case FILTER_CONSTRAINT_TAGS:
+		match_tags(c, t, match);
+		return true;
+	case FILTER_CONSTRAINT_LOCATION:
+		match_locations(c, t, match);
+		return true;
+	case FILTER_CONSTRAINT_CYLINDER_O2:
+		return match_gas_range(c, t.o2min, t.o2max, match);
+	case FILTER_CONSTRAINT_CYLINDER_HE:
+		return match_gas_range(c, t.hemin, t.hemax, match);
+	default:
+		// The other string lists and cylinder constraints are tested per dive.
+		return false;
+	}
+}
@@ -124,6 +124,9 @@ extern char *filter_constraint_data_to_string(const struct filter_constraint *co
 
 // C++ only functions
 #ifdef __cplusplus
+#include <vector>
+struct DiveSummaryTable;
+
 QString filter_constraint_type_to_string_translated(enum filter_constraint_type);
 QString filter_constraint_negate_to_string_translated(bool negate);
 QString filter_constraint_string_mode_to_string_translated(enum filter_constraint_string_mode);
@@ -152,6 +155,11 @@ void filter_constraint_set_timestamp_from(filter_constraint &c, timestamp_t from
 void filter_constraint_set_timestamp_to(filter_constraint &c, timestamp_t to); // convert according to current units (metric or imperial)
 void filter_constraint_set_multiple_choice(filter_constraint &c, uint64_t);
 bool filter_constraint_match_dive(const filter_constraint &c, const struct dive *d);
+int filter_constraint_dive_fields(enum filter_constraint_type type); // DiveField flags of the data the constraint depends on
+// Clear the entries of the match array for rows of the summary table that don't match.
+// Returns false if the constraint can't be fully evaluated on the summary table. Then,
+// it has to be tested on the dives of the remaining rows.
+bool filter_constraint_match_summary(const filter_constraint &c, const DiveSummaryTable &t, std::vector<unsigned char> &match);
 #endif
 
 #endif
@@ -7,27 +7,59 @@
 #include "tag.h"
 #include "trip.h"
 #include "qthelper.h"
+#include <QHash>
 #include <QLocale>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QtConcurrent>
+#include <algorithm>
+#include <iterator>
 #include <map>
+#include <unordered_map>
 
-// This class caches each dives words, so that we can unregister a dive from the full text search
+// This class caches each dives words, so that we can unregister a dive from the full text search.
+// Moreover, it keeps the sorted ids of the words, so that we can quickly test whether a dive
+// contains any word out of a set of words.
 struct full_text_cache {
 	std::vector<QString> words;
+	std::vector<int> ids;
 };
 
-// The FullText-search class
+// Every word in the index gets an id. For substring searches, each word is split
+// into its n-grams of length one to three, which are mapped to the ids of the words
+// that contain them. A substring of up to three characters is looked up directly,
+// longer substrings by intersecting the posting lists of their trigrams.
+struct FullTextWord {
+	int id;
+	std::vector<dive *> dives; // Dives that contain this word
+};
+
+// The FullText-search class. Searches may be run on worker threads,
+// therefore access to the index is protected by a read-write lock.
 class FullText {
-	std::map<QString, std::vector<dive *>> words; // Dives that belong to each word
+	using WordMap = std::map<QString, FullTextWord>;
+	mutable QReadWriteLock lock;
+	WordMap words; // Dives that belong to each word
+	std::vector<WordMap::iterator> wordsById; // Only valid for ids not in freeIds
+	std::vector<int> freeIds; // Ids of removed words that can be reused
+	std::unordered_map<uint64_t, std::vector<int>> ngrams; // Sorted word-ids of the words containing an n-gram
 public:
 	void populate(); // Rebuild from current dive_table
 	void registerDive(struct dive *d); // Note: can be called repeatedly
 	void unregisterDive(struct dive *d); // Note: can be called repeatedly
 	void unregisterAll(); // Unregister all dives in the dive table
 	FullTextResult find(const FullTextQuery &q, StringFilterMode mode) const; // Find dives matchin all words.
+	FullTextWords findWords(const FullTextQuery &q, StringFilterMode mode) const; // Find words matching any word.
 private:
+	void registerDive(struct dive *d, std::vector<QString> diveWords);
 	void registerWords(struct dive *d, const std::vector<QString> &w);
 	void unregisterWords(struct dive *d, const std::vector<QString> &w);
+	WordMap::iterator addWord(const QString &word);
+	void removeWord(WordMap::iterator it);
+	const std::vector<int> *ngramWords(const QString &s, int pos, int len) const;
+	std::vector<int> findSubstring(const QString &s) const;
 	std::vector<dive *> findDives(const QString &s, StringFilterMode mode) const; // Find dives matching a given word.
+	std::vector<int> findWords(const QString &s, StringFilterMode mode) const; // Find ids of words matching a given word.
 };
 
 // This class doesn't depend on any other objects, we might just initialize it at startup.
@@ -65,39 +97,48 @@ FullTextResult fulltext_find_dives(const FullTextQuery &q, StringFilterMode mode
 	return self.find(q, mode);
 }
 
+FullTextWords fulltext_find_words(const FullTextQuery &q, StringFilterMode mode)
+{
+	return self.findWords(q, mode);
+}
+
 // Check whether a single dive matches the fulltext criterion
-bool fulltext_dive_matches(const struct dive *d, const FullTextQuery &q, StringFilterMode mode)
+bool fulltext_dive_matches(const struct dive *d, const FullTextWords &w)
 {
-	if (!q.doit())
+	if (!w.doit)
 		return true;
 	if (!d->full_text)
 		return false;
-	auto matchFunc =
-		mode == StringFilterMode::EXACT ? [](const QString &s1, const QString &s2) { return s1 == s2; } :
-		mode == StringFilterMode::STARTSWITH ? [](const QString &s1, const QString &s2) { return s1.startsWith(s2); } :
-		/* mode == StringFilterMode::SUBSTRING ? */ [](const QString &s1, const QString &s2) { return s1.contains(s2); };
-	const std::vector<QString> &words = d->full_text->words;
-	for (const QString &search: q.words) {
-		if (std::any_of(words.begin(), words.end(), [&search,matchFunc](const QString &w) { return matchFunc(w, search); }))
-			return true;
-	}
-	return false;
+	return std::any_of(d->full_text->ids.begin(), d->full_text->ids.end(),
+			   [&w](int id) { return w.matching[id]; });
 }
 
 // Class implementation
 
-// Take a text and tokenize it into words. Normalize the words to the base
-// upper case base character (e.g. 'ℓ' to 'L') and add to a given list,
+// Take texts and tokenize them into words. Normalize the words to the base
+// upper case base character (e.g. 'ℓ' to 'L') and collect them in a list,
 // if not already in list.
+// Normalization and upper-casing are comparatively expensive and most words
+// appear in many dives. Therefore, the normalized form of each distinct token
+// is cached. A tokenizer must not be shared between threads.
 // We might think about limiting the lower size of words we store.
 // Note: we convert to QString before tokenization because we rely in
 // Qt's isPunct() function.
-static void tokenize(QString s, std::vector<QString> &res)
+class Tokenizer {
+	QLocale loc;
+	QHash<QString, QString> normalized; // Raw token -> normalized word
+	QSet<QString> seen; // Words already in res
+	std::vector<QString> res;
+public:
+	void add(const QString &s);
+	std::vector<QString> take(); // Return the collected words and start a new list
+};
+
+void Tokenizer::add(const QString &s)
 {
 	if (s.isEmpty())
 		return;
 
-	QLocale loc;
 	int size = s.size();
 	int pos = 0;
 	while (pos < size) {
@@ -109,42 +150,52 @@ static void tokenize(QString s, std::vector<QString> &res)
 		int end = pos;
 		while (end < size && !s[end].isSpace() && !s[end].isPunct())
 			++end;
-		QString word = s.mid(pos, end - pos);
-		word = word.normalized(QString::NormalizationForm_KD);
-		word = loc.toUpper(word);
+		QString token = s.mid(pos, end - pos);
 		pos = end;
 
-		if (find(res.begin(), res.end(), word) == res.end())
-			res.push_back(word);
+		auto it = normalized.find(token);
+		if (it == normalized.end())
+			it = normalized.insert(token, loc.toUpper(token.normalized(QString::NormalizationForm_KD)));
+		if (!seen.contains(*it)) {
+			seen.insert(*it);
+			res.push_back(*it);
+		}
 	}
 }
 
+std::vector<QString> Tokenizer::take()
+{
+	std::vector<QString> words;
+	words.swap(res);
+	seen.clear();
+	return words;
+}
+
 // Get all words of a dive
-static std::vector<QString> getWords(const dive *d)
+static std::vector<QString> getWords(const dive *d, Tokenizer &t)
 {
-	std::vector<QString> res;
-	tokenize(QString(d->notes), res);
-	tokenize(QString(d->diveguide), res);
-	tokenize(QString(d->buddy), res);
-	tokenize(QString(d->suit), res);
+	t.add(QString(d->notes));
+	t.add(QString(d->diveguide));
+	t.add(QString(d->buddy));
+	t.add(QString(d->suit));
 	for (const tag_entry *tag = d->tag_list; tag; tag = tag->next)
-		tokenize(QString(tag->tag->name), res);
+		t.add(QString(tag->tag->name));
 	for (int i = 0; i < d->cylinders.nr; ++i) {
 		const cylinder_t &cyl = *get_cylinder(d, i);
-		tokenize(QString(cyl.type.description), res);
+		t.add(QString(cyl.type.description));
 	}
 	for (int i = 0; i < d->weightsystems.nr; ++i) {
 		const weightsystem_t &ws = d->weightsystems.weightsystems[i];
-		tokenize(QString(ws.description), res);
+		t.add(QString(ws.description));
 	}
 	// TODO: We should tokenize all dive-sites and trips first and then
 	// take the tokens from a cache.
 	if (d->dive_site)
-		tokenize(d->dive_site->name, res);
+		t.add(d->dive_site->name);
 	// TODO: We should index trips separately!
 	if (d->divetrip)
-		tokenize(d->divetrip->location, res);
-	return res;
+		t.add(d->divetrip->location);
+	return t.take();
 }
 
 void FullText::populate()
@@ -152,27 +203,59 @@ void FullText::populate()
 	// we want this to be two calls as the second text is overwritten below by the lines starting with "\r"
 	uiNotification(QObject::tr("Create full text index"));
 	uiNotification(QObject::tr("start processing"));
-	int i;
-	dive *d;
-	for_each_dive(i, d)
-		registerDive(d);
-	uiNotification(QObject::tr("%1 dives processed").arg(divelog.dives->nr));
+
+	// Tokenizing is independent for every dive, so do that in parallel.
+	// Each block of dives gets its own tokenizer and thus its own normalization
+	// cache. The index itself is then built serially from the collected words.
+	const int blockSize = 256;
+	int nr = divelog.dives->nr;
+	std::vector<std::vector<QString>> diveWords(nr);
+	std::vector<int> blocks;
+	for (int from = 0; from < nr; from += blockSize)
+		blocks.push_back(from);
+	QtConcurrent::blockingMap(blocks, [&diveWords, nr, blockSize](int from) {
+		Tokenizer t;
+		int to = std::min(from + blockSize, nr);
+		for (int i = from; i < to; ++i)
+			diveWords[i] = getWords(divelog.dives->dives[i], t);
+	});
+
+	QWriteLocker locker(&lock);
+	for (int i = 0; i < nr; ++i)
+		registerDive(divelog.dives->dives[i], std::move(diveWords[i]));
+	uiNotification(QObject::tr("%1 dives processed").arg(nr));
 }
 
 void FullText::registerDive(struct dive *d)
+{
+	Tokenizer t;
+	std::vector<QString> diveWords = getWords(d, t);
+	QWriteLocker locker(&lock);
+	registerDive(d, std::move(diveWords));
+}
+
+void FullText::registerDive(struct dive *d, std::vector<QString> diveWords)
 {
 	if (d->full_text)
 		unregisterWords(d, d->full_text->words);
 	else
 		d->full_text = new full_text_cache;
-	d->full_text->words = getWords(d);
+	d->full_text->words = std::move(diveWords);
 	registerWords(d, d->full_text->words);
+
+	std::vector<int> &ids = d->full_text->ids;
+	ids.clear();
+	ids.reserve(d->full_text->words.size());
+	for (const QString &word: d->full_text->words)
+		ids.push_back(words.find(word)->second.id);
+	std::sort(ids.begin(), ids.end());
 }
 
 void FullText::unregisterDive(struct dive *d)
 {
 	if (!d->full_text)
 		return;
+	QWriteLocker locker(&lock);
 	unregisterWords(d, d->full_text->words);
 	delete d->full_text;
 	d->full_text = nullptr;
@@ -182,18 +265,91 @@ void FullText::unregisterAll()
 {
 	int i;
 	dive *d;
+	QWriteLocker locker(&lock);
 	for_each_dive(i, d) {
 		delete d->full_text;
 		d->full_text = nullptr;
 	}
 	words.clear();
+	wordsById.clear();
+	freeIds.clear();
+	ngrams.clear();
+}
+
+// Pack an n-gram of up to three UTF-16 code units into an integer.
+// The length is stored in the upper bits so that n-grams of different
+// length are distinct.
+static uint64_t ngramKey(const QString &s, int pos, int len)
+{
+	uint64_t res = (uint64_t)len << 48;
+	for (int i = 0; i < len; ++i)
+		res |= (uint64_t)s[pos + i].unicode() << (16 * (2 - i));
+	return res;
+}
+
+// Call a function on all distinct n-grams of length one to three of a word
+template <typename F>
+static void forEachNgram(const QString &word, F f)
+{
+	std::vector<uint64_t> keys;
+	int size = word.size();
+	for (int len = 1; len <= 3; ++len) {
+		for (int pos = 0; pos + len <= size; ++pos)
+			keys.push_back(ngramKey(word, pos, len));
+	}
+	std::sort(keys.begin(), keys.end());
+	keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+	for (uint64_t key: keys)
+		f(key);
+}
+
+// Add a new word to the index
+FullText::WordMap::iterator FullText::addWord(const QString &word)
+{
+	int id;
+	if (freeIds.empty()) {
+		id = (int)wordsById.size();
+		wordsById.emplace_back();
+	} else {
+		id = freeIds.back();
+		freeIds.pop_back();
+	}
+	auto it = words.emplace(word, FullTextWord{ id, {} }).first;
+	wordsById[id] = it;
+	forEachNgram(word, [this, id](uint64_t key) {
+		std::vector<int> &list = ngrams[key];
+		list.insert(std::lower_bound(list.begin(), list.end(), id), id);
+	});
+	return it;
+}
+
+// Remove a word that isn't used by any dive anymore
+void FullText::removeWord(WordMap::iterator it)
+{
+	int id = it->second.id;
+	forEachNgram(it->first, [this, id](uint64_t key) {
+		auto ngram = ngrams.find(key);
+		if (ngram == ngrams.end())
+			return;
+		std::vector<int> &list = ngram->second;
+		auto pos = std::lower_bound(list.begin(), list.end(), id);
+		if (pos != list.end() && *pos == id)
+			list.erase(pos);
+		if (list.empty())
+			ngrams.erase(ngram);
+	});
+	freeIds.push_back(id);
+	words.erase(it);
 }
 
 // Register words of a dive.
 void FullText::registerWords(struct dive *d, const std::vector<QString> &w)
 {
 	for (const QString &word: w) {
-		std::vector<dive *> &entry = words[word];
+		auto it = words.find(word);
+		if (it == words.end())
+			it = addWord(word);
+		std::vector<dive *> &entry = it->second.dives;
 		if (std::find(entry.begin(), entry.end(), d) == entry.end())
 			entry.push_back(d);
 	}
@@ -208,23 +364,60 @@ void FullText::unregisterWords(struct dive *d, const std::vector<QString> &w)
 			qWarning("FullText::unregisterWords: didn't find word '%s' in index!?", qPrintable(word));
 			continue;
 		}
-		std::vector<dive *> &entry = it->second;
-		entry.erase(std::remove(entry.begin(), entry.end(), d));
+		std::vector<dive *> &entry = it->second.dives;
+		entry.erase(std::remove(entry.begin(), entry.end(), d), entry.end());
 		if (entry.empty())
-			words.erase(it);
+			removeWord(it);
 	}
 }
 
-// Add dives from second array to first, if not yet there
-void combineDives(std::vector<dive *> &to, const std::vector<dive *> &from)
+// The sorted list of words containing the n-gram of a string at the given position.
+// Returns null if there are no such words.
+const std::vector<int> *FullText::ngramWords(const QString &s, int pos, int len) const
 {
-	for (dive *d: from) {
-		if (std::find(to.begin(), to.end(), d) == to.end())
-			to.push_back(d);
+	auto it = ngrams.find(ngramKey(s, pos, len));
+	return it != ngrams.end() ? &it->second : nullptr;
+}
+
+// Find the ids of all words that contain a substring.
+std::vector<int> FullText::findSubstring(const QString &s) const
+{
+	int size = s.size();
+	if (size <= 0)
+		return {};
+
+	// Short substrings are n-grams of the words and can be read off the index.
+	if (size <= 3) {
+		const std::vector<int> *list = ngramWords(s, 0, size);
+		return list ? *list : std::vector<int>();
+	}
+
+	// Longer substrings: intersect the words of all trigrams, starting with the
+	// shortest list. The candidates then have to be checked, because the
+	// trigrams might appear in a different order or at different positions.
+	std::vector<const std::vector<int> *> lists;
+	for (int pos = 0; pos + 3 <= size; ++pos) {
+		const std::vector<int> *list = ngramWords(s, pos, 3);
+		if (!list)
+			return {};
+		lists.push_back(list);
+	}
+	std::sort(lists.begin(), lists.end(), [](const std::vector<int> *l1, const std::vector<int> *l2)
+		  { return l1->size() < l2->size(); });
+	std::vector<int> res = *lists[0];
+	std::vector<int> tmp;
+	for (size_t i = 1; i < lists.size() && !res.empty(); ++i) {
+		tmp.clear();
+		std::set_intersection(res.begin(), res.end(), lists[i]->begin(), lists[i]->end(), std::back_inserter(tmp));
+		res.swap(tmp);
 	}
+	res.erase(std::remove_if(res.begin(), res.end(), [this, &s](int id) { return !wordsById[id]->first.contains(s); }),
+		  res.end());
+	return res;
 }
 
-std::vector<dive *> FullText::findDives(const QString &s, StringFilterMode mode) const
+// Find the sorted ids of all words matching a given string.
+std::vector<int> FullText::findWords(const QString &s, StringFilterMode mode) const
 {
 	switch (mode) {
 	case StringFilterMode::EXACT:
@@ -233,33 +426,34 @@ std::vector<dive *> FullText::findDives(const QString &s, StringFilterMode mode)
 		auto it = words.find(s);
 		if (it == words.end())
 			return {};
-		return it->second;
+		return { it->second.id };
 	}
 	case StringFilterMode::STARTSWITH: {
 		// Find all words that start with a substring. We use the fact
 		// that these words must form a contiguous block, since the words are
 		// ordered lexicographically.
-		auto it = words.lower_bound(s);
-		if (it == words.end() || !it->first.startsWith(s))
-			return {};
-		std::vector<dive *> res = it->second;
-		++it;
-		while (it != words.end() && it->first.startsWith(s)) {
-			combineDives(res, it->second);
-			++it;
-		}
+		std::vector<int> res;
+		for (auto it = words.lower_bound(s); it != words.end() && it->first.startsWith(s); ++it)
+			res.push_back(it->second.id);
+		std::sort(res.begin(), res.end());
 		return res;
 	}
-	case StringFilterMode::SUBSTRING: {
-		// Find all words that contain a substring. Here, we have to check all words!
-		std::vector<dive *> res;
-		for (auto it = words.begin(); it != words.end(); ++it) {
-			if (it->first.contains(s))
-				combineDives(res, it->second);
-		}
-		return res;
+	case StringFilterMode::SUBSTRING:
+		return findSubstring(s);
 	}
+}
+
+// Find the dives containing a word matching the given string. The result is sorted.
+std::vector<dive *> FullText::findDives(const QString &s, StringFilterMode mode) const
+{
+	std::vector<dive *> res;
+	for (int id: findWords(s, mode)) {
+		const std::vector<dive *> &dives = wordsById[id]->second.dives;
+		res.insert(res.end(), dives.begin(), dives.end());
 	}
+	std::sort(res.begin(), res.end());
+	res.erase(std::unique(res.begin(), res.end()), res.end());
+	return res;
 }
 
 FullTextResult FullText::find(const FullTextQuery &q, StringFilterMode mode) const
@@ -267,22 +461,39 @@ FullTextResult FullText::find(const FullTextQuery &q, StringFilterMode mode) con
 	if (q.words.empty())
 		return FullTextResult();
 
+	QReadLocker locker(&lock);
 	std::vector<dive *> res = findDives(q.words[0], mode);
-	for (size_t i = 1; i < q.words.size(); ++i) {
+	std::vector<dive *> tmp;
+	for (size_t i = 1; i < q.words.size() && !res.empty(); ++i) {
 		std::vector<dive *> res2 = findDives(q.words[i], mode);
 		// Remove dives from res that are not in res2
-		res.erase(std::remove_if(res.begin(), res.end(),
-				[&res2] (dive *d) { return std::find(res2.begin(), res2.end(), d) == res2.end(); }), res.end());
+		tmp.clear();
+		std::set_intersection(res.begin(), res.end(), res2.begin(), res2.end(), std::back_inserter(tmp));
+		res.swap(tmp);
 	}
 
 	return { std::move(res) };
 }
 
+FullTextWords FullText::findWords(const FullTextQuery &q, StringFilterMode mode) const
+{
+	FullTextWords res;
+	res.doit = q.doit();
+	QReadLocker locker(&lock);
+	res.matching.resize(wordsById.size(), false);
+	for (const QString &word: q.words) {
+		for (int id: findWords(word, mode))
+			res.matching[id] = true;
+	}
+	return res;
+}
+
 FullTextQuery &FullTextQuery::operator=(const QString &s)
 {
 	originalQuery = s;
-	words.clear();
-	tokenize(s, words);
+	Tokenizer t;
+	t.add(s);
+	words = t.take();
 	return *this;
 }
 
@@ -293,5 +504,5 @@ bool FullTextQuery::doit() const
 
 bool FullTextResult::dive_matches(const struct dive *d) const
 {
-	return std::find(dives.begin(), dives.end(), d) != dives.end();
+	return std::binary_search(dives.begin(), dives.end(), d);
 }
@@ -52,15 +52,24 @@ struct FullTextQuery {
 
 // Describes the result of a fulltext search
 struct FullTextResult {
-	std::vector<dive *> dives;
+	std::vector<dive *> dives; // Sorted, so that matches can be tested by binary search
 	bool dive_matches(const struct dive *d) const;
 };
 
+// The words of the index matching any word of a query. Used to test single dives
+// without looking up the query words in the index for every dive.
+struct FullTextWords {
+	std::vector<bool> matching; // Indexed by word-id
+	bool doit = false; // false if the query was empty
+};
+
 // Two search modes:
 //	1) Find all dives matching the query.
-//	2) Test if a given dive matches the query.
+//	2) Test if a given dive matches the query. For that, the words of the
+//	   query have to be looked up first.
 FullTextResult fulltext_find_dives(const FullTextQuery &q, StringFilterMode);
-bool fulltext_dive_matches(const struct dive *d, const FullTextQuery &q, StringFilterMode);
+FullTextWords fulltext_find_words(const FullTextQuery &q, StringFilterMode);
+bool fulltext_dive_matches(const struct dive *d, const FullTextWords &w);
 
 #endif
 #endif
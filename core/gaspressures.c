@@ -11,11 +11,14 @@
  *                                  -> fill_missing_tank_pressures() -> fill_missing_segment_pressures()
  *                                                                   -> get_pr_interpolate_data()
  *
- *  The pr_track_t related functions below implement a linked list that is used by
- *  the majority of the functions below. The linked list covers a part of the dive profile
- *  for which there are no cylinder pressure data. Each element in the linked list
- *  represents a segment between two consecutive points on the dive profile.
- *  pr_track_t is defined in gaspressures.h
+ *  The pressure-times of the plot entries are summed up in a prefix-sum array, so
+ *  that the pressure-time of any range of entries can be read off in constant time.
+ *
+ *  The pr_track_t structures are kept in an array of segments per cylinder, which
+ *  is used by the majority of the functions below. The array covers a part of the dive
+ *  profile for which there are no cylinder pressure data. Each element in the array
+ *  represents a segment between two consecutive points on the dive profile. The
+ *  segments are ordered by time, so that they can be walked with a cursor.
  */
 
 #include "ssrf.h"
@@ -38,7 +41,12 @@ struct pr_track_struct {
 	int t_start;
 	int t_end;
 	int pressure_time;
-	pr_track_t *next;
+};
+
+/* The segments of one cylinder, allocated in one go */
+struct pr_track_table {
+	int nr;
+	pr_track_t *segments;
 };
 
 typedef struct pr_interpolate_struct pr_interpolate_t;
@@ -51,61 +59,28 @@ struct pr_interpolate_struct {
 
 enum interpolation_strategy {SAC, TIME, CONSTANT};
 
-static pr_track_t *pr_track_alloc(int start, int t_start)
+static pr_track_t *pr_track_add(struct pr_track_table *track, int start, int t_start)
 {
-	pr_track_t *pt = malloc(sizeof(pr_track_t));
+	pr_track_t *pt = &track->segments[track->nr++];
 	pt->start = start;
 	pt->end = 0;
 	pt->t_start = pt->t_end = t_start;
 	pt->pressure_time = 0;
-	pt->next = NULL;
 	return pt;
 }
 
-/* poor man's linked list */
-static pr_track_t *list_last(pr_track_t *list)
-{
-	pr_track_t *tail = list;
-	if (!tail)
-		return NULL;
-	while (tail->next) {
-		tail = tail->next;
-	}
-	return tail;
-}
-
-static pr_track_t *list_add(pr_track_t *list, pr_track_t *element)
-{
-	pr_track_t *tail = list_last(list);
-	if (!tail)
-		return element;
-	tail->next = element;
-	return list;
-}
-
-static void list_free(pr_track_t *list)
-{
-	if (!list)
-		return;
-	list_free(list->next);
-	free(list);
-}
-
 #ifdef DEBUG_PR_TRACK
-static void dump_pr_track(int cyl, pr_track_t *track_pr)
+static void dump_pr_track(int cyl, const struct pr_track_table *track)
 {
-	pr_track_t *list;
-
 	printf("cyl%d:\n", cyl);
-	list = track_pr;
-	while (list) {
+	for (int i = 0; i < track->nr; i++) {
+		const pr_track_t *list = &track->segments[i];
 		printf("   start %f end %f t_start %d:%02d t_end %d:%02d pt %d\n",
 		       mbar_to_PSI(list->start),
 		       mbar_to_PSI(list->end),
 		       FRACTION(list->t_start, 60),
 		       FRACTION(list->t_end, 60),
 		       list->pressure_time);
-		list = list->next;
 	}
 }
 #endif
@@ -128,11 +103,13 @@ static void dump_pr_track(int cyl, pr_track_t *track_pr)
  * segments according to how big of a time_pressure area
  * they have.
  */
-static void fill_missing_segment_pressures(pr_track_t *list, enum interpolation_strategy strategy)
+static void fill_missing_segment_pressures(struct pr_track_table *track, enum interpolation_strategy strategy)
 {
 	double magic;
+	pr_track_t *list = track->segments;
+	pr_track_t *last = track->segments + track->nr - 1;
 
-	while (list) {
+	while (list <= last) {
 		int start = list->start, end;
 		pr_track_t *tmp = list;
 		int pt_sum = 0, pt = 0;
@@ -143,9 +120,9 @@ static void fill_missing_segment_pressures(pr_track_t *list, enum interpolation_
 			if (end)
 				break;
 			end = start;
-			if (!tmp->next)
+			if (tmp == last)
 				break;
-			tmp = tmp->next;
+			tmp++;
 		}
 
 		if (!start)
@@ -172,7 +149,7 @@ static void fill_missing_segment_pressures(pr_track_t *list, enum interpolation_
 				list->end = pressure;
 				if (list == tmp)
 					break;
-				list = list->next;
+				list++;
 				list->start = pressure;
 			}
 			break;
@@ -189,7 +166,7 @@ static void fill_missing_segment_pressures(pr_track_t *list, enum interpolation_
 		}
 
 		/* Ok, we've done that set of segments */
-		list = list->next;
+		list++;
 	}
 }
 
@@ -202,53 +179,76 @@ void dump_pr_interpolate(int i, pr_interpolate_t interpolate_pr)
 #endif
 
 
-static struct pr_interpolate_struct get_pr_interpolate_data(pr_track_t *segment, struct plot_info *pi, int cur)
+/* Index of the first plot entry at or after the given time. The plot entries are sorted by time. */
+static int first_entry_at(const struct plot_info *pi, int sec, int from)
+{
+	int lo = from, hi = pi->nr;
+
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (pi->entry[mid].sec < sec)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/*
+ * pt_sum is the prefix sum of the pressure-time of the plot entries, i.e.
+ * pt_sum[i] is the sum of the pressure-times of the entries 0 to i-1.
+ * Thus, the pressure-time over a range of entries is a simple difference.
+ */
+static struct pr_interpolate_struct get_pr_interpolate_data(pr_track_t *segment, struct plot_info *pi, const int64_t *pt_sum, int cur)
 { // cur = index to pi->entry corresponding to t_end of segment;
 	struct pr_interpolate_struct interpolate;
-	int i;
-	struct plot_data *entry;
+	int first, last, acc_last;
 
 	interpolate.start = segment->start;
 	interpolate.end = segment->end;
-	interpolate.acc_pressure_time = 0;
-	interpolate.pressure_time = 0;
 
-	for (i = 0; i < pi->nr; i++) {
-		entry = pi->entry + i;
-
-		if (entry->sec < segment->t_start)
-			continue;
-		interpolate.pressure_time += entry->pressure_time;
-		if (entry->sec >= segment->t_end)
-			break;
-		if (i <= cur)
-			interpolate.acc_pressure_time += entry->pressure_time;
-	}
+	/* The segment covers the entries from the first at t_start up to and
+	 * including the first entry at t_end. The accumulated pressure-time
+	 * covers the entries up to 'cur', excluding the one at t_end. */
+	first = first_entry_at(pi, segment->t_start, 0);
+	last = first_entry_at(pi, segment->t_end, first);
+	acc_last = last < cur + 1 ? last : cur + 1;
+	if (last >= pi->nr)
+		last = pi->nr - 1;
+
+	interpolate.pressure_time = last >= first ? (int)(pt_sum[last + 1] - pt_sum[first]) : 0;
+	interpolate.acc_pressure_time = acc_last > first ? (int)(pt_sum[acc_last] - pt_sum[first]) : 0;
 	return interpolate;
 }
 
-static void fill_missing_tank_pressures(const struct dive *dive, struct plot_info *pi, pr_track_t *track_pr, int cyl)
+static void fill_missing_tank_pressures(const struct dive *dive, struct plot_info *pi, struct pr_track_table *track, int cyl)
 {
-	int i;
+	int i, seg;
 	struct plot_data *entry;
 	pr_interpolate_t interpolate = { 0, 0, 0, 0 };
 	pr_track_t *last_segment = NULL;
 	int cur_pr;
 	enum interpolation_strategy strategy;
+	int64_t *pt_sum;
 
 	/* no segment where this cylinder is used */
-	if (!track_pr)
+	if (!track->nr)
 		return;
 
+	pt_sum = malloc((pi->nr + 1) * sizeof(*pt_sum));
+	pt_sum[0] = 0;
+	for (i = 0; i < pi->nr; i++)
+		pt_sum[i + 1] = pt_sum[i] + pi->entry[i].pressure_time;
+
 	if (get_cylinder(dive, cyl)->cylinder_use == OC_GAS)
 		strategy = SAC;
 	else
 		strategy = TIME;
-	fill_missing_segment_pressures(track_pr, strategy); // Interpolate the missing tank pressure values ..
-	cur_pr = track_pr->start;			       // in the pr_track_t lists of structures
-							       // and keep the starting pressure for each cylinder.
+	fill_missing_segment_pressures(track, strategy); // Interpolate the missing tank pressure values ..
+	cur_pr = track->segments[0].start;		// in the pr_track_t array of structures
+							// and keep the starting pressure for each cylinder.
 #ifdef DEBUG_PR_TRACK
-	dump_pr_track(cyl, track_pr);
+	dump_pr_track(cyl, track);
 #endif
 
 	/* Transfer interpolated cylinder pressures from pr_track strucktures to plotdata
@@ -260,7 +260,11 @@ static void fill_missing_tank_pressures(const struct dive *dive, struct plot_inf
 	 * to the plot_info structure, allowing us to plot the tank pressure.
 	 *
 	 * The first two pi structures are "fillers", but in case we don't have a sample
-	 * at time 0 we need to process the second of them here, therefore i=1 */
+	 * at time 0 we need to process the second of them here, therefore i=1.
+	 *
+	 * Both the plot entries and the segments are sorted by time, therefore the
+	 * segment corresponding to an entry is found by advancing a cursor. */
+	seg = 0;
 	for (i = 1; i < pi->nr; i++) { // For each point on the profile:
 		double magic;
 		pr_track_t *segment;
@@ -277,13 +281,13 @@ static void fill_missing_tank_pressures(const struct dive *dive, struct plot_inf
 		}
 		// If there is NO valid pressure value..
 		// Find the pressure segment corresponding to this entry..
-		segment = track_pr;
-		while (segment && segment->t_end < entry->sec) // Find the track_pr with end time..
-			segment = segment->next;	       // ..that matches the plot_info time (entry->sec)
+		while (seg < track->nr && track->segments[seg].t_end < entry->sec) // Find the segment with end time..
+			seg++;							     // ..that matches the plot_info time (entry->sec)
 
 		// After last segment? All done.
-		if (!segment)
+		if (seg >= track->nr)
 			break;
+		segment = &track->segments[seg];
 
 		// Before first segment, or between segments.. Go on, no interpolation.
 		if (segment->t_start > entry->sec)
@@ -300,7 +304,7 @@ static void fill_missing_tank_pressures(const struct dive *dive, struct plot_inf
 			interpolate.acc_pressure_time += entry->pressure_time;
 		} else {
 			// Set up an interpolation structure
-			interpolate = get_pr_interpolate_data(segment, pi, i);
+			interpolate = get_pr_interpolate_data(segment, pi, pt_sum, i);
 			last_segment = segment;
 		}
 
@@ -320,6 +324,8 @@ static void fill_missing_tank_pressures(const struct dive *dive, struct plot_inf
 		}
 		set_plot_pressure_data(pi, i, INTERPOLATED_PR, cyl, cur_pr); // and store the interpolated data in plot_info
 	}
+
+	free(pt_sum);
 }
 
 
@@ -357,11 +363,11 @@ static void debug_print_pressures(struct plot_info *pi)
 
 /* This function goes through the list of tank pressures, of structure plot_info for the dive profile where each
  * item in the list corresponds to one point (node) of the profile. It finds values for which there are no tank
- * pressures (pressure==0). For each missing item (node) of tank pressure it creates a pr_track_alloc structure
- * that represents a segment on the dive profile and that contains tank pressures. There is a linked list of
- * pr_track_alloc structures for each cylinder. These pr_track_alloc structures ultimately allow for filling
+ * pressures (pressure==0). For each missing item (node) of tank pressure it adds a pr_track_t structure
+ * that represents a segment on the dive profile and that contains tank pressures. There is an array of
+ * pr_track_t structures for each cylinder. These pr_track_t structures ultimately allow for filling
  * the missing tank pressure values on the dive profile using the depth_pressure of the dive. To do this, it
- * calculates the summed pressure-time value for the duration of the dive and stores these * in the pr_track_alloc
+ * calculates the summed pressure-time value for the duration of the dive and stores these * in the pr_track_t
  * structures. This function is called by create_plot_info_new() in profile.c
  */
 void populate_pressure_information(const struct dive *dive, const struct divecomputer *dc, struct plot_info *pi, int sensor)
@@ -369,7 +375,7 @@ void populate_pressure_information(const struct dive *dive, const struct divecom
 	UNUSED(dc);
 	int first, last, cyl;
 	cylinder_t *cylinder = get_cylinder(dive, sensor);
-	pr_track_t *track = NULL;
+	struct pr_track_table track = { 0, NULL };
 	pr_track_t *current = NULL;
 	const struct event *ev, *b_ev;
 	int missing_pr = 0, dense = 1;
@@ -400,6 +406,9 @@ void populate_pressure_information(const struct dive *dive, const struct divecom
 	if (first == last)
 		return;
 
+	/* Every entry in the range starts at most one segment, so allocate them in one go */
+	track.segments = malloc((last - first + 1) * sizeof(*track.segments));
+
 	/*
 	 * Split the range:
 	 *  - missing pressure data
@@ -471,18 +480,17 @@ void populate_pressure_information(const struct dive *dive, const struct divecom
 		// missing entries that need to be interpolated.
 		// Or maybe we didn't have a previous one at all,
 		// and this is the first pressure entry.
-		current = pr_track_alloc(pressure, entry->sec);
-		track = list_add(track, current);
+		current = pr_track_add(&track, pressure, entry->sec);
 		dense = 1;
 	}
 
 	if (missing_pr) {
-		fill_missing_tank_pressures(dive, pi, track, sensor);
+		fill_missing_tank_pressures(dive, pi, &track, sensor);
 	}
 
 #ifdef PRINT_PRESSURES_DEBUG
 	debug_print_pressures(pi);
 #endif
 
-	list_free(track);
+	free(track.segments);
 }
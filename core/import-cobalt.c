@@ -18,6 +18,9 @@
 #include "membuffer.h"
 #include "gettext.h"
 
+/* Statement slots of the per-dive queries, see sql_exec_id() */
+enum { CO_CYLINDERS, CO_BUDDIES, CO_VISIBILITY, CO_LOCATION, CO_SITE, CO_PROFILE };
+
 static int cobalt_profile_sample(void *param, int columns, char **data, char **column)
 {
 	UNUSED(columns);
@@ -105,15 +108,13 @@ static int cobalt_dive(void *param, int columns, char **data, char **column)
 
 	int retval = 0;
 	struct parser_state *state = (struct parser_state *)param;
-	sqlite3 *handle = state->sql_handle;
 	char *location, *location_site;
-	char get_profile_template[] = "select runtime*60,(DepthPressure*10000/SurfacePressure)-10000,p.Temperature from Dive AS d JOIN TrackPoints AS p ON d.Id=p.DiveId where d.Id=%d";
-	char get_cylinder_template[] = "select FO2,FHe,StartingPressure,EndingPressure,TankSize,TankPressure,TotalConsumption from GasMixes where DiveID=%d and StartingPressure>0 and EndingPressure > 0 group by FO2,FHe";
-	char get_buddy_template[] = "select l.Data from Items AS i, List AS l ON i.Value1=l.Id where i.DiveId=%d and l.Type=4";
-	char get_visibility_template[] = "select l.Data from Items AS i, List AS l ON i.Value1=l.Id where i.DiveId=%d and l.Type=3";
-	char get_location_template[] = "select l.Data from Items AS i, List AS l ON i.Value1=l.Id where i.DiveId=%d and l.Type=0";
-	char get_site_template[] = "select l.Data from Items AS i, List AS l ON i.Value1=l.Id where i.DiveId=%d and l.Type=1";
-	char get_buffer[1024];
+	char get_profile_template[] = "select runtime*60,(DepthPressure*10000/SurfacePressure)-10000,p.Temperature from Dive AS d JOIN TrackPoints AS p ON d.Id=p.DiveId where d.Id=?";
+	char get_cylinder_template[] = "select FO2,FHe,StartingPressure,EndingPressure,TankSize,TankPressure,TotalConsumption from GasMixes where DiveID=? and StartingPressure>0 and EndingPressure > 0 group by FO2,FHe";
+	char get_buddy_template[] = "select l.Data from Items AS i, List AS l ON i.Value1=l.Id where i.DiveId=? and l.Type=4";
+	char get_visibility_template[] = "select l.Data from Items AS i, List AS l ON i.Value1=l.Id where i.DiveId=? and l.Type=3";
+	char get_location_template[] = "select l.Data from Items AS i, List AS l ON i.Value1=l.Id where i.DiveId=? and l.Type=0";
+	char get_site_template[] = "select l.Data from Items AS i, List AS l ON i.Value1=l.Id where i.DiveId=? and l.Type=1";
 
 	dive_start(state);
 	state->cur_dive->number = atoi(data[0]);
@@ -159,36 +160,31 @@ static int cobalt_dive(void *param, int columns, char **data, char **column)
 		state->cur_dive->dc.model = strdup("Cobalt import");
 	}
 
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_cylinder_template, state->cur_dive->number);
-	retval = sqlite3_exec(handle, get_buffer, &cobalt_cylinders, state, NULL);
+	retval = sql_exec_id(state, CO_CYLINDERS, get_cylinder_template, state->cur_dive->number, &cobalt_cylinders, state);
 	if (retval != SQLITE_OK) {
 		fprintf(stderr, "%s", "Database query cobalt_cylinders failed.\n");
 		return 1;
 	}
 
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_buddy_template, state->cur_dive->number);
-	retval = sqlite3_exec(handle, get_buffer, &cobalt_buddies, state, NULL);
+	retval = sql_exec_id(state, CO_BUDDIES, get_buddy_template, state->cur_dive->number, &cobalt_buddies, state);
 	if (retval != SQLITE_OK) {
 		fprintf(stderr, "%s", "Database query cobalt_buddies failed.\n");
 		return 1;
 	}
 
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_visibility_template, state->cur_dive->number);
-	retval = sqlite3_exec(handle, get_buffer, &cobalt_visibility, state, NULL);
+	retval = sql_exec_id(state, CO_VISIBILITY, get_visibility_template, state->cur_dive->number, &cobalt_visibility, state);
 	if (retval != SQLITE_OK) {
 		fprintf(stderr, "%s", "Database query cobalt_visibility failed.\n");
 		return 1;
 	}
 
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_location_template, state->cur_dive->number);
-	retval = sqlite3_exec(handle, get_buffer, &cobalt_location, &location, NULL);
+	retval = sql_exec_id(state, CO_LOCATION, get_location_template, state->cur_dive->number, &cobalt_location, &location);
 	if (retval != SQLITE_OK) {
 		fprintf(stderr, "%s", "Database query cobalt_location failed.\n");
 		return 1;
 	}
 
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_site_template, state->cur_dive->number);
-	retval = sqlite3_exec(handle, get_buffer, &cobalt_location, &location_site, NULL);
+	retval = sql_exec_id(state, CO_SITE, get_site_template, state->cur_dive->number, &cobalt_location, &location_site);
 	if (retval != SQLITE_OK) {
 		fprintf(stderr, "%s", "Database query cobalt_location (site) failed.\n");
 		return 1;
@@ -208,8 +204,7 @@ static int cobalt_dive(void *param, int columns, char **data, char **column)
 	free(location);
 	free(location_site);
 
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_profile_template, state->cur_dive->number);
-	retval = sqlite3_exec(handle, get_buffer, &cobalt_profile_sample, state, NULL);
+	retval = sql_exec_id(state, CO_PROFILE, get_profile_template, state->cur_dive->number, &cobalt_profile_sample, state);
 	if (retval != SQLITE_OK) {
 		fprintf(stderr, "%s", "Database query cobalt_profile_sample failed.\n");
 		return 1;
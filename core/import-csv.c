@@ -1,11 +1,13 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <math.h>
 #include <libdivecomputer/parser.h>
 
 #include "dive.h"
 #include "errorhelper.h"
 #include "ssrf.h"
+#include "subsurface-float.h"
 #include "subsurface-string.h"
 #include "divelist.h"
 #include "divelog.h"
@@ -16,6 +18,7 @@
 #include "gettext.h"
 #include "import-csv.h"
 #include "qthelper.h"
+#include "strndup.h"
 #include "xmlparams.h"
 
 #define MATCH(buffer, pattern) \
@@ -277,20 +280,789 @@ static int parse_dan_format(const char *filename, struct xml_params *params, str
 	return ret;
 }
 
-int parse_csv_file(const char *filename, struct xml_params *params, const char *csvtemplate, struct divelog *log)
+/*
+ * A native reader for the profiles that the "csv" template handles. It
+ * produces the same dive as xslt/csv2xml.xslt followed by the XML parser,
+ * but fills in the samples directly. For long profiles that is a lot
+ * faster: the XSLT walks the file with recursive templates and every
+ * sample has to be written out as XML and parsed back in.
+ *
+ * The template parameters are XPath expressions. Only the plain values
+ * that the import dialog passes are understood here; anything else, as
+ * well as the parameters of the Seabear and APD imports, is left to the
+ * XSLT.
+ */
+struct csv_profile {
+	char separator;
+	bool metric, apd;
+	int datefmt;
+	int date_field, starttime_field, number_field;
+	int time_field, depth_field, temp_field, po2_field, setpoint_field, sensor_field[3];
+	int cns_field, ndl_field, tts_field, stopdepth_field, pressure_field, heartbeat_field;
+	const char *date, *time;
+	char *model;
+	char *field;		/* the field last returned by csv_field() */
+	size_t field_size;
+};
+
+static const char *csv_param(const struct xml_params *params, const char *key)
+{
+	for (int i = 0; i < xml_params_count(params); i++) {
+		if (!strcmp(xml_params_get_key(params, i), key))
+			return xml_params_get_value(params, i);
+	}
+	return NULL;
+}
+
+/* A missing parameter is an empty node-set, which compares like -1 */
+static bool csv_int_param(const struct xml_params *params, const char *key, int *res)
+{
+	const char *value = csv_param(params, key);
+	const char *p;
+
+	*res = -1;
+	if (!value)
+		return true;
+	p = *value == '-' ? value + 1 : value;
+	if (!*p || strspn(p, "0123456789") != strlen(p) || strlen(p) > 6)
+		return false;
+	*res = atoi(value);
+	return true;
+}
+
+/* The date and time parameters are numbers that are used as strings */
+static bool csv_digits_param(const struct xml_params *params, const char *key, const char **res)
+{
+	const char *value = csv_param(params, key);
+
+	*res = value ? value : "";
+	return !value || (*value && *value != '0' && strlen(value) <= 15 &&
+			  strspn(value, "0123456789") == strlen(value));
+}
+
+/* The model has to be a string literal */
+static bool csv_model_param(const struct xml_params *params, char **res)
+{
+	const char *value = csv_param(params, "hw");
+	size_t len;
+
+	*res = NULL;
+	if (!value || !*value) {
+		*res = strdup("Imported from CSV");
+		return true;
+	}
+	len = strlen(value);
+	if (len < 2 || (*value != '"' && *value != '\'') || value[len - 1] != *value ||
+	    memchr(value + 1, *value, len - 2))
+		return false;
+	if (len == 2) {
+		*res = strdup("Imported from CSV");
+		return true;
+	}
+	*res = strndup(value + 1, len - 2);
+	if (!trimspace(*res)) {
+		free(*res);
+		*res = NULL;
+	}
+	return true;
+}
+
+static bool csv_profile_init(struct csv_profile *csv, const struct xml_params *params)
+{
+	static const char *const unsupported[] = {
+		"delta", "diveNro", "diveMode", "Firmware", "Serial", "GF",
+		"maxDepth", "meanDepth", "airTemp", "waterTemp", "otuField"
+	};
+	int units, separator;
+
+	memset(csv, 0, sizeof(*csv));
+	for (size_t i = 0; i < sizeof(unsupported) / sizeof(unsupported[0]); i++) {
+		if (csv_param(params, unsupported[i]))
+			return false;
+	}
+	if (!csv_int_param(params, "units", &units) ||
+	    !csv_int_param(params, "separatorIndex", &separator) ||
+	    !csv_int_param(params, "datefmt", &csv->datefmt) ||
+	    !csv_int_param(params, "dateField", &csv->date_field) ||
+	    !csv_int_param(params, "starttimeField", &csv->starttime_field) ||
+	    !csv_int_param(params, "numberField", &csv->number_field) ||
+	    !csv_int_param(params, "timeField", &csv->time_field) ||
+	    !csv_int_param(params, "depthField", &csv->depth_field) ||
+	    !csv_int_param(params, "tempField", &csv->temp_field) ||
+	    !csv_int_param(params, "po2Field", &csv->po2_field) ||
+	    !csv_int_param(params, "setpointField", &csv->setpoint_field) ||
+	    !csv_int_param(params, "o2sensor1Field", &csv->sensor_field[0]) ||
+	    !csv_int_param(params, "o2sensor2Field", &csv->sensor_field[1]) ||
+	    !csv_int_param(params, "o2sensor3Field", &csv->sensor_field[2]) ||
+	    !csv_int_param(params, "cnsField", &csv->cns_field) ||
+	    !csv_int_param(params, "ndlField", &csv->ndl_field) ||
+	    !csv_int_param(params, "ttsField", &csv->tts_field) ||
+	    !csv_int_param(params, "stopdepthField", &csv->stopdepth_field) ||
+	    !csv_int_param(params, "pressureField", &csv->pressure_field) ||
+	    !csv_int_param(params, "heartBeat", &csv->heartbeat_field) ||
+	    !csv_digits_param(params, "date", &csv->date) ||
+	    !csv_digits_param(params, "time", &csv->time) ||
+	    !csv_model_param(params, &csv->model))
+		return false;
+
+	csv->field_size = 256;
+	csv->field = malloc(csv->field_size);
+	if (!csv->field) {
+		free(csv->model);
+		return false;
+	}
+	csv->metric = units == 0;
+	csv->separator = separator == 0 ? '\t' : separator == 2 ? ';' : separator == 3 ? '|' : ',';
+	csv->apd = csv->model && strstr(csv->model, "APD");
+	return true;
+}
+
+static void csv_profile_free(struct csv_profile *csv)
+{
+	free(csv->model);
+	free(csv->field);
+}
+
+static char *csv_copy(struct csv_profile *csv, const char *start, size_t len)
+{
+	memcpy(csv->field, start, len);
+	csv->field[len] = 0;
+	return csv->field;
+}
+
+/* Remove the quotes around and doubled quotes within a quoted field */
+static char *csv_unquote(struct csv_profile *csv, const char *field, const char *end)
+{
+	char *out = csv->field;
+
+	for (;;) {
+		const char *quote = memchr(field, '"', end - field);
+
+		if (out != csv->field)
+			*out++ = '"';
+		if (!quote || quote == field) {
+			memcpy(out, field, end - field);
+			out += end - field;
+			break;
+		}
+		memcpy(out, field, quote - field);
+		out += quote - field;
+		quote = memchr(quote + 1, '"', end - quote - 1);
+		field = quote ? quote + 1 : end;
+	}
+	*out = 0;
+	return csv->field;
+}
+
+/*
+ * Field number idx of the line, extracted like getFieldByIndex in
+ * commonTemplates.xsl does it. Quotes only matter for the field itself,
+ * not for finding it. A negative index means the first field. The
+ * returned string is valid until the next call.
+ */
+static char *csv_field(struct csv_profile *csv, const char *line, size_t len, int idx)
+{
+	const char *end = line + len;
+	const char *p;
+
+	if (len + 1 > csv->field_size) {
+		char *field = realloc(csv->field, len + 1);
+		if (!field)
+			return csv_copy(csv, line, 0);
+		csv->field = field;
+		csv->field_size = len + 1;
+	}
+	for (; idx > 0; idx--) {
+		p = memchr(line, csv->separator, end - line);
+		line = p ? p + 1 : end;
+	}
+	if (line < end && *line == '"') {
+		const char *rest = line + 1, *close = NULL;
+
+		/* A quoted field ends at a quote followed by the separator */
+		for (p = rest; p + 1 < end; p++) {
+			if (p[0] == '"' && p[1] == csv->separator) {
+				close = p;
+				break;
+			}
+		}
+		if (close) {
+			p = memchr(rest, '"', close - rest);
+			if (p && p > rest)
+				return csv_unquote(csv, rest, close);
+		}
+		if (end[-1] == '"') {
+			p = memchr(rest, '"', end - rest);
+			return csv_copy(csv, rest, p ? p - rest : 0);
+		}
+		return csv_copy(csv, rest, close ? close - rest : 0);
+	}
+	p = memchr(line, csv->separator, end - line);
+	return csv_copy(csv, line, p ? p - line : end - line);
+}
+
+static bool csv_blank(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/* Empty or blank values don't make it into the XML parser */
+static bool csv_empty(const char *value)
+{
+	while (csv_blank(*value))
+		value++;
+	return !*value;
+}
+
+static bool csv_digit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+/*
+ * XPath's number() as libxml2 implements it: an optional minus sign,
+ * digits with an optional decimal point and exponent, surrounded by
+ * blanks. Everything else is NaN, except for a lone minus sign, which
+ * is zero. If comma is set, a comma is taken as the decimal point like
+ * translate(value, ',', '.') would do.
+ */
+static double csv_number(const char *s, size_t len, bool comma)
+{
+	const char *end = s + len;
+	double ret = 0.0;
+	int exponent = 0;
+	bool neg = false, exponent_neg = false, ok = false;
+
+	while (s < end && csv_blank(*s))
+		s++;
+	if (s >= end || (*s != '.' && !(comma && *s == ',') && !csv_digit(*s) && *s != '-'))
+		return NAN;
+	if (*s == '-') {
+		neg = true;
+		s++;
+	}
+	for (; s < end && csv_digit(*s); s++) {
+		ret = ret * 10 + (*s - '0');
+		ok = true;
+	}
+	if (s < end && (*s == '.' || (comma && *s == ','))) {
+		double fraction = 0.0;
+		int frac = 0, max;
+
+		s++;
+		if ((s >= end || !csv_digit(*s)) && !ok)
+			return NAN;
+		for (; s < end && *s == '0'; s++)
+			frac++;
+		max = frac + 20;
+		for (; s < end && csv_digit(*s) && frac < max; s++, frac++)
+			fraction = fraction * 10 + (*s - '0');
+		ret += fraction / pow(10.0, frac);
+		while (s < end && csv_digit(*s))
+			s++;
+	}
+	if (s < end && (*s == 'e' || *s == 'E')) {
+		s++;
+		if (s < end && *s == '-') {
+			exponent_neg = true;
+			s++;
+		} else if (s < end && *s == '+') {
+			s++;
+		}
+		for (; s < end && csv_digit(*s); s++) {
+			if (exponent < 1000000)
+				exponent = exponent * 10 + (*s - '0');
+		}
+	}
+	while (s < end && csv_blank(*s))
+		s++;
+	if (s != end)
+		return NAN;
+	if (neg)
+		ret = -ret;
+	return ret * pow(10.0, exponent_neg ? -exponent : exponent);
+}
+
+/* The numbers that format-number() rounds to the given decimals */
+static double csv_round(double val, double scale)
+{
+	return copysign(floor(fabs(val) * scale + 0.5) / scale, val);
+}
+
+/* parse_float() of the XML parser */
+static bool csv_float(const char *buffer, double *res)
+{
+	const char *end;
+	double val;
+
+	errno = 0;
+	val = ascii_strtod(buffer, &end);
+	if (errno || end == buffer)
+		return false;
+	if (*end == ',' && nearly_equal(val, rint(val)))
+		val = strtod_flags(buffer, &end, 0);
+	*res = val;
+	return true;
+}
+
+/* sampletime() of the XML parser */
+static int csv_sampletime(const char *buffer)
+{
+	int hr, min, sec;
+
+	switch (sscanf(buffer, "%d:%d:%d", &hr, &min, &sec)) {
+	case 1:
+		return hr;
+	case 2:
+		return hr * 60 + min;
+	case 3:
+		return (hr * 60 + min) * 60 + sec;
+	default:
+		return 0;
+	}
+}
+
+/* The sec2time template and sampletime() together */
+static int csv_sec2time(double t)
+{
+	if (!isfinite(t) || fabs(t) > 1e9)
+		return 0;
+	return (int)floor(t / 60) * 60 + (int)csv_round(fmod(t, 60), 1);
+}
+
+/* A number written out by the XSLT and read back with sampletime() */
+static int csv_truncate(double t)
+{
+	return isfinite(t) && fabs(t) < 1e9 ? (int)t : 0;
+}
+
+/*
+ * The sample time of a line, in seconds, minutes with decimals, m:s or
+ * h:m:s. Lines without a valid time, such as the header, are skipped.
+ */
+static bool csv_sample_time(const struct csv_profile *csv, const char *value, int *seconds)
+{
+	const char *sep, *colon, *rest;
+	double t;
+
+	if (!isnan(csv_number(value, strlen(value), true))) {
+		/* Decimals are taken as fractions of minutes */
+		if (((sep = strchr(value, '.')) && sep[1] && !csv->apd) ||
+		    ((sep = strchr(value, ',')) && sep[1]))
+			t = csv_number(value, sep - value, false) * 60 + csv_number(sep, strlen(sep), true) * 60;
+		else
+			t = csv_number(value, strlen(value), false);
+		*seconds = csv_sec2time(t);
+		return true;
+	}
+
+	colon = strchr(value, ':');
+	if (!colon || isnan(t = csv_number(value, colon - value, false)))
+		return false;
+	rest = strchr(colon + 1, ':');
+	if (!rest || !rest[1]) {
+		/* m:s */
+		*seconds = csv_truncate(t * 60 + csv_number(colon + 1, strlen(colon + 1), false));
+		return true;
+	}
+
+	/* h:m:s, passed on as m:s */
+	t = t * 60 + csv_number(colon + 1, rest - colon - 1, false);
+	if (isfinite(t) && t == floor(t) && fabs(t) < 1e9) {
+		int min, sec;
+
+		switch (sscanf(rest + 1, "%d:%d", &min, &sec)) {
+		case 2:
+			*seconds = ((int)t * 60 + min) * 60 + sec;
+			break;
+		case 1:
+			*seconds = (int)t * 60 + min;
+			break;
+		default:
+			*seconds = (int)t;
+			break;
+		}
+	} else {
+		*seconds = csv_truncate(t);
+	}
+	return true;
+}
+
+/* pressure() of the XML parser for values in bar or mbar */
+static void csv_pressure(double val, pressure_t *pressure)
+{
+	double mbar = val;
+
+	if (!val)
+		return;
+	if (fabs(mbar) < 5000)
+		mbar *= 1000;
+	if (fabs(mbar) > 5 && fabs(mbar) < 5000000)
+		pressure->mbar = lrint(mbar);
+}
+
+static void csv_temperature(double celsius, temperature_t *temperature)
+{
+	temperature->mkelvin = C_to_mkelvin(celsius);
+	/* temperatures outside -40C .. +70C are ignored */
+	if (temperature->mkelvin < ZERO_C_IN_MKELVIN - 40000 ||
+	    temperature->mkelvin > ZERO_C_IN_MKELVIN + 70000)
+		temperature->mkelvin = 0;
+}
+
+/* Turn decimal commas into points, in place */
+static char *csv_comma_to_point(char *value)
+{
+	for (char *p = value; *p; p++) {
+		if (*p == ',')
+			*p = '.';
+	}
+	return value;
+}
+
+/* The imperial values are stripped of anything but digits and decimal separators */
+static double csv_imperial_number(char *value)
+{
+	char *out = value;
+
+	for (const char *p = value; *p; p++) {
+		if (csv_digit(*p) || *p == '.')
+			*out++ = *p;
+		else if (*p == ',')
+			*out++ = '.';
+	}
+	*out = 0;
+	return csv_number(value, out - value, false);
+}
+
+static void csv_o2pressure(const char *value, o2pressure_t *o2pressure)
+{
+	if (!csv_empty(value))
+		o2pressure->mbar = lrint(ascii_strtod(value, NULL) * 1000.0);
+}
+
+static void csv_parse_sample(struct csv_profile *csv, const char *line, size_t len, struct parser_state *state)
+{
+	struct sample *sample;
+	char *value;
+	double val;
+	int seconds;
+
+	if (!csv_sample_time(csv, csv_field(csv, line, len, csv->time_field), &seconds))
+		return;
+
+	sample_start(state);
+	sample = state->cur_sample;
+	sample->time.seconds = seconds;
+
+	value = csv_field(csv, line, len, csv->depth_field);
+	if (csv->metric) {
+		if (!csv_empty(csv_comma_to_point(value)) && csv_float(value, &val))
+			sample->depth.mm = lrint(val * 1000);
+	} else {
+		val = csv_imperial_number(value);
+		if (!isnan(val))
+			sample->depth.mm = lrint(floor(val * 0.3048 * 1000 + 0.5) / 1000 * 1000);
+	}
+
+	if (csv->temp_field >= 0) {
+		value = csv_field(csv, line, len, csv->temp_field);
+		if (!*value) {
+			/* no temperature in this sample */
+		} else if (csv->metric) {
+			if (!csv_empty(csv_comma_to_point(value)) && csv_float(value, &val))
+				csv_temperature(val, &sample->temperature);
+		} else {
+			val = csv_imperial_number(value);
+			if (!isnan(val))
+				csv_temperature(csv_round((val - 32) * 5 / 9, 10), &sample->temperature);
+		}
+	}
+
+	if (csv->setpoint_field >= 0)
+		csv_o2pressure(csv_field(csv, line, len, csv->setpoint_field), &sample->setpoint);
+	else if (csv->po2_field >= 0)
+		csv_o2pressure(csv_field(csv, line, len, csv->po2_field), &sample->setpoint);
+	for (int i = 0; i < 3; i++) {
+		if (csv->sensor_field[i] >= 0)
+			csv_o2pressure(csv_field(csv, line, len, csv->sensor_field[i]), &sample->o2sensor[i]);
+	}
+
+	if (csv->cns_field >= 0) {
+		value = csv_field(csv, line, len, csv->cns_field);
+		if (!csv_empty(value))
+			sample->cns = atoi(value);
+	}
+	if (csv->ndl_field >= 0) {
+		value = csv_field(csv, line, len, csv->ndl_field);
+		if (!csv_empty(value))
+			sample->ndl.seconds = csv_sampletime(value);
+	}
+	if (csv->tts_field >= 0) {
+		value = csv_field(csv, line, len, csv->tts_field);
+		if (!csv_empty(value))
+			sample->tts.seconds = csv_sampletime(value);
+	}
+
+	if (csv->stopdepth_field >= 0) {
+		value = csv_field(csv, line, len, csv->stopdepth_field);
+		val = csv_number(value, strlen(value), false);
+		if (csv->metric) {
+			double stopdepth;
+			if (!csv_empty(value) && csv_float(value, &stopdepth))
+				sample->stopdepth.mm = lrint(stopdepth * 1000);
+		} else if (!isnan(val)) {
+			sample->stopdepth.mm = lrint(csv_round(val * 0.3048, 100) * 1000);
+		}
+		sample->in_deco = val > 0;
+	}
+
+	if (csv->pressure_field >= 0) {
+		value = csv_field(csv, line, len, csv->pressure_field);
+		val = csv_number(value, strlen(value), false);
+		if (val >= 0) {
+			if (!csv->metric)
+				csv_pressure(floor(val / 14.5037738007 + 0.5), &sample->pressure[0]);
+			else if (csv_float(value, &val))
+				csv_pressure(val, &sample->pressure[0]);
+		}
+	}
+
+	if (csv->heartbeat_field >= 0) {
+		value = csv_field(csv, line, len, csv->heartbeat_field);
+		if (!csv_empty(value))
+			sample->heartbeat = atoi(value);
+	}
+
+	sample_end(state);
+}
+
+/* divedate() of the XML parser */
+static void csv_dive_date(const char *buffer, struct parser_state *state)
+{
+	int d, m, y;
+	int hh = 0, mm = 0, ss = 0;
+
+	if (sscanf(buffer, "%d.%d.%d %d:%d:%d", &d, &m, &y, &hh, &mm, &ss) < 3 &&
+	    sscanf(buffer, "%d-%d-%d %d:%d:%d", &y, &m, &d, &hh, &mm, &ss) < 3)
+		return;
+	state->cur_tm.tm_year = y;
+	state->cur_tm.tm_mon = m - 1;
+	state->cur_tm.tm_mday = d;
+	state->cur_tm.tm_hour = hh;
+	state->cur_tm.tm_min = mm;
+	state->cur_tm.tm_sec = ss;
+	state->cur_dive->when = utc_mktime(&state->cur_tm);
+}
+
+/* divetime() of the XML parser */
+static void csv_dive_time(const char *buffer, struct parser_state *state)
+{
+	int h, m, s = 0;
+
+	if (sscanf(buffer, "%d:%d:%d", &h, &m, &s) >= 2) {
+		state->cur_tm.tm_hour = h;
+		state->cur_tm.tm_min = m;
+		state->cur_tm.tm_sec = s;
+		state->cur_dive->when = utc_mktime(&state->cur_tm);
+	}
+}
+
+/* Like XPath's substring-before() and substring-after() */
+static int csv_before(const char *s, const char *sep)
+{
+	const char *p = strstr(s, sep);
+	return p ? p - s : 0;
+}
+
+static const char *csv_after(const char *s, const char *sep)
+{
+	const char *p = strstr(s, sep);
+	return p ? p + strlen(sep) : "";
+}
+
+/* The date, time and number of the dive are taken from the third line */
+static void csv_parse_header(struct csv_profile *csv, const char *header, struct parser_state *state)
+{
+	size_t len = strcspn(header, "\n");
+	char *date;
+
+	if (csv->date_field >= 0) {
+		char *indate = strdup(csv_field(csv, header, len, csv->date_field));
+		const char *sep = "", *p, *rest, *last;
+		char *out;
+
+		if (!indate)
+			return;
+		if ((p = strchr(indate, '.')) && p > indate)
+			sep = ".";
+		else if ((p = strchr(indate, '-')) && p > indate)
+			sep = "-";
+		else if ((p = strchr(indate, '/')) && p > indate)
+			sep = "/";
+		rest = csv_after(indate, sep);
+		last = csv_after(rest, sep);
+
+		date = malloc(strlen(indate) + 16);
+		if (!date) {
+			free(indate);
+			return;
+		}
+		switch (csv->datefmt) {
+		case 0: /* dd.mm.yyyy */
+			sprintf(date, "%s-%.*s-%.*s", last, csv_before(rest, sep), rest, csv_before(indate, sep), indate);
+			break;
+		case 1: /* mm.dd.yyyy */
+			sprintf(date, "%s-%.*s-%.*s", last, csv_before(indate, sep), indate, csv_before(rest, sep), rest);
+			break;
+		case 2: /* yyyy.mm.dd */
+			sprintf(date, "%.*s-%.*s-%s", csv_before(indate, sep), indate, csv_before(rest, sep), rest, last);
+			break;
+		default:
+			strcpy(date, "1900-1-1");
+			break;
+		}
+		free(indate);
+		for (p = out = date; *p; p++) {
+			if (*p != ' ')
+				*out++ = *p;
+		}
+		*out = 0;
+	} else {
+		date = malloc(16);
+		if (!date)
+			return;
+		sprintf(date, "%.4s-%.2s-%.2s", csv->date,
+			strlen(csv->date) > 4 ? csv->date + 4 : "",
+			strlen(csv->date) > 6 ? csv->date + 6 : "");
+	}
+	csv_dive_date(date, state);
+	free(date);
+
+	if (csv->starttime_field >= 0) {
+		const char *time = csv_field(csv, header, len, csv->starttime_field);
+		if (!csv_empty(time))
+			csv_dive_time(time, state);
+	} else {
+		char time[8];
+		snprintf(time, sizeof(time), "%.2s:%.2s",
+			 strlen(csv->time) > 1 ? csv->time + 1 : "",
+			 strlen(csv->time) > 3 ? csv->time + 3 : "");
+		csv_dive_time(time, state);
+	}
+
+	if (csv->number_field >= 0) {
+		const char *number = csv_field(csv, header, len, csv->number_field);
+		if (!csv_empty(number))
+			state->cur_dive->number = atoi(number);
+	}
+}
+
+static void csv_add_cylinder(const char *description, int o2, enum cylinderuse use, struct parser_state *state)
+{
+	cylinder_t *cyl = cylinder_start(state);
+
+	cyl->type.description = strdup(description);
+	cyl->gasmix.o2.permille = o2;
+	cyl->cylinder_use = use;
+	if (use == OXYGEN)
+		state->o2pressure_sensor = state->cur_dive->cylinders.nr - 1;
+	cylinder_end(state);
+}
+
+static int parse_csv_profile(const char *filename, struct csv_profile *csv, struct divelog *log)
+{
+	struct memblock mem;
+	struct parser_state state;
+	char *text, *line, *next;
+	size_t i, j;
+	int sensors = 0;
+
+	if (readfile(filename, &mem) < 0)
+		return report_error(translate("gettextFromC", "Failed to read '%s'"), filename);
+
+	/* Normalize the line ends like the XML parser does, and end the last line */
+	text = realloc(mem.buffer, mem.size + 2);
+	if (!text) {
+		free(mem.buffer);
+		return report_error("realloc failed in %s", __func__);
+	}
+	for (i = j = 0; i < mem.size; i++) {
+		char c = text[i];
+		if (c == '\r') {
+			c = '\n';
+			if (i + 1 < mem.size && text[i + 1] == '\n')
+				i++;
+		}
+		text[j++] = c;
+	}
+	text[j++] = '\n';
+	text[j] = 0;
+
+	init_parser_state(&state);
+	state.log = log;
+	dive_start(&state);
+	csv_parse_header(csv, csv_after(csv_after(text, "\n"), "\n"), &state);
+
+	for (i = 0; i < 3; i++) {
+		if (csv->sensor_field[i] >= 0)
+			sensors++;
+	}
+	if (csv->po2_field >= 0 || csv->setpoint_field >= 0 || sensors) {
+		csv_add_cylinder("oxygen", 1000, OXYGEN, &state);
+		csv_add_cylinder("diluent", 210, DILUENT, &state);
+	}
+
+	divecomputer_start(&state);
+	if (csv->model)
+		state.cur_dc->model = strdup(csv->model);
+	if (csv->po2_field >= 0 || csv->setpoint_field >= 0 || sensors) {
+		state.cur_dc->divemode = CCR;
+		state.cur_dc->no_o2sensors = sensors;
+	}
+
+	/* Consecutive identical lines are only taken once */
+	for (line = text; (next = strchr(line, '\n')) != NULL; line = next + 1) {
+		size_t len = next - line;
+		const char *following = next + 1;
+		const char *end = strchr(following, '\n');
+		size_t following_len = end ? (size_t)(end - following) : 0;
+
+		if (len == following_len && !memcmp(line, following, len))
+			continue;
+		csv_parse_sample(csv, line, len, &state);
+	}
+
+	divecomputer_end(&state);
+	dive_end(&state);
+	free_parser_state(&state);
+	free(text);
+	return 0;
+}
+
+/* Increase the limits for recursion and variables on XSLT
+ * parsing. libxslt reads these globals in every transformation,
+ * so only write them if they are too small, i.e. the first time. */
+void increase_xslt_limits(void)
+{
+	if (xsltMaxDepth < 30000)
+		xsltMaxDepth = 30000;
+#if LIBXSLT_VERSION > 10126
+	if (xsltMaxVars < 150000)
+		xsltMaxVars = 150000;
+#endif
+}
+
+static int parse_csv(const char *filename, struct xml_params *params, const char *csvtemplate, bool native, struct divelog *log)
 {
 	int ret;
 	struct memblock mem;
+	struct csv_profile csv;
 	time_t now;
 	struct tm *timep = NULL;
 	char tmpbuf[MAXCOLDIGITS];
 
-	/* Increase the limits for recursion and variables on XSLT
-	 * parsing */
-	xsltMaxDepth = 30000;
-#if LIBXSLT_VERSION > 10126
-	xsltMaxVars = 150000;
-#endif
+	increase_xslt_limits();
 
 	if (filename == NULL)
 		return report_error("No CSV filename");
@@ -312,6 +1084,12 @@ int parse_csv_file(const char *filename, struct xml_params *params, const char *
 		xml_params_add(params, "time", tmpbuf);
 	}
 
+	if (native && !strcmp("csv", csvtemplate) && csv_profile_init(&csv, params)) {
+		ret = parse_csv_profile(filename, &csv, log);
+		csv_profile_free(&csv);
+		return ret;
+	}
+
 	if (try_to_xslt_open_csv(filename, &mem, csvtemplate))
 		return -1;
 
@@ -336,6 +1114,15 @@ int parse_csv_file(const char *filename, struct xml_params *params, const char *
 	return ret;
 }
 
+int parse_csv_file(const char *filename, struct xml_params *params, const char *csvtemplate, struct divelog *log)
+{
+	return parse_csv(filename, params, csvtemplate, true, log);
+}
+
+int parse_csv_file_xslt(const char *filename, struct xml_params *params, const char *csvtemplate, struct divelog *log)
+{
+	return parse_csv(filename, params, csvtemplate, false, log);
+}
 
 static int try_to_xslt_open_csv(const char *filename, struct memblock *mem, const char *tag)
 {
@@ -817,12 +1604,7 @@ static int parse_seabear_csv_file(const char *filename, struct xml_params *param
 	char *NL = NULL;
 	char tmpbuf[MAXCOLDIGITS];
 
-	/* Increase the limits for recursion and variables on XSLT
-	 * parsing */
-	xsltMaxDepth = 30000;
-#if LIBXSLT_VERSION > 10126
-	xsltMaxVars = 150000;
-#endif
+	increase_xslt_limits();
 
 	time(&now);
 	timep = localtime(&now);
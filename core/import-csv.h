@@ -26,11 +26,15 @@ extern "C" {
 #endif
 
 int parse_csv_file(const char *filename, struct xml_params *params, const char *csvtemplate, struct divelog *log);
+// Always goes through the XSLT, even where parse_csv_file() reads the profile natively
+int parse_csv_file_xslt(const char *filename, struct xml_params *params, const char *csvtemplate, struct divelog *log);
 int try_to_open_csv(struct memblock *mem, enum csv_format type, struct divelog *log);
 int parse_txt_file(const char *filename, const char *csv, struct divelog *log);
 
 int parse_seabear_log(const char *filename, struct divelog *log);
 int parse_manual_file(const char *filename, struct xml_params *params, struct divelog *log);
+// Called before the files are parsed on several threads, see parallelimport.cpp
+void increase_xslt_limits(void);
 
 #ifdef __cplusplus
 }
@@ -17,18 +17,67 @@
 
 #include <stdlib.h>
 
-static int shearwater_cylinders(void *param, int columns, char **data, char **column)
+/*
+ * The records of all dives are read in a single pass, ordered by dive and
+ * record id, and merged with the dives, which are read in the same order.
+ * The gas mixes and gas changes of a dive are collected while reading its
+ * records and turned into cylinders and events once the dive is complete.
+ */
+struct shearwater_gas {
+	int time;
+	int o2, he;
+};
+
+struct shearwater_records {
+	struct parser_state *state;
+	sqlite3_stmt *stmt;
+	int step;		/* result of the last sqlite3_step() */
+	bool cloud;
+	bool ai;		/* records contain the air integration columns */
+	struct shearwater_gas *mixes;
+	int nr_mixes, allocated_mixes;
+	struct shearwater_gas *changes;
+	int nr_changes, allocated_changes;
+};
+
+/* Columns of the records, the profile columns are passed on to the sample callbacks */
+enum { SW_DIVE_ID, SW_RECORD_ID, SW_CIRCUIT, SW_O2, SW_HE, SW_PROFILE_COLUMNS };
+
+static struct shearwater_gas *add_shearwater_gas(struct shearwater_gas **gases, int *nr, int *allocated)
 {
-	UNUSED(columns);
-	UNUSED(column);
-	struct parser_state *state = (struct parser_state *)param;
-	cylinder_t *cyl;
+	if (*nr >= *allocated) {
+		int new_size = (*allocated + 8) * 3 / 2;
+		struct shearwater_gas *new_gases = realloc(*gases, new_size * sizeof(**gases));
+		if (!new_gases)
+			return NULL;
+		*gases = new_gases;
+		*allocated = new_size;
+	}
+	return &(*gases)[(*nr)++];
+}
+
+static int gas_permille(sqlite3_stmt *stmt, int column)
+{
+	return lrint(sqlite3_column_double(stmt, column) * 1000);
+}
+
+static int compare_gas(const void *a, const void *b)
+{
+	const struct shearwater_gas *gas1 = a;
+	const struct shearwater_gas *gas2 = b;
+	if (gas1->o2 != gas2->o2)
+		return gas1->o2 < gas2->o2 ? -1 : 1;
+	if (gas1->he != gas2->he)
+		return gas1->he < gas2->he ? -1 : 1;
+	return 0;
+}
 
-	int o2 = lrint(strtod_flags(data[0], NULL, 0) * 1000);
-	int he = lrint(strtod_flags(data[1], NULL, 0) * 1000);
+/* Shearwater allows entering only 99%, not 100%
+ * so assume 99% to be pure oxygen */
+static void add_shearwater_cylinder(struct parser_state *state, int o2, int he)
+{
+	cylinder_t *cyl;
 
-	/* Shearwater allows entering only 99%, not 100%
-	 * so assume 99% to be pure oxygen */
 	if (o2 == 990 && he == 0)
 		o2 = 1000;
 
@@ -36,28 +85,10 @@ static int shearwater_cylinders(void *param, int columns, char **data, char **co
 	cyl->gasmix.o2.permille = o2;
 	cyl->gasmix.he.permille = he;
 	cylinder_end(state);
-
-	return 0;
 }
 
-static int shearwater_changes(void *param, int columns, char **data, char **column)
+static void add_shearwater_change(struct parser_state *state, int time, int o2, int he)
 {
-	UNUSED(columns);
-	UNUSED(column);
-	struct parser_state *state = (struct parser_state *)param;
-	cylinder_t *cyl;
-
-	if (columns != 3) {
-		return 1;
-	}
-	if (!data[0] || !data[1] || !data[2]) {
-		return 2;
-	}
-	int o2 = lrint(strtod_flags(data[1], NULL, 0) * 1000);
-	int he = lrint(strtod_flags(data[2], NULL, 0) * 1000);
-
-	/* Shearwater allows entering only 99%, not 100%
-	 * so assume 99% to be pure oxygen */
 	if (o2 == 990 && he == 0)
 		o2 = 1000;
 
@@ -73,14 +104,10 @@ static int shearwater_changes(void *param, int columns, char **data, char **colu
 	}
 	if (!found) {
 		// Cylinder not found, creating a new one
-		cyl = cylinder_start(state);
-		cyl->gasmix.o2.permille = o2;
-		cyl->gasmix.he.permille = he;
-		cylinder_end(state);
+		add_shearwater_cylinder(state, o2, he);
 	}
 
-	add_gas_switch_event(state->cur_dive, get_dc(state), state->sample_rate ? atoi(data[0]) / state->sample_rate * 10 : atoi(data[0]), index);
-	return 0;
+	add_gas_switch_event(state->cur_dive, get_dc(state), state->sample_rate ? time / state->sample_rate * 10 : time, index);
 }
 
 static int shearwater_profile_sample(void *param, int columns, char **data, char **column)
@@ -90,17 +117,20 @@ static int shearwater_profile_sample(void *param, int columns, char **data, char
 	struct parser_state *state = (struct parser_state *)param;
 	int d6, d7;
 
-	sample_start(state);
-
 	/*
 	 * If we have sample_rate, we use self calculated sample number
-	 * to count the sample time.
+	 * to count the sample time. The samples are read in the order
+	 * of the records, therefore the sample number is simply the
+	 * number of samples we already have.
 	 * If we do not have sample_rate, we try to use the sample time
 	 * provided by Shearwater as is.
 	 */
+	int row = get_dc(state)->samples;
+
+	sample_start(state);
 
-	if (data[9] && state->sample_rate)
-		state->cur_sample->time.seconds = atoi(data[9]) * state->sample_rate;
+	if (state->sample_rate)
+		state->cur_sample->time.seconds = row * state->sample_rate;
 	else if (data[0])
 		state->cur_sample->time.seconds = atoi(data[0]);
 
@@ -153,17 +183,20 @@ static int shearwater_ai_profile_sample(void *param, int columns, char **data, c
 	struct parser_state *state = (struct parser_state *)param;
 	int d6, d9;
 
-	sample_start(state);
-
 	/*
 	 * If we have sample_rate, we use self calculated sample number
-	 * to count the sample time.
+	 * to count the sample time. The samples are read in the order
+	 * of the records, therefore the sample number is simply the
+	 * number of samples we already have.
 	 * If we do not have sample_rate, we try to use the sample time
 	 * provided by Shearwater as is.
 	 */
+	int row = get_dc(state)->samples;
 
-	if (data[11] && state->sample_rate)
-		state->cur_sample->time.seconds = atoi(data[11]) * state->sample_rate;
+	sample_start(state);
+
+	if (state->sample_rate)
+		state->cur_sample->time.seconds = row * state->sample_rate;
 	else if (data[0])
 		state->cur_sample->time.seconds = atoi(data[0]);
 
@@ -217,14 +250,99 @@ static int shearwater_ai_profile_sample(void *param, int columns, char **data, c
 	return 0;
 }
 
-static int shearwater_mode(void *param, int columns, char **data, char **column)
+/* Add the records of a dive, which must have been started */
+static int shearwater_dive_records(struct shearwater_records *records, sqlite3_int64 dive_id)
 {
-	UNUSED(columns);
-	UNUSED(column);
-	struct parser_state *state = (struct parser_state *)param;
+	struct parser_state *state = records->state;
+	sqlite3_stmt *stmt = records->stmt;
+	int columns = sqlite3_column_count(stmt) - SW_PROFILE_COLUMNS;
+	char *data[16];
+	unsigned int seen_modes = 0;
+	bool first = true, prev_gas = false;
+	sqlite3_int64 prev_record = 0;
+	int prev_o2 = 0, prev_he = 0;
+	int i;
+
+	records->nr_mixes = records->nr_changes = 0;
+	for (; records->step == SQLITE_ROW; records->step = sqlite3_step(stmt)) {
+		sqlite3_int64 id = sqlite3_column_int64(stmt, SW_DIVE_ID);
+		sqlite3_int64 record = sqlite3_column_int64(stmt, SW_RECORD_ID);
+		bool gas = sqlite3_column_type(stmt, SW_O2) != SQLITE_NULL && sqlite3_column_type(stmt, SW_HE) != SQLITE_NULL;
+		int o2 = gas ? gas_permille(stmt, SW_O2) : 0;
+		int he = gas ? gas_permille(stmt, SW_HE) : 0;
+		const char *time;
+
+		if (id < dive_id)
+			continue;	/* records of a dive that doesn't exist */
+		if (id > dive_id)
+			break;
+
+		for (i = 0; i < columns; i++)
+			data[i] = (char *)sqlite3_column_text(stmt, SW_PROFILE_COLUMNS + i);
+		time = data[0];
+
+		/* the mode of the circuit setting that was used last for the first time */
+		if (sqlite3_column_type(stmt, SW_CIRCUIT) != SQLITE_NULL) {
+			int mode = sqlite3_column_int(stmt, SW_CIRCUIT);
+			bool known = mode >= 0 && mode < 32 && (seen_modes & (1u << mode));
+			if (!known) {
+				if (mode >= 0 && mode < 32)
+					seen_modes |= 1u << mode;
+				state->cur_dive->dc.divemode = mode == 0 ? CCR : OC;
+			}
+		}
+
+		if (gas) {
+			struct shearwater_gas *change = NULL;
+
+			for (i = 0; i < records->nr_mixes; i++) {
+				if (records->mixes[i].o2 == o2 && records->mixes[i].he == he)
+					break;
+			}
+			if (i == records->nr_mixes) {
+				struct shearwater_gas *mix = add_shearwater_gas(&records->mixes, &records->nr_mixes, &records->allocated_mixes);
+				if (!mix)
+					return 1;
+				mix->o2 = o2;
+				mix->he = he;
+			}
+
+			/* Cloud logs record the first gas, changes are changes between consecutive records */
+			if (time && first && records->cloud)
+				change = add_shearwater_gas(&records->changes, &records->nr_changes, &records->allocated_changes);
+			else if (time && prev_gas && prev_record == record - 1 && (o2 != prev_o2 || he != prev_he) &&
+				 (!records->cloud || (o2 > 0 && prev_o2 > 0)))
+				change = add_shearwater_gas(&records->changes, &records->nr_changes, &records->allocated_changes);
+			if (change) {
+				change->time = atoi(time);
+				change->o2 = o2;
+				change->he = he;
+			}
+		}
+		first = false;
+		prev_gas = gas;
+		prev_record = record;
+		prev_o2 = o2;
+		prev_he = he;
+
+		/* Cloud logs contain records before the start of the dive */
+		if (records->cloud && (!time || strtod_flags(time, NULL, 0) <= 0))
+			continue;
+		if (records->ai)
+			shearwater_ai_profile_sample(state, columns, data, NULL);
+		else
+			shearwater_profile_sample(state, columns, data, NULL);
+	}
+	if (records->step != SQLITE_ROW && records->step != SQLITE_DONE) {
+		fprintf(stderr, "%s", "Database query shearwater_records failed.\n");
+		return 1;
+	}
 
-	if (data[0])
-		state->cur_dive->dc.divemode = atoi(data[0]) == 0 ? CCR : OC;
+	qsort(records->mixes, records->nr_mixes, sizeof(*records->mixes), compare_gas);
+	for (i = 0; i < records->nr_mixes; i++)
+		add_shearwater_cylinder(state, records->mixes[i].o2, records->mixes[i].he);
+	for (i = 0; i < records->nr_changes; i++)
+		add_shearwater_change(state, records->changes[i].time, records->changes[i].o2, records->changes[i].he);
 
 	return 0;
 }
@@ -234,22 +352,15 @@ static int shearwater_dive(void *param, int columns, char **data, char **column)
 	UNUSED(columns);
 	UNUSED(column);
 
-	int retval = 0;
-	struct parser_state *state = (struct parser_state *)param;
-	sqlite3 *handle = state->sql_handle;
-	char get_profile_template[] = "select currentTime,currentDepth,waterTemp,averagePPO2,currentNdl,CNSPercent,decoCeiling,firstStopDepth,firstStopTime from dive_log_records where diveLogId=%ld";
-	char get_profile_template_ai[] = "select currentTime,currentDepth,waterTemp,averagePPO2,currentNdl,CNSPercent,decoCeiling,aiSensor0_PressurePSI,aiSensor1_PressurePSI,firstStopDepth,firstStopTime from dive_log_records where diveLogId = %ld";
-	char get_cylinder_template[] = "select fractionO2,fractionHe from dive_log_records where diveLogId = %ld group by fractionO2,fractionHe";
-	char get_changes_template[] = "select a.currentTime,a.fractionO2,a.fractionHe from dive_log_records as a,dive_log_records as b where (a.id - 1) = b.id and (a.fractionO2 != b.fractionO2 or a.fractionHe != b.fractionHe) and a.diveLogId=b.divelogId and a.diveLogId = %ld";
-	char get_mode_template[] = "select distinct currentCircuitSetting from dive_log_records where diveLogId = %ld";
-	char get_buffer[1024];
+	struct shearwater_records *records = (struct shearwater_records *)param;
+	struct parser_state *state = records->state;
 
 	dive_start(state);
 	state->cur_dive->number = atoi(data[0]);
 
 	state->cur_dive->when = (time_t)(atol(data[1]));
 
-	long int dive_id = atol(data[11]);
+	sqlite3_int64 dive_id = atoll(data[11]);
 
 	if (data[2])
 		add_dive_site(data[2], state->cur_dive, state);
@@ -309,39 +420,8 @@ static int shearwater_dive(void *param, int columns, char **data, char **column)
 		}
 	}
 
-	if (data[11]) {
-		snprintf(get_buffer, sizeof(get_buffer) - 1, get_mode_template, dive_id);
-		retval = sqlite3_exec(handle, get_buffer, &shearwater_mode, state, NULL);
-		if (retval != SQLITE_OK) {
-			fprintf(stderr, "%s", "Database query shearwater_mode failed.\n");
-			return 1;
-		}
-	}
-
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_cylinder_template, dive_id);
-	retval = sqlite3_exec(handle, get_buffer, &shearwater_cylinders, state, NULL);
-	if (retval != SQLITE_OK) {
-		fprintf(stderr, "%s", "Database query shearwater_cylinders failed.\n");
-		return 1;
-	}
-
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_changes_template, dive_id);
-	retval = sqlite3_exec(handle, get_buffer, &shearwater_changes, state, NULL);
-	if (retval != SQLITE_OK) {
-		fprintf(stderr, "%s", "Database query shearwater_changes failed.\n");
+	if (shearwater_dive_records(records, dive_id))
 		return 1;
-	}
-
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_profile_template_ai, dive_id);
-	retval = sqlite3_exec(handle, get_buffer, &shearwater_ai_profile_sample, state, NULL);
-	if (retval != SQLITE_OK) {
-		snprintf(get_buffer, sizeof(get_buffer) - 1, get_profile_template, dive_id);
-		retval = sqlite3_exec(handle, get_buffer, &shearwater_profile_sample, state, NULL);
-		if (retval != SQLITE_OK) {
-			fprintf(stderr, "%s", "Database query shearwater_profile_sample failed.\n");
-			return 1;
-		}
-	}
 
 	dive_end(state);
 
@@ -353,9 +433,8 @@ static int shearwater_cloud_dive(void *param, int columns, char **data, char **c
 	UNUSED(columns);
 	UNUSED(column);
 
-	int retval = 0;
-	struct parser_state *state = (struct parser_state *)param;
-	sqlite3 *handle = state->sql_handle;
+	struct shearwater_records *records = (struct shearwater_records *)param;
+	struct parser_state *state = records->state;
 
 	/*
 	 * Since Shearwater reported sample time can be totally bogus,
@@ -364,21 +443,12 @@ static int shearwater_cloud_dive(void *param, int columns, char **data, char **c
 	 * giving us correct sample time.
 	 */
 
-	char get_profile_template[] = "select currentTime,currentDepth,waterTemp,averagePPO2,currentNdl,CNSPercent,decoCeiling,firstStopDepth,firstStopTime,(select count(0) from dive_log_records r where r.id < d.id and r.diveLogId = %ld and r.currentTime > 0) as row from dive_log_records d where d.diveLogId=%ld and d.currentTime > 0";
-	char get_profile_template_ai[] = "select currentTime,currentDepth,waterTemp,averagePPO2,currentNdl,CNSPercent,decoCeiling,aiSensor0_PressurePSI,aiSensor1_PressurePSI,firstStopDepth,firstStopTime,(select count(0) from dive_log_records r where r.id < d.id and r.diveLogId = %ld and r.currentTime > 0) as row from dive_log_records d where d.diveLogId = %ld and d.currentTime > 0";
-
-	char get_cylinder_template[] = "select fractionO2 / 100,fractionHe / 100 from dive_log_records where diveLogId = %ld group by fractionO2,fractionHe";
-	char get_first_gas_template[] = "select currentTime, fractionO2 / 100, fractionHe / 100 from dive_log_records where diveLogId = %ld limit 1";
-	char get_changes_template[] = "select a.currentTime,a.fractionO2 / 100,a.fractionHe /100 from dive_log_records as a,dive_log_records as b where (a.id - 1) = b.id and (a.fractionO2 != b.fractionO2 or a.fractionHe != b.fractionHe) and a.diveLogId=b.divelogId and a.diveLogId = %ld and a.fractionO2 > 0 and b.fractionO2 > 0";
-	char get_mode_template[] = "select distinct currentCircuitSetting from dive_log_records where diveLogId = %ld";
-	char get_buffer[1024];
-
 	dive_start(state);
 	state->cur_dive->number = atoi(data[0]);
 
 	state->cur_dive->when = (time_t)(atol(data[1]));
 
-	long int dive_id = atol(data[11]);
+	sqlite3_int64 dive_id = atoll(data[11]);
 	if (data[12])
 		state->sample_rate = atoi(data[12]);
 	else
@@ -442,50 +512,56 @@ static int shearwater_cloud_dive(void *param, int columns, char **data, char **c
 		}
 	}
 
-	if (data[11]) {
-		snprintf(get_buffer, sizeof(get_buffer) - 1, get_mode_template, dive_id);
-		retval = sqlite3_exec(handle, get_buffer, &shearwater_mode, state, NULL);
-		if (retval != SQLITE_OK) {
-			fprintf(stderr, "%s", "Database query shearwater_mode failed.\n");
-			return 1;
-		}
-	}
-
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_cylinder_template, dive_id);
-	retval = sqlite3_exec(handle, get_buffer, &shearwater_cylinders, state, NULL);
-	if (retval != SQLITE_OK) {
-		fprintf(stderr, "%s", "Database query shearwater_cylinders failed.\n");
+	if (shearwater_dive_records(records, dive_id))
 		return 1;
-	}
 
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_first_gas_template, dive_id);
-	retval = sqlite3_exec(handle, get_buffer, &shearwater_changes, state, NULL);
-	if (retval != SQLITE_OK) {
-		fprintf(stderr, "%s", "Database query shearwater_changes failed.\n");
-		return 1;
-	}
+	dive_end(state);
 
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_changes_template, dive_id);
-	retval = sqlite3_exec(handle, get_buffer, &shearwater_changes, state, NULL);
-	if (retval != SQLITE_OK) {
-		fprintf(stderr, "%s", "Database query shearwater_changes failed.\n");
-		return 1;
-	}
+	return SQLITE_OK;
+}
 
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_profile_template_ai, dive_id, dive_id);
-	retval = sqlite3_exec(handle, get_buffer, &shearwater_ai_profile_sample, state, NULL);
-	if (retval != SQLITE_OK) {
-		snprintf(get_buffer, sizeof(get_buffer) - 1, get_profile_template, dive_id, dive_id);
-		retval = sqlite3_exec(handle, get_buffer, &shearwater_profile_sample, state, NULL);
-		if (retval != SQLITE_OK) {
-			fprintf(stderr, "%s", "Database query shearwater_profile_sample failed.\n");
+static const char shearwater_records_query[] = "select diveLogId,id,currentCircuitSetting,fractionO2,fractionHe,"
+	"currentTime,currentDepth,waterTemp,averagePPO2,currentNdl,CNSPercent,decoCeiling,firstStopDepth,firstStopTime "
+	"from dive_log_records order by cast(diveLogId as integer),id";
+static const char shearwater_records_query_ai[] = "select diveLogId,id,currentCircuitSetting,fractionO2,fractionHe,"
+	"currentTime,currentDepth,waterTemp,averagePPO2,currentNdl,CNSPercent,decoCeiling,aiSensor0_PressurePSI,aiSensor1_PressurePSI,firstStopDepth,firstStopTime "
+	"from dive_log_records order by cast(diveLogId as integer),id";
+static const char shearwater_cloud_records_query[] = "select diveLogId,id,currentCircuitSetting,fractionO2 / 100,fractionHe / 100,"
+	"currentTime,currentDepth,waterTemp,averagePPO2,currentNdl,CNSPercent,decoCeiling,firstStopDepth,firstStopTime "
+	"from dive_log_records order by cast(diveLogId as integer),id";
+static const char shearwater_cloud_records_query_ai[] = "select diveLogId,id,currentCircuitSetting,fractionO2 / 100,fractionHe / 100,"
+	"currentTime,currentDepth,waterTemp,averagePPO2,currentNdl,CNSPercent,decoCeiling,aiSensor0_PressurePSI,aiSensor1_PressurePSI,firstStopDepth,firstStopTime "
+	"from dive_log_records order by cast(diveLogId as integer),id";
+
+/*
+ * Start reading the records of all dives. Older logs don't have the air
+ * integration columns, in which case the statement can't be prepared
+ * and the records are read without them.
+ */
+static int start_shearwater_records(struct shearwater_records *records, struct parser_state *state, bool cloud)
+{
+	memset(records, 0, sizeof(*records));
+	records->state = state;
+	records->cloud = cloud;
+	records->ai = true;
+	if (sqlite3_prepare_v2(state->sql_handle, cloud ? shearwater_cloud_records_query_ai : shearwater_records_query_ai,
+			       -1, &records->stmt, NULL) != SQLITE_OK) {
+		records->ai = false;
+		if (sqlite3_prepare_v2(state->sql_handle, cloud ? shearwater_cloud_records_query : shearwater_records_query,
+				       -1, &records->stmt, NULL) != SQLITE_OK) {
+			fprintf(stderr, "%s", "Database query shearwater_records failed.\n");
 			return 1;
 		}
 	}
+	records->step = sqlite3_step(records->stmt);
+	return 0;
+}
 
-	dive_end(state);
-
-	return SQLITE_OK;
+static void free_shearwater_records(struct shearwater_records *records)
+{
+	sqlite3_finalize(records->stmt);
+	free(records->mixes);
+	free(records->changes);
 }
 
 int parse_shearwater_buffer(sqlite3 *handle, const char *url, const char *buffer, int size, struct divelog *log)
@@ -495,6 +571,7 @@ int parse_shearwater_buffer(sqlite3 *handle, const char *url, const char *buffer
 
 	int retval;
 	struct parser_state state;
+	struct shearwater_records records;
 
 	init_parser_state(&state);
 	state.log = log;
@@ -503,9 +580,12 @@ int parse_shearwater_buffer(sqlite3 *handle, const char *url, const char *buffer
 	// So far have not seen any sample rate in Shearwater Desktop
 	state.sample_rate = 0;
 
-	char get_dives[] = "select l.number,timestamp,location||' / '||site,buddy,notes,imperialUnits,maxDepth,maxTime,startSurfacePressure,computerSerial,computerModel,i.diveId FROM dive_info AS i JOIN dive_logs AS l ON i.diveId=l.diveId";
+	char get_dives[] = "select l.number,timestamp,location||' / '||site,buddy,notes,imperialUnits,maxDepth,maxTime,startSurfacePressure,computerSerial,computerModel,i.diveId FROM dive_info AS i JOIN dive_logs AS l ON i.diveId=l.diveId order by cast(i.diveId as integer)";
 
-	retval = sqlite3_exec(handle, get_dives, &shearwater_dive, &state, NULL);
+	retval = start_shearwater_records(&records, &state, false);
+	if (retval == 0)
+		retval = sqlite3_exec(handle, get_dives, &shearwater_dive, &records, NULL);
+	free_shearwater_records(&records);
 	free_parser_state(&state);
 
 	if (retval != SQLITE_OK) {
@@ -523,14 +603,18 @@ int parse_shearwater_cloud_buffer(sqlite3 *handle, const char *url, const char *
 
 	int retval;
 	struct parser_state state;
+	struct shearwater_records records;
 
 	init_parser_state(&state);
 	state.log = log;
 	state.sql_handle = handle;
 
-	char get_dives[] = "select l.number,strftime('%s', DiveDate),location||' / '||site,buddy,notes,imperialUnits,maxDepth,DiveLengthTime,startSurfacePressure,computerSerial,computerModel,d.diveId,l.sampleRateMs / 1000 FROM dive_details AS d JOIN dive_logs AS l ON d.diveId=l.diveId";
+	char get_dives[] = "select l.number,strftime('%s', DiveDate),location||' / '||site,buddy,notes,imperialUnits,maxDepth,DiveLengthTime,startSurfacePressure,computerSerial,computerModel,d.diveId,l.sampleRateMs / 1000 FROM dive_details AS d JOIN dive_logs AS l ON d.diveId=l.diveId order by cast(d.diveId as integer)";
 
-	retval = sqlite3_exec(handle, get_dives, &shearwater_cloud_dive, &state, NULL);
+	retval = start_shearwater_records(&records, &state, true);
+	if (retval == 0)
+		retval = sqlite3_exec(handle, get_dives, &shearwater_cloud_dive, &records, NULL);
+	free_shearwater_records(&records);
 	free_parser_state(&state);
 
 	if (retval != SQLITE_OK) {
@@ -18,6 +18,9 @@
 
 #include <stdlib.h>
 
+/* Statement slots of the per-dive queries, see sql_exec_id() */
+enum { DM_EVENTS, DM_TAGS, DM_CYLINDERS, DM_GASCHANGE };
+
 static int dm4_events(void *param, int columns, char **data, char **column)
 {
 	UNUSED(columns);
@@ -170,13 +173,11 @@ static int dm4_dive(void *param, int columns, char **data, char **column)
 	int i;
 	int interval, retval = 0;
 	struct parser_state *state = (struct parser_state *)param;
-	sqlite3 *handle = state->sql_handle;
 	float *profileBlob;
 	unsigned char *tempBlob;
 	int *pressureBlob;
-	char get_events_template[] = "select * from Mark where DiveId = %d";
-	char get_tags_template[] = "select Text from DiveTag where DiveId = %d";
-	char get_events[64];
+	char get_events_template[] = "select * from Mark where DiveId = ?";
+	char get_tags_template[] = "select Text from DiveTag where DiveId = ?";
 	cylinder_t *cyl;
 
 	dive_start(state);
@@ -263,15 +264,13 @@ static int dm4_dive(void *param, int columns, char **data, char **column)
 		sample_end(state);
 	}
 
-	snprintf(get_events, sizeof(get_events) - 1, get_events_template, state->cur_dive->number);
-	retval = sqlite3_exec(handle, get_events, &dm4_events, state, NULL);
+	retval = sql_exec_id(state, DM_EVENTS, get_events_template, state->cur_dive->number, &dm4_events, state);
 	if (retval != SQLITE_OK) {
 		fprintf(stderr, "%s", "Database query dm4_events failed.\n");
 		return 1;
 	}
 
-	snprintf(get_events, sizeof(get_events) - 1, get_tags_template, state->cur_dive->number);
-	retval = sqlite3_exec(handle, get_events, &dm4_tags, state, NULL);
+	retval = sql_exec_id(state, DM_TAGS, get_tags_template, state->cur_dive->number, &dm4_tags, state);
 	if (retval != SQLITE_OK) {
 		fprintf(stderr, "%s", "Database query dm4_tags failed.\n");
 		return 1;
@@ -380,13 +379,11 @@ static int dm5_dive(void *param, int columns, char **data, char **column)
 	int tempformat = 0;
 	int interval, retval = 0, block_size;
 	struct parser_state *state = (struct parser_state *)param;
-	sqlite3 *handle = state->sql_handle;
 	unsigned const char *sampleBlob;
-	char get_events_template[] = "select * from Mark where DiveId = %d";
-	char get_tags_template[] = "select Text from DiveTag where DiveId = %d";
-	char get_cylinders_template[] = "select * from DiveMixture where DiveId = %d";
-	char get_gaschange_template[] = "select GasChangeTime,Oxygen,Helium from DiveGasChange join DiveMixture on DiveGasChange.DiveMixtureId=DiveMixture.DiveMixtureId where DiveId = %d";
-	char get_events[512];
+	char get_events_template[] = "select * from Mark where DiveId = ?";
+	char get_tags_template[] = "select Text from DiveTag where DiveId = ?";
+	char get_cylinders_template[] = "select * from DiveMixture where DiveId = ?";
+	char get_gaschange_template[] = "select GasChangeTime,Oxygen,Helium from DiveGasChange join DiveMixture on DiveGasChange.DiveMixtureId=DiveMixture.DiveMixtureId where DiveId = ?";
 
 	dive_start(state);
 	state->cur_dive->number = atoi(data[0]);
@@ -443,8 +440,7 @@ static int dm5_dive(void *param, int columns, char **data, char **column)
 		}
 	}
 
-	snprintf(get_events, sizeof(get_events) - 1, get_cylinders_template, state->cur_dive->number);
-	retval = sqlite3_exec(handle, get_events, &dm5_cylinders, state, NULL);
+	retval = sql_exec_id(state, DM_CYLINDERS, get_cylinders_template, state->cur_dive->number, &dm5_cylinders, state);
 	if (retval != SQLITE_OK) {
 		fprintf(stderr, "%s", "Database query dm5_cylinders failed.\n");
 		return 1;
@@ -549,22 +545,19 @@ static int dm5_dive(void *param, int columns, char **data, char **column)
 		}
 	}
 
-	snprintf(get_events, sizeof(get_events) - 1, get_gaschange_template, state->cur_dive->number);
-	retval = sqlite3_exec(handle, get_events, &dm5_gaschange, state, NULL);
+	retval = sql_exec_id(state, DM_GASCHANGE, get_gaschange_template, state->cur_dive->number, &dm5_gaschange, state);
 	if (retval != SQLITE_OK) {
 		fprintf(stderr, "%s", "Database query dm5_gaschange failed.\n");
 		return 1;
 	}
 
-	snprintf(get_events, sizeof(get_events) - 1, get_events_template, state->cur_dive->number);
-	retval = sqlite3_exec(handle, get_events, &dm4_events, state, NULL);
+	retval = sql_exec_id(state, DM_EVENTS, get_events_template, state->cur_dive->number, &dm4_events, state);
 	if (retval != SQLITE_OK) {
 		fprintf(stderr, "%s", "Database query dm4_events failed.\n");
 		return 1;
 	}
 
-	snprintf(get_events, sizeof(get_events) - 1, get_tags_template, state->cur_dive->number);
-	retval = sqlite3_exec(handle, get_events, &dm4_tags, state, NULL);
+	retval = sql_exec_id(state, DM_TAGS, get_tags_template, state->cur_dive->number, &dm4_tags, state);
 	if (retval != SQLITE_OK) {
 		fprintf(stderr, "%s", "Database query dm4_tags failed.\n");
 		return 1;
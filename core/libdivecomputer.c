@@ -26,6 +26,7 @@
 #include "sha1.h"
 #include "subsurface-time.h"
 #include "timer.h"
+#include "workqueue.h"
 
 #include <libdivecomputer/version.h>
 #include <libdivecomputer/usbhid.h>
@@ -97,6 +98,9 @@ const char *errmsg (dc_status_t rc)
 
 static dc_status_t create_parser(device_data_t *devdata, dc_parser_t **parser)
 {
+	// Raw dives imported without a device, see libdc_download_raw_dives()
+	if (!devdata->device)
+		return dc_parser_new2(parser, devdata->context, devdata->descriptor, 0, 0);
 	return dc_parser_new(parser, devdata->device);
 }
 
@@ -506,17 +510,18 @@ static void dev_info(device_data_t *devdata, const char *fmt, ...)
 		(*progress_callback)(buffer);
 }
 
-static int import_dive_number = 0;
+static int queued_dive_number = 0;
 
-static void download_error(const char *fmt, ...)
+/* Called from the download thread and from the worker that parses the dives */
+static void download_error(int number, const char *fmt, ...)
 {
-	static char buffer[1024];
+	char buffer[1024];
 	va_list ap;
 
 	va_start(ap, fmt);
 	vsnprintf(buffer, sizeof(buffer), fmt, ap);
 	va_end(ap);
-	report_error("Dive %d: %s", import_dive_number, buffer);
+	report_error("Dive %d: %s", number, buffer);
 }
 
 static int parse_samples(device_data_t *devdata, struct divecomputer *dc, dc_parser_t *parser)
@@ -581,6 +586,21 @@ static int find_dive(struct divecomputer *match)
 	return 0;
 }
 
+/*
+ * The download stops at the first dive that we already have.
+ * This is the check that decides that.
+ */
+bool dive_was_downloaded(const char *model, uint32_t deviceid, uint32_t diveid, timestamp_t when)
+{
+	struct divecomputer dc = { 0 };
+
+	dc.model = model;
+	dc.deviceid = deviceid;
+	dc.diveid = diveid;
+	dc.when = when;
+	return find_dive(&dc);
+}
+
 /*
  * Like g_strdup_printf(), but without the stupid g_malloc/g_free confusion.
  * And we limit the string to some arbitrary size.
@@ -654,7 +674,7 @@ static void parse_string_field(device_data_t *devdata, struct dive *dive, dc_fie
 	}
 }
 
-static dc_status_t libdc_header_parser(dc_parser_t *parser, device_data_t *devdata, struct dive *dive)
+static dc_status_t libdc_header_parser(dc_parser_t *parser, device_data_t *devdata, struct dive *dive, int number)
 {
 	dc_status_t rc = 0;
 	dc_datetime_t dt = { 0 };
@@ -662,7 +682,7 @@ static dc_status_t libdc_header_parser(dc_parser_t *parser, device_data_t *devda
 
 	rc = dc_parser_get_datetime(parser, &dt);
 	if (rc != DC_STATUS_SUCCESS && rc != DC_STATUS_UNSUPPORTED) {
-		download_error(translate("gettextFromC", "Error parsing the datetime"));
+		download_error(number, translate("gettextFromC", "Error parsing the datetime"));
 		return rc;
 	}
 
@@ -680,14 +700,10 @@ static dc_status_t libdc_header_parser(dc_parser_t *parser, device_data_t *devda
 	}
 
 	// Parse the divetime.
-	char *date_string = get_dive_date_c_string(dive->when);
-	dev_info(devdata, translate("gettextFromC", "Dive %d: %s"), import_dive_number, date_string);
-	free(date_string);
-
 	unsigned int divetime = 0;
 	rc = dc_parser_get_field(parser, DC_FIELD_DIVETIME, 0, &divetime);
 	if (rc != DC_STATUS_SUCCESS && rc != DC_STATUS_UNSUPPORTED) {
-		download_error(translate("gettextFromC", "Error parsing the divetime"));
+		download_error(number, translate("gettextFromC", "Error parsing the divetime"));
 		return rc;
 	}
 	if (rc == DC_STATUS_SUCCESS)
@@ -697,7 +713,7 @@ static dc_status_t libdc_header_parser(dc_parser_t *parser, device_data_t *devda
 	double maxdepth = 0.0;
 	rc = dc_parser_get_field(parser, DC_FIELD_MAXDEPTH, 0, &maxdepth);
 	if (rc != DC_STATUS_SUCCESS && rc != DC_STATUS_UNSUPPORTED) {
-		download_error(translate("gettextFromC", "Error parsing the maxdepth"));
+		download_error(number, translate("gettextFromC", "Error parsing the maxdepth"));
 		return rc;
 	}
 	if (rc == DC_STATUS_SUCCESS)
@@ -711,7 +727,7 @@ static dc_status_t libdc_header_parser(dc_parser_t *parser, device_data_t *devda
 	for (int i = 0; i < 3; i++) {
 		rc = dc_parser_get_field(parser, temp_fields[i], 0, &temperature);
 		if (rc != DC_STATUS_SUCCESS && rc != DC_STATUS_UNSUPPORTED) {
-			download_error(translate("gettextFromC", "Error parsing temperature"));
+			download_error(number, translate("gettextFromC", "Error parsing temperature"));
 			return rc;
 		}
 		if (rc == DC_STATUS_SUCCESS)
@@ -730,7 +746,7 @@ static dc_status_t libdc_header_parser(dc_parser_t *parser, device_data_t *devda
 	unsigned int ngases = 0;
 	rc = dc_parser_get_field(parser, DC_FIELD_GASMIX_COUNT, 0, &ngases);
 	if (rc != DC_STATUS_SUCCESS && rc != DC_STATUS_UNSUPPORTED) {
-		download_error(translate("gettextFromC", "Error parsing the gas mix count"));
+		download_error(number, translate("gettextFromC", "Error parsing the gas mix count"));
 		return rc;
 	}
 
@@ -741,7 +757,7 @@ static dc_status_t libdc_header_parser(dc_parser_t *parser, device_data_t *devda
 	};
 	rc = dc_parser_get_field(parser, DC_FIELD_SALINITY, 0, &salinity);
 	if (rc != DC_STATUS_SUCCESS && rc != DC_STATUS_UNSUPPORTED) {
-		download_error(translate("gettextFromC", "Error obtaining water salinity"));
+		download_error(number, translate("gettextFromC", "Error obtaining water salinity"));
 		return rc;
 	}
 	if (rc == DC_STATUS_SUCCESS) {
@@ -763,7 +779,7 @@ static dc_status_t libdc_header_parser(dc_parser_t *parser, device_data_t *devda
 	double surface_pressure = 0;
 	rc = dc_parser_get_field(parser, DC_FIELD_ATMOSPHERIC, 0, &surface_pressure);
 	if (rc != DC_STATUS_SUCCESS && rc != DC_STATUS_UNSUPPORTED) {
-		download_error(translate("gettextFromC", "Error obtaining surface pressure"));
+		download_error(number, translate("gettextFromC", "Error obtaining surface pressure"));
 		return rc;
 	}
 	if (rc == DC_STATUS_SUCCESS)
@@ -785,7 +801,7 @@ static dc_status_t libdc_header_parser(dc_parser_t *parser, device_data_t *devda
 	dc_divemode_t divemode;
 	rc = dc_parser_get_field(parser, DC_FIELD_DIVEMODE, 0, &divemode);
 	if (rc != DC_STATUS_SUCCESS && rc != DC_STATUS_UNSUPPORTED) {
-		download_error(translate("gettextFromC", "Error obtaining dive mode"));
+		download_error(number, translate("gettextFromC", "Error obtaining dive mode"));
 		return rc;
 	}
 	if (rc == DC_STATUS_SUCCESS)
@@ -807,22 +823,43 @@ static dc_status_t libdc_header_parser(dc_parser_t *parser, device_data_t *devda
 
 	rc = parse_gasmixes(devdata, dive, parser, ngases);
 	if (rc != DC_STATUS_SUCCESS && rc != DC_STATUS_UNSUPPORTED) {
-		download_error(translate("gettextFromC", "Error parsing the gas mix"));
+		download_error(number, translate("gettextFromC", "Error parsing the gas mix"));
 		return rc;
 	}
 
 	return DC_STATUS_SUCCESS;
 }
 
-/* returns true if we want libdivecomputer's dc_device_foreach() to continue,
- *  false otherwise */
-static int dive_cb(const unsigned char *data, unsigned int size,
-		   const unsigned char *fingerprint, unsigned int fsize,
-		   void *userdata)
+/*
+ * Downloaded dives are parsed on a worker thread, so that the transfer
+ * of the next dives doesn't have to wait for the parser. A download job
+ * owns a copy of the raw dive data, which libdivecomputer only guarantees
+ * for the duration of the foreach callback, and a parser for that data.
+ * The parser is created on the download thread, because it is created
+ * from the device.
+ */
+#define DOWNLOAD_QUEUE_SIZE 16
+
+struct download_job {
+	unsigned char *data;
+	dc_parser_t *parser;
+	uint32_t diveid;
+	int number;
+	unsigned char *fingerprint;
+	unsigned int fsize;
+};
+
+static struct work_queue *download_queue;
+static bool already_downloaded;
+static timestamp_t already_downloaded_when;
+
+/* Parse a downloaded dive. Runs on the worker thread of the download queue. */
+static void parse_dive_job(void *job_data, void *userdata)
 {
 	int rc;
-	dc_parser_t *parser = NULL;
 	device_data_t *devdata = userdata;
+	struct download_job *job = job_data;
+	dc_parser_t *parser = job->parser;
 	struct dive *dive = NULL;
 
 	/* reset static data, that is only valid per dive */
@@ -831,65 +868,41 @@ static int dive_cb(const unsigned char *data, unsigned int size,
 	in_deco = false;
 	current_gas_index = -1;
 
-	import_dive_number++;
-
-	rc = create_parser(devdata, &parser);
-	if (rc != DC_STATUS_SUCCESS) {
-		download_error(translate("gettextFromC", "Unable to create parser for %s %s"), devdata->vendor, devdata->product);
-		return true;
-	}
-
-	rc = dc_parser_set_data(parser, data, size);
-	if (rc != DC_STATUS_SUCCESS) {
-		download_error(translate("gettextFromC", "Error registering the data"));
-		goto error_exit;
-	}
-
 	dive = alloc_dive();
 
 	// Fill in basic fields
 	dive->dc.model = strdup(devdata->model);
-	dive->dc.diveid = calculate_diveid(fingerprint, fsize);
+	dive->dc.diveid = job->diveid;
 
 	// Parse the dive's header data
-	rc = libdc_header_parser (parser, devdata, dive);
+	rc = libdc_header_parser (parser, devdata, dive, job->number);
 	if (rc != DC_STATUS_SUCCESS) {
-		download_error(translate("getextFromC", "Error parsing the header"));
+		download_error(job->number, translate("getextFromC", "Error parsing the header"));
 		goto error_exit;
 	}
 
 	// Initialize the sample data.
 	rc = parse_samples(devdata, &dive->dc, parser);
 	if (rc != DC_STATUS_SUCCESS) {
-		download_error(translate("gettextFromC", "Error parsing the samples"));
+		download_error(job->number, translate("gettextFromC", "Error parsing the samples"));
 		goto error_exit;
 	}
 
 	dc_parser_destroy(parser);
 
 	/*
-	 * Save off fingerprint data.
+	 * Save off fingerprint data of the first dive that could be parsed.
 	 *
 	 * NOTE! We do this after parsing the dive fully, so that
-	 * we have the final deviceid here.
+	 * we have the final deviceid here. The fingerprint is only
+	 * accessed by this thread until the download has finished.
 	 */
-	if (fingerprint && fsize && !devdata->fingerprint) {
-		devdata->fingerprint = calloc(fsize, 1);
-		if (devdata->fingerprint) {
-			devdata->fsize = fsize;
-			devdata->fdeviceid = dive->dc.deviceid;
-			devdata->fdiveid = dive->dc.diveid;
-			memcpy(devdata->fingerprint, fingerprint, fsize);
-		}
-	}
-
-	/* If we already saw this dive, abort. */
-	if (!devdata->force_download && find_dive(&dive->dc)) {
-		char *date_string = get_dive_date_c_string(dive->when);
-		dev_info(devdata, translate("gettextFromC", "Already downloaded dive at %s"), date_string);
-		free(date_string);
-		free_dive(dive);
-		return false;
+	if (job->fingerprint && !devdata->fingerprint) {
+		devdata->fingerprint = job->fingerprint;
+		devdata->fsize = job->fsize;
+		devdata->fdeviceid = dive->dc.deviceid;
+		devdata->fdiveid = dive->dc.diveid;
+		job->fingerprint = NULL;
 	}
 
 	/* Various libdivecomputer interface fixups */
@@ -907,13 +920,172 @@ static int dive_cb(const unsigned char *data, unsigned int size,
 		dive->dc.sample[0].temperature.mkelvin = dive->dc.sample[1].temperature.mkelvin;
 
 	record_dive_to_table(dive, devdata->log->dives);
-	return true;
+	goto free_job;
 
 error_exit:
 	dc_parser_destroy(parser);
 	free_dive(dive);
+free_job:
+	free(job->fingerprint);
+	free(job->data);
+	free(job);
+}
+
+/*
+ * The device id and, if the dive has no fingerprint, the dive id are
+ * taken from the string fields of the dive. They are needed to decide
+ * whether we already have the dive, before the worker parses it fully.
+ */
+static void parse_dive_ids(dc_parser_t *parser, struct divecomputer *dc)
+{
+	int idx;
+
+	for (idx = 0; idx < 100; idx++) {
+		dc_field_string_t str = { NULL };
+		if (dc_parser_get_field(parser, DC_FIELD_STRING, idx, &str) != DC_STATUS_SUCCESS)
+			break;
+		if (!str.desc || !str.value)
+			break;
+		// Same as parse_string_field() and add_extra_data()
+		if (!strcmp(str.desc, "Dive ID")) {
+			if (!dc->diveid)
+				dc->diveid = calculate_string_hash(str.value);
+		} else if (!strcasecmp(str.desc, "Serial")) {
+			dc->deviceid = calculate_string_hash(str.value);
+		}
+		free((void *)str.value); // libdc gives us copies of the value-string.
+	}
+}
+
+/* returns true if we want libdivecomputer's dc_device_foreach() to continue,
+ *  false otherwise */
+static int dive_cb(const unsigned char *data, unsigned int size,
+		   const unsigned char *fingerprint, unsigned int fsize,
+		   void *userdata)
+{
+	int rc;
+	dc_parser_t *parser = NULL;
+	device_data_t *devdata = userdata;
+	struct divecomputer dc = { 0 };
+	struct download_job *job;
+	unsigned char *copy;
+	char *date_string;
+	dc_datetime_t dt = { 0 };
+	struct tm tm;
+	int number = queued_dive_number + 1;
+
+	rc = create_parser(devdata, &parser);
+	if (rc != DC_STATUS_SUCCESS) {
+		download_error(number, translate("gettextFromC", "Unable to create parser for %s %s"), devdata->vendor, devdata->product);
+		return true;
+	}
+
+	copy = malloc(size);
+	memcpy(copy, data, size);
+	rc = dc_parser_set_data(parser, copy, size);
+	if (rc != DC_STATUS_SUCCESS) {
+		download_error(number, translate("gettextFromC", "Error registering the data"));
+		goto error_exit;
+	}
+
+	/*
+	 * Only the date and the ids are parsed here, because that is all
+	 * we need to know whether we already have this dive. The full dive
+	 * is parsed by the worker thread of the download queue.
+	 */
+	rc = dc_parser_get_datetime(parser, &dt);
+	if (rc != DC_STATUS_SUCCESS && rc != DC_STATUS_UNSUPPORTED) {
+		download_error(number, translate("gettextFromC", "Error parsing the datetime"));
+		goto error_exit;
+	}
+	if (rc == DC_STATUS_SUCCESS) {
+		tm.tm_year = dt.year;
+		tm.tm_mon = dt.month - 1;
+		tm.tm_mday = dt.day;
+		tm.tm_hour = dt.hour;
+		tm.tm_min = dt.minute;
+		tm.tm_sec = dt.second;
+		dc.when = utc_mktime(&tm);
+	}
+	dc.model = devdata->model;
+	dc.diveid = calculate_diveid(fingerprint, fsize);
+	parse_dive_ids(parser, &dc);
+
+	/* If we already saw this dive, abort. */
+	if (!devdata->force_download && dive_was_downloaded(dc.model, dc.deviceid, dc.diveid, dc.when)) {
+		already_downloaded = true;
+		already_downloaded_when = dc.when;
+		dc_parser_destroy(parser);
+		free(copy);
+		return false;
+	}
+
+	date_string = get_dive_date_c_string(dc.when);
+	dev_info(devdata, translate("gettextFromC", "Dive %d: %s"), number, date_string);
+	free(date_string);
+
+	job = calloc(1, sizeof(*job));
+	job->data = copy;
+	job->parser = parser;
+	job->diveid = dc.diveid;
+	job->number = ++queued_dive_number;
+
+	/*
+	 * The fingerprint is only valid during this callback. The worker
+	 * saves it off if this turns out to be the first dive that can
+	 * be parsed.
+	 */
+	if (fingerprint && fsize) {
+		job->fingerprint = malloc(fsize);
+		if (job->fingerprint) {
+			job->fsize = fsize;
+			memcpy(job->fingerprint, fingerprint, fsize);
+		}
+	}
+
+	work_queue_push(download_queue, job);
+	return true;
+
+error_exit:
+	dc_parser_destroy(parser);
+	free(copy);
 	return true;
+}
+
+static void start_download(device_data_t *devdata)
+{
+	queued_dive_number = 0;
+	already_downloaded = false;
+	download_queue = work_queue_start(DOWNLOAD_QUEUE_SIZE, parse_dive_job, devdata);
+}
+
+static void finish_download(device_data_t *devdata)
+{
+	work_queue_finish(download_queue);
+	download_queue = NULL;
+
+	if (already_downloaded) {
+		char *date_string = get_dive_date_c_string(already_downloaded_when);
+		dev_info(devdata, translate("gettextFromC", "Already downloaded dive at %s"), date_string);
+		free(date_string);
+	}
+}
+
+/*
+ * Import raw dives, newest first, as if they were downloaded from
+ * the device in devdata->descriptor. This runs the same code as a
+ * download, but doesn't need a device. Used by the tests.
+ */
+void libdc_download_raw_dives(device_data_t *devdata, const struct libdc_raw_dive *dives, int nr)
+{
+	int i;
 
+	start_download(devdata);
+	for (i = 0; i < nr; i++) {
+		if (!dive_cb(dives[i].data, dives[i].size, dives[i].fingerprint, dives[i].fsize, devdata))
+			break;
+	}
+	finish_download(devdata);
 }
 
 #ifndef O_BINARY
@@ -1020,29 +1192,34 @@ static void save_fingerprint(device_data_t *devdata)
  * Before we use the fingerprint data, verify that we actually
  * do have that fingerprinted dive.
  */
-static void verify_fingerprint(dc_device_t *device, device_data_t *devdata, const unsigned char *buffer, size_t size)
+size_t usable_fingerprint_size(const unsigned char *buffer, size_t size)
 {
 	uint32_t diveid, deviceid;
 
 	if (size <= 8)
-		return;
+		return 0;
 	size -= 8;
 
 	/* Get the dive ID from the end of the fingerprint cache file.. */
 	memcpy(&deviceid, buffer + size, 4);
 	memcpy(&diveid, buffer + size + 4, 4);
 
-	if (verbose)
-		dev_info(devdata, " ... fingerprinted dive %08x:%08x", deviceid, diveid);
 	/* Only use it if we *have* that dive! */
-	if (!has_dive(deviceid, diveid)) {
+	return has_dive(deviceid, diveid) ? size : 0;
+}
+
+static void verify_fingerprint(dc_device_t *device, device_data_t *devdata, const unsigned char *buffer, size_t size)
+{
+	size_t fsize = usable_fingerprint_size(buffer, size);
+
+	if (!fsize) {
 		if (verbose)
-			dev_info(devdata, " ... dive not found");
+			dev_info(devdata, " ... fingerprinted dive not found");
 		return;
 	}
-	dc_device_set_fingerprint(device, buffer, size);
+	dc_device_set_fingerprint(device, buffer, fsize);
 	if (verbose)
-		dev_info(devdata, " ... fingerprint of size %zu", size);
+		dev_info(devdata, " ... fingerprint of size %zu", fsize);
 }
 
 /*
@@ -1207,7 +1384,9 @@ static const char *do_device_import(device_data_t *data)
 			return translate("gettextFromC", "Dive data dumping error");
 		}
 	} else {
+		start_download(data);
 		rc = dc_device_foreach(device, dive_cb, data);
+		finish_download(data);
 
 		if (rc != DC_STATUS_SUCCESS) {
 			progress_bar_fraction = 0.0;
@@ -1403,6 +1582,11 @@ dc_status_t divecomputer_device_open(device_data_t *data)
 	dc_context_t *context = data->context;
 	unsigned int transports, supported;
 
+	if (data->replay_file) {
+		dev_info(data, "Replaying download from %s", data->replay_file);
+		return replay_open(&data->iostream, context, data);
+	}
+
 	transports = dc_descriptor_get_transports(data->descriptor);
 	supported = get_supported_transports(data);
 
@@ -1496,7 +1680,6 @@ const char *do_libdivecomputer_import(device_data_t *data)
 	const char *err;
 	FILE *fp = NULL;
 
-	import_dive_number = 0;
 	first_temp_is_air = 0;
 	data->device = NULL;
 	data->context = NULL;
@@ -1641,7 +1824,7 @@ dc_status_t libdc_buffer_parser(struct dive *dive, device_data_t *data, unsigned
 	// Do not parse Aladin/Memomouse headers as they are fakes
 	// Do not return on error, we can still parse the samples
 	if (dc_descriptor_get_type(data->descriptor) != DC_FAMILY_UWATEC_ALADIN && dc_descriptor_get_type(data->descriptor) != DC_FAMILY_UWATEC_MEMOMOUSE) {
-		rc = libdc_header_parser (parser, data, dive);
+		rc = libdc_header_parser (parser, data, dive, dive->number);
 		if (rc != DC_STATUS_SUCCESS) {
 			report_error("Error parsing the dive header data. Dive # %d\nStatus = %s", dive->number, errmsg(rc));
 		}
@@ -4,6 +4,7 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include "units.h"
 
 /* libdivecomputer */
 
@@ -50,14 +51,28 @@ typedef struct {
 	FILE *libdc_logfile;
 	struct divelog *log;
 	void *androidUsbDeviceDescriptor;
+	const char *replay_file;	/* download from this libdivecomputer logfile instead of the device */
+	unsigned int replay_latency;	/* emulated latency of every read in ms */
+	unsigned int replay_bandwidth;	/* emulated bandwidth in bytes per second, 0 means unlimited */
 } device_data_t;
 
+/* Raw data of a dive as passed by dc_device_foreach() */
+struct libdc_raw_dive {
+	const unsigned char *data;
+	unsigned int size;
+	const unsigned char *fingerprint;
+	unsigned int fsize;
+};
+
 const char *errmsg (dc_status_t rc);
 const char *do_libdivecomputer_import(device_data_t *data);
 const char *do_uemis_import(device_data_t *data);
 dc_status_t libdc_buffer_parser(struct dive *dive, device_data_t *data, unsigned char *buffer, int size);
+void libdc_download_raw_dives(device_data_t *devdata, const struct libdc_raw_dive *dives, int nr);
 void logfunc(dc_context_t *context, dc_loglevel_t loglevel, const char *file, unsigned int line, const char *function, const char *msg, void *userdata);
 dc_descriptor_t *get_descriptor(dc_family_t type, unsigned int model);
+bool dive_was_downloaded(const char *model, uint32_t deviceid, uint32_t diveid, timestamp_t when);
+size_t usable_fingerprint_size(const unsigned char *buffer, size_t size);
 
 extern int import_thread_cancelled;
 extern const char *progress_bar_text;
@@ -70,6 +85,7 @@ dc_status_t ble_packet_open(dc_iostream_t **iostream, dc_context_t *context, con
 dc_status_t rfcomm_stream_open(dc_iostream_t **iostream, dc_context_t *context, const char* devaddr);
 dc_status_t ftdi_open(dc_iostream_t **iostream, dc_context_t *context);
 dc_status_t serial_usb_android_open(dc_iostream_t **iostream, dc_context_t *context, void *androidUsbDevice);
+dc_status_t replay_open(dc_iostream_t **iostream, dc_context_t *context, device_data_t *data);
 
 dc_status_t divecomputer_device_open(device_data_t *data);
 
@@ -446,9 +446,13 @@ int try_to_open_liquivision(const char *filename, struct memblock *mem, struct d
 	unsigned int ptr;
 	int log_version;
 
+	if (buf_size < 8)
+		return 0;
 	// Get name length
 	unsigned int len = array_uint32_le(buf);
 	// Ignore length field and the name
+	if (len > buf_size - 8)
+		return 0;
 	ptr = 4 + len;
 
 	unsigned int dive_count = array_uint32_le(buf + ptr);
@@ -456,6 +460,8 @@ int try_to_open_liquivision(const char *filename, struct memblock *mem, struct d
 		// File version 3.0
 		log_version = 3;
 		ptr += 6;
+		if (ptr + 4 > buf_size)
+			return 0;
 		dive_count = array_uint32_le(buf + ptr);
 	} else {
 		log_version = 2;
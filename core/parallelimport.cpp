@@ -0,0 +1,67 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "parallelimport.h"
+#include "divelog.h"
+#include "file.h"
+#include "import-csv.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QtConcurrent>
+#include <vector>
+
+struct ImportJob {
+	QByteArray fileName;
+	struct divelog log;
+	int ret = 0;
+};
+
+// Some importers keep their state in global variables: the libdivecomputer
+// based ones (DataTrak, OSTCtools), Liquivision and the git storage. These
+// files are parsed one after the other on the calling thread.
+static bool needsSerialParse(const QString &fileName)
+{
+	static const char *serialExtensions[] = { "log", "dive", "lvd" };
+
+	if (fileName.endsWith(']') || QFileInfo(fileName).isDir())
+		return true;
+	QString suffix = QFileInfo(fileName).suffix();
+	for (const char *ext: serialExtensions) {
+		if (suffix.compare(ext, Qt::CaseInsensitive) == 0)
+			return true;
+	}
+	return false;
+}
+
+static void parseJob(ImportJob &job)
+{
+	job.ret = parse_file(job.fileName.constData(), &job.log);
+}
+
+int parse_files(const QStringList &fileNames, struct divelog *log)
+{
+	// The size of the vector is fixed, because the jobs are parsed in place
+	std::vector<ImportJob> jobs(fileNames.size());
+	std::vector<ImportJob *> parallel;
+	for (int i = 0; i < fileNames.size(); ++i) {
+		jobs[i].fileName = QFile::encodeName(fileNames[i]);
+		if (needsSerialParse(fileNames[i]))
+			parseJob(jobs[i]);
+		else
+			parallel.push_back(&jobs[i]);
+	}
+
+	// The importers only write the process-wide state that the jobs
+	// share under lock_tag_list() and lock_import_tables(). The limits
+	// of libxslt are set here, before any job reads them.
+	increase_xslt_limits();
+	QtConcurrent::blockingMap(parallel, [](ImportJob *job) { parseJob(*job); });
+
+	// Collect the results in the order of the files, so that the outcome
+	// is the same as when parsing the files one after the other.
+	int failed = 0;
+	for (ImportJob &job: jobs) {
+		if (job.ret < 0)
+			++failed;
+		log->append(std::move(job.log));
+	}
+	return failed;
+}
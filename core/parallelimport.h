@@ -0,0 +1,15 @@
+// SPDX-License-Identifier: GPL-2.0
+// Parse a list of dive log files on the global thread pool. Every file is
+// parsed into its own divelog, the results are then collected in a single
+// divelog so that they can be imported with one undo command.
+#ifndef PARALLELIMPORT_H
+#define PARALLELIMPORT_H
+
+#include <QStringList>
+
+struct divelog;
+
+// Returns the number of files that couldn't be parsed.
+int parse_files(const QStringList &fileNames, struct divelog *log);
+
+#endif
@@ -1500,8 +1500,10 @@ static bool entry(const char *name, char *buf, struct parser_state *state)
 {
 	if (!strncmp(name, "version.program", sizeof("version.program") - 1) ||
 	    !strncmp(name, "version.divelog", sizeof("version.divelog") - 1)) {
+		lock_import_tables();
 		last_xml_version = atoi(buf);
 		report_datafile_version(last_xml_version);
+		unlock_import_tables();
 	}
 	if (state->in_userid) {
 		return true;
@@ -1768,7 +1770,7 @@ int parse_xml_buffer(const char *url, const char *buffer, int size, struct divel
 
 	init_parser_state(&state);
 	state.log = log;
-	state.fingerprints = &fingerprint_table; // simply use the global table for now
+	state.fingerprints = &fingerprint_table; // simply use the global table for now, under lock_import_tables()
 	doc = xmlReadMemory(res, strlen(res), url, NULL, XML_PARSE_HUGE | XML_PARSE_RECOVER);
 	if (!doc)
 		doc = xmlReadMemory(res, strlen(res), url, "latin1", XML_PARSE_HUGE | XML_PARSE_RECOVER);
@@ -1796,7 +1798,7 @@ int parse_xml_buffer(const char *url, const char *buffer, int size, struct divel
  * Parse a unsigned 32-bit integer in little-endian mode,
  * that is seconds since Jan 1, 2000.
  */
-static timestamp_t parse_dlf_timestamp(unsigned char *buffer)
+static timestamp_t parse_dlf_timestamp(const unsigned char *buffer)
 {
 	timestamp_t offset;
 
@@ -1810,9 +1812,9 @@ static timestamp_t parse_dlf_timestamp(unsigned char *buffer)
 	return offset + 946684800;
 }
 
-int parse_dlf_buffer(unsigned char *buffer, size_t size, struct divelog *log)
+int parse_dlf_buffer(const unsigned char *buffer, size_t size, struct divelog *log)
 {
-	unsigned char *ptr = buffer;
+	const unsigned char *ptr = buffer;
 	unsigned char event;
 	bool found;
 	unsigned int time = 0;
@@ -1834,7 +1836,7 @@ int parse_dlf_buffer(unsigned char *buffer, size_t size, struct divelog *log)
 	state.log = log;
 
 	// Check for the correct file magic
-	if (ptr[0] != 'D' || ptr[1] != 'i' || ptr[2] != 'v' || ptr[3] != 'E')
+	if (size < 32 || ptr[0] != 'D' || ptr[1] != 'i' || ptr[2] != 'v' || ptr[3] != 'E')
 		return -1;
 
 	dive_start(&state);
@@ -1892,7 +1894,7 @@ int parse_dlf_buffer(unsigned char *buffer, size_t size, struct divelog *log)
 	if (state.cur_dc->divemode == CCR || state.cur_dc->divemode == PSCR)
 		state.cur_dc->no_o2sensors = 1;
 
-	for (; ptr < buffer + size; ptr += 16) {
+	for (; ptr + 16 <= buffer + size; ptr += 16) {
 		time = ((ptr[0] >> 4) & 0x0f) +
 			((ptr[1] << 4) & 0xff0) +
 			((ptr[2] << 12) & 0x1f000);
@@ -2312,6 +2314,7 @@ void parse_xml_init(void)
 
 void parse_xml_exit(void)
 {
+	flush_stylesheet_cache();
 	xmlCleanupParser();
 }
 
@@ -2376,14 +2379,13 @@ static xmlDoc *test_xslt_transforms(xmlDoc *doc, const struct xml_params *params
 			xmlFree(attribute);
 		}
 		xmlSubstituteEntitiesDefault(1);
-		xslt = get_stylesheet(info->file);
+		xslt = get_cached_stylesheet(info->file);
 		if (xslt == NULL) {
 			report_error(translate("gettextFromC", "Can't open stylesheet %s"), info->file);
 			return doc;
 		}
-		transformed = xsltApplyStylesheet(xslt, doc, xml_params_get(params));
+		transformed = apply_cached_stylesheet(xslt, info->file, doc, xml_params_get(params));
 		xmlFreeDoc(doc);
-		xsltFreeStylesheet(xslt);
 
 		return transformed;
 	}
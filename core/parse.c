@@ -15,6 +15,7 @@
 #include "sample.h"
 #include "subsurface-string.h"
 #include "picture.h"
+#include "qthelper.h"
 #include "trip.h"
 #include "device.h"
 #include "gettext.h"
@@ -29,6 +30,10 @@ void init_parser_state(struct parser_state *state)
 
 void free_parser_state(struct parser_state *state)
 {
+	int i;
+
+	for (i = 0; i < MAX_SQL_STATEMENTS; i++)
+		sqlite3_finalize(state->sql_stmt[i]);
 	free_dive(state->cur_dive);
 	free_trip(state->cur_trip);
 	free_dive_site(state->cur_dive_site);
@@ -86,7 +91,14 @@ int trimspace(char *buffer)
  */
 void record_dive_to_table(struct dive *dive, struct dive_table *table)
 {
-	add_to_dive_table(table, table->nr, fixup_dive(dive));
+	/* Dives that are recorded into another table, e.g. when importing or
+	 * loading a file, get their CNS when they are added to the dive list.
+	 * See calculate_derived_dive_data(). */
+	if (table == divelog.dives)
+		fixup_dive(dive);
+	else
+		fixup_dive_nocns(dive);
+	add_to_dive_table(table, table->nr, dive);
 }
 
 void start_match(const char *type, const char *name, char *buffer)
@@ -212,12 +224,14 @@ void fingerprint_settings_start(struct parser_state *state)
 
 void fingerprint_settings_end(struct parser_state *state)
 {
+	lock_import_tables();
 	create_fingerprint_node_from_hex(state->fingerprints,
 			state->cur_settings.fingerprint.model,
 			state->cur_settings.fingerprint.serial,
 			state->cur_settings.fingerprint.data,
 			state->cur_settings.fingerprint.fdeviceid,
 			state->cur_settings.fingerprint.fdiveid);
+	unlock_import_tables();
 }
 void dc_settings_start(struct parser_state *state)
 {
@@ -555,3 +569,45 @@ int atoi_n(char *ptr, unsigned int len)
 	}
 	return 0;
 }
+
+/*
+ * Run a per-dive query of the SQL based parsers. The query is prepared
+ * once, on first use, and kept in the statement slot "idx" of the parser
+ * state. Every parameter of the query is bound to "id". The callback
+ * has the same semantics as for sqlite3_exec().
+ */
+int sql_exec_id(struct parser_state *state, int idx, const char *query, sqlite3_int64 id, sqlite3_callback callback, void *param)
+{
+	sqlite3_stmt *stmt = state->sql_stmt[idx];
+	int i, columns, retval;
+	char **data;
+
+	if (!stmt) {
+		retval = sqlite3_prepare_v2(state->sql_handle, query, -1, &stmt, NULL);
+		if (retval != SQLITE_OK)
+			return retval;
+		state->sql_stmt[idx] = stmt;
+	}
+
+	for (i = 1; i <= sqlite3_bind_parameter_count(stmt); i++)
+		sqlite3_bind_int64(stmt, i, id);
+
+	columns = sqlite3_column_count(stmt);
+	data = malloc(2 * columns * sizeof(char *));
+	while ((retval = sqlite3_step(stmt)) == SQLITE_ROW) {
+		for (i = 0; i < columns; i++) {
+			data[i] = (char *)sqlite3_column_text(stmt, i);
+			data[columns + i] = (char *)sqlite3_column_name(stmt, i);
+		}
+		if (callback(param, columns, data, data + columns)) {
+			retval = SQLITE_ABORT;
+			break;
+		}
+	}
+	if (retval == SQLITE_DONE)
+		retval = SQLITE_OK;
+
+	sqlite3_reset(stmt);
+	free(data);
+	return retval;
+}
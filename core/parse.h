@@ -3,6 +3,7 @@
 #define PARSE_H
 
 #define MAX_EVENT_NAME 128
+#define MAX_SQL_STATEMENTS 8
 
 #include "event.h"
 #include "equipment.h" // for cylinder_t
@@ -91,6 +92,7 @@ struct parser_state {
 	struct fingerprint_table *fingerprints;         /* non-owning */
 
 	sqlite3 *sql_handle;			/* for SQL based parsers */
+	sqlite3_stmt *sql_stmt[MAX_SQL_STATEMENTS];	/* per-dive queries, prepared on first use */
 	event_allocation_t event_allocation;
 };
 
@@ -147,6 +149,7 @@ void utf8_string(char *buffer, void *_res);
 
 void add_dive_site(char *ds_name, struct dive *dive, struct parser_state *state);
 int atoi_n(char *ptr, unsigned int len);
+int sql_exec_id(struct parser_state *state, int idx, const char *query, sqlite3_int64 id, sqlite3_callback callback, void *param);
 
 void parse_xml_init(void);
 int parse_xml_buffer(const char *url, const char *buf, int size, struct divelog *log, const struct xml_params *params);
@@ -158,7 +161,7 @@ int parse_shearwater_buffer(sqlite3 *handle, const char *url, const char *buf, i
 int parse_shearwater_cloud_buffer(sqlite3 *handle, const char *url, const char *buf, int size, struct divelog *log);
 int parse_cobalt_buffer(sqlite3 *handle, const char *url, const char *buf, int size, struct divelog *log);
 int parse_divinglog_buffer(sqlite3 *handle, const char *url, const char *buf, int size, struct divelog *log);
-int parse_dlf_buffer(unsigned char *buffer, size_t size, struct divelog *log);
+int parse_dlf_buffer(const unsigned char *buffer, size_t size, struct divelog *log);
 #ifdef __cplusplus
 }
 #endif
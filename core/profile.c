@@ -378,15 +378,25 @@ static void insert_entry(struct plot_info *pi, int idx, int time, int depth, int
 	entry->sac = sac;
 	entry->ndl = -1;
 	entry->bearing = -1;
+	if (pi->o2sensors)
+		pi->o2sensors[idx] = pi->o2sensors[idx - 1];
 }
 
 void free_plot_info_data(struct plot_info *pi)
 {
 	free(pi->entry);
 	free(pi->pressures);
+	free(pi->tissues);
+	free(pi->gas);
+	free(pi->o2sensors);
 	memset(pi, 0, sizeof(*pi));
 }
 
+static bool has_o2sensor_data(const struct divecomputer *dc)
+{
+	return dc->divemode == CCR || (dc->divemode == PSCR && dc->no_o2sensors);
+}
+
 static void populate_plot_entries(const struct dive *dive, const struct divecomputer *dc, struct plot_info *pi)
 {
 	UNUSED(dive);
@@ -410,6 +420,8 @@ static void populate_plot_entries(const struct dive *dive, const struct divecomp
 	pi->entry = plot_data;
 	pi->nr_cylinders = dive->cylinders.nr;
 	pi->pressures = calloc(nr * (size_t)pi->nr_cylinders, sizeof(struct plot_pressure_data));
+	if (has_o2sensor_data(dc))
+		pi->o2sensors = calloc(nr, sizeof(struct plot_o2sensor_data));
 	if (!plot_data)
 		return;
 	pi->nr = nr;
@@ -474,11 +486,11 @@ static void populate_plot_entries(const struct dive *dive, const struct divecomp
 		entry->tts = sample->tts.seconds;
 		entry->in_deco = sample->in_deco;
 		entry->cns = sample->cns;
-		if (dc->divemode == CCR || (dc->divemode == PSCR && dc->no_o2sensors)) {
+		if (pi->o2sensors) {
 			entry->o2pressure.mbar = entry->o2setpoint.mbar = sample->setpoint.mbar;     // for rebreathers
 			int i;
 			for (i = 0; i < MAX_O2_SENSORS; i++)
-				entry->o2sensor[i].mbar = sample->o2sensor[i].mbar;
+				pi->o2sensors[idx].o2sensor[i].mbar = sample->o2sensor[i].mbar;
 		} else {
 			entry->pressures.o2 = sample->setpoint.mbar / 1000.0;
 		}
@@ -526,12 +538,107 @@ static void populate_plot_entries(const struct dive *dive, const struct divecomp
 	pi->nr = idx;
 }
 
+/*
+ * Precalculated data for the SAC calculation: the ambient pressure
+ * integrated over time as a prefix sum, the gas volume of every
+ * cylinder at every plot entry and, for every plot entry, the bounds
+ * of the window that the SAC rate is averaged over. Using these, the
+ * SAC rate of a plot entry can be calculated without looping over the
+ * entries in the window, so that the whole pass is linear in the number
+ * of plot entries.
+ */
+struct sac_data {
+	int64_t *mbar_time;	/* nr entries: integral of the ambient pressure in mbar * sec up to that entry */
+	int *volumes;		/* nr_cylinders blocks of nr entries: gas volume in ml, 0 if the pressure is unknown */
+	int *window_start;	/* nr entries: first entry at most 30 sec before that entry */
+	int *window_end;	/* nr entries: last entry at most 60 sec after that entry */
+	int *prev_surface;	/* nr entries: last k <= i where entries k-1 and k are at the surface, 0 if none */
+	int *next_surface;	/* nr + 1 entries: first k >= i where entries k-1 and k are at the surface, nr if none */
+	int *prev_missing;	/* nr_cylinders blocks of nr entries: last entry <= i without pressure, -1 if none */
+	int *next_missing;	/* nr_cylinders blocks of nr + 2 entries: first entry >= i without pressure, nr + 1 if none */
+};
+
+static bool surface_interval(const struct plot_info *pi, int i)
+{
+	return pi->entry[i - 1].depth < SURFACE_THRESHOLD && pi->entry[i].depth < SURFACE_THRESHOLD;
+}
+
+static void init_sac_data(const struct dive *dive, const struct plot_info *pi, struct sac_data *sd)
+{
+	int i, j, cyl;
+	int nr = pi->nr, nr_cylinders = pi->nr_cylinders;
+
+	sd->mbar_time = malloc(nr * sizeof(*sd->mbar_time));
+	sd->volumes = malloc(nr * (size_t)nr_cylinders * sizeof(*sd->volumes));
+	sd->window_start = malloc(nr * sizeof(*sd->window_start));
+	sd->window_end = malloc(nr * sizeof(*sd->window_end));
+	sd->prev_surface = malloc(nr * sizeof(*sd->prev_surface));
+	sd->next_surface = malloc((nr + 1) * sizeof(*sd->next_surface));
+	sd->prev_missing = malloc(nr * (size_t)nr_cylinders * sizeof(*sd->prev_missing));
+	sd->next_missing = malloc((nr + 2) * (size_t)nr_cylinders * sizeof(*sd->next_missing));
+
+	sd->mbar_time[0] = 0;
+	for (i = 1; i < nr; i++) {
+		const struct plot_data *entry = pi->entry + i;
+		int depth = (entry[-1].depth + entry[0].depth) / 2;
+		int time = entry[0].sec - entry[-1].sec;
+		sd->mbar_time[i] = sd->mbar_time[i - 1] + (int64_t)depth_to_mbar(depth, dive) * time;
+	}
+
+	for (i = 0; i < nr; i++) {
+		for (cyl = 0; cyl < nr_cylinders; cyl++) {
+			pressure_t p = { .mbar = get_plot_pressure(pi, i, cyl) };
+			sd->volumes[cyl + i * nr_cylinders] = p.mbar ? gas_volume(get_cylinder(dive, cyl), p) : 0;
+			sd->prev_missing[cyl + i * nr_cylinders] = p.mbar ? (i > 0 ? sd->prev_missing[cyl + (i - 1) * nr_cylinders] : -1) : i;
+		}
+	}
+	for (cyl = 0; cyl < nr_cylinders; cyl++) {
+		sd->next_missing[cyl + (nr + 1) * nr_cylinders] = nr + 1;
+		sd->next_missing[cyl + nr * nr_cylinders] = nr + 1;
+	}
+	for (i = nr - 1; i >= 0; i--) {
+		for (cyl = 0; cyl < nr_cylinders; cyl++)
+			sd->next_missing[cyl + i * nr_cylinders] = get_plot_pressure(pi, i, cyl) ? sd->next_missing[cyl + (i + 1) * nr_cylinders] : i;
+	}
+
+	sd->prev_surface[0] = 0;
+	for (i = 1; i < nr; i++)
+		sd->prev_surface[i] = surface_interval(pi, i) ? i : sd->prev_surface[i - 1];
+	sd->next_surface[nr] = nr;
+	for (i = nr - 1; i >= 0; i--)
+		sd->next_surface[i] = i > 0 && surface_interval(pi, i) ? i : sd->next_surface[i + 1];
+
+	/* The plot entries are sorted by time, therefore both window bounds only move forward */
+	for (i = 0, j = 0; i < nr; i++) {
+		while (pi->entry[j].sec < pi->entry[i].sec - 30)
+			j++;
+		sd->window_start[i] = j;
+	}
+	for (i = 0, j = 0; i < nr; i++) {
+		while (j + 1 < nr && pi->entry[j + 1].sec <= pi->entry[i].sec + 60)
+			j++;
+		sd->window_end[i] = j;
+	}
+}
+
+static void free_sac_data(struct sac_data *sd)
+{
+	free(sd->mbar_time);
+	free(sd->volumes);
+	free(sd->window_start);
+	free(sd->window_end);
+	free(sd->prev_surface);
+	free(sd->next_surface);
+	free(sd->prev_missing);
+	free(sd->next_missing);
+}
+
 /*
  * Calculate the sac rate between the two plot entries 'first' and 'last'.
  *
  * Everything in between has a cylinder pressure for at least some of the cylinders.
  */
-static int sac_between(const struct dive *dive, struct plot_info *pi, int first, int last, const bool gases[])
+static int sac_between(const struct plot_info *pi, const struct sac_data *sd, int first, int last, const bool gases[])
 {
 	int i, airuse;
 	double pressuretime;
@@ -542,55 +649,25 @@ static int sac_between(const struct dive *dive, struct plot_info *pi, int first,
 	/* Get airuse for the set of cylinders over the range */
 	airuse = 0;
 	for (i = 0; i < pi->nr_cylinders; i++) {
-		pressure_t a, b;
-		cylinder_t *cyl;
 		int cyluse;
 
 		if (!gases[i])
 			continue;
 
-		a.mbar = get_plot_pressure(pi, first, i);
-		b.mbar = get_plot_pressure(pi, last, i);
-		cyl = get_cylinder(dive, i);
-		cyluse = gas_volume(cyl, a) - gas_volume(cyl, b);
+		cyluse = sd->volumes[i + first * pi->nr_cylinders] - sd->volumes[i + last * pi->nr_cylinders];
 		if (cyluse > 0)
 			airuse += cyluse;
 	}
 	if (!airuse)
 		return 0;
 
-	/* Calculate depthpressure integrated over time */
-	pressuretime = 0.0;
-	do {
-		struct plot_data *entry = pi->entry + first;
-		struct plot_data *next = entry + 1;
-		int depth = (entry->depth + next->depth) / 2;
-		int time = next->sec - entry->sec;
-		double atm = depth_to_atm(depth, dive);
-
-		pressuretime += atm * time;
-	} while (++first < last);
-
-	/* Turn "atmseconds" into "atmminutes" */
-	pressuretime /= 60;
+	/* Depthpressure integrated over time, turned from "mbarseconds" into "atmminutes" */
+	pressuretime = (double)(sd->mbar_time[last] - sd->mbar_time[first]) / SURFACE_PRESSURE / 60;
 
 	/* SAC = mliter per minute */
 	return lrint(airuse / pressuretime);
 }
 
-/* Is there pressure data for all gases? */
-static bool all_pressures(struct plot_info *pi, int idx, const bool gases[])
-{
-	int i;
-
-	for (i = 0; i < pi->nr_cylinders; i++) {
-		if (gases[i] && !get_plot_pressure(pi, idx, i))
-			return false;
-	}
-
-	return true;
-}
-
 /* Which of the set of gases have pressure data? Returns false if none of them. */
 static bool filter_pressures(struct plot_info *pi, int idx, const bool gases_in[], bool gases_out[])
 {
@@ -611,11 +688,10 @@ static bool filter_pressures(struct plot_info *pi, int idx, const bool gases_in[
  * an array of gases, the caller passes in scratch memory in the last
  * argument.
  */
-static void fill_sac(const struct dive *dive, struct plot_info *pi, int idx, const bool gases_in[], bool gases[])
+static void fill_sac(struct plot_info *pi, const struct sac_data *sd, int idx, const bool gases_in[], bool gases[])
 {
 	struct plot_data *entry = pi->entry + idx;
-	int first, last;
-	int time;
+	int first, last, cyl;
 
 	if (entry->sac)
 		return;
@@ -628,42 +704,29 @@ static void fill_sac(const struct dive *dive, struct plot_info *pi, int idx, con
 		return;
 
 	/*
-	 * Try to go back 30 seconds to get 'first'.
-	 * Stop if the cylinder pressure data set changes.
+	 * Go back up to 30 seconds to get 'first'.
+	 * Stop at surface intervals and if the cylinder pressure data set changes.
 	 */
-	first = idx;
-	time = entry->sec - 30;
-	while (idx > 0) {
-		struct plot_data *entry = pi->entry + idx;
-		struct plot_data *prev = pi->entry + idx - 1;
-
-		if (prev->depth < SURFACE_THRESHOLD && entry->depth < SURFACE_THRESHOLD)
-			break;
-		if (prev->sec < time)
-			break;
-		if (!all_pressures(pi, idx - 1, gases))
-			break;
-		idx--;
-		first = idx;
+	first = MAX(sd->window_start[idx], sd->prev_surface[idx]);
+	for (cyl = 0; cyl < pi->nr_cylinders; cyl++) {
+		if (gases[cyl])
+			first = MAX(first, sd->prev_missing[cyl + idx * pi->nr_cylinders] + 1);
 	}
 
-	/* Now find an entry a minute after the first one */
-	last = first;
-	time = pi->entry[first].sec + 60;
-	while (++idx < pi->nr) {
-		struct plot_data *entry = pi->entry + last;
-		struct plot_data *next = pi->entry + last + 1;
-		if (next->depth < SURFACE_THRESHOLD && entry->depth < SURFACE_THRESHOLD)
-			break;
-		if (next->sec > time)
-			break;
-		if (!all_pressures(pi, idx + 1, gases))
-			break;
-		last = idx;
+	/*
+	 * Now find an entry up to a minute after the first one. Note that
+	 * an entry is only included if the pressure data of the entry after
+	 * it is complete.
+	 */
+	last = MIN(sd->window_end[first], sd->next_surface[first + 1] - 1);
+	for (cyl = 0; cyl < pi->nr_cylinders; cyl++) {
+		if (gases[cyl])
+			last = MIN(last, sd->next_missing[cyl + (first + 2) * pi->nr_cylinders] - 2);
 	}
+	last = MIN(last, pi->nr - 1);
 
 	/* Ok, now calculate the SAC between 'first' and 'last' */
-	entry->sac = sac_between(dive, pi, first, last, gases);
+	entry->sac = sac_between(pi, sd, first, last, gases);
 }
 
 /*
@@ -682,7 +745,12 @@ static void calculate_sac(const struct dive *dive, const struct divecomputer *dc
 	struct gasmix gasmix = gasmix_invalid;
 	const struct event *ev = NULL;
 	bool *gases, *gases_scratch;
+	struct sac_data sd;
 
+	if (pi->nr <= 0)
+		return;
+
+	init_sac_data(dive, pi, &sd);
 	gases = calloc(pi->nr_cylinders, sizeof(*gases));
 
 	/* This might be premature optimization, but let's allocate the gas array for
@@ -697,11 +765,12 @@ static void calculate_sac(const struct dive *dive, const struct divecomputer *dc
 			matching_gases(dive, newmix, gases);
 		}
 
-		fill_sac(dive, pi, i, gases, gases_scratch);
+		fill_sac(pi, &sd, i, gases, gases_scratch);
 	}
 
 	free(gases);
 	free(gases_scratch);
+	free_sac_data(&sd);
 }
 
 static void populate_secondary_sensor_data(const struct divecomputer *dc, struct plot_info *pi)
@@ -957,6 +1026,7 @@ static void calculate_deco_information(struct deco_state *ds, const struct deco_
 
 		for (i = 1; i < pi->nr; i++) {
 			struct plot_data *entry = pi->entry + i;
+			struct plot_tissue_data *tissues = pi->tissues ? pi->tissues + i : NULL;
 			int j, t0 = (entry - 1)->sec, t1 = entry->sec;
 			int time_stepsize = 20, max_ceiling = -1;
 
@@ -1027,13 +1097,19 @@ static void calculate_deco_information(struct deco_state *ds, const struct deco_
 			for (j = 0; j < 16; j++) {
 				double m_value = ds->buehlmann_inertgas_a[j] + entry->ambpressure / ds->buehlmann_inertgas_b[j];
 				double surface_m_value = ds->buehlmann_inertgas_a[j] + surface_pressure / ds->buehlmann_inertgas_b[j];
-				entry->ceilings[j] = deco_allowed_depth(ds->tolerated_by_tissue[j], surface_pressure, dive, 1);
-				if (entry->ceilings[j] > max_ceiling)
-					max_ceiling = entry->ceilings[j];
 				double current_gf = (ds->tissue_inertgas_saturation[j] - entry->ambpressure) / (m_value - entry->ambpressure);
-				entry->percentages[j] = ds->tissue_inertgas_saturation[j] < entry->ambpressure ?
-					lrint(ds->tissue_inertgas_saturation[j] / entry->ambpressure * AMB_PERCENTAGE) :
-					lrint(AMB_PERCENTAGE + current_gf * (100.0 - AMB_PERCENTAGE));
+				// The per-tissue ceilings are only needed for the tissue graphs and to detect ceiling violations in the planner
+				if (tissues || in_planner) {
+					int ceiling = deco_allowed_depth(ds->tolerated_by_tissue[j], surface_pressure, dive, 1);
+					if (ceiling > max_ceiling)
+						max_ceiling = ceiling;
+					if (tissues)
+						tissues->ceilings[j] = ceiling;
+				}
+				if (tissues)
+					tissues->percentages[j] = ds->tissue_inertgas_saturation[j] < entry->ambpressure ?
+						lrint(ds->tissue_inertgas_saturation[j] / entry->ambpressure * AMB_PERCENTAGE) :
+						lrint(AMB_PERCENTAGE + current_gf * (100.0 - AMB_PERCENTAGE));
 				if (current_gf > entry->current_gf)
 					entry->current_gf = current_gf;
 				double surface_gf = 100.0 * (ds->tissue_inertgas_saturation[j] - surface_pressure) / (surface_m_value - surface_pressure);
@@ -1120,17 +1196,17 @@ static void calculate_deco_information(struct deco_state *ds, const struct deco_
 /* Sort the o2 pressure values. There are so few that a simple bubble sort
  * will do */
 
-void sort_o2_pressures(int *sensorn, int np, struct plot_data *entry)
+static void sort_o2_pressures(int *sensorn, int np, const struct plot_o2sensor_data *sensors)
 {
 	int smallest, position, old;
 
 	for (int i = 0; i < np - 1; i++) {
 		position = i;
-		smallest = entry->o2sensor[sensorn[i]].mbar;
+		smallest = sensors->o2sensor[sensorn[i]].mbar;
 		for (int j = i+1; j < np; j++)
-			if (entry->o2sensor[sensorn[j]].mbar < smallest) {
+			if (sensors->o2sensor[sensorn[j]].mbar < smallest) {
 				position = j;
-				smallest = entry->o2sensor[sensorn[j]].mbar;
+				smallest = sensors->o2sensor[sensorn[j]].mbar;
 			}
 		old = sensorn[i];
 		sensorn[i] = position;
@@ -1139,41 +1215,41 @@ void sort_o2_pressures(int *sensorn, int np, struct plot_data *entry)
 }
 
 /* Function calculate_ccr_po2: This function takes information from one plot_data structure (i.e. one point on
- * the dive profile), containing the oxygen sensor values of a CCR system and, for that plot_data structure,
+ * the dive profile) and the oxygen sensor values of a CCR system at that point and
  * calculates the po2 value from the sensor data. If there are at least 3 sensors, sensors are voted out until
  * their span is within diff_limit.
  */
-static int calculate_ccr_po2(struct plot_data *entry, const struct divecomputer *dc)
+static int calculate_ccr_po2(const struct plot_data *entry, const struct plot_o2sensor_data *sensors, const struct divecomputer *dc)
 {
 	int sump = 0, minp = 0, maxp = 0;
 	int sensorn[MAX_O2_SENSORS];
 	int i, np = 0;
 
 	for (i = 0; i < dc->no_o2sensors && i < MAX_O2_SENSORS; i++)
-		if (entry->o2sensor[i].mbar) { // Valid reading
+		if (sensors->o2sensor[i].mbar) { // Valid reading
 			sensorn[np++] = i;
-			sump += entry->o2sensor[i].mbar;
+			sump += sensors->o2sensor[i].mbar;
 		}
 	if (np == 0)
 		return entry->o2pressure.mbar;
 	else if (np == 1)
-		return entry->o2sensor[sensorn[0]].mbar;
+		return sensors->o2sensor[sensorn[0]].mbar;
 
 	maxp = np - 1;
-	sort_o2_pressures(sensorn, np, entry);
+	sort_o2_pressures(sensorn, np, sensors);
 
 	// This is the Shearwater voting logic: If there are still at least three sensors and one
 	// differs by more than 20% from the closest it is voted out.
 	while (maxp - minp > 1) {
-		if (entry->o2sensor[sensorn[minp + 1]].mbar - entry->o2sensor[sensorn[minp]].mbar >
+		if (sensors->o2sensor[sensorn[minp + 1]].mbar - sensors->o2sensor[sensorn[minp]].mbar >
 		    sump / (maxp - minp + 1) / 5) {
-			sump -= entry->o2sensor[sensorn[minp]].mbar;
+			sump -= sensors->o2sensor[sensorn[minp]].mbar;
 			++minp;
 			continue;
 		}
-		if (entry->o2sensor[sensorn[maxp]].mbar - entry->o2sensor[sensorn[maxp - 1]].mbar >
+		if (sensors->o2sensor[sensorn[maxp]].mbar - sensors->o2sensor[sensorn[maxp - 1]].mbar >
 		    sump / (maxp - minp +1) / 5) {
-			sump -= entry->o2sensor[sensorn[maxp]].mbar;
+			sump -= sensors->o2sensor[sensorn[maxp]].mbar;
 			--maxp;
 			continue;
 		}
@@ -1212,28 +1288,32 @@ static void calculate_gas_information_new(const struct dive *dive, const struct
 			entry->scr_OC_pO2.mbar = (int) depth_to_mbar(entry->depth, dive) * get_o2(gasmix2) / 1000;
 		}
 
+		if (!pi->gas)
+			continue;
+
 		/* Calculate MOD, EAD, END and EADD based on partial pressures calculated before
 		 * so there is no difference in calculating between OC and CC
 		 * END takes O₂ + N₂ (air) into account ("Narcotic" for trimix dives)
 		 * EAD just uses N₂ ("Air" for nitrox dives) */
+		struct plot_gas_data *gas = pi->gas + i;
 		pressure_t modpO2 = { .mbar = (int)(prefs.modpO2 * 1000) };
-		entry->mod = gas_mod(gasmix, modpO2, dive, 1).mm;
-		entry->end = mbar_to_depth(lrint(depth_to_mbarf(entry->depth, dive) * (1000 - fhe) / 1000.0), dive);
-		entry->ead = mbar_to_depth(lrint(depth_to_mbarf(entry->depth, dive) * fn2 / (double)N2_IN_AIR), dive);
-		entry->eadd = mbar_to_depth(lrint(depth_to_mbarf(entry->depth, dive) *
-				      (entry->pressures.o2 / amb_pressure * O2_DENSITY +
-				       entry->pressures.n2 / amb_pressure * N2_DENSITY +
-				       entry->pressures.he / amb_pressure * HE_DENSITY) /
-				      (O2_IN_AIR * O2_DENSITY + N2_IN_AIR * N2_DENSITY) * 1000), dive);
-		entry->density = gas_density(&entry->pressures);
-		if (entry->mod < 0)
-			entry->mod = 0;
-		if (entry->ead < 0)
-			entry->ead = 0;
-		if (entry->end < 0)
-			entry->end = 0;
-		if (entry->eadd < 0)
-			entry->eadd = 0;
+		gas->mod = gas_mod(gasmix, modpO2, dive, 1).mm;
+		gas->end = mbar_to_depth(lrint(depth_to_mbarf(entry->depth, dive) * (1000 - fhe) / 1000.0), dive);
+		gas->ead = mbar_to_depth(lrint(depth_to_mbarf(entry->depth, dive) * fn2 / (double)N2_IN_AIR), dive);
+		gas->eadd = mbar_to_depth(lrint(depth_to_mbarf(entry->depth, dive) *
+				    (entry->pressures.o2 / amb_pressure * O2_DENSITY +
+				     entry->pressures.n2 / amb_pressure * N2_DENSITY +
+				     entry->pressures.he / amb_pressure * HE_DENSITY) /
+				    (O2_IN_AIR * O2_DENSITY + N2_IN_AIR * N2_DENSITY) * 1000), dive);
+		gas->density = gas_density(&entry->pressures);
+		if (gas->mod < 0)
+			gas->mod = 0;
+		if (gas->ead < 0)
+			gas->ead = 0;
+		if (gas->end < 0)
+			gas->end = 0;
+		if (gas->eadd < 0)
+			gas->eadd = 0;
 	}
 }
 
@@ -1254,19 +1334,20 @@ static void fill_o2_values(const struct dive *dive, const struct divecomputer *d
 	for (i = 0; i < pi->nr; i++) {
 		struct plot_data *entry = pi->entry + i;
 
-		if (dc->divemode == CCR || (dc->divemode == PSCR && dc->no_o2sensors)) {
+		if (pi->o2sensors) {
+			struct plot_o2sensor_data *sensors = pi->o2sensors + i;
 			if (i == 0) { // For 1st iteration, initialise the last_sensor values
 				for (j = 0; j < dc->no_o2sensors; j++)
-					last_sensor[j].mbar = pi->entry->o2sensor[j].mbar;
+					last_sensor[j].mbar = sensors->o2sensor[j].mbar;
 			} else { // Now re-insert the missing oxygen pressure values
 				for (j = 0; j < dc->no_o2sensors; j++)
-					if (entry->o2sensor[j].mbar)
-						last_sensor[j].mbar = entry->o2sensor[j].mbar;
+					if (sensors->o2sensor[j].mbar)
+						last_sensor[j].mbar = sensors->o2sensor[j].mbar;
 					else
-						entry->o2sensor[j].mbar = last_sensor[j].mbar;
+						sensors->o2sensor[j].mbar = last_sensor[j].mbar;
 			} // having initialised the empty o2 sensor values for this point on the profile,
 			amb_pressure.mbar = depth_to_mbar(entry->depth, dive);
-			o2pressure.mbar = calculate_ccr_po2(entry, dc); // ...calculate the po2 based on the sensor data
+			o2pressure.mbar = calculate_ccr_po2(entry, sensors, dc); // ...calculate the po2 based on the sensor data
 			entry->o2pressure.mbar = MIN(o2pressure.mbar, amb_pressure.mbar);
 		} else {
 			entry->o2pressure.mbar = 0; // initialise po2 to zero for dctype = OC
@@ -1291,7 +1372,7 @@ static void debug_print_profiledata(struct plot_info *pi)
 			entry = pi->entry + i;
 			fprintf(f1, "%d gas=%8d %8d ; dil=%8d %8d ; o2_sp= %d %d %d %d PO2= %f\n", i, get_plot_sensor_pressure(pi, i),
 				get_plot_interpolated_pressure(pi, i), O2CYLINDER_PRESSURE(entry), INTERPOLATED_O2CYLINDER_PRESSURE(entry),
-				entry->o2pressure.mbar, entry->o2sensor[0].mbar, entry->o2sensor[1].mbar, entry->o2sensor[2].mbar, entry->pressures.o2);
+				entry->o2pressure.mbar, get_plot_o2sensor(pi, i, 0), get_plot_o2sensor(pi, i, 1), get_plot_o2sensor(pi, i, 2), entry->pressures.o2);
 		}
 		fclose(f1);
 	}
@@ -1313,10 +1394,14 @@ void init_plot_info(struct plot_info *pi)
  * sides, so that you can do end-points without having to worry
  * about it.
  *
+ * The optional columns given by the "columns" bit field are
+ * allocated and calculated on top of the core columns.
+ *
  * The old data will be freed. Before the first call, the plot
  * info must be initialized with init_plot_info().
  */
-void create_plot_info_new(const struct dive *dive, const struct divecomputer *dc, struct plot_info *pi, const struct deco_state *planner_ds)
+void create_plot_info_new(const struct dive *dive, const struct divecomputer *dc, struct plot_info *pi, const struct deco_state *planner_ds,
+			  unsigned int columns)
 {
 	int o2, he, o2max;
 	struct deco_state plot_deco_state;
@@ -1337,6 +1422,11 @@ void create_plot_info_new(const struct dive *dive, const struct divecomputer *dc
 	}
 
 	populate_plot_entries(dive, dc, pi);
+	if (columns & PLOT_TISSUES)
+		pi->tissues = calloc(pi->nr, sizeof(struct plot_tissue_data));
+	if (columns & PLOT_GAS_DETAILS)
+		pi->gas = calloc(pi->nr, sizeof(struct plot_gas_data));
+	pi->columns = columns;
 
 	check_setpoint_events(dive, dc, pi);     /* Populate setpoints */
 	setup_gas_sensor_pressure(dive, dc, pi); /* Try to populate our gas pressure knowledge */
@@ -1365,6 +1455,7 @@ static void plot_string(const struct dive *d, const struct plot_info *pi, int id
 	int decimals, cyl;
 	const char *unit;
 	const struct plot_data *entry = pi->entry + idx;
+	const struct plot_gas_data *gas = pi->gas ? pi->gas + idx : NULL;
 
 	depthvalue = get_depth_units(entry->depth, NULL, &depth_unit);
 	put_format_loc(b, translate("gettextFromC", "@: %d:%02d\nD: %.1f%s\n"), FRACTION(entry->sec, 60), depthvalue, depth_unit);
@@ -1399,29 +1490,29 @@ static void plot_string(const struct dive *d, const struct plot_info *pi, int id
 		put_format_loc(b, translate("gettextFromC", "pN₂: %.2fbar\n"), entry->pressures.n2);
 	if (prefs.pp_graphs.phe && entry->pressures.he > 0)
 		put_format_loc(b, translate("gettextFromC", "pHe: %.2fbar\n"), entry->pressures.he);
-	if (prefs.mod && entry->mod > 0) {
-		mod = lrint(get_depth_units(entry->mod, NULL, &depth_unit));
+	if (gas && prefs.mod && gas->mod > 0) {
+		mod = lrint(get_depth_units(gas->mod, NULL, &depth_unit));
 		put_format_loc(b, translate("gettextFromC", "MOD: %d%s\n"), mod, depth_unit);
 	}
-	eadd = lrint(get_depth_units(entry->eadd, NULL, &depth_unit));
 
-	if (prefs.ead) {
+	if (gas && prefs.ead) {
+		eadd = lrint(get_depth_units(gas->eadd, NULL, &depth_unit));
 		switch (pi->dive_type) {
 		case NITROX:
-			if (entry->ead > 0) {
-				ead = lrint(get_depth_units(entry->ead, NULL, &depth_unit));
-				put_format_loc(b, translate("gettextFromC", "EAD: %d%s\nEADD: %d%s / %.1fg/ℓ\n"), ead, depth_unit, eadd, depth_unit, entry->density);
+			if (gas->ead > 0) {
+				ead = lrint(get_depth_units(gas->ead, NULL, &depth_unit));
+				put_format_loc(b, translate("gettextFromC", "EAD: %d%s\nEADD: %d%s / %.1fg/ℓ\n"), ead, depth_unit, eadd, depth_unit, gas->density);
 				break;
 			}
 		case TRIMIX:
-			if (entry->end > 0) {
-				end = lrint(get_depth_units(entry->end, NULL, &depth_unit));
-				put_format_loc(b, translate("gettextFromC", "END: %d%s\nEADD: %d%s / %.1fg/ℓ\n"), end, depth_unit, eadd, depth_unit, entry->density);
+			if (gas->end > 0) {
+				end = lrint(get_depth_units(gas->end, NULL, &depth_unit));
+				put_format_loc(b, translate("gettextFromC", "END: %d%s\nEADD: %d%s / %.1fg/ℓ\n"), end, depth_unit, eadd, depth_unit, gas->density);
 				break;
 			}
 		case AIR:
-			if (entry->density > 0) {
-				put_format_loc(b, translate("gettextFromC", "Density: %.1fg/ℓ\n"), entry->density);
+			if (gas->density > 0) {
+				put_format_loc(b, translate("gettextFromC", "Density: %.1fg/ℓ\n"), gas->density);
 			}
 		case FREEDIVING:
 			/* nothing */
@@ -1487,11 +1578,12 @@ static void plot_string(const struct dive *d, const struct plot_info *pi, int id
 		if (entry->ceiling) {
 			depthvalue = get_depth_units(entry->ceiling, NULL, &depth_unit);
 			put_format_loc(b, translate("gettextFromC", "Calculated ceiling %.1f%s\n"), depthvalue, depth_unit);
-			if (prefs.calcalltissues) {
+			if (prefs.calcalltissues && pi->tissues) {
+				const struct plot_tissue_data *tissues = pi->tissues + idx;
 				int k;
 				for (k = 0; k < 16; k++) {
-					if (entry->ceilings[k]) {
-						depthvalue = get_depth_units(entry->ceilings[k], NULL, &depth_unit);
+					if (tissues->ceilings[k]) {
+						depthvalue = get_depth_units(tissues->ceilings[k], NULL, &depth_unit);
 						put_format_loc(b, translate("gettextFromC", "Tissue %.0fmin: %.1f%s\n"), buehlmann_N2_t_halflife[k], depthvalue, depth_unit);
 					}
 				}
@@ -41,8 +41,6 @@ struct plot_data {
 	/* Depth info */
 	int depth;
 	int ceiling;
-	int ceilings[16];
-	int percentages[16];
 	int ndl;
 	int tts;
 	int rbt;
@@ -54,10 +52,8 @@ struct plot_data {
 	int running_sum;
 	struct gas_pressures pressures;
 	pressure_t o2pressure;  // for rebreathers, this is consensus measured po2, or setpoint otherwise. 0 for OC.
-	pressure_t o2sensor[MAX_O2_SENSORS]; //for rebreathers with several sensors
 	pressure_t o2setpoint;
 	pressure_t scr_OC_pO2;
-	int mod, ead, end, eadd;
 	velocity_t velocity;
 	int speed;
 	/* values calculated by us */
@@ -73,10 +69,35 @@ struct plot_data {
 	double gfline;
 	double surface_gf;
 	double current_gf;
-	double density;
 	bool icd_warning;
 };
 
+/*
+ * Optional columns of the plot info. These are rather large, but only
+ * needed by some consumers (tissue graphs, info box, export). They are
+ * only calculated if the caller of create_plot_info_new() asks for them.
+ */
+enum plot_columns {
+	PLOT_TISSUES = 1 << 0,		/* per-tissue ceilings and saturations */
+	PLOT_GAS_DETAILS = 1 << 1,	/* MOD, EAD, END, EADD and gas density */
+	PLOT_ALL_COLUMNS = PLOT_TISSUES | PLOT_GAS_DETAILS
+};
+
+struct plot_tissue_data {
+	int ceilings[16];
+	int percentages[16];
+};
+
+struct plot_gas_data {
+	int mod, ead, end, eadd;
+	double density;
+};
+
+/* only allocated for rebreather dives with oxygen sensors */
+struct plot_o2sensor_data {
+	pressure_t o2sensor[MAX_O2_SENSORS];
+};
+
 /* Plot info with smoothing, velocity indication
  * and one-, two- and three-minute minimums and maximums */
 struct plot_info {
@@ -91,16 +112,22 @@ struct plot_info {
 	double endtempcoord;
 	double maxpp;
 	bool waypoint_above_ceiling;
+	unsigned int columns; /* optional columns that were calculated, see enum plot_columns */
 	struct plot_data *entry;
 	struct plot_pressure_data *pressures; /* cylinders.nr blocks of nr entries. */
+	struct plot_tissue_data *tissues; /* nr entries if PLOT_TISSUES was requested, NULL otherwise. */
+	struct plot_gas_data *gas; /* nr entries if PLOT_GAS_DETAILS was requested, NULL otherwise. */
+	struct plot_o2sensor_data *o2sensors; /* nr entries for rebreather dives, NULL otherwise. */
 };
 
 #define AMB_PERCENTAGE 50.0
 
 extern void compare_samples(const struct dive *d, const struct plot_info *pi, int idx1, int idx2, char *buf, int bufsize, bool sum);
 extern void init_plot_info(struct plot_info *pi);
-/* when planner_dc is non-null, this is called in planner mode. */
-extern void create_plot_info_new(const struct dive *dive, const struct divecomputer *dc, struct plot_info *pi, const struct deco_state *planner_ds);
+/* when planner_dc is non-null, this is called in planner mode.
+ * columns is a bit field of optional columns to calculate (see enum plot_columns). */
+extern void create_plot_info_new(const struct dive *dive, const struct divecomputer *dc, struct plot_info *pi, const struct deco_state *planner_ds,
+				 unsigned int columns);
 extern int get_plot_details_new(const struct dive *d, const struct plot_info *pi, int time, struct membuffer *);
 extern void free_plot_info_data(struct plot_info *pi);
 
@@ -143,6 +170,12 @@ static inline int get_plot_pressure(const struct plot_info *pi, int idx, int cyl
 	return res ? res : get_plot_interpolated_pressure(pi, idx, cylinder);
 }
 
+/* returns 0 if there is no sensor data */
+static inline int get_plot_o2sensor(const struct plot_info *pi, int idx, int sensor)
+{
+	return pi->o2sensors ? pi->o2sensors[idx].o2sensor[sensor].mbar : 0;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -31,6 +31,7 @@
 #include <QJsonDocument>
 #include <QNetworkProxy>
 #include <QDateTime>
+#include <QElapsedTimer>
 #include <QImageReader>
 #include <QtConcurrent>
 #include <QFont>
@@ -38,6 +39,8 @@
 #include <QTextDocument>
 #include <cstdarg>
 #include <cstdint>
+#include <atomic>
+#include <numeric>
 #ifdef Q_OS_UNIX
 #include <sys/utsname.h>
 #endif
@@ -331,6 +334,49 @@ extern "C" xsltStylesheetPtr get_stylesheet(const char *name)
 	return xslt;
 }
 
+// Compiled stylesheets for imports, keyed by their resource path. A compiled
+// stylesheet is never modified by a transformation, so the same one can be
+// applied by several import threads at the same time.
+static QMutex stylesheetLock;
+static QHash<QString, xsltStylesheetPtr> stylesheetCache;
+
+extern "C" xsltStylesheetPtr get_cached_stylesheet(const char *name)
+{
+	QString path = QLatin1String(":/xslt/") + name;
+	QMutexLocker locker(&stylesheetLock);
+	auto it = stylesheetCache.find(path);
+	if (it != stylesheetCache.end())
+		return *it;
+
+	QElapsedTimer timer;
+	timer.start();
+	xsltStylesheetPtr xslt = get_stylesheet(name);
+	if (!xslt)
+		return NULL;
+	if (verbose > 0)
+		qDebug() << "compiled stylesheet" << path << "in" << timer.elapsed() << "ms";
+	stylesheetCache.insert(path, xslt);
+	return xslt;
+}
+
+extern "C" xmlDocPtr apply_cached_stylesheet(xsltStylesheetPtr xslt, const char *name, xmlDocPtr doc, const char **params)
+{
+	QElapsedTimer timer;
+	timer.start();
+	xmlDocPtr transformed = xsltApplyStylesheet(xslt, doc, params);
+	if (verbose > 0)
+		qDebug() << "applied stylesheet" << name << "in" << timer.elapsed() << "ms";
+	return transformed;
+}
+
+extern "C" void flush_stylesheet_cache()
+{
+	QMutexLocker locker(&stylesheetLock);
+	for (xsltStylesheetPtr xslt: stylesheetCache)
+		xsltFreeStylesheet(xslt);
+	stylesheetCache.clear();
+}
+
 extern "C" char *move_away(const char *old_path)
 {
 	if (verbose > 1)
@@ -1610,6 +1656,56 @@ extern "C" void unlock_planner()
 	planLock.unlock();
 }
 
+// The importers add tags to the global tag list and give out dive ids
+// from several threads, see parallelimport.cpp.
+static QMutex tagListLock;
+
+extern "C" void lock_tag_list()
+{
+	tagListLock.lock();
+}
+
+extern "C" void unlock_tag_list()
+{
+	tagListLock.unlock();
+}
+
+// Likewise, they add to the global fingerprint, tank info and weight system
+// tables and record the version of the data file.
+static QMutex importTablesLock;
+
+extern "C" void lock_import_tables()
+{
+	importTablesLock.lock();
+}
+
+extern "C" void unlock_import_tables()
+{
+	importTablesLock.unlock();
+}
+
+// report_error() is called from the download thread and from the worker
+// that parses the downloaded dives. The error callbacks aren't reentrant.
+static QMutex errorLock;
+
+extern "C" void lock_errors()
+{
+	errorLock.lock();
+}
+
+extern "C" void unlock_errors()
+{
+	errorLock.unlock();
+}
+
+// we need this to be uniq. oh, and it has no meaning whatsoever
+// - that's why we have the silly initial number and increment by 3 :-)
+extern "C" int dive_getUniqID()
+{
+	static std::atomic<int> maxId(83529);
+	return maxId += 3;
+}
+
 char *copy_qstring(const QString &s)
 {
 	return strdup(qPrintable(s));
@@ -1672,3 +1768,49 @@ extern "C" void emit_reset_signal()
 {
 	emit diveListNotifier.dataReset();
 }
+
+// The dives whose single-dive CNS is needed to calculate the missing CNS values:
+// the dives without CNS and the dives before them that are less than 12 hours
+// apart. calculate_cns_cached() looks at the same dives, except that it skips
+// the dives of other trips.
+static std::vector<int> divesForCns()
+{
+	std::vector<int> res;
+	bool inChain = false;
+	for (int i = divelog.dives->nr - 1; i >= 0; --i) {
+		const struct dive *d = divelog.dives->dives[i];
+		if (d->maxcns == 0 && d->cns == 0)
+			inChain = true;
+		else if (inChain)
+			inChain = dive_endtime(d) + 12 * 60 * 60 >= divelog.dives->dives[i + 1]->when;
+		if (inChain)
+			res.push_back(i);
+	}
+	return res;
+}
+
+// Calculate the CNS of the dives in the dive list that don't have one yet. SAC
+// and OTU only depend on the dive itself and were already set when the dives
+// were recorded. The CNS of the single dives is calculated in parallel. The CNS
+// carry-over between dives is then added up in a second, serial pass using the
+// per-dive values. The dives are processed in chunks so that we can report
+// progress.
+extern "C" void calculate_derived_dive_data(bool report_progress)
+{
+	const size_t chunkSize = 256;
+	std::vector<int> todo = divesForCns();
+	if (todo.empty())
+		return;
+
+	std::vector<double> cns(divelog.dives->nr, -1.0);
+	for (size_t start = 0; start < todo.size(); start += chunkSize) {
+		size_t end = std::min(start + chunkSize, todo.size());
+		QtConcurrent::blockingMap(todo.begin() + start, todo.begin() + end,
+					  [&cns](int i) { cns[i] = calculate_cns_dive(divelog.dives->dives[i]); });
+		if (report_progress) {
+			QString msg = gettextFromC::tr("Calculating dive data (%1/%2)").arg(end).arg(todo.size());
+			git_storage_update_progress(qPrintable(msg));
+		}
+	}
+	update_dive_chained_info(cns.data());
+}
@@ -137,7 +137,17 @@ time_t get_dive_datetime_from_isostring(char *when);
 void print_qt_versions();
 void lock_planner();
 void unlock_planner();
+void lock_tag_list();
+void unlock_tag_list();
+void lock_import_tables();
+void unlock_import_tables();
+void lock_errors();
+void unlock_errors();
 xsltStylesheetPtr get_stylesheet(const char *name);
+// Compiled once and shared; owned by the cache, don't free
+xsltStylesheetPtr get_cached_stylesheet(const char *name);
+xmlDocPtr apply_cached_stylesheet(xsltStylesheetPtr xslt, const char *name, xmlDocPtr doc, const char **params);
+void flush_stylesheet_cache();
 weight_t string_to_weight(const char *str);
 depth_t string_to_depth(const char *str);
 pressure_t string_to_pressure(const char *str);
@@ -145,6 +155,7 @@ volume_t string_to_volume(const char *str, pressure_t workp);
 fraction_t string_to_fraction(const char *str);
 char *get_changes_made();
 void emit_reset_signal();
+void calculate_derived_dive_data(bool report_progress);
 
 extern void report_info(const char *fmt, ...);
 
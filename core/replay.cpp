@@ -0,0 +1,200 @@
+// SPDX-License-Identifier: GPL-2.0
+// A libdivecomputer I/O stream that replays the data of a previous download
+// instead of talking to a dive computer. The recording is a libdivecomputer
+// logfile as written by the download dialog: the data of every "Read" line is
+// handed to the device backend in the same chunks as it came from the dive
+// computer, everything written to the device is dropped. Optionally, the
+// latency and bandwidth of a slow link are emulated. This makes it possible
+// to test and benchmark the download code without hardware.
+#include "libdivecomputer.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QThread>
+#include <algorithm>
+#include <vector>
+#include <string.h>
+
+#include <libdivecomputer/context.h>
+#include <libdivecomputer/custom.h>
+
+extern "C" {
+
+typedef struct replay_t {
+	std::vector<QByteArray> chunks;
+	size_t chunk;		// the chunk to be read next
+	size_t pos;		// the read position in that chunk
+	unsigned int latency;	// in ms, for every read
+	unsigned int bandwidth;	// in bytes per second, 0 means unlimited
+} replay_t;
+
+static bool replay_load(replay_t *replay, const char *filename)
+{
+	QFile f(filename);
+	if (!f.open(QIODevice::ReadOnly))
+		return false;
+
+	// The log lines look like "[0.123456] INFO: Read: size=5, data=0102030405"
+	while (!f.atEnd()) {
+		QByteArray line = f.readLine();
+		int idx = line.indexOf("Read: size=");
+		if (idx < 0)
+			continue;
+		idx = line.indexOf("data=", idx);
+		if (idx < 0)
+			continue;
+		QByteArray data = QByteArray::fromHex(line.mid(idx + 5).trimmed());
+		if (!data.isEmpty())
+			replay->chunks.push_back(data);
+	}
+	return true;
+}
+
+// Wait as long as transferring size bytes over the emulated link would take
+static void replay_transfer(replay_t *replay, size_t size, bool latency)
+{
+	unsigned long usecs = latency ? replay->latency * 1000UL : 0;
+	if (replay->bandwidth)
+		usecs += size * 1000000UL / replay->bandwidth;
+	if (usecs)
+		QThread::usleep(usecs);
+}
+
+static dc_status_t replay_set_timeout(void *, int)
+{
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t replay_get_available(void *io, size_t *available)
+{
+	replay_t *replay = (replay_t *)io;
+
+	if (replay->chunk >= replay->chunks.size())
+		*available = 0;
+	else
+		*available = replay->chunks[replay->chunk].size() - replay->pos;
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t replay_poll(void *io, int)
+{
+	replay_t *replay = (replay_t *)io;
+
+	return replay->chunk < replay->chunks.size() ? DC_STATUS_SUCCESS : DC_STATUS_TIMEOUT;
+}
+
+static dc_status_t replay_read(void *io, void *data, size_t size, size_t *actual)
+{
+	replay_t *replay = (replay_t *)io;
+
+	*actual = 0;
+	// The recording is exhausted: act like a dive computer that doesn't answer
+	if (replay->chunk >= replay->chunks.size())
+		return DC_STATUS_TIMEOUT;
+
+	// Never return more than one recorded chunk at a time. Packet based
+	// backends rely on getting exactly one packet per read.
+	const QByteArray &chunk = replay->chunks[replay->chunk];
+	size_t len = std::min(size, (size_t)chunk.size() - replay->pos);
+	memcpy(data, chunk.constData() + replay->pos, len);
+	replay->pos += len;
+	if (replay->pos >= (size_t)chunk.size()) {
+		replay->chunk++;
+		replay->pos = 0;
+	}
+	replay_transfer(replay, len, true);
+	*actual = len;
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t replay_write(void *io, const void *, size_t size, size_t *actual)
+{
+	replay_t *replay = (replay_t *)io;
+
+	replay_transfer(replay, size, false);
+	*actual = size;
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t replay_ioctl(void *, unsigned int, void *, size_t)
+{
+	return DC_STATUS_UNSUPPORTED;
+}
+
+static dc_status_t replay_purge(void *, dc_direction_t)
+{
+	return DC_STATUS_SUCCESS;
+}
+
+// The backends sleep to give the dive computer time to answer. The recorded
+// answers are there already, so there is no need to wait.
+static dc_status_t replay_sleep(void *, unsigned int)
+{
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t replay_close(void *io)
+{
+	delete (replay_t *)io;
+	return DC_STATUS_SUCCESS;
+}
+
+// Pretend to use the transport that divecomputer_device_open() would have used
+static dc_transport_t replay_transport(device_data_t *data)
+{
+	unsigned int transports = dc_descriptor_get_transports(data->descriptor);
+
+	if (data->bluetooth_mode) {
+		if ((transports & DC_TRANSPORT_BLE) && data->devname && !strncmp(data->devname, "LE:", 3))
+			return DC_TRANSPORT_BLE;
+		if (transports & DC_TRANSPORT_BLUETOOTH)
+			return DC_TRANSPORT_BLUETOOTH;
+		if (transports & DC_TRANSPORT_BLE)
+			return DC_TRANSPORT_BLE;
+	}
+	if (transports & DC_TRANSPORT_USBHID)
+		return DC_TRANSPORT_USBHID;
+	if (transports & DC_TRANSPORT_USB)
+		return DC_TRANSPORT_USB;
+	if (transports & DC_TRANSPORT_IRDA)
+		return DC_TRANSPORT_IRDA;
+	return DC_TRANSPORT_SERIAL;
+}
+
+dc_status_t replay_open(dc_iostream_t **iostream, dc_context_t *context, device_data_t *data)
+{
+	static const dc_custom_cbs_t callbacks = {
+		.set_timeout	= replay_set_timeout,
+		.set_break	= nullptr,
+		.set_dtr	= nullptr,
+		.set_rts	= nullptr,
+		.get_lines	= nullptr,
+		.get_available	= replay_get_available,
+		.configure	= nullptr,
+		.poll		= replay_poll,
+		.read		= replay_read,
+		.write		= replay_write,
+		.ioctl		= replay_ioctl,
+		.flush		= nullptr,
+		.purge		= replay_purge,
+		.sleep		= replay_sleep,
+		.close		= replay_close,
+	};
+
+	replay_t *replay = new replay_t;
+	replay->chunk = 0;
+	replay->pos = 0;
+	replay->latency = data->replay_latency;
+	replay->bandwidth = data->replay_bandwidth;
+	if (!replay_load(replay, data->replay_file)) {
+		delete replay;
+		return DC_STATUS_IO;
+	}
+
+	dc_status_t rc = dc_custom_open(iostream, context, replay_transport(data), &callbacks, replay);
+	if (rc != DC_STATUS_SUCCESS)
+		delete replay;
+	return rc;
+}
+
+}
@@ -41,9 +41,12 @@ static void put_video_time(struct membuffer *b, int secs)
 	put_format(b, "%d:%02d:%02d.000,", hours, mins, secs);
 }
 
+/* Note: the plot info must have been created with all optional columns (PLOT_ALL_COLUMNS). */
 static void put_pd(struct membuffer *b, const struct plot_info *pi, int idx)
 {
 	const struct plot_data *entry = pi->entry + idx;
+	const struct plot_tissue_data *tissues = pi->tissues + idx;
+	const struct plot_gas_data *gas = pi->gas + idx;
 
 	put_int(b, entry->in_deco);
 	put_int(b,  entry->sec);
@@ -55,9 +58,9 @@ static void put_pd(struct membuffer *b, const struct plot_info *pi, int idx)
 	put_int(b, entry->depth);
 	put_int(b, entry->ceiling);
 	for (int i = 0; i < 16; i++)
-		put_int(b, entry->ceilings[i]);
+		put_int(b, tissues->ceilings[i]);
 	for (int i = 0; i < 16; i++)
-		put_int(b, entry->percentages[i]);
+		put_int(b, tissues->percentages[i]);
 	put_int(b, entry->ndl);
 	put_int(b, entry->tts);
 	put_int(b, entry->rbt);
@@ -72,13 +75,13 @@ static void put_pd(struct membuffer *b, const struct plot_info *pi, int idx)
 	put_double(b, entry->pressures.he);
 	put_int(b, entry->o2pressure.mbar);
 	for (int i = 0; i < MAX_O2_SENSORS; i++)
-		put_int(b, entry->o2sensor[i].mbar);
+		put_int(b, get_plot_o2sensor(pi, idx, i));
 	put_int(b, entry->o2setpoint.mbar);
 	put_int(b, entry->scr_OC_pO2.mbar);
-	put_int(b, entry->mod);
-	put_int(b, entry->ead);
-	put_int(b, entry->end);
-	put_int(b, entry->eadd);
+	put_int(b, gas->mod);
+	put_int(b, gas->ead);
+	put_int(b, gas->end);
+	put_int(b, gas->eadd);
 	switch (entry->velocity) {
 	case STABLE:
 		put_csv_string(b, "STABLE");
@@ -108,7 +111,7 @@ static void put_pd(struct membuffer *b, const struct plot_info *pi, int idx)
 	put_double(b, entry->ambpressure);
 	put_double(b, entry->gfline);
 	put_double(b, entry->surface_gf);
-	put_double(b, entry->density);
+	put_double(b, gas->density);
 	put_int_with_nl(b, entry->icd_warning ? 1 : 0);
 }
 
@@ -211,7 +214,7 @@ static void save_profiles_buffer(struct membuffer *b, bool select_only)
 	for_each_dive(i, dive) {
 		if (select_only && !dive->selected)
 			continue;
-		create_plot_info_new(dive, &dive->dc, &pi, planner_deco_state);
+		create_plot_info_new(dive, &dive->dc, &pi, planner_deco_state, PLOT_ALL_COLUMNS);
 		put_headers(b, pi.nr_cylinders);
 
 		for (int i = 0; i < pi.nr; i++)
@@ -227,7 +230,7 @@ void save_subtitles_buffer(struct membuffer *b, struct dive *dive, int offset, i
 	struct deco_state *planner_deco_state = NULL;
 
 	init_plot_info(&pi);
-	create_plot_info_new(dive, &dive->dc, &pi, planner_deco_state);
+	create_plot_info_new(dive, &dive->dc, &pi, planner_deco_state, 0);
 
 	put_format(b, "[Script Info]\n");
 	put_format(b, "; Script generated by Subsurface %s\n", subsurface_canonical_version());
@@ -3,15 +3,18 @@
  *
  * core logic for the Info & Stats page -
  * void calculate_stats_summary(struct stats_summary *out, bool selected_only);
+ * const struct stats_summary *get_stats_summary(void);
  * void calculate_stats_selected(stats_t *stats_selection);
  */
 
 #include "statistics.h"
 #include "dive.h"
+#include "divelist.h"
 #include "divelog.h"
 #include "event.h"
 #include "gettext.h"
 #include "sample.h"
+#include "selection.h"
 #include "subsurface-time.h"
 #include "trip.h"
 #include "units.h"
@@ -84,13 +87,53 @@ static void process_dive(struct dive *dive, stats_t *stats)
 	}
 }
 
+/* allocate sufficient space to hold the worst
+ * case (one dive per year or all dives during
+ * one month) for yearly and monthly statistics */
+static bool alloc_stats_summary(struct stats_summary *out, int nr)
+{
+	out->stats_yearly = malloc(sizeof(stats_t) * nr);
+	out->stats_monthly = malloc(sizeof(stats_t) * nr);
+	out->stats_by_trip = malloc(sizeof(stats_t) * nr);
+	out->stats_by_type = malloc(sizeof(stats_t) * (NUM_DIVEMODE + 1));
+	out->stats_by_depth = malloc(sizeof(stats_t) * ((STATS_MAX_DEPTH / STATS_DEPTH_BUCKET) + 1));
+	out->stats_by_temp = malloc(sizeof(stats_t) * ((STATS_MAX_TEMP / STATS_TEMP_BUCKET) + 1));
+	return out->stats_yearly && out->stats_monthly && out->stats_by_trip &&
+	       out->stats_by_type && out->stats_by_depth && out->stats_by_temp;
+}
+
+/* The labels of the summary entries that are not a year, month or trip */
+#define NUM_STATS_LABELS (NUM_DIVEMODE + 4)
+
+static void make_stats_labels(char *labels[NUM_STATS_LABELS])
+{
+	labels[0] = strdup(translate("gettextFromC", "All (by type stats)"));
+	labels[1] = strdup(translate("gettextFromC", divemode_text_ui[OC]));
+	labels[2] = strdup(translate("gettextFromC", divemode_text_ui[CCR]));
+	labels[3] = strdup(translate("gettextFromC", divemode_text_ui[PSCR]));
+	labels[4] = strdup(translate("gettextFromC", divemode_text_ui[FREEDIVE]));
+	labels[NUM_DIVEMODE + 1] = strdup(translate("gettextFromC", "All (by max depth stats)"));
+	labels[NUM_DIVEMODE + 2] = strdup(translate("gettextFromC", "All (by min. temp stats)"));
+	labels[NUM_DIVEMODE + 3] = strdup(translate("gettextFromC", "All (by trip stats)"));
+}
+
+static void set_stats_labels(struct stats_summary *out, char *labels[NUM_STATS_LABELS])
+{
+	int i;
+
+	for (i = 0; i <= NUM_DIVEMODE; i++)
+		out->stats_by_type[i].location = labels[i];
+	out->stats_by_depth[0].location = labels[NUM_DIVEMODE + 1];
+	out->stats_by_temp[0].location = labels[NUM_DIVEMODE + 2];
+	out->stats_by_trip[0].location = labels[NUM_DIVEMODE + 3];
+}
+
 /*
- * Calculate a summary of the statistics and put in the stats_summary
- * structure provided in the first parameter.
- * Before first use, it should be initialized with init_stats_summary().
- * After use, memory must be released with free_stats_summary().
+ * Fill in a summary whose arrays were allocated for the current number of
+ * dives. If trips is not NULL, the trip of each stats_by_trip entry is
+ * recorded there. Returns the number of trips.
  */
-void calculate_stats_summary(struct stats_summary *out, bool selected_only)
+static int fill_stats_summary(struct stats_summary *out, bool selected_only, char *labels[NUM_STATS_LABELS], dive_trip_t **trips)
 {
 	int idx;
 	int t_idx, d_idx, r;
@@ -103,7 +146,6 @@ void calculate_stats_summary(struct stats_summary *out, bool selected_only)
 	int prev_month = 0, prev_year = 0;
 	int trip_iter = 0;
 	dive_trip_t *trip_ptr = 0;
-	size_t size, tsize, dsize, tmsize;
 	stats_t stats = { 0 };
 
 	if (divelog.dives->nr > 0) {
@@ -112,50 +154,24 @@ void calculate_stats_summary(struct stats_summary *out, bool selected_only)
 		stats.selection_size = divelog.dives->nr;
 	}
 
-	/* allocate sufficient space to hold the worst
-	 * case (one dive per year or all dives during
-	 * one month) for yearly and monthly statistics*/
-
-	size = sizeof(stats_t) * (divelog.dives->nr + 1);
-	tsize = sizeof(stats_t) * (NUM_DIVEMODE + 1);
-	dsize = sizeof(stats_t) * ((STATS_MAX_DEPTH / STATS_DEPTH_BUCKET) + 1);
-	tmsize = sizeof(stats_t) * ((STATS_MAX_TEMP / STATS_TEMP_BUCKET) + 1);
-	free_stats_summary(out);
-	out->stats_yearly = malloc(size);
-	out->stats_monthly = malloc(size);
-	out->stats_by_trip = malloc(size);
-	out->stats_by_type = malloc(tsize);
-	out->stats_by_depth = malloc(dsize);
-	out->stats_by_temp = malloc(tmsize);
-	if (!out->stats_yearly || !out->stats_monthly || !out->stats_by_trip ||
-		  !out->stats_by_type || !out->stats_by_depth || !out->stats_by_temp)
-		return;
-	memset(out->stats_yearly, 0, size);
-	memset(out->stats_monthly, 0, size);
-	memset(out->stats_by_trip, 0, size);
-	memset(out->stats_by_type, 0, tsize);
-	memset(out->stats_by_depth, 0, dsize);
-	memset(out->stats_by_temp, 0, tmsize);
+	memset(out->stats_yearly, 0, sizeof(stats_t) * (divelog.dives->nr + 1));
+	memset(out->stats_monthly, 0, sizeof(stats_t) * (divelog.dives->nr + 1));
+	memset(out->stats_by_trip, 0, sizeof(stats_t) * (divelog.dives->nr + 1));
+	memset(out->stats_by_type, 0, sizeof(stats_t) * (NUM_DIVEMODE + 1));
+	memset(out->stats_by_depth, 0, sizeof(stats_t) * ((STATS_MAX_DEPTH / STATS_DEPTH_BUCKET) + 1));
+	memset(out->stats_by_temp, 0, sizeof(stats_t) * ((STATS_MAX_TEMP / STATS_TEMP_BUCKET) + 1));
 	out->stats_yearly[0].is_year = true;
 
 	/* Setting the is_trip to true to show the location as first
 	 * field in the statistics window */
-	out->stats_by_type[0].location = strdup(translate("gettextFromC", "All (by type stats)"));
 	out->stats_by_type[0].is_trip = true;
-	out->stats_by_type[1].location = strdup(translate("gettextFromC", divemode_text_ui[OC]));
 	out->stats_by_type[1].is_trip = true;
-	out->stats_by_type[2].location = strdup(translate("gettextFromC", divemode_text_ui[CCR]));
 	out->stats_by_type[2].is_trip = true;
-	out->stats_by_type[3].location = strdup(translate("gettextFromC", divemode_text_ui[PSCR]));
 	out->stats_by_type[3].is_trip = true;
-	out->stats_by_type[4].location = strdup(translate("gettextFromC", divemode_text_ui[FREEDIVE]));
 	out->stats_by_type[4].is_trip = true;
-
-	out->stats_by_depth[0].location = strdup(translate("gettextFromC", "All (by max depth stats)"));
 	out->stats_by_depth[0].is_trip = true;
-
-	out->stats_by_temp[0].location = strdup(translate("gettextFromC", "All (by min. temp stats)"));
 	out->stats_by_temp[0].is_trip = true;
+	set_stats_labels(out, labels);
 
 	/* this relies on the fact that the dives in the dive_table
 	 * are in chronological order */
@@ -216,13 +232,14 @@ void calculate_stats_summary(struct stats_summary *out, bool selected_only)
 			if (trip_ptr != dp->divetrip) {
 				trip_ptr = dp->divetrip;
 				trip_iter++;
+				if (trips)
+					trips[trip_iter] = trip_ptr;
 			}
 
 			/* stats_by_trip[0] is all the dives combined */
 			out->stats_by_trip[0].selection_size++;
 			process_dive(dp, &(out->stats_by_trip[0]));
 			out->stats_by_trip[0].is_trip = true;
-			out->stats_by_trip[0].location = strdup(translate("gettextFromC", "All (by trip stats)"));
 
 			process_dive(dp, &(out->stats_by_trip[trip_iter]));
 			out->stats_by_trip[trip_iter].selection_size++;
@@ -263,6 +280,90 @@ void calculate_stats_summary(struct stats_summary *out, bool selected_only)
 		for (r = 0; r * STATS_TEMP_BUCKET < t_idx; ++r)
 			out->stats_by_temp[r+1].is_trip = true;
 	}
+	return trip_iter;
+}
+
+/*
+ * Calculate a summary of the statistics and put in the stats_summary
+ * structure provided in the first parameter.
+ * Before first use, it should be initialized with init_stats_summary().
+ * After use, memory must be released with free_stats_summary().
+ */
+void calculate_stats_summary(struct stats_summary *out, bool selected_only)
+{
+	char *labels[NUM_STATS_LABELS];
+
+	free_stats_summary(out);
+	if (!alloc_stats_summary(out, divelog.dives->nr + 1))
+		return;
+	make_stats_labels(labels);
+	fill_stats_summary(out, selected_only, labels, NULL);
+}
+
+/*
+ * The summary of all dives is requested by the yearly statistics, the
+ * exporters and the printing templates. Therefore, it is kept here and
+ * only recalculated, in place, if the dive table or a dive was modified
+ * since the last request. This is detected by comparing the generation
+ * counters of the dive table and of the dive data.
+ */
+static struct stats_summary cached_summary;
+static int cached_summary_capacity;
+static dive_trip_t **cached_summary_trips;
+static int cached_summary_nr_trips;
+static unsigned int cached_table_generation;
+static unsigned int cached_data_generation;
+static bool cached_summary_valid;
+/* The items of the yearly statistics refer to the labels, so they are never freed */
+static char *cached_summary_labels[NUM_STATS_LABELS];
+
+static bool update_cached_summary(void)
+{
+	int nr = divelog.dives->nr + 1;
+
+	cached_summary_valid = false;
+	if (nr > cached_summary_capacity) {
+		free_stats_summary(&cached_summary);
+		free(cached_summary_trips);
+		cached_summary_capacity = 0;
+		cached_summary_trips = malloc(nr * sizeof(*cached_summary_trips));
+		if (!alloc_stats_summary(&cached_summary, nr) || !cached_summary_trips)
+			return false;
+		cached_summary_capacity = nr;
+	}
+	if (!cached_summary_labels[0])
+		make_stats_labels(cached_summary_labels);
+	cached_summary_nr_trips = fill_stats_summary(&cached_summary, false, cached_summary_labels, cached_summary_trips);
+	cached_table_generation = get_dive_table_generation();
+	cached_data_generation = get_dive_data_generation();
+	cached_summary_valid = true;
+	return true;
+}
+
+/*
+ * Get the summary of all dives. The summary is owned by the statistics
+ * code and must neither be modified nor freed. It stays valid until
+ * the dives are changed. On allocation failure, the arrays are NULL.
+ */
+const struct stats_summary *get_stats_summary(void)
+{
+	int i;
+
+	if (!cached_summary_valid ||
+	    cached_table_generation != get_dive_table_generation() ||
+	    cached_data_generation != get_dive_data_generation()) {
+		if (!update_cached_summary()) {
+			free_stats_summary(&cached_summary);
+			init_stats_summary(&cached_summary);
+			return &cached_summary;
+		}
+	}
+
+	/* Editing the trip location does not modify the dives, so
+	 * refer to the current strings of the trips. */
+	for (i = 1; i <= cached_summary_nr_trips; i++)
+		cached_summary.stats_by_trip[i].location = cached_summary_trips[i]->location;
+	return &cached_summary;
 }
 
 void free_stats_summary(struct stats_summary *stats)
@@ -289,13 +390,21 @@ void init_stats_summary(struct stats_summary *stats)
 void calculate_stats_selected(stats_t *stats_selection)
 {
 	struct dive *dive;
-	unsigned int i, nr;
+	int i, seen;
+	unsigned int nr;
 
 	memset(stats_selection, 0, sizeof(*stats_selection));
 
 	nr = 0;
+	seen = 0;
 	for_each_dive(i, dive) {
-		if (dive->selected && !dive->invalid) {
+		/* no need to look further once all selected dives were found */
+		if (seen >= amount_selected)
+			break;
+		if (!dive->selected)
+			continue;
+		seen++;
+		if (!dive->invalid) {
 			process_dive(dive, stats_selection);
 			nr++;
 		}
@@ -61,6 +61,7 @@ extern "C" {
 extern void init_stats_summary(struct stats_summary *stats);
 extern void free_stats_summary(struct stats_summary *stats);
 extern void calculate_stats_summary(struct stats_summary *stats, bool selected_only);
+extern const struct stats_summary *get_stats_summary(void);
 extern void calculate_stats_selected(stats_t *stats_selection);
 extern volume_t *get_gas_used(struct dive *dive);
 extern void selected_dives_gas_parts(volume_t *o2_tot, volume_t *he_tot);
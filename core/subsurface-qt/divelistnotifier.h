@@ -65,6 +65,7 @@ struct DiveField {
 		INVALID = 1 << 21
 	};
 	DiveField(int flags);
+	int flags() const;
 };
 struct TripField {
 	unsigned int location : 1;
@@ -95,6 +96,10 @@ signals:
 	void divesChanged(const QVector<dive *> &dives, DiveField field);
 	void divesTimeChanged(timestamp_t delta, const QVector<dive *> &dives);
 	void divesImported(); // A general signal when multiple dives have been imported.
+	// Sent instead of divesAdded() and divesDeleted() when a large number of dives
+	// was added and removed at once. Updating the models row by row would be too
+	// slow: they should repopulate themselves from the core.
+	void divesBulkChanged();
 
 	void diveComputerEdited(divecomputer *dc);
 
@@ -180,6 +185,32 @@ inline DiveField::DiveField(int flags) :
 {
 }
 
+inline int DiveField::flags() const
+{
+	return (nr ? NR : 0) |
+	       (datetime ? DATETIME : 0) |
+	       (depth ? DEPTH : 0) |
+	       (duration ? DURATION : 0) |
+	       (air_temp ? AIR_TEMP : 0) |
+	       (water_temp ? WATER_TEMP : 0) |
+	       (atm_press ? ATM_PRESS : 0) |
+	       (divesite ? DIVESITE : 0) |
+	       (diveguide ? DIVEGUIDE : 0) |
+	       (buddy ? BUDDY : 0) |
+	       (rating ? RATING : 0) |
+	       (visibility ? VISIBILITY : 0) |
+	       (wavesize ? WAVESIZE : 0) |
+	       (current ? CURRENT : 0) |
+	       (surge ? SURGE : 0) |
+	       (chill ? CHILL : 0) |
+	       (suit ? SUIT : 0) |
+	       (tags ? TAGS : 0) |
+	       (mode ? MODE : 0) |
+	       (notes ? NOTES : 0) |
+	       (salinity ? SALINITY : 0) |
+	       (invalid ? INVALID : 0);
+}
+
 inline TripField::TripField(int flags) :
 	location((flags & LOCATION) != 0),
 	notes((flags & NOTES) != 0)
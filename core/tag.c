@@ -5,6 +5,7 @@
 #include "subsurface-string.h"
 #include "membuffer.h"
 #include "gettext.h"
+#include "qthelper.h"
 
 #include <stdlib.h>
 
@@ -137,6 +138,7 @@ struct divetag *taglist_add_tag(struct tag_entry **tag_list, const char *tag)
 		memcpy(new_tag->name, tag, strlen(tag) + 1);
 	}
 	/* Try to insert new_tag into g_tag_list if we are not operating on it */
+	lock_tag_list();
 	if (tag_list != &g_tag_list) {
 		ret_tag = taglist_add_divetag(&g_tag_list, new_tag);
 		/* g_tag_list already contains new_tag, free the duplicate */
@@ -148,6 +150,7 @@ struct divetag *taglist_add_tag(struct tag_entry **tag_list, const char *tag)
 		if (ret_tag != new_tag)
 			taglist_free_divetag(new_tag);
 	}
+	unlock_tag_list();
 	return ret_tag;
 }
 
@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "workqueue.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+struct work_queue {
+	size_t capacity;
+	void (*fn)(void *job, void *data);
+	void *data;
+	std::deque<void *> jobs;
+	bool finished;
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::thread worker;
+
+	work_queue(int capacity, void (*fn)(void *, void *), void *data);
+	void run();
+};
+
+work_queue::work_queue(int capacityIn, void (*fnIn)(void *, void *), void *dataIn) :
+	capacity(capacityIn > 0 ? capacityIn : 1),
+	fn(fnIn),
+	data(dataIn),
+	finished(false)
+{
+}
+
+void work_queue::run()
+{
+	for (;;) {
+		void *job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [this] { return !jobs.empty() || finished; });
+			if (jobs.empty())
+				return;
+			job = jobs.front();
+			jobs.pop_front();
+		}
+		changed.notify_all(); // There is room for the producer again
+		fn(job, data);
+	}
+}
+
+extern "C" struct work_queue *work_queue_start(int capacity, void (*fn)(void *job, void *data), void *data)
+{
+	work_queue *queue = new work_queue(capacity, fn, data);
+	queue->worker = std::thread(&work_queue::run, queue);
+	return queue;
+}
+
+extern "C" void work_queue_push(struct work_queue *queue, void *job)
+{
+	{
+		std::unique_lock<std::mutex> lock(queue->mutex);
+		queue->changed.wait(lock, [queue] { return queue->jobs.size() < queue->capacity; });
+		queue->jobs.push_back(job);
+	}
+	queue->changed.notify_all();
+}
+
+extern "C" void work_queue_finish(struct work_queue *queue)
+{
+	{
+		std::lock_guard<std::mutex> lock(queue->mutex);
+		queue->finished = true;
+	}
+	queue->changed.notify_all();
+	queue->worker.join();
+	delete queue;
+}
@@ -0,0 +1,25 @@
+// SPDX-License-Identifier: GPL-2.0
+// A bounded queue of jobs that are processed in order by a single worker
+// thread. Used to parse downloaded dives while the dive computer transfers
+// the next ones. Pushing blocks while the queue is full, so that a slow
+// worker throttles the producer instead of buffering unlimited data.
+#ifndef WORKQUEUE_H
+#define WORKQUEUE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct work_queue;
+
+// Start a worker thread that calls fn(job, data) for every pushed job.
+struct work_queue *work_queue_start(int capacity, void (*fn)(void *job, void *data), void *data);
+void work_queue_push(struct work_queue *queue, void *job);
+// Wait until all pushed jobs were processed, stop the worker and free the queue.
+void work_queue_finish(struct work_queue *queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -26,6 +26,7 @@
 #include "core/gettextfromc.h"
 #include "core/git-access.h"
 #include "core/import-csv.h"
+#include "core/parallelimport.h"
 #include "core/planner.h"
 #include "core/qthelper.h"
 #include "core/selection.h"
@@ -399,6 +400,14 @@ void MainWindow::on_actionSaveAs_triggered()
 	file_save_as();
 }
 
+// Files are parsed into a separate log, which leaves the CNS of the dives to
+// process_loaded_dives(). It calculates the CNS for all dives in parallel.
+static void addLoadedDives(struct divelog &log)
+{
+	divelog.autogroup = log.autogroup;
+	divelog.append(std::move(log));
+}
+
 void MainWindow::on_actionCloudstorageopen_triggered()
 {
 	if (!okToClose(tr("Please save or cancel the current dive edit before opening a new file.")))
@@ -415,8 +424,11 @@ void MainWindow::on_actionCloudstorageopen_triggered()
 
 	showProgressBar();
 	QByteArray fileNamePtr = QFile::encodeName(filename);
-	if (!parse_file(fileNamePtr.data(), &divelog))
+	struct divelog log;
+	log.autogroup = divelog.autogroup;
+	if (!parse_file(fileNamePtr.data(), &log))
 		setCurrentFile(fileNamePtr.data());
+	addLoadedDives(log);
 	process_loaded_dives();
 	hideProgressBar();
 	refreshDisplay();
@@ -1278,13 +1290,9 @@ void MainWindow::importFiles(const QStringList &fileNames)
 	if (fileNames.isEmpty())
 		return;
 
-	QByteArray fileNamePtr;
 	struct divelog log;
 
-	for (int i = 0; i < fileNames.size(); ++i) {
-		fileNamePtr = QFile::encodeName(fileNames.at(i));
-		parse_file(fileNamePtr.data(), &log);
-	}
+	parse_files(fileNames, &log);
 	QString source = fileNames.size() == 1 ? fileNames[0] : tr("multiple files");
 	Command::importDives(&log, IMPORT_MERGE_ALL_TRIPS, source);
 }
@@ -1298,13 +1306,16 @@ void MainWindow::loadFiles(const QStringList &fileNames)
 	QByteArray fileNamePtr;
 
 	showProgressBar();
+	struct divelog log;
+	log.autogroup = divelog.autogroup;
 	for (int i = 0; i < fileNames.size(); ++i) {
 		fileNamePtr = QFile::encodeName(fileNames.at(i));
-		if (!parse_file(fileNamePtr.data(), &divelog)) {
+		if (!parse_file(fileNamePtr.data(), &log)) {
 			setCurrentFile(fileNamePtr.data());
 			addRecentFile(fileNamePtr, false);
 		}
 	}
+	addLoadedDives(log);
 	hideProgressBar();
 	updateRecentFiles();
 	process_loaded_dives();
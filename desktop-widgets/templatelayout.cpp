@@ -122,8 +122,7 @@ QString TemplateLayout::generateStatistics()
 	State state;
 
 	int i = 0;
-	stats_summary_auto_free stats;
-	calculate_stats_summary(&stats, false);
+	const stats_summary &stats = *get_stats_summary();
 	while (stats.stats_yearly != NULL && stats.stats_yearly[i].period) {
 		state.years.append(&stats.stats_yearly[i]);
 		i++;
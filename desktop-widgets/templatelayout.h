@@ -36,7 +36,7 @@ public:
 private:
 	struct State {
 		QList<const dive *> dives;
-		QList<stats_t *> years;
+		QList<const stats_t *> years;
 		QMap<QString, QString> types;
 		int forloopiterator = -1;
 		const dive * const *currentDive = nullptr;
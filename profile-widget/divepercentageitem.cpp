@@ -89,7 +89,7 @@ void DivePercentageItem::replot(const dive *d, const struct divecomputer *dc, co
 	auto [minY, maxY] = vAxis.screenMinMax();
 	int width = lrint(maxX) - lrint(minX);
 	int height = lrint(maxY) - lrint(minY);
-	if (width <= 0 || height <= 0) {
+	if (width <= 0 || height <= 0 || !pi.tissues) {
 		setPixmap(QPixmap());
 		return;
 	}
@@ -113,7 +113,7 @@ void DivePercentageItem::replot(const dive *d, const struct divecomputer *dc, co
 			if (nextX == x)
 				continue;
 
-			double value = item.percentages[tissue];
+			double value = pi.tissues[i].percentages[tissue];
 			struct gasmix gasmix = get_gasmix(d, dc, sec, &ev, gasmix);
 			int inert = get_n2(gasmix) + get_he(gasmix);
 			color = colorScale(value, inert);
@@ -27,6 +27,91 @@ void AbstractProfilePolygonItem::clear()
 {
 	setPolygon(QPolygonF());
 	texts.clear();
+	indexes.clear();
+	lod.clear();
+}
+
+void AbstractProfilePolygonItem::plotInfoChanged()
+{
+	lod.clear();
+}
+
+void AbstractProfilePolygonItem::buildLod()
+{
+	lod.clear();
+	int nr = pInfo.nr;
+	if (nr < 2)
+		return;
+
+	std::vector<LodBucket> level(nr / 2);
+	for (size_t b = 0; b < level.size(); ++b) {
+		int i1 = static_cast<int>(2 * b);
+		int i2 = i1 + 1;
+		level[b] = accessor(pInfo, i1) <= accessor(pInfo, i2) ? LodBucket{ i1, i2 } : LodBucket{ i2, i1 };
+	}
+	lod.push_back(std::move(level));
+
+	// Each level is created by merging pairs of buckets of the previous level.
+	while (lod.back().size() >= 2) {
+		const std::vector<LodBucket> &prev = lod.back();
+		std::vector<LodBucket> level(prev.size() / 2);
+		for (size_t b = 0; b < level.size(); ++b) {
+			const LodBucket &b1 = prev[2 * b];
+			const LodBucket &b2 = prev[2 * b + 1];
+			level[b].minIdx = accessor(pInfo, b2.minIdx) < accessor(pInfo, b1.minIdx) ? b2.minIdx : b1.minIdx;
+			level[b].maxIdx = accessor(pInfo, b2.maxIdx) > accessor(pInfo, b1.maxIdx) ? b2.maxIdx : b1.maxIdx;
+		}
+		lod.push_back(std::move(level));
+	}
+}
+
+// Return the indexes of the plot info entries in the range [from, to) that should be plotted.
+// If there are more than two entries per pixel, use the coarsest level of detail that still
+// has at least one bucket per pixel (i.e. one to two buckets per pixel) and plot only the
+// minimum and maximum of every bucket. Thus, extremes are preserved, but at most four points
+// per pixel are plotted and their number scales with the width of the plot instead of the
+// number of samples. The first and the last entry are always returned,
+// since they are clipped to the time axis.
+std::vector<int> AbstractProfilePolygonItem::lodIndexes(int from, int to)
+{
+	std::vector<int> res;
+	if (to <= from)
+		return res;
+
+	auto [minX, maxX] = hAxis.screenMinMax();
+	int pixels = std::max(static_cast<int>(lrint(maxX - minX)), 1);
+	int level = -1;
+	if (to - from > 2 * pixels) {
+		if (lod.empty())
+			buildLod();
+		while (level + 1 < static_cast<int>(lod.size()) && ((to - from) >> (level + 2)) >= pixels)
+			++level;
+	}
+
+	int firstBucket = 0, lastBucket = 0, shift = level + 1;
+	if (level >= 0) {
+		firstBucket = (from + (1 << shift)) >> shift;
+		lastBucket = std::min((to - 1) >> shift, static_cast<int>(lod[level].size()));
+	}
+	if (firstBucket >= lastBucket) {
+		res.reserve(to - from);
+		for (int i = from; i < to; ++i)
+			res.push_back(i);
+		return res;
+	}
+
+	res.reserve(2 * (lastBucket - firstBucket) + 2 * (1 << shift));
+	for (int i = from; i < firstBucket << shift; ++i)
+		res.push_back(i);
+	for (int b = firstBucket; b < lastBucket; ++b) {
+		auto [minIdx, maxIdx] = lod[level][b];
+		res.push_back(std::min(minIdx, maxIdx));
+		if (minIdx != maxIdx)
+			res.push_back(std::max(minIdx, maxIdx));
+	}
+	for (int i = lastBucket << shift; i < to; ++i)
+		res.push_back(i);
+	return res;
 }
 
 static std::pair<double,double> clip(double x1, double y1, double x2, double y2, double x)
@@ -51,17 +136,17 @@ std::pair<double, double> AbstractProfilePolygonItem::getPoint(int i) const
 {
 	const struct plot_data *data = pInfo.entry;
 	double x = data[i].sec;
-	double y = accessor(data[i]);
+	double y = accessor(pInfo, i);
 
 	// Do clipping of first and last value
 	if (i == from && i < to) {
 		double next_x = data[i+1].sec;
-		double next_y = accessor(data[i+1]);
+		double next_y = accessor(pInfo, i+1);
 		clipStart(x, y, next_x, next_y);
 	}
 	if (i == to - 1 && i > 0) {
 		double prev_x = data[i-1].sec;
-		double prev_y = accessor(data[i-1]);
+		double prev_y = accessor(pInfo, i-1);
 		clipStop(x, y, prev_x, prev_y);
 	}
 
@@ -78,8 +163,12 @@ void AbstractProfilePolygonItem::makePolygon(int fromIn, int toIn)
 	// regarting our cartesian plane ( made by the hAxis and vAxis ), the QPolygonF
 	// is an array of QPointF's, so we basically get the point from the model, convert
 	// to our coordinates, store. no painting is done here.
+	// To keep the number of points manageable, only the entries of the
+	// appropriate level of detail are used.
+	indexes = lodIndexes(from, to);
 	QPolygonF poly;
-	for (int i = from; i < to; i++) {
+	poly.reserve(static_cast<int>(indexes.size()) + 2);
+	for (int i: indexes) {
 		auto [horizontalValue, verticalValue] = getPoint(i);
 
 		if (i == from) {
@@ -122,13 +211,15 @@ void DiveProfileItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *o
 	pen.setWidth(2);
 	QPolygonF poly = polygon();
 	const struct plot_data *data = pInfo.entry;
-	// This paints the colors of the velocities.
-	for (int i = from + 1; i < to; i++) {
-		QColor color = getColor((color_index_t)(VELOCITY_COLORS_START_IDX + data[i].velocity));
+	// This paints the colors of the velocities. The first point of
+	// the polygon is at the surface, therefore the point of the n-th
+	// plotted entry is at position n + 1.
+	for (size_t i = 1; i < indexes.size(); i++) {
+		QColor color = getColor((color_index_t)(VELOCITY_COLORS_START_IDX + data[indexes[i]].velocity));
 		pen.setBrush(QBrush(color));
 		painter->setPen(pen);
-		if (i - from < poly.count() - 1)
-			painter->drawLine(poly[i - from], poly[i - from + 1]);
+		if ((int)i < poly.count() - 1)
+			painter->drawLine(poly[(int)i], poly[(int)i + 1]);
 	}
 	painter->restore();
 }
@@ -150,8 +241,8 @@ void DiveProfileItem::replot(const dive *d, int from, int to, bool in_planner)
 	/* Show any ceiling we may have encountered */
 	if (prefs.dcceiling && !prefs.redceiling) {
 		QPolygonF p = polygon();
-		plot_data *entry = pInfo.entry + to - 1;
-		for (int i = to - 1; i >= from; i--, entry--) {
+		for (auto it = indexes.rbegin(); it != indexes.rend(); ++it) {
+			const plot_data *entry = pInfo.entry + *it;
 			if (!entry->in_deco) {
 				/* not in deco implies this is a safety stop, no ceiling */
 				p.append(QPointF(hAxis.posAtValue(entry->sec), vAxis.posAtValue(0)));
@@ -571,7 +662,7 @@ void DiveGasPressureItem::replot(const dive *d, int fromIn, int toIn, bool in_pl
 				if (mbar < 0.0)
 					color = MAGENTA;
 				else
-					color = getPressureColor(entry->density);
+					color = getPressureColor(pInfo.gas ? pInfo.gas[i].density : 0.0);
 			}
 
 			if (!act_segments[cyl].polygon.empty()) {
@@ -785,7 +876,7 @@ void PartialPressureGasItem::replot(const dive *, int fromIn, int toIn, bool)
 	if (thresholdPtrMin)
 		threshold_min = *thresholdPtrMin;
 	bool inAlertFragment = false;
-	for (int i = from; i < to; i++) {
+	for (int i: lodIndexes(from, to)) {
 		auto [time, value] = getPoint(i);
 		QPointF point(hAxis.posAtValue(time), vAxis.posAtValue(value));
 		poly.push_back(point);
@@ -24,12 +24,13 @@ struct dive;
 
 class AbstractProfilePolygonItem : public QGraphicsPolygonItem {
 public:
-	using DataAccessor = double (*)(const plot_data &data); // The pointer-to-function syntax is hilarious.
+	using DataAccessor = double (*)(const plot_info &pi, int idx); // The pointer-to-function syntax is hilarious.
 	AbstractProfilePolygonItem(const plot_info &pInfo, const DiveCartesianAxis &hAxis, const DiveCartesianAxis &vAxis,
 				   DataAccessor accessor, double dpr);
 	~AbstractProfilePolygonItem();
 	virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = 0) = 0;
 	void clear();
+	void plotInfoChanged(); // Must be called when the plot info was recalculated.
 
 	// Plot the range (from, to), given as indexes. The caller guarantees that
 	// only the first and the last segment will have to be clipped.
@@ -37,6 +38,7 @@ public:
 
 protected:
 	void makePolygon(int from, int to);
+	std::vector<int> lodIndexes(int from, int to);
 	void clipStart(double &x, double &y, double next_x, double next_y) const;
 	void clipStop(double &x, double &y, double prev_x, double prev_y) const;
 	std::pair<double, double> getPoint(int i) const;
@@ -46,7 +48,17 @@ protected:
 	DataAccessor accessor;
 	double dpr;
 	int from, to;
+	std::vector<int> indexes; // The plot info entries of the polygon calculated by makePolygon().
 	std::vector<std::unique_ptr<DiveTextItem>> texts;
+
+private:
+	// Level-of-detail pyramid of the accessed values. Level n consists of buckets of
+	// 2^(n+1) plot info entries and stores the indexes of the minimum and maximum value.
+	struct LodBucket {
+		int minIdx, maxIdx;
+	};
+	std::vector<std::vector<LodBucket>> lod;
+	void buildLod();
 };
 
 class DiveProfileItem : public AbstractProfilePolygonItem {
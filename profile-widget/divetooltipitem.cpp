@@ -251,8 +251,10 @@ void ToolTipItem::refresh(const dive *d, const QPointF &pos, bool inPlanner)
 		painter.drawLine(0, lrint(60 - AMB_PERCENTAGE * (entry->pressures.n2 + entry->pressures.he) / entry->ambpressure / 2),
 				16, lrint(60 - AMB_PERCENTAGE * (entry->pressures.n2 + entry->pressures.he) / entry->ambpressure /2));
 		painter.setPen(QColor(0, 0, 0, 127));
-		for (int i = 0; i < 16; i++)
-			painter.drawLine(i, 60, i, 60 - entry->percentages[i] / 2);
+		if (pInfo.tissues) {
+			for (int i = 0; i < 16; i++)
+				painter.drawLine(i, 60, i, 60 - pInfo.tissues[idx].percentages[i] / 2);
+		}
 		entryToolTip.second->setPlainText(QString::fromUtf8(mb.buffer, mb.len));
 	}
 	entryToolTip.first->setPixmap(tissues);
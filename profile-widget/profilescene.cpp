@@ -66,9 +66,9 @@ PartialPressureGasItem *ProfileScene::createPPGas(DataAccessor accessor, color_i
 }
 
 template <int IDX>
-double accessTissue(const plot_data &item)
+double accessTissue(const plot_info &pi, int i)
 {
-	return item.ceilings[IDX];
+	return pi.tissues ? pi.tissues[i].ceilings[IDX] : 0.0;
 }
 
 // For now, the accessor functions for the profile data do not possess a payload.
@@ -108,43 +108,43 @@ ProfileScene::ProfileScene(double dpr, bool printMode, bool isGrayscale) :
 	percentageAxis(new DiveCartesianAxis(DiveCartesianAxis::Position::Right, false, 2, 0, TIME_GRID, Qt::black, false, false,
 					     dpr, 0.7, printMode, isGrayscale, *this)),
 	diveProfileItem(createItem<DiveProfileItem>(*profileYAxis,
-						    [](const plot_data &item) { return (double)item.depth; },
+						    [](const plot_info &pi, int i) { return (double)pi.entry[i].depth; },
 						    0, dpr)),
 	temperatureItem(createItem<DiveTemperatureItem>(*temperatureAxis,
-							[](const plot_data &item) { return (double)item.temperature; },
+							[](const plot_info &pi, int i) { return (double)pi.entry[i].temperature; },
 							1, dpr)),
 	meanDepthItem(createItem<DiveMeanDepthItem>(*profileYAxis,
-						    [](const plot_data &item) { return (double)item.running_sum; },
+						    [](const plot_info &pi, int i) { return (double)pi.entry[i].running_sum; },
 						    1, dpr)),
 	gasPressureItem(createItem<DiveGasPressureItem>(*cylinderPressureAxis,
-							[](const plot_data &item) { return 0.0; }, // unused
+							[](const plot_info &, int) { return 0.0; }, // unused
 							1, dpr)),
 	diveComputerText(new DiveTextItem(dpr, 1.0, Qt::AlignRight | Qt::AlignTop, nullptr)),
 	reportedCeiling(createItem<DiveReportedCeiling>(*profileYAxis,
-							[](const plot_data &item) { return (double)item.ceiling; },
+							[](const plot_info &pi, int i) { return (double)pi.entry[i].ceiling; },
 							1, dpr)),
-	pn2GasItem(createPPGas([](const plot_data &item) { return (double)item.pressures.n2; },
+	pn2GasItem(createPPGas([](const plot_info &pi, int i) { return (double)pi.entry[i].pressures.n2; },
 			       PN2, PN2_ALERT, NULL, &prefs.pp_graphs.pn2_threshold)),
-	pheGasItem(createPPGas([](const plot_data &item) { return (double)item.pressures.he; },
+	pheGasItem(createPPGas([](const plot_info &pi, int i) { return (double)pi.entry[i].pressures.he; },
 			       PHE, PHE_ALERT, NULL, &prefs.pp_graphs.phe_threshold)),
-	po2GasItem(createPPGas([](const plot_data &item) { return (double)item.pressures.o2; },
+	po2GasItem(createPPGas([](const plot_info &pi, int i) { return (double)pi.entry[i].pressures.o2; },
 			       PO2, PO2_ALERT, &prefs.pp_graphs.po2_threshold_min, &prefs.pp_graphs.po2_threshold_max)),
-	o2SetpointGasItem(createPPGas([](const plot_data &item) { return item.o2setpoint.mbar / 1000.0; },
+	o2SetpointGasItem(createPPGas([](const plot_info &pi, int i) { return pi.entry[i].o2setpoint.mbar / 1000.0; },
 				      O2SETPOINT, PO2_ALERT, &prefs.pp_graphs.po2_threshold_min, &prefs.pp_graphs.po2_threshold_max)),
-	ccrsensor1GasItem(createPPGas([](const plot_data &item) { return item.o2sensor[0].mbar / 1000.0; },
+	ccrsensor1GasItem(createPPGas([](const plot_info &pi, int i) { return get_plot_o2sensor(&pi, i, 0) / 1000.0; },
 				      CCRSENSOR1, PO2_ALERT, &prefs.pp_graphs.po2_threshold_min, &prefs.pp_graphs.po2_threshold_max)),
-	ccrsensor2GasItem(createPPGas([](const plot_data &item) { return item.o2sensor[1].mbar / 1000.0; },
+	ccrsensor2GasItem(createPPGas([](const plot_info &pi, int i) { return get_plot_o2sensor(&pi, i, 1) / 1000.0; },
 				      CCRSENSOR2, PO2_ALERT, &prefs.pp_graphs.po2_threshold_min, &prefs.pp_graphs.po2_threshold_max)),
-	ccrsensor3GasItem(createPPGas([](const plot_data &item) { return item.o2sensor[2].mbar / 1000.0; },
+	ccrsensor3GasItem(createPPGas([](const plot_info &pi, int i) { return get_plot_o2sensor(&pi, i, 2) / 1000.0; },
 				      CCRSENSOR3, PO2_ALERT, &prefs.pp_graphs.po2_threshold_min, &prefs.pp_graphs.po2_threshold_max)),
-	ocpo2GasItem(createPPGas([](const plot_data &item) { return item.scr_OC_pO2.mbar / 1000.0; },
+	ocpo2GasItem(createPPGas([](const plot_info &pi, int i) { return pi.entry[i].scr_OC_pO2.mbar / 1000.0; },
 				 SCR_OCPO2, PO2_ALERT, &prefs.pp_graphs.po2_threshold_min, &prefs.pp_graphs.po2_threshold_max)),
 	diveCeiling(createItem<DiveCalculatedCeiling>(*profileYAxis,
-						      [](const plot_data &item) { return (double)item.ceiling; },
+						      [](const plot_info &pi, int i) { return (double)pi.entry[i].ceiling; },
 						      1, dpr)),
 	decoModelParameters(new DiveTextItem(dpr, 1.0, Qt::AlignHCenter | Qt::AlignTop, nullptr)),
 	heartBeatItem(createItem<DiveHeartrateItem>(*heartBeatAxis,
-						    [](const plot_data &item) { return (double)item.heartbeat; },
+						    [](const plot_info &pi, int i) { return (double)pi.entry[i].heartbeat; },
 						    1, dpr)),
 	percentageItem(new DivePercentageItem(*timeAxis, *percentageAxis)),
 	tankItem(new TankItem(*timeAxis, dpr)),
@@ -391,6 +391,23 @@ bool ProfileScene::pointOnProfile(const QPointF &point) const
 	return timeAxis->pointInRange(point.x()) && profileYAxis->pointInRange(point.y());
 }
 
+// The optional columns of the plot info that are needed to draw the visible items.
+unsigned int ProfileScene::plotColumns(bool inPlanner) const
+{
+	unsigned int res = 0;
+	if (prefs.percentagegraph || (prefs.calcalltissues && prefs.calcceiling))
+		res |= PLOT_TISSUES;
+	// In the planner, the pressure graph is colored according to the gas density.
+	if (inPlanner)
+		res |= PLOT_GAS_DETAILS;
+#ifndef SUBSURFACE_MOBILE
+	// The info box shows everything (tissue saturation, MOD, EAD, etc.).
+	if (!printMode && prefs.infobox)
+		res |= PLOT_ALL_COLUMNS;
+#endif
+	return res;
+}
+
 static double max_gas(const plot_info &pi, double gas_pressures::*gas)
 {
 	double ret = -1;
@@ -444,13 +461,18 @@ void ProfileScene::plotDive(const struct dive *dIn, int dcIn, DivePlannerPointsM
 	/* This struct holds all the data that's about to be plotted.
 	 * I'm not sure this is the best approach ( but since we are
 	 * interpolating some points of the Dive, maybe it is... )
-	 * The  Calculation of the points should be done per graph,
-	 * so I'll *not* calculate everything if something is not being
-	 * shown.
+	 * Optional data, such as the tissue saturation, is only
+	 * calculated if an item that shows it is visible. If such an
+	 * item became visible, we have to recalculate even if the caller
+	 * asked us to keep the plot info.
 	 * create_plot_info_new() automatically frees old plot data.
 	 */
-	if (!keepPlotInfo)
-		create_plot_info_new(d, currentdc, &plotInfo, planner_ds);
+	unsigned int columns = plotColumns(inPlanner);
+	if (!keepPlotInfo || (columns & ~plotInfo.columns)) {
+		create_plot_info_new(d, currentdc, &plotInfo, planner_ds, columns);
+		for (AbstractProfilePolygonItem *item: profileItems)
+			item->plotInfoChanged();
+	}
 
 	bool hasHeartBeat = plotInfo.maxhr;
 	// For mobile we might want to turn of some features that are normally shown.
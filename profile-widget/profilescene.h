@@ -53,11 +53,12 @@ public:
 	const struct dive *d;
 	int dc;
 private:
-	using DataAccessor = double (*)(const plot_data &data);
+	using DataAccessor = double (*)(const plot_info &pi, int idx);
 	template<typename T, class... Args> T *createItem(const DiveCartesianAxis &vAxis, DataAccessor accessor, int z, Args&&... args);
 	PartialPressureGasItem *createPPGas(DataAccessor accessor, color_index_t color, color_index_t colorAlert,
 					    const double *thresholdSettingsMin, const double *thresholdSettingsMax);
 	template <int ACT, int MAX> void addTissueItems(double dpr);
+	unsigned int plotColumns(bool inPlanner) const;
 	void updateVisibility(bool diveHasHeartBeat, bool simplified); // Update visibility of non-interactive chart features according to preferences
 	void updateAxes(bool diveHasHeartBeat, bool simplified); // Update axes according to preferences
 
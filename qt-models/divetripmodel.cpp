@@ -685,6 +685,7 @@ DiveTripModelTree::DiveTripModelTree(QObject *parent) : DiveTripModelBase(parent
 	// Stay informed of changes to the divelist
 	connect(&diveListNotifier, &DiveListNotifier::divesAdded, this, &DiveTripModelTree::divesAdded);
 	connect(&diveListNotifier, &DiveListNotifier::divesDeleted, this, &DiveTripModelTree::divesDeleted);
+	connect(&diveListNotifier, &DiveListNotifier::divesBulkChanged, this, &DiveTripModelTree::reset);
 	connect(&diveListNotifier, &DiveListNotifier::divesChanged, this, &DiveTripModelTree::divesChanged);
 	connect(&diveListNotifier, &DiveListNotifier::diveSiteChanged, this, &DiveTripModelTree::diveSiteChanged);
 	connect(&diveListNotifier, &DiveListNotifier::divesMovedBetweenTrips, this, &DiveTripModelTree::divesMovedBetweenTrips);
@@ -715,7 +716,6 @@ void DiveTripModelTree::populate()
 		dive *d = get_dive(i);
 		if (!d) // should never happen
 			continue;
-		update_cylinder_related_info(d);
 		if (d->hidden_by_filter)
 			continue;
 		dive_trip_t *trip = d->divetrip;
@@ -1224,27 +1224,45 @@ void DiveTripModelTree::diveSiteChanged(dive_site *ds, int field)
 {
 	if (!isInterestingDiveSiteField(field))
 		return;
-	divesChanged(getDivesForSite(ds));
+	divesChangedInternal(getDivesForSite(ds), DiveFilter::instance()->dependsOn(DiveField(DiveField::DIVESITE)));
 }
 
-void DiveTripModelTree::divesChanged(const QVector<dive *> &dives)
+void DiveTripModelTree::divesChanged(const QVector<dive *> &dives, DiveField field)
 {
-	processByTrip(dives, [this] (dive_trip *trip, const QVector<dive *> &divesInTrip)
-		      { divesChangedTrip(trip, divesInTrip); });
+	// Only rerun the filter if the changed fields can change the shown status
+	divesChangedInternal(dives, DiveFilter::instance()->dependsOn(field));
 }
 
 void DiveTripModelTree::diveChanged(dive *d)
 {
-	divesChanged(QVector<dive *> { d });
+	// We don't know what changed (cylinders, weights, pictures) - rerun the filter
+	divesChangedInternal(QVector<dive *> { d }, true);
 }
 
-void DiveTripModelTree::divesChangedTrip(dive_trip *trip, const QVector<dive *> &divesIn)
+// The filter is run on all dives at once, so that the shown status and the
+// selection are updated in one batch. Then the changes are processed trip-wise.
+void DiveTripModelTree::divesChangedInternal(const QVector<dive *> &divesIn, bool refilter)
 {
 	QVector<dive *> dives = divesIn;
-	ShownChange shownChange = updateShown(dives);
-	divesShown(trip, shownChange.newShown);
-	divesHidden(trip, shownChange.newHidden);
+	ShownChange shownChange;
+	if (refilter)
+		shownChange = updateShown(dives);
+	processByTrip(shownChange.newShown, [this] (dive_trip *trip, const QVector<dive *> &divesInTrip)
+		      { divesShown(trip, divesInTrip); });
+	processByTrip(shownChange.newHidden, [this] (dive_trip *trip, const QVector<dive *> &divesInTrip)
+		      { divesHidden(trip, divesInTrip); });
+	processByTrip(dives, [this] (dive_trip *trip, const QVector<dive *> &divesInTrip)
+		      { divesChangedTrip(trip, divesInTrip); });
+
+	// If the current dive changed (because the change caused it to become hidden
+	// by the filter), instruct the UI of the changed selection.
+	// TODO: This is way to heavy, as it reloads the whole selection!
+	if (shownChange.currentChanged)
+		initSelection();
+}
 
+void DiveTripModelTree::divesChangedTrip(dive_trip *trip, const QVector<dive *> &dives)
+{
 	if (!trip) {
 		// This is outside of a trip. Process top-level items range-wise.
 
@@ -1279,12 +1297,6 @@ void DiveTripModelTree::divesChangedTrip(dive_trip *trip, const QVector<dive *>
 		// If necessary, move the trip
 		topLevelChanged(idx);
 	}
-
-	// If the current dive changed (because the change caused it to become hidden
-	// by the filter), instruct the UI of the changed selection.
-	// TODO: This is way to heavy, as it reloads the whole selection!
-	if (shownChange.currentChanged)
-		initSelection();
 }
 
 void DiveTripModelTree::tripChanged(dive_trip *trip, TripField)
@@ -1465,6 +1477,7 @@ DiveTripModelList::DiveTripModelList(QObject *parent) : DiveTripModelBase(parent
 	// Stay informed of changes to the divelist
 	connect(&diveListNotifier, &DiveListNotifier::divesAdded, this, &DiveTripModelList::divesAdded);
 	connect(&diveListNotifier, &DiveListNotifier::divesDeleted, this, &DiveTripModelList::divesDeleted);
+	connect(&diveListNotifier, &DiveListNotifier::divesBulkChanged, this, &DiveTripModelList::reset);
 	connect(&diveListNotifier, &DiveListNotifier::divesChanged, this, &DiveTripModelList::divesChanged);
 	connect(&diveListNotifier, &DiveListNotifier::diveSiteChanged, this, &DiveTripModelList::diveSiteChanged);
 	// Does nothing in list-view
@@ -1605,17 +1618,26 @@ void DiveTripModelList::diveSiteChanged(dive_site *ds, int field)
 {
 	if (!isInterestingDiveSiteField(field))
 		return;
-	divesChanged(getDivesForSite(ds));
+	divesChangedInternal(getDivesForSite(ds), DiveFilter::instance()->dependsOn(DiveField(DiveField::DIVESITE)));
+}
+
+void DiveTripModelList::divesChanged(const QVector<dive *> &dives, DiveField field)
+{
+	// Only rerun the filter if the changed fields can change the shown status
+	divesChangedInternal(dives, DiveFilter::instance()->dependsOn(field));
 }
 
-void DiveTripModelList::divesChanged(const QVector<dive *> &divesIn)
+void DiveTripModelList::divesChangedInternal(const QVector<dive *> &divesIn, bool refilter)
 {
 	QVector<dive *> dives = divesIn;
 	std::sort(dives.begin(), dives.end(), dive_less_than);
 
-	ShownChange shownChange = updateShown(dives);
-	removeDives(shownChange.newHidden);
-	addDives(shownChange.newShown);
+	ShownChange shownChange;
+	if (refilter) {
+		shownChange = updateShown(dives);
+		removeDives(shownChange.newHidden);
+		addDives(shownChange.newShown);
+	}
 
 	// Since we know that the dive list is sorted, we will only ever search for the first element
 	// in dives as this must be the first that we encounter. Once we find a range, increase the
@@ -1637,7 +1659,8 @@ void DiveTripModelList::divesChanged(const QVector<dive *> &divesIn)
 
 void DiveTripModelList::diveChanged(dive *d)
 {
-	divesChanged(QVector<dive *> { d });
+	// We don't know what changed (cylinders, weights, pictures) - rerun the filter
+	divesChangedInternal(QVector<dive *> { d }, true);
 }
 
 void DiveTripModelList::divesTimeChanged(timestamp_t delta, const QVector<dive *> &divesIn)
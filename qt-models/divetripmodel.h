@@ -116,7 +116,7 @@ public slots:
 	void divesDeleted(dive_trip *trip, bool deleteTrip, const QVector<dive *> &dives);
 	void divesMovedBetweenTrips(dive_trip *from, dive_trip *to, bool deleteFrom, bool createTo, const QVector<dive *> &dives);
 	void diveSiteChanged(dive_site *ds, int field);
-	void divesChanged(const QVector<dive *> &dives);
+	void divesChanged(const QVector<dive *> &dives, DiveField field);
 	void diveChanged(dive *d);
 	void divesTimeChanged(timestamp_t delta, const QVector<dive *> &dives);
 	void divesSelectedSlot(const QVector<dive *> &dives, dive *currentDive, int currentDC);
@@ -137,6 +137,7 @@ private:
 	bool lessThan(const QModelIndex &i1, const QModelIndex &i2) const override;
 	void divesSelectedTrip(dive_trip *trip, const QVector<dive *> &dives, QVector<QModelIndex> &);
 	dive *diveOrNull(const QModelIndex &index) const override;
+	void divesChangedInternal(const QVector<dive *> &dives, bool refilter);
 	void divesChangedTrip(dive_trip *trip, const QVector<dive *> &dives);
 	void divesShown(dive_trip *trip, const QVector<dive *> &dives);
 	void divesHidden(dive_trip *trip, const QVector<dive *> &dives);
@@ -193,7 +194,7 @@ public slots:
 	void divesAdded(dive_trip *trip, bool addTrip, const QVector<dive *> &dives);
 	void divesDeleted(dive_trip *trip, bool deleteTrip, const QVector<dive *> &dives);
 	void diveSiteChanged(dive_site *ds, int field);
-	void divesChanged(const QVector<dive *> &dives);
+	void divesChanged(const QVector<dive *> &dives, DiveField field);
 	void diveChanged(dive *d);
 	void divesTimeChanged(timestamp_t delta, const QVector<dive *> &dives);
 	// Does nothing in list view.
@@ -215,6 +216,7 @@ private:
 	dive *diveOrNull(const QModelIndex &index) const override;
 	void addDives(QVector<dive *> &dives);
 	void removeDives(QVector<dive *> dives);
+	void divesChangedInternal(const QVector<dive *> &dives, bool refilter);
 	QModelIndex diveToIdx(const dive *d) const;
 	void divesDeletedInternal(const QVector<dive *> &dives);
 
@@ -186,10 +186,9 @@ void YearlyStatisticsModel::update_yearly_stats()
 {
 	int i, month = 0;
 	unsigned int j, combined_months;
-	stats_summary_auto_free stats;
+	const stats_summary &stats = *get_stats_summary();
 	QString label;
 	temperature_t t_range_min,t_range_max;
-	calculate_stats_summary(&stats, false);
 
 	for (i = 0; stats.stats_yearly != NULL && stats.stats_yearly[i].period; ++i) {
 		YearStatisticsItem *item = new YearStatisticsItem(stats.stats_yearly[i]);
@@ -237,8 +236,9 @@ void YearlyStatisticsModel::update_yearly_stats()
 			if (stats.stats_by_depth[i].selection_size) {
 				label = QString(tr("%1 - %2")).arg(get_depth_string((i - 1) * (STATS_DEPTH_BUCKET * 1000), true, false),
 					get_depth_string(i * (STATS_DEPTH_BUCKET * 1000), true, false));
-				stats.stats_by_depth[i].location = strdup(label.toUtf8().data());
-				YearStatisticsItem *iChild = new YearStatisticsItem(stats.stats_by_depth[i]);
+				stats_t range = stats.stats_by_depth[i];
+				range.location = strdup(label.toUtf8().data());
+				YearStatisticsItem *iChild = new YearStatisticsItem(range);
 				item->children.append(iChild);
 				iChild->parent = item;
 			}
@@ -255,8 +255,9 @@ void YearlyStatisticsModel::update_yearly_stats()
 				t_range_max.mkelvin = C_to_mkelvin(i * STATS_TEMP_BUCKET);
 				label = QString(tr("%1 - %2")).arg(get_temperature_string(t_range_min, true),
 					get_temperature_string(t_range_max, true));
-				stats.stats_by_temp[i].location = strdup(label.toUtf8().data());
-				YearStatisticsItem *iChild = new YearStatisticsItem(stats.stats_by_temp[i]);
+				stats_t range = stats.stats_by_temp[i];
+				range.location = strdup(label.toUtf8().data());
+				YearStatisticsItem *iChild = new YearStatisticsItem(range);
 				item->children.append(iChild);
 				iChild->parent = item;
 			}
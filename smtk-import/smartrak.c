@@ -325,7 +325,7 @@ static void smtk_wreck_site(MdbHandle *mdb, char *site_idx, struct dive_site *ds
  * Location format:
  * | Idx | Text | Province | Country | Depth |
  */
-static void smtk_build_location(MdbHandle *mdb, char *idx, struct dive_site **location, struct divelog *log)
+static void smtk_build_location(MdbHandle *mdb, char *idx, struct dive_site **location, struct dive_site *sites[], int sites_num, struct divelog *log)
 {
 	MdbTableDef *table;
 	MdbColumn *col[MDB_MAX_COLS];
@@ -337,6 +337,13 @@ static void smtk_build_location(MdbHandle *mdb, char *idx, struct dive_site **lo
 	char *str = NULL, *loc_idx = NULL, *site = NULL, *notes = NULL;
 	const char *site_fields[] = {QT_TRANSLATE_NOOP("gettextFromC", "Altitude"), QT_TRANSLATE_NOOP("gettextFromC", "Depth"),
 				     QT_TRANSLATE_NOOP("gettextFromC", "Notes")};
+	int site_i = atoi(idx) - 1;
+
+	/* Many dives share a site. Build every site only once. */
+	if (site_i >= 0 && site_i < sites_num && sites[site_i]) {
+		*location = sites[site_i];
+		return;
+	}
 
 	/* Read data from Site table. Format notes for the dive site if any.*/
 	table = smtk_open_table(mdb, "Site", bound_values, NULL);
@@ -405,6 +412,8 @@ static void smtk_build_location(MdbHandle *mdb, char *idx, struct dive_site **lo
 			ds = create_dive_site_with_gps(str, &loc, log->sites);
 	}
 	*location = ds;
+	if (site_i >= 0 && site_i < sites_num)
+		sites[site_i] = ds;
 	smtk_free(bound_values, table->num_cols);
 
 	/* Insert site notes */
@@ -626,35 +635,62 @@ static void smtk_build_list(MdbHandle *mdb,  char *table_name, char *array[])
 	mdb_free_tabledef(table);
 }
 
+/* Clean an array of types_list lists, as built by smtk_build_relations() */
+static void smtk_relations_free(struct types_list **array, int count)
+{
+	int n;
+
+	if (!array)
+		return;
+	for (n = 0; n < count; n++)
+		smtk_list_free(array[n]);
+	free(array);
+}
+
 /*
- * Parses a relation table and returns a list with the relations for a dive idx.
+ * Parses a relation table in a single pass and returns an array, indexed by dive
+ * idx, of lists with the relations of each dive. This avoids parsing the whole
+ * table again for every single dive.
  * Use types_list items with text set to NULL.
- * Returns a pointer to the list head.
  * Table relation format:
  * | Diveidx | Idx |
  */
-static struct types_list *smtk_index_list(MdbHandle *mdb, char *table_name, char *dive_idx)
+static struct types_list **smtk_build_relations(MdbHandle *mdb, char *table_name, int dives_num)
 {
 	MdbTableDef *table;
 	char *bounders[MDB_MAX_COLS];
-	struct types_list *item, *head = NULL;
+	struct types_list **array = calloc(dives_num, sizeof(struct types_list *));
+	int i;
 
 	table = smtk_open_table(mdb, table_name, bounders, NULL);
 
 	/* Sanity check */
 	if (!table)
-		return NULL;
+		return array;
 
-	/* Parse the table searching for dive_idx */
 	while (mdb_fetch_row(table)) {
-		if (!strcmp(dive_idx, bounders[0]))
-			smtk_head_insert(&head, atoi(bounders[1]), NULL);
+		i = atoi(bounders[0]) - 1;
+		if (i >= 0 && i < dives_num)
+			smtk_head_insert(&array[i], atoi(bounders[1]), NULL);
 	}
 
 	/* Clean up and exit */
 	smtk_free(bounders, table->num_cols);
 	mdb_free_tabledef(table);
-	return head;
+	return array;
+}
+
+/*
+ * Returns the list of relations for a dive idx from an array built by
+ * smtk_build_relations(). The list is owned by the array.
+ */
+static struct types_list *smtk_index_list(struct types_list **array, int dives_num, char *dive_idx)
+{
+	int i = atoi(dive_idx) - 1;
+
+	if (i < 0 || i >= dives_num)
+		return NULL;
+	return array[i];
 }
 
 /*
@@ -697,20 +733,14 @@ static void smtk_build_buddies(MdbHandle *mdb, char *array[])
 /*
  * Returns string with buddies names as registered in smartrak (may be a nickname).
  */
-static char *smtk_locate_buddy(MdbHandle *mdb, char *dive_idx, char *buddies_list[])
+static char *smtk_locate_buddy(struct types_list **relations, int dives_num, char *dive_idx, char *buddies_list[])
 {
 	char *str = NULL;
-	struct types_list *rel, *rel_head;
+	struct types_list *rel;
 
-	rel_head = smtk_index_list(mdb, "BuddyRelation", dive_idx);
-	if (!rel_head)
-		return str;
-
-	for (rel = rel_head; rel; rel = rel->next)
+	for (rel = smtk_index_list(relations, dives_num, dive_idx); rel; rel = rel->next)
 		str = smtk_concat_str(str, ", ", "%s", buddies_list[rel->idx - 1]);
 
-	/* Clean up and exit */
-	smtk_list_free(rel_head);
 	return str;
 }
 
@@ -720,12 +750,12 @@ static char *smtk_locate_buddy(MdbHandle *mdb, char *dive_idx, char *buddies_lis
  * The "tag" parameter is used to mark if we want this table to be imported
  * into tags or into notes.
  */
-static void smtk_parse_relations(MdbHandle *mdb, struct dive *dive, char *dive_idx, char *table_name, char *rel_table_name, char *list[], bool tag)
+static void smtk_parse_relations(struct types_list **relations, int dives_num, struct dive *dive, char *dive_idx, char *table_name, char *list[], bool tag)
 {
 	char *tmp = NULL;
 	struct types_list *diverel_head, *d_runner;
 
-	diverel_head = smtk_index_list(mdb, rel_table_name, dive_idx);
+	diverel_head = smtk_index_list(relations, dives_num, dive_idx);
 	if (!diverel_head)
 		return;
 
@@ -745,7 +775,6 @@ static void smtk_parse_relations(MdbHandle *mdb, struct dive *dive, char *dive_i
 	if (tmp)
 		dive->notes = smtk_concat_str(dive->notes, "\n", "Smartrak %s: %s", table_name, tmp);
 	free(tmp);
-	smtk_list_free(diverel_head);
 }
 
 /*
@@ -791,35 +820,58 @@ static struct event *find_bookmark(struct event *orig, unsigned int t)
  * YPos irelevant
  * XConnect irelevant
  * YConnect irelevant
+ * Like relation tables, the table is parsed once into an array, indexed by dive idx,
+ * of lists. Each item keeps the bookmark time in seconds as idx and its text.
  */
-static void smtk_parse_bookmarks(MdbHandle *mdb, struct dive *d, char *dive_idx)
+static struct types_list **smtk_build_bookmarks(MdbHandle *mdb, int dives_num)
 {
 	MdbTableDef *table;
-	char *bound_values[MDB_MAX_COLS], *tmp = NULL;
-	unsigned int time;
-	struct event *ev;
+	char *bound_values[MDB_MAX_COLS];
+	struct types_list **array = calloc(dives_num, sizeof(struct types_list *));
+	struct types_list *item, *reversed;
+	int i;
 
 	table = smtk_open_table(mdb, "Marker", bound_values, NULL);
 	if (!table) {
-		report_error("[smtk-import] Error - Couldn't open table 'Marker', dive %d", d->number);
-		return;
+		report_error("[smtk-import] Error - Couldn't open table 'Marker'");
+		return array;
 	}
 	while (mdb_fetch_row(table)) {
-		if (same_string(bound_values[0], dive_idx)) {
-			time = lrint(strtod(bound_values[4], NULL) * 60);
-			tmp = strdup(bound_values[2]);
-			ev = find_bookmark(d->dc.events, time);
-			if (ev)
-				update_event_name(d, 0, ev, tmp);
-			else
-				if (!add_event(&d->dc, time, SAMPLE_EVENT_BOOKMARK, 0, 0, tmp))
-					report_error("[smtk-import] Error - Couldn't add bookmark, dive %d, Name = %s",
-						     d->number, tmp);
-		}
+		i = atoi(bound_values[0]) - 1;
+		if (i >= 0 && i < dives_num)
+			smtk_head_insert(&array[i], lrint(strtod(bound_values[4], NULL) * 60), strdup(bound_values[2]));
 	}
-	free(tmp);
 	smtk_free(bound_values, table->num_cols);
 	mdb_free_tabledef(table);
+
+	/* Restore the table order of the bookmarks */
+	for (i = 0; i < dives_num; i++) {
+		reversed = NULL;
+		while (array[i]) {
+			item = array[i];
+			array[i] = item->next;
+			item->next = reversed;
+			reversed = item;
+		}
+		array[i] = reversed;
+	}
+	return array;
+}
+
+static void smtk_parse_bookmarks(struct types_list **bookmarks, int dives_num, struct dive *d, char *dive_idx)
+{
+	struct types_list *bm;
+	struct event *ev;
+
+	for (bm = smtk_index_list(bookmarks, dives_num, dive_idx); bm; bm = bm->next) {
+		ev = find_bookmark(d->dc.events, bm->idx);
+		if (ev)
+			update_event_name(d, 0, ev, bm->text);
+		else
+			if (!add_event(&d->dc, bm->idx, SAMPLE_EVENT_BOOKMARK, 0, 0, bm->text))
+				report_error("[smtk-import] Error - Couldn't add bookmark, dive %d, Name = %s",
+					     d->number, bm->text);
+	}
 }
 
 
@@ -964,7 +1016,9 @@ void smartrak_import(const char *file, struct divelog *log)
 		weather_num = get_rows_num(mdb_clon, "Weather"),
 		underwater_num = get_rows_num(mdb_clon, "Underwater"),
 		surface_num = get_rows_num(mdb_clon, "Surface"),
-		buddy_num = get_rows_num(mdb_clon, "Buddy");
+		buddy_num = get_rows_num(mdb_clon, "Buddy"),
+		site_num = get_rows_num(mdb_clon, "Site"),
+		dives_num = get_rows_num(mdb_clon, "Dives");
 
 	char	*type_list[type_num], *activity_list[activity_num], *gear_list[gear_num],
 		*fish_list[fish_num], *buddy_list[buddy_num], *suit_list[suit_num],
@@ -999,6 +1053,15 @@ void smartrak_import(const char *file, struct divelog *log)
 		report_error("[Error][smartrak_import]\tFile %s does not seem to be an SmartTrak file.", file);
 		return;
 	}
+
+	/* Load relation tables, so we don't have to parse them for every dive */
+	struct types_list **buddy_rel = smtk_build_relations(mdb_clon, "BuddyRelation", dives_num),
+			  **type_rel = smtk_build_relations(mdb_clon, "TypeRelation", dives_num),
+			  **activity_rel = smtk_build_relations(mdb_clon, "ActivityRelation", dives_num),
+			  **gear_rel = smtk_build_relations(mdb_clon, "GearRelation", dives_num),
+			  **fish_rel = smtk_build_relations(mdb_clon, "FishRelation", dives_num),
+			  **bookmarks = smtk_build_bookmarks(mdb_clon, dives_num);
+	struct dive_site **site_list = calloc(site_num, sizeof(struct dive_site *));
 	while (mdb_fetch_row(mdb_table)) {
 		device_data_t *devdata = calloc(1, sizeof(device_data_t));
 		dc_family_t dc_fam = DC_FAMILY_NULL;
@@ -1108,22 +1171,29 @@ void smartrak_import(const char *file, struct divelog *log)
 		weightsystem_t ws = { {lrint(strtod(col[coln(WEIGHT)]->bind_ptr, NULL) * 1000)}, "", false };
 		add_cloned_weightsystem(&smtkdive->weightsystems, ws);
 		smtkdive->suit = copy_string(suit_list[atoi(col[coln(SUITIDX)]->bind_ptr) - 1]);
-		smtk_build_location(mdb_clon, col[coln(SITEIDX)]->bind_ptr, &smtkdive->dive_site, log);
-		smtkdive->buddy = smtk_locate_buddy(mdb_clon, col[0]->bind_ptr, buddy_list);
-		smtk_parse_relations(mdb_clon, smtkdive, col[0]->bind_ptr, "Type", "TypeRelation", type_list, true);
-		smtk_parse_relations(mdb_clon, smtkdive, col[0]->bind_ptr, "Activity", "ActivityRelation", activity_list, false);
-		smtk_parse_relations(mdb_clon, smtkdive, col[0]->bind_ptr, "Gear", "GearRelation", gear_list, false);
-		smtk_parse_relations(mdb_clon, smtkdive, col[0]->bind_ptr, "Fish", "FishRelation", fish_list, false);
+		smtk_build_location(mdb_clon, col[coln(SITEIDX)]->bind_ptr, &smtkdive->dive_site, site_list, site_num, log);
+		smtkdive->buddy = smtk_locate_buddy(buddy_rel, dives_num, col[0]->bind_ptr, buddy_list);
+		smtk_parse_relations(type_rel, dives_num, smtkdive, col[0]->bind_ptr, "Type", type_list, true);
+		smtk_parse_relations(activity_rel, dives_num, smtkdive, col[0]->bind_ptr, "Activity", activity_list, false);
+		smtk_parse_relations(gear_rel, dives_num, smtkdive, col[0]->bind_ptr, "Gear", gear_list, false);
+		smtk_parse_relations(fish_rel, dives_num, smtkdive, col[0]->bind_ptr, "Fish", fish_list, false);
 		smtk_parse_other(smtkdive, weather_list, "Weather", col[coln(WEATHERIDX)]->bind_ptr, false);
 		smtk_parse_other(smtkdive, underwater_list, "Underwater", col[coln(UNDERWATERIDX)]->bind_ptr, false);
 		smtk_parse_other(smtkdive, surface_list, "Surface", col[coln(SURFACEIDX)]->bind_ptr, false);
-		smtk_parse_bookmarks(mdb_clon, smtkdive, col[0]->bind_ptr);
+		smtk_parse_bookmarks(bookmarks, dives_num, smtkdive, col[0]->bind_ptr);
 		smtkdive->notes = smtk_concat_str(smtkdive->notes, "\n", "%s", col[coln(REMARKS)]->bind_ptr);
 
 		record_dive_to_table(smtkdive, log->dives);
 		device_data_free(devdata);
 	}
 	mdb_free_tabledef(mdb_table);
+	smtk_relations_free(buddy_rel, dives_num);
+	smtk_relations_free(type_rel, dives_num);
+	smtk_relations_free(activity_rel, dives_num);
+	smtk_relations_free(gear_rel, dives_num);
+	smtk_relations_free(fish_rel, dives_num);
+	smtk_relations_free(bookmarks, dives_num);
+	free(site_list);
 	mdb_free_catalog(mdb_clon);
 	mdb->catalog = NULL;
 	mdb_close(mdb_clon);
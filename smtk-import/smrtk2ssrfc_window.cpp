@@ -10,6 +10,7 @@
 #include <QFileDialog>
 #include <QFileInfo>
 #include <QDebug>
+#include <QElapsedTimer>
 
 QStringList inputFiles;
 QString outputFile;
@@ -78,6 +79,7 @@ void Smrtk2ssrfcWindow::on_importButton_clicked()
 		return;
 
 	QByteArray fileNamePtr;
+	QElapsedTimer timer;
 
 	ui->plainTextEdit->setDisabled(false);
 	ui->progressBar->setRange(0, inputFiles.size());
@@ -85,11 +87,17 @@ void Smrtk2ssrfcWindow::on_importButton_clicked()
 	for (int i = 0; i < inputFiles.size(); ++i) {
 		ui->progressBar->setValue(i);
 		fileNamePtr = QFile::encodeName(inputFiles.at(i));
+		int nr = divelog.dives->nr;
+		timer.start();
 		smartrak_import(fileNamePtr.data(), &divelog);
 		ui->plainTextEdit->appendPlainText(error_buf);
+		ui->plainTextEdit->appendPlainText(tr("Imported %1 dives from %2 in %3 ms")
+						   .arg(divelog.dives->nr - nr).arg(inputFiles.at(i)).arg(timer.elapsed()));
 	}
 	ui->progressBar->setValue(inputFiles.size());
+	timer.start();
 	save_dives_logic(qPrintable(outputFile), false, false);
+	ui->plainTextEdit->appendPlainText(tr("Wrote %1 in %2 ms").arg(outputFile).arg(timer.elapsed()));
 	ui->progressBar->setDisabled(true);
 }
 
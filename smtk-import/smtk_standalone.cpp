@@ -7,6 +7,7 @@
 #include "smrtk2ssrfc_window.h"
 #include <QApplication>
 #include <QDebug>
+#include <QElapsedTimer>
 
 /*
  * Simple command line interface to call directly smartrak_import() or launch
@@ -16,7 +17,8 @@
 int main(int argc, char *argv[])
 {
 	char *infile, *outfile;
-	int i;
+	int i, nr;
+	QElapsedTimer timer;
 #ifndef COMMANDLINE
 	QApplication a(argc, argv);
 	Smrtk2ssrfcWindow w;
@@ -47,10 +49,15 @@ int main(int argc, char *argv[])
 		for(i = 1; i < argc -1; i++) {
 			infile = argv[i];
 			qDebug() << "\t" << infile << "\n";
+			nr = divelog.dives->nr;
+			timer.start();
 			smartrak_import(infile, &divelog);
+			qDebug() << "\t" << divelog.dives->nr - nr << "dives in" << timer.elapsed() << "ms\n";
 		}
 		qDebug() << "\n[Writing]\n\t" << outfile << "\n";
+		timer.start();
 		save_dives_logic(outfile, false, false);
+		qDebug() << "\t" << timer.elapsed() << "ms\n";
 		break;
 	}
 }
@@ -300,6 +300,34 @@ void BarSeries::add_item(double lowerBound, double upperBound, std::vector<SubIt
 			   total, horizontal, stacked, binCount(), theme);
 }
 
+bool BarSeries::updateItem(double lowerBound, double value, std::vector<dive *> dives,
+			   const std::vector<QString> &label, const StatsOperationResults &res, int total)
+{
+	auto it = std::find_if(items.begin(), items.end(),
+			       [lowerBound](const Item &item) { return item.lowerBound == lowerBound; });
+	if (it == items.end() || it->subitems.size() != 1 || value <= 0.0)
+		return false;
+
+	// Don't show stale information
+	if (highlighted.bar == it - items.begin()) {
+		unhighlight();
+		if (information)
+			information->setVisible(false);
+	}
+
+	SubItem &subitem = it->subitems[0];
+	subitem.dives = std::move(dives);
+	subitem.value_to = subitem.value_from + value;
+	subitem.selected = allDivesSelected(subitem.dives);
+	if (subitem.label)
+		subitem.label->item->setText(label);
+	it->res = res;
+	it->total = total;
+	subitem.highlight(false, binCount(), theme);
+	it->updatePosition(this, horizontal, stacked, binCount(), theme);
+	return true;
+}
+
 void BarSeries::updatePositions()
 {
 	for (Item &item: items)
@@ -66,6 +66,12 @@ public:
 		  std::vector<MultiItem> items);
 	~BarSeries();
 
+	// Update the bar at the given position of a count or value based series in place.
+	// Returns false if there is no such bar or if the bar would vanish.
+	// In that case, the chart has to be replotted.
+	bool updateItem(double lowerBound, double value, std::vector<dive *> dives,
+			const std::vector<QString> &label, const StatsOperationResults &res, int total);
+
 	void updatePositions() override;
 	bool hover(QPointF pos) override;
 	void unhighlight() override;
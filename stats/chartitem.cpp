@@ -237,12 +237,24 @@ void ChartRectItem::resize(QSizeF size)
 
 ChartTextItem::ChartTextItem(StatsView &v, ChartZValue z, const QFont &f, const std::vector<QString> &text, bool center) :
 	ChartPixmapItem(v, z), f(f), center(center)
+{
+	setText(text);
+}
+
+ChartTextItem::ChartTextItem(StatsView &v, ChartZValue z, const QFont &f, const QString &text) :
+	ChartTextItem(v, z, f, std::vector<QString>({ text }), true)
+{
+}
+
+// Attention: the canvas is uninitialized until setColor() is called.
+void ChartTextItem::setText(const std::vector<QString> &text)
 {
 	QFontMetrics fm(f);
 	double totalWidth = 1.0;
 	fontHeight = static_cast<double>(fm.height());
 	double totalHeight = std::max(1.0, static_cast<double>(text.size()) * fontHeight);
 
+	items.clear();
 	items.reserve(text.size());
 	for (const QString &s: text) {
 		double w = fm.size(Qt::TextSingleLine, s).width();
@@ -253,11 +265,6 @@ ChartTextItem::ChartTextItem(StatsView &v, ChartZValue z, const QFont &f, const
 	resize(QSizeF(totalWidth, totalHeight));
 }
 
-ChartTextItem::ChartTextItem(StatsView &v, ChartZValue z, const QFont &f, const QString &text) :
-	ChartTextItem(v, z, f, std::vector<QString>({ text }), true)
-{
-}
-
 void ChartTextItem::setColor(const QColor &c)
 {
 	setColor(c, Qt::transparent);
@@ -94,6 +94,7 @@ public:
 	ChartTextItem(StatsView &v, ChartZValue z, const QFont &f, const QString &text);
 	void setColor(const QColor &color); // Draw on transparent background
 	void setColor(const QColor &color, const QColor &background); // Fill rectangle with given background color
+	void setText(const std::vector<QString> &text); // Must be followed by setColor()
 private:
 	const QFont &f;
 	double fontHeight;
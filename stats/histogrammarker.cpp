@@ -27,3 +27,9 @@ void HistogramMarker::updatePosition()
 		setLine(QPointF(x, y1), QPointF(x, y2));
 	}
 }
+
+void HistogramMarker::setValue(double valIn)
+{
+	val = valIn;
+	updatePosition();
+}
@@ -12,6 +12,7 @@ class HistogramMarker : public ChartLineItem {
 public:
 	HistogramMarker(StatsView &view, double val, bool horizontal, QColor color, StatsAxis *xAxis, StatsAxis *yAxis);
 	void updatePosition();
+	void setValue(double val);
 private:
 	StatsAxis *xAxis, *yAxis;
 	double val;
@@ -41,18 +41,20 @@ void RegressionItem::updatePosition()
 	auto [screenMinX, screenMaxX] = xAxis->minMaxScreen();
 
 	// Draw the confidence interval according to http://www2.stat.duke.edu/~tjl13/s101/slides/unit6lec3H.pdf p.5 with t*=2 for 95% confidence
+	// The terms that don't depend on x are calculated only once.
+	double var = reg.res2 / (reg.n - 2);
+	double varSlope = var * (reg.n - 2) / (reg.n - 1) / reg.sx2;
+	auto halfWidth = [&](double x) { return 1.960 * sqrt(var / reg.n + (x - reg.xavg) * (x - reg.xavg) * varSlope); };
 	QPolygonF poly;
 	const int num_samples = 101;
 	poly.reserve(num_samples * 2);
 	for (int i = 0; i < num_samples; ++i) {
 		double x = (maxX - minX) / (num_samples - 1) * static_cast<double>(i) + minX;
-		poly << QPointF(xAxis->toScreen(x),
-			yAxis->toScreen(reg.a * x + reg.b + 1.960 * sqrt(reg.res2 / (reg.n - 2)  * (1.0 / reg.n + (x - reg.xavg) * (x - reg.xavg) / (reg.n - 1) * (reg.n -2) / reg.sx2))));
+		poly << QPointF(xAxis->toScreen(x), yAxis->toScreen(reg.a * x + reg.b + halfWidth(x)));
 	}
 	for (int i = num_samples - 1; i >= 0; --i) {
 		double x = (maxX - minX) / (num_samples - 1) * static_cast<double>(i) + minX;
-		poly << QPointF(xAxis->toScreen(x),
-			yAxis->toScreen(reg.a * x + reg.b - 1.960 * sqrt(reg.res2 / (reg.n - 2)  * (1.0 / reg.n + (x - reg.xavg) * (x - reg.xavg) / (reg.n - 1) * (reg.n -2) / reg.sx2))));
+		poly << QPointF(xAxis->toScreen(x), yAxis->toScreen(reg.a * x + reg.b - halfWidth(x)));
 	}
 	QPolygonF linePolygon;
 	linePolygon.reserve(2);
@@ -12,10 +12,16 @@
 #include "core/divelist.h"
 #include "core/qthelper.h"
 #include "core/selection.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <unordered_set>
 
 ScatterSeries::ScatterSeries(StatsView &view, StatsAxis *xAxis, StatsAxis *yAxis,
 			     const StatsVariable &varX, const StatsVariable &varY) :
 	StatsSeries(view, xAxis, yAxis),
+	cellSize(1.0), gridWidth(0), gridHeight(0),
 	varX(varX), varY(varY)
 {
 }
@@ -28,6 +34,7 @@ ScatterSeries::Item::Item(StatsView &view, ScatterSeries *series, dive *d, doubl
 	item(view.createChartItem<ChartScatterItem>(ChartZValue::Series, d->selected)),
 	d(d),
 	selected(d->selected),
+	representative(true),
 	pos(pos),
 	value(value)
 {
@@ -46,6 +53,7 @@ void ScatterSeries::Item::highlight(bool highlight)
 	if (highlight)
 		status = ChartScatterItem::Highlight::Highlighted;
 	item->setHighlight(status);
+	item->setVisible(highlight || representative);
 }
 
 void ScatterSeries::append(dive *d, double pos, double value)
@@ -57,42 +65,111 @@ void ScatterSeries::updatePositions()
 {
 	for (Item &item: items)
 		item.updatePosition(this);
+	buildGrid();
+	updateVisibility();
 }
 
-std::vector<int> ScatterSeries::getItemsUnderMouse(const QPointF &point) const
+// Sort the items into the cells by a counting sort. Since the items are
+// processed in order, the items of each cell are sorted by index.
+void ScatterSeries::buildGrid()
 {
-	std::vector<int> res;
-	double x = point.x();
-
-	auto low = std::lower_bound(items.begin(), items.end(), x,
-				    [] (const Item &item, double x) { return item.item->getRect().right() < x; });
-	auto high = std::upper_bound(low, items.end(), x,
-				    [] (double x, const Item &item) { return x < item.item->getRect().left(); });
-	// Hopefully that narrows it down enough. For discrete scatter plots, we could also partition
-	// by equal x and do a binary search in these partitions. But that's probably not worth it.
-	res.reserve(high - low);
-	for (auto it = low; it < high; ++it) {
-		if (it->item->contains(point))
-			res.push_back(it - items.begin());
+	cellStart.clear();
+	cellItems.clear();
+	if (items.empty())
+		return;
+
+	double minX = std::numeric_limits<double>::max();
+	double minY = std::numeric_limits<double>::max();
+	double maxX = std::numeric_limits<double>::lowest();
+	double maxY = std::numeric_limits<double>::lowest();
+	for (const Item &item: items) {
+		QPointF center = item.item->getRect().center();
+		minX = std::min(minX, center.x());
+		minY = std::min(minY, center.y());
+		maxX = std::max(maxX, center.x());
+		maxY = std::max(maxY, center.y());
 	}
-	return res;
+	cellSize = std::max(items[0].item->getRect().width(), 1.0);
+	gridOrigin = QPointF(minX, minY);
+	gridWidth = (int)floor((maxX - minX) / cellSize) + 1;
+	gridHeight = (int)floor((maxY - minY) / cellSize) + 1;
+
+	std::vector<int> cells(items.size());
+	cellStart.assign(gridWidth * gridHeight + 1, 0);
+	for (size_t i = 0; i < items.size(); ++i) {
+		QPointF center = items[i].item->getRect().center() - gridOrigin;
+		int x = std::min((int)(center.x() / cellSize), gridWidth - 1);
+		int y = std::min((int)(center.y() / cellSize), gridHeight - 1);
+		cells[i] = y * gridWidth + x;
+		++cellStart[cells[i] + 1];
+	}
+	std::partial_sum(cellStart.begin(), cellStart.end(), cellStart.begin());
+	std::vector<int> pos(cellStart.begin(), cellStart.end() - 1);
+	cellItems.resize(items.size());
+	for (size_t i = 0; i < items.size(); ++i)
+		cellItems[pos[cells[i]]++] = (int)i;
 }
 
-std::vector<int> ScatterSeries::getItemsInRect(const QRectF &rect) const
+// Cell coordinate, clamped to one outside of the grid to avoid overflow
+static int cellCoord(double v, double origin, double cellSize, int size)
+{
+	return (int)std::clamp(floor((v - origin) / cellSize), -1.0, (double)size);
+}
+
+std::vector<int> ScatterSeries::itemsInCells(const QRectF &rect) const
 {
 	std::vector<int> res;
+	if (cellStart.empty())
+		return res;
+	int x1 = std::max(cellCoord(rect.left(), gridOrigin.x(), cellSize, gridWidth), 0);
+	int x2 = std::min(cellCoord(rect.right(), gridOrigin.x(), cellSize, gridWidth), gridWidth - 1);
+	int y1 = std::max(cellCoord(rect.top(), gridOrigin.y(), cellSize, gridHeight), 0);
+	int y2 = std::min(cellCoord(rect.bottom(), gridOrigin.y(), cellSize, gridHeight), gridHeight - 1);
+	for (int y = y1; y <= y2; ++y) {
+		for (int x = x1; x <= x2; ++x) {
+			int cell = y * gridWidth + x;
+			res.insert(res.end(), cellItems.begin() + cellStart[cell], cellItems.begin() + cellStart[cell + 1]);
+		}
+	}
+	std::sort(res.begin(), res.end());
+	return res;
+}
 
-	auto low = std::lower_bound(items.begin(), items.end(), rect.left(),
-				    [] (const Item &item, double x) { return item.item->getRect().right() < x; });
-	auto high = std::upper_bound(low, items.end(), rect.right(),
-				    [] (double x, const Item &item) { return x < item.item->getRect().left(); });
-	// Hopefully that narrows it down enough. For discrete scatter plots, we could also partition
-	// by equal x and do a binary search in these partitions. But that's probably not worth it.
-	res.reserve(high - low);
-	for (auto it = low; it < high; ++it) {
-		if (it->item->inRect(rect))
-			res.push_back(it - items.begin());
+// With many dives, most items are drawn on top of other items. For every
+// pixel, only show the first item of each selection status. Highlighted
+// items are always shown.
+void ScatterSeries::updateVisibility()
+{
+	std::unordered_set<uint64_t> occupied;
+	occupied.reserve(items.size());
+	for (Item &item: items) {
+		QPointF center = item.item->getRect().center();
+		uint64_t key = ((uint64_t)(uint32_t)lrint(center.x()) << 32) |
+			       (uint32_t)(2 * lrint(center.y()) + (item.selected ? 1 : 0));
+		item.representative = occupied.insert(key).second;
+		item.item->setVisible(item.representative);
 	}
+	for (int idx: highlighted)
+		items[idx].item->setVisible(true);
+}
+
+std::vector<int> ScatterSeries::getItemsUnderMouse(const QPointF &point) const
+{
+	// An item is under the mouse if its center is less than a radius away.
+	double radius = cellSize / 2.0;
+	std::vector<int> res = itemsInCells(QRectF(point - QPointF(radius, radius), QSizeF(2.0 * radius, 2.0 * radius)));
+	res.erase(std::remove_if(res.begin(), res.end(),
+				 [this, &point](int idx) { return !items[idx].item->contains(point); }),
+		  res.end());
+	return res;
+}
+
+std::vector<int> ScatterSeries::getItemsInRect(const QRectF &rect) const
+{
+	std::vector<int> res = itemsInCells(rect);
+	res.erase(std::remove_if(res.begin(), res.end(),
+				 [this, &rect](int idx) { return !items[idx].item->inRect(rect); }),
+		  res.end());
 	return res;
 }
 
@@ -122,9 +199,10 @@ void ScatterSeries::selectItemsInRect(const QRectF &rect, SelectionModifier modi
 
 	if (modifier.ctrl) {
 		selected = oldSelection;
-		// Ouch - this primitive merging of the selections grows with O(n^2). Fix this.
+		std::vector<dive *> sorted = oldSelection;
+		std::sort(sorted.begin(), sorted.end());
 		for (int idx: indices) {
-			if (std::find(selected.begin(), selected.end(), items[idx].d) == selected.end())
+			if (!std::binary_search(sorted.begin(), sorted.end(), items[idx].d))
 				selected.push_back(items[idx].d);
 		}
 	} else {
@@ -219,12 +297,17 @@ void ScatterSeries::unhighlight()
 
 void ScatterSeries::divesSelected(const QVector<dive *> &)
 {
+	bool changed = false;
 	for (Item &item: items) {
 		if (item.selected != item.d->selected) {
 			item.selected = item.d->selected;
 			int idx = &item - &items[0];
 			bool highlight = std::find(highlighted.begin(), highlighted.end(), idx) != highlighted.end();
 			item.highlight(highlight);
+			changed = true;
 		}
 	}
+	// Which items are drawn on top of each other depends on the selection status
+	if (changed)
+		updateVisibility();
 }
@@ -40,6 +40,7 @@ private:
 		ChartItemPtr<ChartScatterItem> item;
 		dive *d;
 		bool selected;
+		bool representative; // False if drawn on top of an identical item
 		double pos, value;
 		Item(StatsView &view, ScatterSeries *series, dive *d, double pos, double value);
 		void updatePosition(ScatterSeries *series);
@@ -49,6 +50,18 @@ private:
 	ChartItemPtr<InformationBox> information;
 	std::vector<Item> items;
 	std::vector<int> highlighted;
+
+	// Uniform grid of the item centers on the screen for hit-testing.
+	// The cells have the size of an item, so that only few cells
+	// have to be checked for items under the mouse.
+	QPointF gridOrigin;
+	double cellSize;
+	int gridWidth, gridHeight;
+	std::vector<int> cellStart; // Index of each cell's first item in cellItems, plus end marker
+	std::vector<int> cellItems; // Item indices, sorted by cell
+	void buildGrid();
+	std::vector<int> itemsInCells(const QRectF &rect) const; // Sorted items with center in cells overlapping the rectangle
+	void updateVisibility();
 	const StatsVariable &varX;
 	const StatsVariable &varY;
 	void divesSelected(const QVector<dive *> &) override;
@@ -2,6 +2,7 @@
 #include "statsvariables.h"
 #include "statstranslations.h"
 #include "core/dive.h"
+#include "core/divelist.h"
 #include "core/divelog.h"
 #include "core/divemode.h"
 #include "core/divesite.h"
@@ -12,8 +13,11 @@
 #include "core/tag.h"
 #include "core/trip.h"
 #include "core/subsurface-time.h"
+#include "core/subsurface-qt/divelistnotifier.h"
 #include <cmath>
 #include <limits>
+#include <optional>
+#include <unordered_map>
 #include <QLocale>
 
 static constexpr double NaN = std::numeric_limits<double>::quiet_NaN();
@@ -320,11 +324,225 @@ int StatsVariable::decimals() const
 	return 0;
 }
 
+int StatsVariable::diveFields() const
+{
+	return DiveField::NONE;
+}
+
+bool StatsVariable::usesCylinders() const
+{
+	return false;
+}
+
+bool StatsVariable::usesWeights() const
+{
+	return false;
+}
+
+bool StatsVariable::usesTrip() const
+{
+	return false;
+}
+
 double StatsVariable::toFloat(const dive *d) const
 {
 	return invalid_value<double>();
 }
 
+// Cache of the values of the variables and of the bins of the binners. For every
+// variable or binner that was accessed, the values of all dives are kept in a
+// column, i.e. an array indexed by the position of the dive in the dive table.
+// The position of a dive is found by bisecting the sorted dive table. Since the
+// dives are usually processed in dive table order, most lookups are a single
+// comparison with the dive following the previously found dive.
+// All columns are discarded if the dive table changes (detected by the generation
+// counter of the dive table), if the units change or if trips or dive sites are
+// edited. Edited dives get a new stamp, which marks their entries in all columns
+// as outdated.
+// The cache connects to the DiveListNotifier. It must do so before the StatsView,
+// so that the values are up to date when the view replots. Therefore, it is
+// created by initStatsCache() and not lazily on first use.
+class StatsValueCache {
+public:
+	StatsValueCache();
+	std::vector<int> rows(const std::vector<dive *> &dives); // -1 for dives not in the dive table
+	int row(const dive *d);
+	unsigned int generation() const; // Increased whenever all columns are invalidated
+	int size() const;
+	unsigned int stamp(int row) const;
+private:
+	unsigned int tableGeneration;
+	unsigned int gen;
+	std::vector<unsigned int> stamps; // Per dive, increased when the dive is edited
+	void invalidate();
+	void invalidateDives(const QVector<dive *> &dives);
+	void invalidateDive(const dive *d);
+	void update();
+	int find(const dive *d, int from) const;
+};
+
+static std::unique_ptr<StatsValueCache> stats_value_cache;
+
+void initStatsCache()
+{
+	if (!stats_value_cache)
+		stats_value_cache = std::make_unique<StatsValueCache>();
+}
+
+static StatsValueCache &get_value_cache()
+{
+	initStatsCache();
+	return *stats_value_cache;
+}
+
+StatsValueCache::StatsValueCache() : tableGeneration(get_dive_table_generation()), gen(1)
+{
+	// The cache is a global object, therefore connect without context object.
+	QObject::connect(&diveListNotifier, &DiveListNotifier::dataReset, [this]() { invalidate(); });
+	QObject::connect(&diveListNotifier, &DiveListNotifier::settingsChanged, [this]() { invalidate(); });
+	QObject::connect(&diveListNotifier, &DiveListNotifier::divesBulkChanged, [this]() { invalidate(); });
+	QObject::connect(&diveListNotifier, &DiveListNotifier::tripChanged, [this]() { invalidate(); });
+	QObject::connect(&diveListNotifier, &DiveListNotifier::diveSiteChanged, [this]() { invalidate(); });
+	QObject::connect(&diveListNotifier, &DiveListNotifier::divesTimeChanged,
+			 [this](timestamp_t, const QVector<dive *> &dives) { invalidateDives(dives); });
+	QObject::connect(&diveListNotifier, &DiveListNotifier::divesMovedBetweenTrips,
+			 [this](dive_trip *, dive_trip *, bool, bool, const QVector<dive *> &dives) { invalidateDives(dives); });
+	QObject::connect(&diveListNotifier, &DiveListNotifier::divesChanged,
+			 [this](const QVector<dive *> &dives, DiveField) { invalidateDives(dives); });
+	QObject::connect(&diveListNotifier, &DiveListNotifier::cylindersReset,
+			 [this](const QVector<dive *> &dives) { invalidateDives(dives); });
+	QObject::connect(&diveListNotifier, &DiveListNotifier::weightsystemsReset,
+			 [this](const QVector<dive *> &dives) { invalidateDives(dives); });
+	QObject::connect(&diveListNotifier, &DiveListNotifier::cylinderAdded, [this](dive *d) { invalidateDive(d); });
+	QObject::connect(&diveListNotifier, &DiveListNotifier::cylinderRemoved, [this](dive *d) { invalidateDive(d); });
+	QObject::connect(&diveListNotifier, &DiveListNotifier::cylinderEdited, [this](dive *d) { invalidateDive(d); });
+	QObject::connect(&diveListNotifier, &DiveListNotifier::weightAdded, [this](dive *d) { invalidateDive(d); });
+	QObject::connect(&diveListNotifier, &DiveListNotifier::weightRemoved, [this](dive *d) { invalidateDive(d); });
+	QObject::connect(&diveListNotifier, &DiveListNotifier::weightEdited, [this](dive *d) { invalidateDive(d); });
+	// Changing the dive computer recalculates depth and duration
+	QObject::connect(&diveListNotifier, &DiveListNotifier::diveComputerEdited, [this]() { invalidate(); });
+	stamps.assign(divelog.dives->nr, 1);
+}
+
+void StatsValueCache::invalidate()
+{
+	++gen;
+	stamps.assign(divelog.dives->nr, 1);
+	tableGeneration = get_dive_table_generation();
+}
+
+// Note: Dives added, removed or sorted are caught by the generation
+// counter of the dive table. Thus, there is no need to listen to the
+// corresponding signals.
+void StatsValueCache::update()
+{
+	if (tableGeneration != get_dive_table_generation())
+		invalidate();
+}
+
+void StatsValueCache::invalidateDive(const dive *d)
+{
+	int idx = row(d);
+	if (idx >= 0)
+		++stamps[idx];
+}
+
+void StatsValueCache::invalidateDives(const QVector<dive *> &dives)
+{
+	for (const dive *d: dives)
+		invalidateDive(d);
+}
+
+// Find a dive in the dive table, starting at position "from". Returns -1 if not found.
+int StatsValueCache::find(const dive *d, int from) const
+{
+	dive **begin = divelog.dives->dives;
+	dive **end = begin + divelog.dives->nr;
+	if (from < divelog.dives->nr && begin[from] == d)
+		return from;
+	dive **it = std::lower_bound(begin + from, end, d,
+				     [](const dive *d1, const dive *d2) { return comp_dives(d1, d2) < 0; });
+	return it != end && *it == d ? (int)(it - begin) : -1;
+}
+
+std::vector<int> StatsValueCache::rows(const std::vector<dive *> &dives)
+{
+	update();
+	std::vector<int> res;
+	res.reserve(dives.size());
+	int next = 0;
+	for (const dive *d: dives) {
+		int idx = find(d, next);
+		if (idx < 0 && next > 0)
+			idx = find(d, 0); // Not in dive table order
+		res.push_back(idx);
+		if (idx >= 0)
+			next = idx + 1;
+	}
+	return res;
+}
+
+int StatsValueCache::row(const dive *d)
+{
+	update();
+	return find(d, 0);
+}
+
+unsigned int StatsValueCache::generation() const
+{
+	return gen;
+}
+
+int StatsValueCache::size() const
+{
+	return (int)stamps.size();
+}
+
+unsigned int StatsValueCache::stamp(int row) const
+{
+	return stamps[row];
+}
+
+// A column of the cache: the values of a variable or binner for all dives.
+// The optional is used, because not all bin-values are default constructible.
+template<typename T>
+class StatsCacheColumn {
+	unsigned int generation = 0; // Cache generation the column was built for
+	std::vector<unsigned int> stamps; // Stamps of the rows when the values were calculated
+	std::vector<std::optional<T>> values;
+	std::optional<T> uncached; // For dives not in the dive table
+public:
+	// Returns the cached value of the dive or calculates it with func(d).
+	// "row" is the position of the dive as returned by StatsValueCache.
+	template<typename Func>
+	const T &get(const StatsValueCache &cache, int row, const dive *d, Func func) {
+		if (row < 0) {
+			uncached = func(d);
+			return *uncached;
+		}
+		if (generation != cache.generation() || (int)stamps.size() != cache.size()) {
+			generation = cache.generation();
+			stamps.assign(cache.size(), 0);
+			values.assign(cache.size(), std::nullopt);
+		}
+		if (stamps[row] != cache.stamp(row)) {
+			values[row] = func(d);
+			stamps[row] = cache.stamp(row);
+		}
+		return *values[row];
+	}
+};
+
+// The columns of the variables are kept here, so as not to expose the cache in the header.
+static std::unordered_map<const StatsVariable *, StatsCacheColumn<double>> value_columns;
+
+double StatsVariable::value(const dive *d) const
+{
+	StatsValueCache &cache = get_value_cache();
+	return value_columns[this].get(cache, cache.row(d), d,
+				       [this](const dive *d) { return toFloat(d); });
+}
+
 QString StatsVariable::nameWithUnit() const
 {
 	QString s = name();
@@ -395,25 +613,38 @@ double StatsVariable::mean(const std::vector<dive *> &dives) const
 	return res.isValid() ? res.mean : invalid_value<double>();
 }
 
-std::vector<StatsValue> StatsVariable::values(const std::vector<dive *> &dives) const
+static bool value_less_than(const StatsValue &v1, const StatsValue &v2)
+{
+	return v1.v < v2.v;
+}
+
+std::vector<StatsValue> StatsVariable::unsortedValues(const std::vector<dive *> &dives) const
 {
 	std::vector<StatsValue> vec;
 	vec.reserve(dives.size());
-	for (dive *d: dives) {
-		double v = toFloat(d);
+	StatsValueCache &cache = get_value_cache();
+	StatsCacheColumn<double> &col = value_columns[this];
+	std::vector<int> rows = cache.rows(dives);
+	for (size_t i = 0; i < dives.size(); ++i) {
+		dive *d = dives[i];
+		double v = col.get(cache, rows[i], d, [this](const dive *d) { return toFloat(d); });
 		if (!is_invalid_value(v))
 			vec.push_back({ v, d });
 	}
-	std::sort(vec.begin(), vec.end(),
-		  [](const StatsValue &v1, const StatsValue &v2)
-		  { return v1.v < v2.v; });
+	return vec;
+}
+
+std::vector<StatsValue> StatsVariable::values(const std::vector<dive *> &dives) const
+{
+	std::vector<StatsValue> vec = unsortedValues(dives);
+	std::sort(vec.begin(), vec.end(), &value_less_than);
 	return vec;
 }
 
 QString StatsVariable::valueWithUnit(const dive *d) const
 {
 	QLocale loc;
-	double v = toFloat(d);
+	double v = value(d);
 	if (is_invalid_value(v))
 		return QStringLiteral("-");
 	return QString("%1 %2").arg(loc.toString(v, 'f', decimals()),
@@ -438,12 +669,36 @@ static double q3(const StatsValue *v)
 	return (v[0].v + 3.0*v[1].v) / 4.0;
 }
 
+// Calculating the quartiles only needs the values at a few positions of the
+// sorted vector, namely the extrema and the elements around the quartiles.
+// Instead of sorting the whole vector, put only these elements into place
+// using selection. Each selection works on the part of the vector above the
+// previously selected element, which is already partitioned.
+static void select_quartile_elements(std::vector<StatsValue> &vec)
+{
+	int s = (int)vec.size();
+	if (s < 32) {
+		std::sort(vec.begin(), vec.end(), &value_less_than);
+		return;
+	}
+	int positions[] = { 0, s/4 - 1, s/4, s/4 + 1, s/2 - 1, s/2, s - s/4 - 2, s - s/4 - 1, s - s/4, s - 1 };
+	int from = 0;
+	for (int pos: positions) {
+		if (pos < from)
+			continue;
+		std::nth_element(vec.begin() + from, vec.begin() + pos, vec.end(), &value_less_than);
+		from = pos + 1;
+	}
+}
+
 StatsQuartiles StatsVariable::quartiles(const std::vector<dive *> &dives) const
 {
-	return quartiles(values(dives));
+	std::vector<StatsValue> vec = unsortedValues(dives);
+	select_quartile_elements(vec);
+	return quartiles(vec);
 }
 
-// This expects the value vector to be sorted!
+// This expects the value vector to be sorted or prepared by select_quartile_elements()!
 StatsQuartiles StatsVariable::quartiles(const std::vector<StatsValue> &vec)
 {
 	int s = (int)vec.size();
@@ -471,7 +726,8 @@ StatsQuartiles StatsVariable::quartiles(const std::vector<StatsValue> &vec)
 StatsOperationResults StatsVariable::applyOperations(const std::vector<dive *> &dives) const
 {
 	StatsOperationResults res;
-	std::vector<StatsValue> val = values(dives);
+	std::vector<StatsValue> val = unsortedValues(dives);
+	select_quartile_elements(val);
 
 	double sumTime = 0.0;
 	res.dives.reserve(val.size());
@@ -527,9 +783,14 @@ std::vector<StatsScatterItem> StatsVariable::scatter(const StatsVariable &t2, co
 {
 	std::vector<StatsScatterItem> res;
 	res.reserve(dives.size());
-	for (dive *d: dives) {
-		double v1 = toFloat(d);
-		double v2 = t2.toFloat(d);
+	StatsValueCache &cache = get_value_cache();
+	StatsCacheColumn<double> &col1 = value_columns[this];
+	StatsCacheColumn<double> &col2 = value_columns[&t2];
+	std::vector<int> rows = cache.rows(dives);
+	for (size_t i = 0; i < dives.size(); ++i) {
+		dive *d = dives[i];
+		double v1 = col1.get(cache, rows[i], d, [this](const dive *d) { return toFloat(d); });
+		double v2 = col2.get(cache, rows[i], d, [&t2](const dive *d) { return t2.toFloat(d); });
 		if (is_invalid_value(v1) || is_invalid_value(v2))
 			continue;
 		res.push_back({ v1, v2, d });
@@ -631,6 +892,8 @@ public:
 	const Bin &derived_bin(const StatsBin &bin) const {
 		return dynamic_cast<const Bin &>(bin);
 	}
+private:
+	mutable StatsCacheColumn<Type> cache;
 };
 
 // Wrapper around std::lower_bound that searches for a value in a
@@ -692,8 +955,12 @@ std::vector<StatsBinDives> SimpleBinner<Binner, Bin>::bin_dives(const std::vecto
 	// out of that. I wonder if that is premature optimization?
 	using Pair = std::pair<Type, std::vector<dive *>>;
 	std::vector<Pair> value_bins;
-	for (dive *d: dives) {
-		Type value = derived().to_bin_value(d);
+	StatsValueCache &value_cache = get_value_cache();
+	std::vector<int> rows = value_cache.rows(dives);
+	for (size_t i = 0; i < dives.size(); ++i) {
+		dive *d = dives[i];
+		const Type &value = cache.get(value_cache, rows[i], d,
+					      [this](const dive *d) { return derived().to_bin_value(d); });
 		if (is_invalid_value(value))
 			continue;
 		register_bin_value(value_bins, value,
@@ -806,6 +1073,8 @@ public:
 	const Bin &derived_bin(const StatsBin &bin) const {
 		return dynamic_cast<const Bin &>(bin);
 	}
+private:
+	mutable StatsCacheColumn<std::vector<Type>> cache;
 };
 
 template<typename Binner, typename Bin>
@@ -815,8 +1084,13 @@ std::vector<StatsBinDives> MultiBinner<Binner, Bin>::bin_dives(const std::vector
 	// out of that. I wonder if that is premature optimization?
 	using Pair = std::pair<Type, std::vector<dive *>>;
 	std::vector<Pair> value_bins;
-	for (dive *d: dives) {
-		for (const Type &val: derived().to_bin_values(d)) {
+	StatsValueCache &value_cache = get_value_cache();
+	std::vector<int> rows = value_cache.rows(dives);
+	for (size_t i = 0; i < dives.size(); ++i) {
+		dive *d = dives[i];
+		const std::vector<Type> &vals = cache.get(value_cache, rows[i], d,
+							  [this](const dive *d) { return derived().to_bin_values(d); });
+		for (const Type &val: vals) {
 			if (is_invalid_value(val))
 				continue;
 			register_bin_value(value_bins, val,
@@ -959,6 +1233,9 @@ struct DateVariable : public StatsVariableTemplate<StatsVariable::Type::Continuo
 	QString name() const {
 		return StatsTranslations::tr("Date");
 	}
+	int diveFields() const override {
+		return DiveField::DATETIME;
+	}
 	double toFloat(const dive *d) const override {
 		return d->when / 86400.0;
 	}
@@ -1012,6 +1289,9 @@ struct DepthVariableBase : public StatsVariableTemplate<StatsVariable::Type::Num
 	int decimals() const override {
 		return 1;
 	}
+	int diveFields() const override {
+		return DiveField::DEPTH;
+	}
 	std::vector<const StatsBinner *> binners() const override {
 		if (prefs.units.length == units::METERS)
 			return { &meter5, &meter10, &meter20 };
@@ -1089,6 +1369,9 @@ struct DurationVariable : public StatsVariableTemplate<StatsVariable::Type::Nume
 	QString name() const override {
 		return StatsTranslations::tr("Duration");
 	}
+	int diveFields() const override {
+		return DiveField::DURATION;
+	}
 	QString unitSymbol() const override {
 		return StatsTranslations::tr("min");
 	}
@@ -1174,6 +1457,12 @@ struct SACVariable : public StatsVariableTemplate<StatsVariable::Type::Numeric>
 	QString name() const override {
 		return StatsTranslations::tr("SAC");
 	}
+	int diveFields() const override {
+		return DiveField::DEPTH | DiveField::DURATION;
+	}
+	bool usesCylinders() const override {
+		return true;
+	}
 	QString unitSymbol() const override {
 		return get_volume_unit() + StatsTranslations::tr("/min");
 	}
@@ -1264,6 +1553,9 @@ struct WaterTemperatureVariable : TemperatureVariable {
 	QString name() const override {
 		return StatsTranslations::tr("Water temperature");
 	}
+	int diveFields() const override {
+		return DiveField::WATER_TEMP;
+	}
 	double toFloat(const dive *d) const override {
 		return tempToFloat(d->watertemp);
 	}
@@ -1276,6 +1568,9 @@ struct AirTemperatureVariable : TemperatureVariable {
 	QString name() const override {
 		return StatsTranslations::tr("Air temperature");
 	}
+	int diveFields() const override {
+		return DiveField::AIR_TEMP;
+	}
 	double toFloat(const dive *d) const override {
 		return tempToFloat(d->airtemp);
 	}
@@ -1315,6 +1610,9 @@ struct WeightVariable : public StatsVariableTemplate<StatsVariable::Type::Numeri
 	QString name() const override {
 		return StatsTranslations::tr("Weight");
 	}
+	bool usesWeights() const override {
+		return true;
+	}
 	QString unitSymbol() const override {
 		return get_weight_unit();
 	}
@@ -1380,6 +1678,9 @@ struct DiveNrVariable : public StatsVariableTemplate<StatsVariable::Type::Numeri
 	QString name() const override {
 		return StatsTranslations::tr("Dive #");
 	}
+	int diveFields() const override {
+		return DiveField::NR;
+	}
 	std::vector<const StatsBinner *> binners() const override {
 		if (divelog.dives->nr > 1000)
 			return { &dive_nr_binner_20, &dive_nr_binner_50, &dive_nr_binner_100, &dive_nr_binner_200 };
@@ -1412,6 +1713,9 @@ struct DiveModeVariable : public StatsVariableTemplate<StatsVariable::Type::Disc
 	QString name() const override {
 		return StatsTranslations::tr("Dive mode");
 	}
+	int diveFields() const override {
+		return DiveField::MODE;
+	}
 	QString diveCategories(const dive *d) const override {
 		int mode = (int)d->dc.divemode;
 		return mode >= 0 && mode < NUM_DIVEMODE ?
@@ -1440,6 +1744,9 @@ struct PeopleVariable : public StatsVariableTemplate<StatsVariable::Type::Discre
 	QString name() const override {
 		return StatsTranslations::tr("People");
 	}
+	int diveFields() const override {
+		return DiveField::BUDDY | DiveField::DIVEGUIDE;
+	}
 	QString diveCategories(const dive *d) const override {
 		QString buddy = QString(d->buddy).trimmed();
 		QString diveguide = QString(d->diveguide).trimmed();
@@ -1466,6 +1773,9 @@ struct BuddyVariable : public StatsVariableTemplate<StatsVariable::Type::Discret
 	QString name() const override {
 		return StatsTranslations::tr("Buddies");
 	}
+	int diveFields() const override {
+		return DiveField::BUDDY;
+	}
 	QString diveCategories(const dive *d) const override {
 		return QString(d->buddy).trimmed();
 	}
@@ -1488,6 +1798,9 @@ struct DiveGuideVariable : public StatsVariableTemplate<StatsVariable::Type::Dis
 	QString name() const override {
 		return StatsTranslations::tr("Dive guides");
 	}
+	int diveFields() const override {
+		return DiveField::DIVEGUIDE;
+	}
 	QString diveCategories(const dive *d) const override {
 		return QString(d->diveguide).trimmed();
 	}
@@ -1512,6 +1825,9 @@ struct TagVariable : public StatsVariableTemplate<StatsVariable::Type::Discrete>
 	QString name() const override {
 		return StatsTranslations::tr("Tags");
 	}
+	int diveFields() const override {
+		return DiveField::TAGS;
+	}
 	QString diveCategories(const dive *d) const override {
 		return get_taglist_string(d->tag_list);
 	}
@@ -1616,6 +1932,9 @@ struct GasTypeVariable : public StatsVariableTemplate<StatsVariable::Type::Discr
 	QString name() const override {
 		return StatsTranslations::tr("Gas type");
 	}
+	bool usesCylinders() const override {
+		return true;
+	}
 	QString diveCategories(const dive *d) const override {
 		QString res;
 		std::vector<gasmix> mixes;	// List multiple cylinders only once
@@ -1693,6 +2012,9 @@ struct GasContentVariable : public StatsVariableTemplate<StatsVariable::Type::Nu
 		he(he), max_he(max_he)
 	{
 	}
+	bool usesCylinders() const override {
+		return true;
+	}
 	std::vector<const StatsBinner *> binners() const override {
 		return { &b1, &b2, &b3, &b4 };
 	}
@@ -1755,6 +2077,9 @@ struct SuitVariable : public StatsVariableTemplate<StatsVariable::Type::Discrete
 	QString name() const override {
 		return StatsTranslations::tr("Suit type");
 	}
+	int diveFields() const override {
+		return DiveField::SUIT;
+	}
 	QString diveCategories(const dive *d) const override {
 		return QString(d->suit);
 	}
@@ -1785,6 +2110,9 @@ struct WeightsystemVariable : public StatsVariableTemplate<StatsVariable::Type::
 	QString name() const override {
 		return StatsTranslations::tr("Weightsystem");
 	}
+	bool usesWeights() const override {
+		return true;
+	}
 	QString diveCategories(const dive *d) const override {
 		return join_strings(weightsystems(d));
 	}
@@ -1815,6 +2143,9 @@ struct CylinderTypeVariable : public StatsVariableTemplate<StatsVariable::Type::
 	QString name() const override {
 		return StatsTranslations::tr("Cylinder type");
 	}
+	bool usesCylinders() const override {
+		return true;
+	}
 	QString diveCategories(const dive *d) const override {
 		return join_strings(cylinder_types(d));
 	}
@@ -1841,6 +2172,9 @@ struct LocationVariable : public StatsVariableTemplate<StatsVariable::Type::Disc
 	QString name() const override {
 		return StatsTranslations::tr("Dive site");
 	}
+	int diveFields() const override {
+		return DiveField::DIVESITE;
+	}
 	QString diveCategories(const dive *d) const override {
 		return DiveSiteWrapper(d->dive_site).format();
 	}
@@ -1867,6 +2201,9 @@ struct TripVariable : public StatsVariableTemplate<StatsVariable::Type::Discrete
 	QString name() const override {
 		return StatsTranslations::tr("Dive trip");
 	}
+	bool usesTrip() const override {
+		return true;
+	}
 	QString diveCategories(const dive *d) const override {
 		return formatTripTitle(d->divetrip);
 	}
@@ -1891,6 +2228,9 @@ struct DayOfWeekVariable : public StatsVariableTemplate<StatsVariable::Type::Dis
 	QString name() const override {
 		return StatsTranslations::tr("Day of week");
 	}
+	int diveFields() const override {
+		return DiveField::DATETIME;
+	}
 	QString diveCategories(const dive *d) const override {
 		return formatDayOfWeek(utc_weekday(d->when));
 	}
@@ -1916,6 +2256,9 @@ struct RatingVariable : public StatsVariableTemplate<StatsVariable::Type::Discre
 	QString name() const override {
 		return StatsTranslations::tr("Rating");
 	}
+	int diveFields() const override {
+		return DiveField::RATING;
+	}
 	QString diveCategories(const dive *d) const override {
 		int rating = (int)d->rating;
 		return QString("🌟").repeated(rating);
@@ -1942,6 +2285,9 @@ struct VisibilityVariable : public StatsVariableTemplate<StatsVariable::Type::Di
 	QString name() const override {
 		return StatsTranslations::tr("Visibility");
 	}
+	int diveFields() const override {
+		return DiveField::VISIBILITY;
+	}
 	QString diveCategories(const dive *d) const override {
 		int viz = (int)d->visibility;
 		return QString("🌟").repeated(viz);
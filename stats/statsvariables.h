@@ -123,6 +123,11 @@ struct StatsVariable {
 	virtual int decimals() const; // For numeric variables: numbers of decimals to display on axes. Defaults to 0.
 	virtual std::vector<const StatsBinner *> binners() const = 0; // Note: may depend on current locale!
 	virtual QString diveCategories(const dive *d) const; // Only for discrete variables
+	// The dive data a variable depends on. Used to decide whether edited dives require a replot.
+	virtual int diveFields() const; // DiveField flags - by default none
+	virtual bool usesCylinders() const; // Defaults to false
+	virtual bool usesWeights() const; // Defaults to false
+	virtual bool usesTrip() const; // Defaults to false
 	std::vector<StatsBinQuartiles> bin_quartiles(const StatsBinner &binner, const std::vector<dive *> &dives, bool fill_empty) const;
 	std::vector<StatsBinOp> bin_operations(const StatsBinner &binner, const std::vector<dive *> &dives, bool fill_empty) const;
 	std::vector<StatsBinValues> bin_values(const StatsBinner &binner, const std::vector<dive *> &dives, bool fill_empty) const;
@@ -134,18 +139,24 @@ struct StatsVariable {
 	StatsOperation idxToOperation(int idx) const;
 	static QString operationName(StatsOperation);
 	double mean(const std::vector<dive *> &dives) const; // Returns NaN for empty list
-	static StatsQuartiles quartiles(const std::vector<StatsValue> &values); // Returns invalid quartiles for empty list
+	static StatsQuartiles quartiles(const std::vector<StatsValue> &values); // Expects sorted values. Returns invalid quartiles for empty list
 	StatsQuartiles quartiles(const std::vector<dive *> &dives) const; // Only for numeric variables
 	std::vector<StatsValue> values(const std::vector<dive *> &dives) const; // Only for numeric variables
 	QString valueWithUnit(const dive *d) const; // Only for numeric variables
 	std::vector<StatsScatterItem> scatter(const StatsVariable &t2, const std::vector<dive *> &dives) const;
+	StatsOperationResults applyOperations(const std::vector<dive *> &dives) const; // Only for numeric variables
 private:
 	virtual double toFloat(const struct dive *d) const; // For numeric variables - if dive doesn't have that value, returns NaN
-	StatsOperationResults applyOperations(const std::vector<dive *> &dives) const;
+	double value(const struct dive *d) const; // Cached version of toFloat()
+	std::vector<StatsValue> unsortedValues(const std::vector<dive *> &dives) const;
 };
 
 extern const std::vector<const StatsVariable *> stats_variables;
 
+// The values of the variables are cached. The cache listens to the DiveListNotifier
+// and therefore must be created before any user of the variables connects to it.
+extern void initStatsCache();
+
 // Helper function for date-based variables
 extern double date_to_double(int year, int month, int day);
 
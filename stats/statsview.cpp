@@ -17,6 +17,7 @@
 #include "statsvariables.h"
 #include "zvalues.h"
 #include "core/divefilter.h"
+#include "core/divesite.h"
 #include "core/subsurface-qt/divelistnotifier.h"
 #include "core/selection.h"
 #include "core/trip.h"
@@ -28,12 +29,32 @@
 #include <QSGImageNode>
 #include <QSGRectangleNode>
 #include <QSGTexture>
+#include <QTimer>
 
 // Constants that control the graph layouts
 static const double sceneBorder = 5.0;			// Border between scene edges and statitistics view
 static const double titleBorder = 2.0;			// Border between title and chart
 static const double selectionLassoWidth = 2.0;		// Border between title and chart
 
+const double NaN = std::numeric_limits<double>::quiet_NaN();
+
+// The data of a chart consisting of one bar per bin. See updateBars().
+struct StatsView::BinnedBars {
+	BarSeries *series;
+	const StatsVariable *categoryVariable;
+	const StatsBinner *binner;
+	const StatsVariable *valueVariable;	// Null for count based charts
+	StatsOperation operation;		// Only for value based charts
+	bool isHorizontal;
+	bool isHistogram;			// Bars are positioned according to the bounds of the bins
+	std::vector<StatsBinPtr> bins;
+	std::vector<std::vector<dive *>> dives;	// For each bin
+	std::vector<double> values;		// For each bin: the height of the bar, NaN if there is no bar
+	int total;				// Number of dives in all bins
+	double lowerBound(int bin) const;
+	void setValueBins(std::vector<StatsBinOp> &categoryBins);
+};
+
 StatsView::StatsView(QQuickItem *parent) : QQuickItem(parent),
 	backgroundDirty(true),
 	currentTheme(&getStatsTheme(false)),
@@ -41,17 +62,38 @@ StatsView::StatsView(QQuickItem *parent) : QQuickItem(parent),
 	xAxis(nullptr),
 	yAxis(nullptr),
 	draggedItem(nullptr),
+	replotPending(false),
 	restrictDives(false),
 	rootNode(nullptr)
 {
 	setFlag(ItemHasContents, true);
 
+	// Make sure that the value cache is updated before we replot
+	initStatsCache();
+
 	connect(&diveListNotifier, &DiveListNotifier::numShownChanged, this, &StatsView::replotIfVisible);
 	connect(&diveListNotifier, &DiveListNotifier::divesAdded, this, &StatsView::replotIfVisible);
 	connect(&diveListNotifier, &DiveListNotifier::divesDeleted, this, &StatsView::replotIfVisible);
+	connect(&diveListNotifier, &DiveListNotifier::divesBulkChanged, this, &StatsView::replotIfVisible);
 	connect(&diveListNotifier, &DiveListNotifier::dataReset, this, &StatsView::replotIfVisible);
 	connect(&diveListNotifier, &DiveListNotifier::settingsChanged, this, &StatsView::replotIfVisible);
 	connect(&diveListNotifier, &DiveListNotifier::divesSelected, this, &StatsView::divesSelected);
+	connect(&diveListNotifier, &DiveListNotifier::divesChanged, this, &StatsView::divesChanged);
+	connect(&diveListNotifier, &DiveListNotifier::divesTimeChanged, this,
+		[this](timestamp_t, const QVector<dive *> &dives) { divesChanged(dives, DiveField::DATETIME); });
+	connect(&diveListNotifier, &DiveListNotifier::cylindersReset, this, &StatsView::cylindersChanged);
+	connect(&diveListNotifier, &DiveListNotifier::cylinderAdded, this, [this](dive *d) { cylindersChanged({ d }); });
+	connect(&diveListNotifier, &DiveListNotifier::cylinderRemoved, this, [this](dive *d) { cylindersChanged({ d }); });
+	connect(&diveListNotifier, &DiveListNotifier::cylinderEdited, this, [this](dive *d) { cylindersChanged({ d }); });
+	connect(&diveListNotifier, &DiveListNotifier::weightsystemsReset, this, &StatsView::weightsChanged);
+	connect(&diveListNotifier, &DiveListNotifier::weightAdded, this, [this](dive *d) { weightsChanged({ d }); });
+	connect(&diveListNotifier, &DiveListNotifier::weightRemoved, this, [this](dive *d) { weightsChanged({ d }); });
+	connect(&diveListNotifier, &DiveListNotifier::weightEdited, this, [this](dive *d) { weightsChanged({ d }); });
+	connect(&diveListNotifier, &DiveListNotifier::divesMovedBetweenTrips, this,
+		[this](dive_trip *, dive_trip *, bool, bool, const QVector<dive *> &dives) { tripsChanged(dives); });
+	connect(&diveListNotifier, &DiveListNotifier::tripChanged, this, &StatsView::tripChanged);
+	connect(&diveListNotifier, &DiveListNotifier::diveSiteChanged, this,
+		[this](dive_site *ds) { diveSiteChanged(ds); });
 
 	setAcceptHoverEvents(true);
 	setAcceptedMouseButtons(Qt::LeftButton);
@@ -393,6 +435,101 @@ void StatsView::replotIfVisible()
 		plot(state);
 }
 
+// Check whether a dive is part of the chart
+bool StatsView::plotsDive(const dive *d) const
+{
+	if (d->hidden_by_filter)
+		return false;
+	return !restrictDives || std::binary_search(restrictedDives.begin(), restrictedDives.end(), d);
+}
+
+bool StatsView::plotsAnyDive(const QVector<dive *> &dives) const
+{
+	return std::any_of(dives.begin(), dives.end(), [this](const dive *d) { return plotsDive(d); });
+}
+
+// Check whether any of the plotted variables depends on some dive data
+bool StatsView::plotsVariable(bool (StatsVariable::*uses)() const) const
+{
+	return (state.var1 && (state.var1->*uses)()) ||
+	       (state.var2 && (state.var2->*uses)());
+}
+
+void StatsView::replotLater()
+{
+	if (replotPending || !isVisible())
+		return;
+	replotPending = true;
+	QTimer::singleShot(0, this, [this]() {
+		replotPending = false;
+		replotIfVisible();
+	});
+}
+
+void StatsView::updateDives(const QVector<dive *> &dives)
+{
+	if (replotPending || !isVisible())
+		return;
+	if (binnedBars && updateBars(dives))
+		update();
+	else
+		replotLater();
+}
+
+void StatsView::divesChanged(const QVector<dive *> &dives, DiveField field)
+{
+	int fields = (state.var1 ? state.var1->diveFields() : 0) |
+		     (state.var2 ? state.var2->diveFields() : 0);
+	if ((field.flags() & fields) && plotsAnyDive(dives))
+		updateDives(dives);
+}
+
+void StatsView::cylindersChanged(const QVector<dive *> &dives)
+{
+	if (plotsVariable(&StatsVariable::usesCylinders) && plotsAnyDive(dives))
+		updateDives(dives);
+}
+
+void StatsView::weightsChanged(const QVector<dive *> &dives)
+{
+	if (plotsVariable(&StatsVariable::usesWeights) && plotsAnyDive(dives))
+		updateDives(dives);
+}
+
+void StatsView::tripsChanged(const QVector<dive *> &dives)
+{
+	if (plotsVariable(&StatsVariable::usesTrip) && plotsAnyDive(dives))
+		updateDives(dives);
+}
+
+// Renaming a trip or a dive site changes the labels and may change the order of the bins. Therefore, replot.
+void StatsView::tripChanged(dive_trip *trip)
+{
+	if (!plotsVariable(&StatsVariable::usesTrip))
+		return;
+	for (int i = 0; i < trip->dives.nr; ++i) {
+		if (plotsDive(trip->dives.dives[i])) {
+			replotLater();
+			return;
+		}
+	}
+}
+
+
+void StatsView::diveSiteChanged(dive_site *ds)
+{
+	int fields = (state.var1 ? state.var1->diveFields() : 0) |
+		     (state.var2 ? state.var2->diveFields() : 0);
+	if (!(fields & DiveField::DIVESITE))
+		return;
+	for (int i = 0; i < ds->dives.nr; ++i) {
+		if (plotsDive(ds->dives.dives[i])) {
+			replotLater();
+			return;
+		}
+	}
+}
+
 void StatsView::divesSelected(const QVector<dive *> &dives)
 {
 	if (isVisible()) {
@@ -513,6 +650,7 @@ void StatsView::reset()
 	series.clear();
 	quartileMarkers.clear();
 	grid.reset();
+	binnedBars.reset();
 }
 
 void StatsView::restrictToSelection()
@@ -726,6 +864,118 @@ static std::vector<BarSeries::MultiItem::Item> makeMultiItems(std::vector<std::v
 	return res;
 }
 
+double StatsView::BinnedBars::lowerBound(int bin) const
+{
+	return isHistogram ? binner->lowerBoundToFloat(*bins[bin]) : bin - 0.5;
+}
+
+static double getMaxBarValue(const std::vector<double> &values)
+{
+	double res = 0.0;
+	for (double v: values) {
+		if (!std::isnan(v) && v > res)
+			res = v;
+	}
+	return res;
+}
+
+// Move the edited dives between the bins and update the bars of the concerned bins.
+// If a bin has to be added or removed or if the range of the value axis changes,
+// give up and let the caller replot the chart.
+bool StatsView::updateBars(const QVector<dive *> &dives)
+{
+	BinnedBars &b = *binnedBars;
+	std::vector<unsigned char> changed(b.bins.size(), false);
+	for (dive *d: dives) {
+		std::vector<int> oldBins, newBins;
+		for (size_t i = 0; i < b.bins.size(); ++i) {
+			if (std::find(b.dives[i].begin(), b.dives[i].end(), d) != b.dives[i].end())
+				oldBins.push_back((int)i);
+		}
+		if (plotsDive(d)) {
+			for (auto &[bin, dummy]: b.binner->bin_dives({ d }, false)) {
+				StatsBin &newBin = *bin;
+				auto it = std::find_if(b.bins.begin(), b.bins.end(),
+						       [&newBin](const StatsBinPtr &p) { return *p == newBin; });
+				if (it == b.bins.end())
+					return false; // Dive moved into a new bin
+				newBins.push_back((int)(it - b.bins.begin()));
+			}
+		}
+		for (int i: oldBins) {
+			if (std::find(newBins.begin(), newBins.end(), i) == newBins.end()) {
+				std::vector<dive *> &v = b.dives[i];
+				v.erase(std::find(v.begin(), v.end(), d));
+			}
+			changed[i] = true;
+		}
+		for (int i: newBins) {
+			if (std::find(oldBins.begin(), oldBins.end(), i) == oldBins.end())
+				b.dives[i].push_back(d);
+			changed[i] = true;
+		}
+	}
+
+	// Recalculate the values of the concerned bins
+	double oldMax = getMaxBarValue(b.values);
+	std::vector<StatsOperationResults> res(b.bins.size());
+	int total = 0;
+	for (size_t i = 0; i < b.bins.size(); ++i) {
+		total += (int)b.dives[i].size();
+		if (!changed[i])
+			continue;
+		if (std::isnan(b.values[i]))
+			return false; // A new bar appears
+		if (b.valueVariable) {
+			res[i] = b.valueVariable->applyOperations(b.dives[i]);
+			b.values[i] = res[i].isValid() ? res[i].get(b.operation) : NaN;
+		} else {
+			b.values[i] = b.dives[i].empty() ? NaN : (double)b.dives[i].size();
+		}
+		if (std::isnan(b.values[i]))
+			return false; // The bar vanishes
+	}
+	if (getMaxBarValue(b.values) != oldMax)
+		return false; // The value axis changes
+
+	// For count based charts, the labels show percentages. If the
+	// total number of dives changed, all labels have to be updated.
+	bool updateAll = !b.valueVariable && total != b.total;
+	b.total = total;
+	int decimals = b.valueVariable ? b.valueVariable->decimals() : 0;
+	for (size_t i = 0; i < b.bins.size(); ++i) {
+		if ((!changed[i] && !updateAll) || std::isnan(b.values[i]))
+			continue;
+		std::vector<QString> label = b.valueVariable ?
+			std::vector<QString> { QString("%L1").arg(b.values[i], 0, 'f', decimals) } :
+			makePercentageLabels((int)b.dives[i].size(), total, b.isHorizontal);
+		if (!b.series->updateItem(b.lowerBound((int)i), b.values[i], b.dives[i], label, res[i],
+					  b.valueVariable ? -1 : total))
+			return false;
+	}
+
+	// The mean and median markers of histograms depend on all dives
+	if (meanMarker || medianMarker) {
+		std::vector<dive *> all;
+		all.reserve(total);
+		for (const std::vector<dive *> &v: b.dives)
+			all.insert(all.end(), v.begin(), v.end());
+		if (meanMarker) {
+			double mean = b.categoryVariable->mean(all);
+			if (std::isnan(mean))
+				return false;
+			meanMarker->setValue(mean);
+		}
+		if (medianMarker) {
+			double median = b.categoryVariable->quartiles(all).q2;
+			if (std::isnan(median))
+				return false;
+			medianMarker->setValue(median);
+		}
+	}
+	return true;
+}
+
 void StatsView::plotBarChart(const std::vector<dive *> &dives,
 			     ChartSubType subType, ChartSortMode sortMode,
 			     const StatsVariable *categoryVariable, const StatsBinner *categoryBinner,
@@ -778,8 +1028,6 @@ void StatsView::plotBarChart(const std::vector<dive *> &dives,
 	createSeries<BarSeries>(isHorizontal, isStacked, categoryVariable->name(), valueVariable, std::move(data.vbinNames), std::move(items));
 }
 
-const double NaN = std::numeric_limits<double>::quiet_NaN();
-
 // These templates are used to extract min and max y-values of various lists.
 // A bit too convoluted for my tastes - can we make that simpler?
 static std::pair<double, double> getMinMaxValueBase(const std::vector<StatsValue> &values)
@@ -844,6 +1092,18 @@ static std::pair<double, double> getMinMaxValue(const std::vector<StatsBinOp> &b
 	return found ? std::make_pair(min, max) : std::make_pair(0.0, 0.0);
 }
 
+// Remember the bins of a value based bar chart for incremental updates.
+// Attention: this moves away the bins and the dives.
+void StatsView::BinnedBars::setValueBins(std::vector<StatsBinOp> &categoryBins)
+{
+	for (auto &[bin, res]: categoryBins) {
+		values.push_back(res.isValid() ? res.get(operation) : NaN);
+		total += (int)res.dives.size();
+		bins.push_back(std::move(bin));
+		dives.push_back(std::move(res.dives));
+	}
+}
+
 void StatsView::plotValueChart(const std::vector<dive *> &dives,
 			       ChartSubType subType, ChartSortMode sortMode,
 			       const StatsVariable *categoryVariable, const StatsBinner *categoryBinner,
@@ -899,7 +1159,14 @@ void StatsView::plotValueChart(const std::vector<dive *> &dives,
 		pos += 1.0;
 	}
 
-	createSeries<BarSeries>(isHorizontal, categoryVariable->name(), valueVariable, std::move(items));
+	BarSeries *series = createSeries<BarSeries>(isHorizontal, categoryVariable->name(), valueVariable, std::move(items));
+
+	// Sorted charts are replotted on change, since the order of the bins might change
+	if (sortMode == ChartSortMode::Bin) {
+		binnedBars = std::make_unique<BinnedBars>(BinnedBars{ series, categoryVariable, categoryBinner, valueVariable,
+								      valueAxisOperation, isHorizontal, false, {}, {}, {}, 0 });
+		binnedBars->setValueBins(categoryBins);
+	}
 }
 
 static int getTotalCount(const std::vector<StatsBinDives> &bins)
@@ -965,7 +1232,18 @@ void StatsView::plotDiscreteCountChart(const std::vector<dive *> &dives,
 		pos += 1.0;
 	}
 
-	createSeries<BarSeries>(isHorizontal, categoryVariable->name(), std::move(items));
+	BarSeries *series = createSeries<BarSeries>(isHorizontal, categoryVariable->name(), std::move(items));
+
+	// Sorted charts are replotted on change, since the order of the bins might change
+	if (sortMode == ChartSortMode::Bin) {
+		binnedBars = std::make_unique<BinnedBars>(BinnedBars{ series, categoryVariable, categoryBinner, nullptr,
+								      StatsOperation::Invalid, isHorizontal, false, {}, {}, {}, total });
+		for (auto &[bin, dives]: categoryBins) {
+			binnedBars->values.push_back((double)dives.size());
+			binnedBars->bins.push_back(std::move(bin));
+			binnedBars->dives.push_back(std::move(dives));
+		}
+	}
 }
 
 void StatsView::plotPieChart(const std::vector<dive *> &dives, ChartSortMode sortMode,
@@ -1122,18 +1400,23 @@ void StatsView::plotHistogramCountChart(const std::vector<dive *> &dives,
 
 	std::vector<BarSeries::CountItem> items;
 	items.reserve(categoryBins.size());
+	binnedBars = std::make_unique<BinnedBars>(BinnedBars{ nullptr, categoryVariable, categoryBinner, nullptr,
+							      StatsOperation::Invalid, isHorizontal, true, {}, {}, {}, total });
 
-	// Attention: this moves away the dives
+	// Attention: this moves away the bins
 	for (auto &[bin, dives]: categoryBins) {
 		double lowerBound = categoryBinner->lowerBoundToFloat(*bin);
 		double upperBound = categoryBinner->upperBoundToFloat(*bin);
 		std::vector<QString> label = makePercentageLabels((int)dives.size(), total, isHorizontal);
 
-		items.push_back({ lowerBound, upperBound, std::move(dives), std::move(label),
+		items.push_back({ lowerBound, upperBound, dives, std::move(label),
 				  categoryBinner->formatWithUnit(*bin), total });
+		binnedBars->values.push_back(dives.empty() ? NaN : (double)dives.size());
+		binnedBars->bins.push_back(std::move(bin));
+		binnedBars->dives.push_back(std::move(dives));
 	}
 
-	createSeries<BarSeries>(isHorizontal, categoryVariable->name(), std::move(items));
+	binnedBars->series = createSeries<BarSeries>(isHorizontal, categoryVariable->name(), std::move(items));
 
 	if (categoryVariable->type() == StatsVariable::Type::Numeric) {
 		double mean = categoryVariable->mean(dives);
@@ -1192,7 +1475,10 @@ void StatsView::plotHistogramValueChart(const std::vector<dive *> &dives,
 				  categoryBinner->formatWithUnit(*bin), res });
 	}
 
-	createSeries<BarSeries>(isHorizontal, categoryVariable->name(), valueVariable, std::move(items));
+	BarSeries *series = createSeries<BarSeries>(isHorizontal, categoryVariable->name(), valueVariable, std::move(items));
+	binnedBars = std::make_unique<BinnedBars>(BinnedBars{ series, categoryVariable, categoryBinner, valueVariable,
+							      valueAxisOperation, isHorizontal, true, {}, {}, {}, 0 });
+	binnedBars->setValueBins(categoryBins);
 }
 
 void StatsView::plotHistogramStackedChart(const std::vector<dive *> &dives,
@@ -1305,20 +1591,20 @@ static struct regression_data linear_regression(const std::vector<StatsScatterIt
 	ret.n = v.size();
 	if (ret.n < 2)
 		return ret;
-	// First, calculate the x and y average
+	// Calculate the averages and the (co)variance sums in a single pass.
+	// The running updates avoid the cancellation of naive sums of squares.
 	double avg_x = 0.0, avg_y = 0.0;
-	for (auto [x, y, d]: v) {
-		avg_x += x;
-		avg_y += y;
-	}
-	avg_x /= ret.n;
-	avg_y /= ret.n;
-
 	double cov = 0.0, sx2 = 0.0, sy2 = 0.0;
+	int n = 0;
 	for (auto [x, y, d]: v) {
-		cov += (x - avg_x) * (y - avg_y);
-		sx2 += (x - avg_x) * (x - avg_x);
-		sy2 += (y - avg_y) * (y - avg_y);
+		++n;
+		double dx = x - avg_x;
+		double dy = y - avg_y;
+		avg_x += dx / n;
+		avg_y += dy / n;
+		cov += dx * (y - avg_y);
+		sx2 += dx * (x - avg_x);
+		sy2 += dy * (y - avg_y);
 	}
 
 	bool is_linear = is_linear_regression((int)v.size(), cov, sx2, sy2);
@@ -1330,8 +1616,8 @@ static struct regression_data linear_regression(const std::vector<StatsScatterIt
 	ret.a = cov / sx2;
 	ret.b = avg_y - ret.a * avg_x;
 
-	for (auto [x, y, d]: v)
-		ret.res2 += (y - ret.a * x - ret.b) * (y - ret.a * x - ret.b);
+	// The sum of the squared residuals follows from the sums above
+	ret.res2 = std::max(sy2 - ret.a * cov, 0.0);
 	ret.r2 = sy2 > 0.0 ? 1.0 - ret.res2 / sy2 : 1.0;
 	return ret;
 }
@@ -11,6 +11,9 @@
 #include <QQuickItem>
 
 struct dive;
+struct dive_site;
+struct dive_trip;
+struct DiveField;
 struct StatsBinner;
 struct StatsBin;
 struct StatsState;
@@ -74,6 +77,27 @@ private slots:
 	void replotIfVisible();
 	void divesSelected(const QVector<dive *> &dives);
 private:
+	// Edits are only considered if they concern the plotted dives and variables
+	void divesChanged(const QVector<dive *> &dives, DiveField field);
+	void cylindersChanged(const QVector<dive *> &dives);
+	void weightsChanged(const QVector<dive *> &dives);
+	void tripsChanged(const QVector<dive *> &dives);
+	void tripChanged(dive_trip *trip);
+	void diveSiteChanged(dive_site *ds);
+	bool plotsDive(const dive *d) const;
+	bool plotsAnyDive(const QVector<dive *> &dives) const;
+	bool plotsVariable(bool (StatsVariable::*uses)() const) const;
+	void updateDives(const QVector<dive *> &dives); // Updates the chart incrementally, if possible
+	void replotLater(); // Combines multiple edits into a single replot
+	bool replotPending;
+
+	// Charts with one bar per bin (count and value based bar charts and histograms)
+	// are updated incrementally: edited dives are moved between the bins and only
+	// the bars of the concerned bins are updated. For that, the bins are kept.
+	struct BinnedBars;
+	std::unique_ptr<BinnedBars> binnedBars; // Null if the chart doesn't support incremental updates
+	bool updateBars(const QVector<dive *> &dives); // Returns false if the chart has to be replotted
+
 	// QtQuick related things
 	bool backgroundDirty;
 	QRectF plotRect;
@@ -0,0 +1,337 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "testdownload.h"
+#include "core/dive.h"
+#include "core/divelist.h"
+#include "core/divelog.h"
+#include "core/downloadfromdcthread.h"
+#include "core/libdivecomputer.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryFile>
+#include <QDebug>
+#include <libdivecomputer/iostream.h>
+
+// A libdivecomputer logfile as it is written by the download dialog
+static const char replay_log[] =
+	"Subsurface: v5.0.0, built with libdivecomputer v0.8.0-devel\n"
+	"[0.000123] INFO: Write: size=3, data=A5B6C7\n"
+	"[0.010456] INFO: Read: size=4, data=01020304\n"
+	"[0.020789] INFO: Read: size=2, data=0506\n"
+	"[0.030012] INFO: Sleep: value=100\n";
+
+static const timestamp_t dive_when = 1600000000;
+
+static void add_test_dive(const char *model, uint32_t deviceid, uint32_t diveid, timestamp_t when = dive_when)
+{
+	struct dive *d = alloc_dive();
+	d->when = d->dc.when = when;
+	d->dc.model = strdup(model);
+	d->dc.deviceid = deviceid;
+	d->dc.diveid = diveid;
+	record_dive_to_table(d, divelog.dives);
+}
+
+static void write_replay_log(QTemporaryFile &f)
+{
+	QVERIFY(f.open());
+	f.write(replay_log);
+	f.close();
+}
+
+void TestDownload::init()
+{
+	add_test_dive("Suunto EON Steel", 0x1234, 0xabcd);
+}
+
+void TestDownload::cleanup()
+{
+	clear_dive_file_data();
+}
+
+void TestDownload::replayReads()
+{
+	QTemporaryFile f;
+	write_replay_log(f);
+	QByteArray filename = f.fileName().toUtf8();
+
+	device_data_t data = {};
+	data.replay_file = filename.constData();
+
+	dc_iostream_t *iostream;
+	QCOMPARE(replay_open(&iostream, NULL, &data), DC_STATUS_SUCCESS);
+
+	// Writes are accepted and dropped
+	unsigned char buf[16];
+	size_t actual;
+	QCOMPARE(dc_iostream_write(iostream, buf, 3, &actual), DC_STATUS_SUCCESS);
+	QCOMPARE(actual, (size_t)3);
+
+	// Reads never cross the boundary of a recorded chunk
+	QCOMPARE(dc_iostream_read(iostream, buf, 3, &actual), DC_STATUS_SUCCESS);
+	QCOMPARE(actual, (size_t)3);
+	QCOMPARE(buf[0], (unsigned char)0x01);
+	QCOMPARE(buf[2], (unsigned char)0x03);
+	QCOMPARE(dc_iostream_read(iostream, buf, sizeof(buf), &actual), DC_STATUS_SUCCESS);
+	QCOMPARE(actual, (size_t)1);
+	QCOMPARE(buf[0], (unsigned char)0x04);
+	QCOMPARE(dc_iostream_read(iostream, buf, sizeof(buf), &actual), DC_STATUS_SUCCESS);
+	QCOMPARE(actual, (size_t)2);
+	QCOMPARE(buf[1], (unsigned char)0x06);
+
+	// At the end of the recording, the dive computer doesn't answer anymore
+	QCOMPARE(dc_iostream_read(iostream, buf, sizeof(buf), &actual), DC_STATUS_TIMEOUT);
+	QCOMPARE(actual, (size_t)0);
+
+	dc_iostream_close(iostream);
+}
+
+void TestDownload::replayLatency()
+{
+	QTemporaryFile f;
+	write_replay_log(f);
+	QByteArray filename = f.fileName().toUtf8();
+
+	device_data_t data = {};
+	data.replay_file = filename.constData();
+	data.replay_latency = 50;
+
+	dc_iostream_t *iostream;
+	QCOMPARE(replay_open(&iostream, NULL, &data), DC_STATUS_SUCCESS);
+
+	unsigned char buf[16];
+	size_t actual;
+	QElapsedTimer timer;
+	timer.start();
+	QCOMPARE(dc_iostream_read(iostream, buf, sizeof(buf), &actual), DC_STATUS_SUCCESS);
+	QCOMPARE(dc_iostream_read(iostream, buf, sizeof(buf), &actual), DC_STATUS_SUCCESS);
+	QVERIFY(timer.elapsed() >= 100);
+
+	dc_iostream_close(iostream);
+}
+
+// Two dives of an OSTC 2N in the format of OSTC Tools
+static const char ostc_newer[] = SUBSURFACE_TEST_DATA "/dives/ostc_00087_04-05-2014_043m_032min.dive";
+static const char ostc_older[] = SUBSURFACE_TEST_DATA "/dives/ostc_00173_17-08-2013_027m_043min.dive";
+static const unsigned char fingerprint_newer[] = { 0x87, 0x00, 0x87, 0x00 };
+static const unsigned char fingerprint_older[] = { 0x73, 0x01, 0x73, 0x01 };
+
+// The raw dive data, as it would be downloaded, is stored at a fixed
+// offset and ends with two 0xfd bytes, see ostctools_import()
+static QByteArray ostc_raw_dive(const char *filename)
+{
+	QFile f(filename);
+	if (!f.open(QIODevice::ReadOnly))
+		return QByteArray();
+	QByteArray data = f.readAll().mid(456);
+	int end = data.indexOf("\xfd\xfd");
+	return end < 0 ? QByteArray() : data.left(end + 2);
+}
+
+template <size_t N>
+static libdc_raw_dive raw_dive(const QByteArray &data, const unsigned char (&fingerprint)[N])
+{
+	return { (const unsigned char *)data.constData(), (unsigned int)data.size(), fingerprint, (unsigned int)N };
+}
+
+static void init_ostc_download(device_data_t &data, struct divelog *log)
+{
+	data.descriptor = get_descriptor(DC_FAMILY_HW_OSTC, 2);
+	data.vendor = "Heinrichs Weikamp";
+	data.product = "OSTC 2N";
+	data.model = "Heinrichs Weikamp OSTC 2N";
+	data.log = log;
+}
+
+static const dive *newest_dive(const struct divelog &log)
+{
+	const dive *res = nullptr;
+	for (int i = 0; i < log.dives->nr; ++i) {
+		if (!res || log.dives->dives[i]->when > res->when)
+			res = log.dives->dives[i];
+	}
+	return res;
+}
+
+void TestDownload::downloadDives()
+{
+	QByteArray newer = ostc_raw_dive(ostc_newer);
+	QByteArray older = ostc_raw_dive(ostc_older);
+	QVERIFY(!newer.isEmpty() && !older.isEmpty());
+
+	struct divelog log;
+	device_data_t data = {};
+	init_ostc_download(data, &log);
+	QVERIFY(data.descriptor != nullptr);
+
+	libdc_raw_dive dives[] = { raw_dive(newer, fingerprint_newer), raw_dive(older, fingerprint_older) };
+	libdc_download_raw_dives(&data, dives, 2);
+	QCOMPARE(log.dives->nr, 2);
+
+	// The fingerprint of the newest dive is saved with the ids of the parsed dive
+	const dive *d = newest_dive(log);
+	QVERIFY(d != nullptr);
+	QVERIFY(data.fingerprint != nullptr);
+	QCOMPARE(QByteArray((const char *)data.fingerprint, data.fsize), QByteArray((const char *)fingerprint_newer, sizeof(fingerprint_newer)));
+	QCOMPARE(data.fdiveid, d->dc.diveid);
+	QCOMPARE(data.fdeviceid, d->dc.deviceid);
+	free(data.fingerprint);
+}
+
+void TestDownload::downloadStopsAtKnownDive()
+{
+	QByteArray newer = ostc_raw_dive(ostc_newer);
+	QByteArray older = ostc_raw_dive(ostc_older);
+	QVERIFY(!newer.isEmpty() && !older.isEmpty());
+
+	// The older dive was downloaded before
+	device_data_t first = {};
+	init_ostc_download(first, &divelog);
+	libdc_raw_dive known[] = { raw_dive(older, fingerprint_older) };
+	libdc_download_raw_dives(&first, known, 1);
+	QCOMPARE(divelog.dives->nr, 2);
+	free(first.fingerprint);
+
+	struct divelog log;
+	device_data_t data = {};
+	init_ostc_download(data, &log);
+	libdc_raw_dive dives[] = { raw_dive(newer, fingerprint_newer), raw_dive(older, fingerprint_older) };
+	libdc_download_raw_dives(&data, dives, 2);
+	// Only the newer dive was downloaded and it is the fingerprinted dive
+	QCOMPARE(log.dives->nr, 1);
+	QCOMPARE(QByteArray((const char *)data.fingerprint, data.fsize), QByteArray((const char *)fingerprint_newer, sizeof(fingerprint_newer)));
+	QCOMPARE(log.dives->dives[0]->dc.diveid, data.fdiveid);
+	free(data.fingerprint);
+}
+
+void TestDownload::skipUnparsableDive()
+{
+	QByteArray newer = ostc_raw_dive(ostc_newer);
+	QVERIFY(!newer.isEmpty());
+	QByteArray broken(8, '\0');
+	static const unsigned char fingerprint_broken[] = { 0xff, 0xff, 0xff, 0xff };
+
+	// The fingerprint of a dive that can't be parsed is not saved
+	struct divelog log;
+	device_data_t data = {};
+	init_ostc_download(data, &log);
+	libdc_raw_dive dives[] = { raw_dive(broken, fingerprint_broken), raw_dive(newer, fingerprint_newer) };
+	libdc_download_raw_dives(&data, dives, 2);
+	QCOMPARE(log.dives->nr, 1);
+	QCOMPARE(QByteArray((const char *)data.fingerprint, data.fsize), QByteArray((const char *)fingerprint_newer, sizeof(fingerprint_newer)));
+	free(data.fingerprint);
+}
+
+// Parse a raw dive to get the date and the device id that a download sees
+static const dive *parse_raw_dive(struct divelog &log, const QByteArray &raw)
+{
+	device_data_t data = {};
+	init_ostc_download(data, &log);
+	data.force_download = true;
+	libdc_raw_dive dives[] = { raw_dive(raw, fingerprint_older) };
+	libdc_download_raw_dives(&data, dives, 1);
+	free(data.fingerprint);
+	return log.dives->nr == 1 ? log.dives->dives[0] : nullptr;
+}
+
+void TestDownload::stopAtDownloadedDive()
+{
+	QByteArray newer = ostc_raw_dive(ostc_newer);
+	QByteArray older = ostc_raw_dive(ostc_older);
+	QVERIFY(!newer.isEmpty() && !older.isEmpty());
+	struct divelog parsed;
+	const dive *d = parse_raw_dive(parsed, older);
+	QVERIFY(d != nullptr);
+	libdc_raw_dive dives[] = { raw_dive(newer, fingerprint_newer), raw_dive(older, fingerprint_older) };
+
+	// Another dive computer that recorded the older dive
+	add_test_dive("Shearwater Perdix", 0, 0x1234, d->when);
+	// A different dive of the same dive computer at the same time.
+	// The dive ids decide, not the date.
+	add_test_dive("Heinrichs Weikamp OSTC 2N", d->dc.deviceid, 0x1234, d->when);
+	{
+		struct divelog log;
+		device_data_t data = {};
+		init_ostc_download(data, &log);
+		libdc_download_raw_dives(&data, dives, 2);
+		QCOMPARE(log.dives->nr, 2);
+		free(data.fingerprint);
+	}
+
+	// The older dive itself
+	device_data_t first = {};
+	init_ostc_download(first, &divelog);
+	libdc_raw_dive known[] = { raw_dive(older, fingerprint_older) };
+	libdc_download_raw_dives(&first, known, 1);
+	free(first.fingerprint);
+	{
+		struct divelog log;
+		device_data_t data = {};
+		init_ostc_download(data, &log);
+		libdc_download_raw_dives(&data, dives, 2);
+		QCOMPARE(log.dives->nr, 1);
+		free(data.fingerprint);
+	}
+}
+
+// The fingerprint cache contains the fingerprint, followed by the
+// device id and the dive id of the fingerprinted dive
+static QByteArray fingerprint_cache(uint32_t deviceid, uint32_t diveid)
+{
+	QByteArray res("\x11\x22\x33\x44\x55\x66", 6);
+	res.append((const char *)&deviceid, 4);
+	res.append((const char *)&diveid, 4);
+	return res;
+}
+
+void TestDownload::fingerprintOfKnownDive()
+{
+	QByteArray cache = fingerprint_cache(0x1234, 0xabcd);
+	QCOMPARE(usable_fingerprint_size((const unsigned char *)cache.constData(), cache.size()), (size_t)6);
+}
+
+void TestDownload::fingerprintOfUnknownDive()
+{
+	// If the fingerprinted dive was deleted, all dives have to be downloaded
+	QByteArray cache = fingerprint_cache(0x1234, 0xabce);
+	QCOMPARE(usable_fingerprint_size((const unsigned char *)cache.constData(), cache.size()), (size_t)0);
+	// Truncated cache file
+	QCOMPARE(usable_fingerprint_size((const unsigned char *)cache.constData(), 8), (size_t)0);
+}
+
+// Benchmark a full download from a libdivecomputer logfile. There is no
+// such recording in the test data, set SUBSURFACE_REPLAY_FILE to the logfile
+// and SUBSURFACE_REPLAY_VENDOR and SUBSURFACE_REPLAY_PRODUCT to the dive
+// computer that it was recorded with.
+void TestDownload::benchmarkReplay()
+{
+	QByteArray filename = qgetenv("SUBSURFACE_REPLAY_FILE");
+	QByteArray vendor = qgetenv("SUBSURFACE_REPLAY_VENDOR");
+	QByteArray product = qgetenv("SUBSURFACE_REPLAY_PRODUCT");
+	if (filename.isEmpty() || vendor.isEmpty() || product.isEmpty()) {
+		qDebug() << "set SUBSURFACE_REPLAY_FILE, SUBSURFACE_REPLAY_VENDOR and SUBSURFACE_REPLAY_PRODUCT to benchmark a download";
+		return;
+	}
+	fill_computer_list();
+	dc_descriptor_t *descriptor = descriptorLookup.value(QString(vendor).toLower() + QString(product).toLower());
+	QVERIFY(descriptor != nullptr);
+	QByteArray model = vendor + " " + product;
+
+	QBENCHMARK {
+		struct divelog log;
+		device_data_t data = {};
+		data.descriptor = descriptor;
+		data.vendor = vendor.constData();
+		data.product = product.constData();
+		data.model = model.constData();
+		data.devname = "";
+		data.force_download = true;
+		data.log = &log;
+		data.replay_file = filename.constData();
+		data.replay_latency = qEnvironmentVariableIntValue("SUBSURFACE_REPLAY_LATENCY");
+		data.replay_bandwidth = qEnvironmentVariableIntValue("SUBSURFACE_REPLAY_BANDWIDTH");
+		QCOMPARE(do_libdivecomputer_import(&data), (const char *)NULL);
+		QVERIFY(log.dives->nr > 0);
+	}
+}
+
+QTEST_GUILESS_MAIN(TestDownload)
@@ -0,0 +1,24 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef TESTDOWNLOAD_H
+#define TESTDOWNLOAD_H
+
+#include <QtTest>
+
+class TestDownload : public QObject {
+	Q_OBJECT
+private slots:
+	void init();
+	void cleanup();
+
+	void replayReads();
+	void replayLatency();
+	void stopAtDownloadedDive();
+	void downloadDives();
+	void downloadStopsAtKnownDive();
+	void skipUnparsableDive();
+	void fingerprintOfKnownDive();
+	void fingerprintOfUnknownDive();
+	void benchmarkReplay();
+};
+
+#endif
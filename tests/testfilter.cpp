@@ -0,0 +1,159 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "testfilter.h"
+#include "core/dive.h"
+#include "core/divelist.h"
+#include "core/divelog.h"
+#include "core/divesummarytable.h"
+#include "core/file.h"
+#include "core/filterconstraint.h"
+#include <vector>
+
+void TestFilter::initTestCase()
+{
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/abitofeverything.ssrf", &divelog), 0);
+	process_loaded_dives();
+	QVERIFY(divelog.dives->nr > 0);
+}
+
+void TestFilter::cleanupTestCase()
+{
+	clear_dive_file_data();
+}
+
+// One character per dive of the dive table: '1' if it matches, '0' if it doesn't
+static QString matchDives(const filter_constraint &c)
+{
+	QString res;
+	for (int i = 0; i < divelog.dives->nr; ++i)
+		res += filter_constraint_match_dive(c, divelog.dives->dives[i]) ? '1' : '0';
+	return res;
+}
+
+// Same as matchDives(), but like DiveFilter::showAllDives() does it: on the summary
+// table and only if that isn't possible, on the remaining dives.
+static QString matchSummary(const filter_constraint &c, const DiveSummaryTable &t)
+{
+	std::vector<unsigned char> match(t.size(), 1);
+	bool complete = filter_constraint_match_summary(c, t, match);
+	QString res;
+	for (int i = 0; i < t.size(); ++i) {
+		if (match[i] && !complete)
+			match[i] = filter_constraint_match_dive(c, t.dives[i]);
+		res += match[i] ? '1' : '0';
+	}
+	return res;
+}
+
+static QString describe(const filter_constraint &c)
+{
+	return QStringLiteral("%1 negate: %2 range mode: %3 string mode: %4")
+		.arg(filter_constraint_type_to_string(c.type))
+		.arg(c.negate)
+		.arg(filter_constraint_range_mode_to_string(c.range_mode))
+		.arg(filter_constraint_string_mode_to_string(c.string_mode));
+}
+
+// The constraints that are tested for a type: the data of the default constraint and
+// some variations of it, in all string or range modes and negated.
+static std::vector<filter_constraint> constraintsOfType(filter_constraint_type type, timestamp_t first, timestamp_t last)
+{
+	static const enum filter_constraint_string_mode stringModes[] = {
+		FILTER_CONSTRAINT_STARTS_WITH, FILTER_CONSTRAINT_SUBSTRING, FILTER_CONSTRAINT_EXACT
+	};
+	static const enum filter_constraint_range_mode rangeModes[] = {
+		FILTER_CONSTRAINT_EQUAL, FILTER_CONSTRAINT_LESS, FILTER_CONSTRAINT_GREATER, FILTER_CONSTRAINT_RANGE
+	};
+	std::vector<filter_constraint> res;
+	filter_constraint c(type);
+
+	if (filter_constraint_is_string(type)) {
+		const QStringList terms[] = { {}, { "boat" }, { "teach" }, { "Larnaca" }, { "test", "shore" }, { "AL80" } };
+		for (const QStringList &t: terms) {
+			*c.data.string_list = t;
+			for (enum filter_constraint_string_mode mode: stringModes) {
+				c.string_mode = mode;
+				res.push_back(c);
+			}
+		}
+	} else if (type == FILTER_CONSTRAINT_DIVE_MODE || type == FILTER_CONSTRAINT_DAY_OF_WEEK) {
+		for (uint64_t bits: { ~0ULL, 1ULL, 2ULL, 5ULL, 0ULL }) {
+			c.data.multiple_choice = bits;
+			res.push_back(c);
+		}
+	} else {
+		std::vector<std::pair<timestamp_t, timestamp_t>> ranges;
+		if (filter_constraint_is_timestamp(type)) {
+			timestamp_t middle = first + (last - first) / 2;
+			ranges = { { first, last }, { first, middle }, { middle, last } };
+		} else {
+			int from = c.data.numerical_range.from, to = c.data.numerical_range.to;
+			if (type == FILTER_CONSTRAINT_YEAR) {
+				from = 2010;
+				to = 2012;
+			}
+			ranges = { { from, to }, { from, from + (to - from) / 2 }, { from + (to - from) / 4, from + (to - from) / 2 } };
+		}
+		for (auto [from, to]: ranges) {
+			if (filter_constraint_is_timestamp(type)) {
+				c.data.timestamp_range.from = from;
+				c.data.timestamp_range.to = to;
+			} else {
+				c.data.numerical_range.from = (int)from;
+				c.data.numerical_range.to = (int)to;
+			}
+			for (enum filter_constraint_range_mode mode: rangeModes) {
+				c.range_mode = mode;
+				res.push_back(c);
+			}
+		}
+	}
+
+	size_t nr = res.size();
+	res.reserve(2 * nr);
+	for (size_t i = 0; i < nr; ++i) {
+		res.push_back(res[i]);
+		res.back().negate = true;
+	}
+	return res;
+}
+
+void TestFilter::testEmptyStringConstraint()
+{
+	/*
+	 * a string constraint without strings, e.g. a newly added one, matches all dives
+	 */
+	DiveSummaryTable t;
+	t.ensureUpToDate();
+	QString all(divelog.dives->nr, QChar('1'));
+	for (int type = FILTER_CONSTRAINT_DATE; type <= FILTER_CONSTRAINT_NOTES; ++type) {
+		if (!filter_constraint_is_string((filter_constraint_type)type))
+			continue;
+		filter_constraint c((filter_constraint_type)type);
+		QVERIFY2(matchDives(c) == all, qPrintable(describe(c)));
+		QVERIFY2(matchSummary(c, t) == all, qPrintable(describe(c)));
+	}
+}
+
+void TestFilter::testSummaryMatchesDives()
+{
+	/*
+	 * for every type of constraint, testing the summary table gives the same
+	 * result as testing the dives one by one
+	 */
+	DiveSummaryTable t;
+	t.ensureUpToDate();
+	QCOMPARE(t.size(), divelog.dives->nr);
+	for (int i = 0; i < t.size(); ++i)
+		QCOMPARE(t.dives[i], divelog.dives->dives[i]);
+
+	timestamp_t first = divelog.dives->dives[0]->when;
+	timestamp_t last = dive_endtime(divelog.dives->dives[divelog.dives->nr - 1]);
+	for (int type = FILTER_CONSTRAINT_DATE; type <= FILTER_CONSTRAINT_NOTES; ++type) {
+		for (const filter_constraint &c: constraintsOfType((filter_constraint_type)type, first, last)) {
+			QString expected = matchDives(c);
+			QVERIFY2(matchSummary(c, t) == expected, qPrintable(describe(c) + " expected: " + expected));
+		}
+	}
+}
+
+QTEST_GUILESS_MAIN(TestFilter)
@@ -0,0 +1,17 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef TESTFILTER_H
+#define TESTFILTER_H
+
+#include <QtTest>
+
+class TestFilter : public QObject {
+	Q_OBJECT
+private slots:
+	void initTestCase();
+	void cleanupTestCase();
+
+	void testEmptyStringConstraint();
+	void testSummaryMatchesDives();
+};
+
+#endif
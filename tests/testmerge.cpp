@@ -2,6 +2,8 @@
 #include "testmerge.h"
 #include "core/device.h"
 #include "core/dive.h" // for save_dives()
+#include "core/divecomputer.h"
+#include "core/divelist.h"
 #include "core/divelog.h"
 #include "core/divesite.h"
 #include "core/file.h"
@@ -67,4 +69,141 @@ void TestMerge::testMergeBackwards()
 		QCOMPARE(written.takeFirst().trimmed(), readin.takeFirst().trimmed());
 }
 
+void TestMerge::testInsertRemoveDives()
+{
+	/*
+	 * check that inserting and removing dives in one go gives
+	 * the same table as inserting and removing them one by one
+	 */
+	struct dive_table single = empty_dive_table;
+	struct dive_table bulk = empty_dive_table;
+	struct dive_table dives = empty_dive_table;
+	std::vector<dive *> all;
+
+	// Old dives every hour, new dives interleaved, partly at the same time
+	for (int i = 0; i < 200; ++i) {
+		struct dive *d = alloc_dive();
+		d->when = i * 3600;
+		insert_dive(&single, d);
+		insert_dive(&bulk, d);
+		all.push_back(d);
+	}
+	for (int i = 0; i < 300; ++i) {
+		struct dive *d = alloc_dive();
+		d->when = (i * 7 % 250) * 1800 + 60;
+		d->number = i % 3;
+		insert_dive(&dives, d);
+		all.push_back(d);
+	}
+	for (int i = 0; i < dives.nr; ++i)
+		insert_dive(&single, dives.dives[i]);
+	insert_dives(&bulk, dives.dives, dives.nr);
+	QCOMPARE(bulk.nr, single.nr);
+	for (int i = 0; i < single.nr; ++i)
+		QCOMPARE(bulk.dives[i], single.dives[i]);
+
+	// Remove every third dive
+	std::vector<dive *> toRemove;
+	for (int i = 0; i < (int)all.size(); i += 3)
+		toRemove.push_back(all[i]);
+	for (dive *d: toRemove)
+		remove_dive(d, &single);
+	remove_dives(&bulk, toRemove.data(), (int)toRemove.size());
+	QCOMPARE(bulk.nr, single.nr);
+	for (int i = 0; i < single.nr; ++i)
+		QCOMPARE(bulk.dives[i], single.dives[i]);
+
+	for (dive *d: all)
+		free_dive(d);
+	free(single.dives);
+	free(bulk.dives);
+	free(dives.dives);
+}
+
+void TestMerge::testDiveTableGeneration()
+{
+	/*
+	 * check that every modification of the global dive table,
+	 * and only of the global dive table, changes its generation
+	 */
+	struct dive_table other = empty_dive_table;
+	struct dive *d1 = alloc_dive();
+	struct dive *d2 = alloc_dive();
+	d1->when = 3600;
+	d2->when = 7200;
+
+	unsigned int generation = get_dive_table_generation();
+	insert_dive(&other, d1);
+	remove_dive(d1, &other);
+	QCOMPARE(get_dive_table_generation(), generation);
+
+	insert_dive(divelog.dives, d1);
+	QVERIFY(get_dive_table_generation() != generation);
+	generation = get_dive_table_generation();
+	insert_dives(divelog.dives, &d2, 1);
+	QVERIFY(get_dive_table_generation() != generation);
+	generation = get_dive_table_generation();
+	sort_dive_table(divelog.dives);
+	QVERIFY(get_dive_table_generation() != generation);
+	generation = get_dive_table_generation();
+	remove_dives(divelog.dives, &d2, 1);
+	QVERIFY(get_dive_table_generation() != generation);
+	generation = get_dive_table_generation();
+	remove_dive(d1, divelog.dives);
+	QVERIFY(get_dive_table_generation() != generation);
+	generation = get_dive_table_generation();
+	clear_dive_table(divelog.dives);
+	QVERIFY(get_dive_table_generation() != generation);
+
+	free_dive(d1);
+	free_dive(d2);
+	free(other.dives);
+}
+
+// The samples of a dive computer that started recording 'delay' seconds into the dive
+static void startLate(const struct divecomputer *dc, int delay, struct divecomputer *res)
+{
+	for (int i = 0; i < dc->samples; ++i) {
+		if (dc->sample[i].time.seconds >= delay)
+			add_sample(&dc->sample[i], dc->sample[i].time.seconds - delay, res);
+	}
+}
+
+void TestMerge::testSampleOffset()
+{
+	/*
+	 * ostc.xml and vyper.xml are the same two dives recorded by two
+	 * different dive computers. Let the computers start recording later
+	 * and check that the alignment finds the delay, also beyond the
+	 * thirty seconds that were searched before.
+	 */
+	struct divelog ostc, vyper;
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/ostc.xml", &ostc), 0);
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/vyper.xml", &vyper), 0);
+	QCOMPARE(ostc.dives->nr, 2);
+	QCOMPARE(vyper.dives->nr, 2);
+
+	for (int i = 0; i < 2; ++i) {
+		const struct divecomputer *a = &ostc.dives->dives[i]->dc;
+		const struct divecomputer *b = &vyper.dives->dives[i]->dc;
+		QCOMPARE(find_sample_offset(b, b, 600), 0);
+
+		// The two computers started recording within a few seconds
+		int base = find_sample_offset(a, b, 600);
+		QVERIFY(qAbs(base) <= 10);
+		QVERIFY(qAbs(find_sample_offset(b, a, 600) + base) <= 2);
+
+		for (int delay: { 40, 90, 150, 300, 600 }) {
+			struct divecomputer late = { 0 };
+			startLate(b, delay, &late);
+			QCOMPARE(find_sample_offset(b, &late, 900), delay);
+			QVERIFY2(qAbs(find_sample_offset(a, &late, 900) - base - delay) <= 10, qPrintable(QString::number(delay)));
+			QVERIFY2(qAbs(find_sample_offset(&late, a, 900) + base + delay) <= 10, qPrintable(QString::number(delay)));
+			// Nothing is found outside of the window
+			QVERIFY(qAbs(find_sample_offset(a, &late, 30)) <= 35);
+			free_dc_contents(&late);
+		}
+	}
+}
+
 QTEST_GUILESS_MAIN(TestMerge)
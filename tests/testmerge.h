@@ -12,6 +12,9 @@ private slots:
 
 	void testMergeEmpty();
 	void testMergeBackwards();
+	void testInsertRemoveDives();
+	void testDiveTableGeneration();
+	void testSampleOffset();
 };
 
 #endif
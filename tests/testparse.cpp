@@ -2,17 +2,25 @@
 #include "testparse.h"
 #include "core/device.h"
 #include "core/dive.h"
+#include "core/divelist.h"
 #include "core/divelog.h"
 #include "core/divesite.h"
+#include "core/event.h"
 #include "core/errorhelper.h"
 #include "core/trip.h"
 #include "core/file.h"
 #include "core/import-csv.h"
+#include "core/parallelimport.h"
 #include "core/parse.h"
 #include "core/qthelper.h"
+#include "core/sample.h"
 #include "core/subsurface-string.h"
+#include "core/tag.h"
 #include "core/xmlparams.h"
+#include <QSet>
 #include <QTextStream>
+#include <QVector>
+#include <algorithm>
 
 /* We have to use a macro since QCOMPARE
  * can only be called from a test method
@@ -155,6 +163,89 @@ void TestParse::testParseDM5()
 		     SUBSURFACE_TEST_DATA "/dives/TestDiveDM5.xml");
 }
 
+// The rows of a query with the dive id bound to its only parameter
+static std::vector<QStringList> sqlRows(sqlite3 *handle, const char *query, int dive_id)
+{
+	std::vector<QStringList> res;
+	sqlite3_stmt *stmt;
+	if (sqlite3_prepare_v2(handle, query, -1, &stmt, NULL) != SQLITE_OK)
+		return res;
+	sqlite3_bind_int(stmt, 1, dive_id);
+	while (sqlite3_step(stmt) == SQLITE_ROW) {
+		QStringList row;
+		for (int i = 0; i < sqlite3_column_count(stmt); ++i)
+			row.append(QString::fromUtf8((const char *)sqlite3_column_text(stmt, i)));
+		res.push_back(row);
+	}
+	sqlite3_finalize(stmt);
+	return res;
+}
+
+static int shearwaterPermille(const QString &fraction)
+{
+	return lrint(fraction.toDouble() * 1000);
+}
+
+void TestParse::testParseShearwater()
+{
+	/*
+	 * The Shearwater importer reads the records of all dives in a single
+	 * pass. Compare the dives with the per-dive queries that it used
+	 * before. The log contains a dive without records, records of dives
+	 * that don't exist and consecutive records of different dives.
+	 */
+	QCOMPARE(sqlite3_open(SUBSURFACE_TEST_DATA "/dives/TestDiveShearwater.db", &_sqlite3_handle), 0);
+	QCOMPARE(parse_shearwater_buffer(_sqlite3_handle, "TestDiveShearwater.db", 0, 0, &divelog), 0);
+	QCOMPARE(divelog.dives->nr, 4);
+
+	for (int i = 0; i < divelog.dives->nr; ++i) {
+		const struct dive *d = divelog.dives->dives[i];
+		const struct divecomputer *dc = &d->dc;
+		int id = d->number;
+
+		enum divemode_t mode = OC;
+		for (const QStringList &row: sqlRows(_sqlite3_handle, "select distinct currentCircuitSetting from dive_log_records where diveLogId = ?", id)) {
+			if (!row[0].isEmpty())
+				mode = row[0].toInt() == 0 ? CCR : OC;
+		}
+		QCOMPARE((int)dc->divemode, (int)mode);
+
+		QVector<QPair<int, int>> mixes;
+		for (const QStringList &row: sqlRows(_sqlite3_handle, "select fractionO2,fractionHe from dive_log_records where diveLogId = ? group by fractionO2,fractionHe", id)) {
+			int o2 = shearwaterPermille(row[0]), he = shearwaterPermille(row[1]);
+			mixes.append(qMakePair(o2 == 990 && he == 0 ? 1000 : o2, he));
+		}
+		QCOMPARE(d->cylinders.nr, (int)mixes.size());
+		for (int j = 0; j < mixes.size(); ++j) {
+			QCOMPARE(get_cylinder(d, j)->gasmix.o2.permille, mixes[j].first);
+			QCOMPARE(get_cylinder(d, j)->gasmix.he.permille, mixes[j].second);
+		}
+
+		QVector<QPair<int, int>> changes;
+		for (const QStringList &row: sqlRows(_sqlite3_handle, "select a.currentTime,a.fractionO2,a.fractionHe from dive_log_records as a,dive_log_records as b where (a.id - 1) = b.id and (a.fractionO2 != b.fractionO2 or a.fractionHe != b.fractionHe) and a.diveLogId=b.divelogId and a.diveLogId = ?", id)) {
+			int o2 = shearwaterPermille(row[1]), he = shearwaterPermille(row[2]);
+			if (o2 == 990 && he == 0)
+				o2 = 1000;
+			changes.append(qMakePair(row[0].toInt(), (int)mixes.indexOf(qMakePair(o2, he))));
+		}
+		std::sort(changes.begin(), changes.end());
+		QVector<QPair<int, int>> events;
+		for (const struct event *ev = get_next_event(dc->events, "gaschange"); ev; ev = get_next_event(ev->next, "gaschange"))
+			events.append(qMakePair((int)ev->time.seconds, ev->gas.index));
+		QCOMPARE(events, changes);
+
+		// Dives without records get a fake profile
+		std::vector<QStringList> profile = sqlRows(_sqlite3_handle, "select currentTime,currentDepth from dive_log_records where diveLogId=?", id);
+		if (profile.empty())
+			continue;
+		QCOMPARE(dc->samples, (int)profile.size());
+		for (int j = 0; j < dc->samples; ++j) {
+			QCOMPARE((int)dc->sample[j].time.seconds, profile[j][0].toInt());
+			QCOMPARE(dc->sample[j].depth.mm, shearwaterPermille(profile[j][1]));
+		}
+	}
+}
+
 void TestParse::testParseHUDC()
 {
 	xml_params params;
@@ -197,6 +288,85 @@ void TestParse::testParseHUDC()
 		     SUBSURFACE_TEST_DATA "/dives/TestDiveSeabearHUDC.xml");
 }
 
+void TestParse::testParseCSVNative()
+{
+	/*
+	 * the native reader of the "csv" template gives the same dives as the XSLT,
+	 * for metric and imperial units and for CCR data
+	 */
+	for (int units = 0; units < 2; ++units) {
+		for (int ccr = 0; ccr < 2; ++ccr) {
+			xml_params params;
+
+			xml_params_add(&params, "date", "20191012");
+			xml_params_add(&params, "time", "11230");
+			xml_params_add_int(&params, "timeField", 0);
+			xml_params_add_int(&params, "depthField", 1);
+			xml_params_add_int(&params, "tempField", 5);
+			xml_params_add_int(&params, "ndlField", ccr ? -1 : 2);
+			xml_params_add_int(&params, "ttsField", ccr ? -1 : 3);
+			xml_params_add_int(&params, "stopdepthField", 4);
+			xml_params_add_int(&params, "pressureField", 6);
+			xml_params_add_int(&params, "po2Field", ccr ? 4 : -1);
+			xml_params_add_int(&params, "o2sensor1Field", ccr ? 3 : -1);
+			xml_params_add_int(&params, "separatorIndex", 2);
+			xml_params_add_int(&params, "units", units);
+			xml_params_add(&params, "hw", "\"DC text\"");
+
+			QCOMPARE(parse_csv_file(SUBSURFACE_TEST_DATA "/dives/TestDiveSeabearHUDC.csv",
+						&params, "csv", &divelog), 0);
+			QCOMPARE(save_dives("./testcsvnative.ssrf"), 0);
+			clear_dive_file_data();
+
+			QCOMPARE(parse_csv_file_xslt(SUBSURFACE_TEST_DATA "/dives/TestDiveSeabearHUDC.csv",
+						     &params, "csv", &divelog), 0);
+			QCOMPARE(save_dives("./testcsvxslt.ssrf"), 0);
+			clear_dive_file_data();
+
+			FILE_COMPARE("./testcsvnative.ssrf",
+				     "./testcsvxslt.ssrf");
+		}
+	}
+}
+
+void TestParse::testParseCSVNativeHeader()
+{
+	/*
+	 * the number of the dive is taken from the third line only, also when
+	 * that line has fewer fields than the following ones
+	 */
+	QFile csv("./testcsvheader.csv");
+	QVERIFY(csv.open(QFile::WriteOnly | QFile::Truncate));
+	csv.write("time,depth,number\n"
+		  "0:00,0.0,7\n"
+		  "1:00,10.0\n"
+		  "2:00,5.0,9\n"
+		  "3:00,0.0,11\n");
+	csv.close();
+
+	xml_params params;
+	xml_params_add(&params, "date", "20191012");
+	xml_params_add(&params, "time", "11230");
+	xml_params_add_int(&params, "timeField", 0);
+	xml_params_add_int(&params, "depthField", 1);
+	xml_params_add_int(&params, "numberField", 2);
+	xml_params_add_int(&params, "separatorIndex", 1);
+	xml_params_add_int(&params, "units", 0);
+
+	QCOMPARE(parse_csv_file("./testcsvheader.csv", &params, "csv", &divelog), 0);
+	QCOMPARE(divelog.dives->nr, 1);
+	QCOMPARE(divelog.dives->dives[0]->number, 0);
+	QCOMPARE(save_dives("./testcsvheadernative.ssrf"), 0);
+	clear_dive_file_data();
+
+	QCOMPARE(parse_csv_file_xslt("./testcsvheader.csv", &params, "csv", &divelog), 0);
+	QCOMPARE(save_dives("./testcsvheaderxslt.ssrf"), 0);
+	clear_dive_file_data();
+
+	FILE_COMPARE("./testcsvheadernative.ssrf",
+		     "./testcsvheaderxslt.ssrf");
+}
+
 void TestParse::testParseNewFormat()
 {
 	QDir dir;
@@ -251,6 +421,24 @@ void TestParse::testParseDLD()
 		     SUBSURFACE_TEST_DATA "/dives/TestDiveDivelogsDE.xml")
 }
 
+void TestParse::testMapFile()
+{
+	/*
+	 * a mapped file has the same contents as a file read into memory
+	 */
+	struct memblock mem, mapped;
+	QString filename = SUBSURFACE_TEST_DATA "/dives/TestDiveDivelogsDE.DLD";
+
+	QVERIFY(readfile(filename.toLatin1().data(), &mem) > 0);
+	QVERIFY(mapfile(filename.toLatin1().data(), &mapped) > 0);
+	QCOMPARE(mapped.size, mem.size);
+	QVERIFY(memcmp(mapped.buffer, mem.buffer, mem.size) == 0);
+	QVERIFY(!mem.mapped);
+	free_memblock(&mapped);
+	free_memblock(&mem);
+	QVERIFY(mapped.buffer == NULL && mapped.size == 0);
+}
+
 void TestParse::testParseMerge()
 {
 	/*
@@ -263,6 +451,108 @@ void TestParse::testParseMerge()
 		     SUBSURFACE_TEST_DATA "/dives/mergedVyperOstc.xml");
 }
 
+void TestParse::testParseFiles()
+{
+	/*
+	 * parsing files concurrently gives the same result as parsing them one by one
+	 */
+	QStringList files { SUBSURFACE_TEST_DATA "/dives/ostc.xml", SUBSURFACE_TEST_DATA "/dives/vyper.xml" };
+	QCOMPARE(parse_files(files, &divelog), 0);
+	QCOMPARE(save_dives("./testparsefiles.ssrf"), 0);
+	FILE_COMPARE("./testparsefiles.ssrf",
+		     SUBSURFACE_TEST_DATA "/dives/mergedVyperOstc.xml");
+}
+
+static QVector<int> maxcns_of_dives()
+{
+	QVector<int> res;
+	for (int i = 0; i < divelog.dives->nr; ++i)
+		res.append(divelog.dives->dives[i]->maxcns);
+	return res;
+}
+
+void TestParse::testDeferredCns()
+{
+	/*
+	 * dives that are parsed into a separate log get their CNS when they are
+	 * added to the dive list, including the CNS carried over from the
+	 * previous dives
+	 */
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/test29.xml", &divelog), 0);
+	QVector<int> expected = maxcns_of_dives();
+	QCOMPARE(expected.size(), 4);
+	QVERIFY(expected[0] > 0);
+	QVERIFY(expected[1] > expected[0]);
+	clear_dive_file_data();
+
+	struct divelog log;
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/test29.xml", &log), 0);
+	QCOMPARE(log.dives->nr, 4);
+	for (int i = 0; i < log.dives->nr; ++i)
+		QCOMPARE(log.dives->dives[i]->maxcns, 0);
+	add_imported_dives(&log, IMPORT_MERGE_ALL_TRIPS);
+	QCOMPARE(maxcns_of_dives(), expected);
+}
+
+void TestParse::testParseFilesWithTags()
+{
+	/*
+	 * files with tags use the global tag list and give out dive ids
+	 * from several threads at the same time
+	 */
+	QStringList files { SUBSURFACE_TEST_DATA "/dives/TestDiveDM5.xml", SUBSURFACE_TEST_DATA "/dives/test29.xml",
+			    SUBSURFACE_TEST_DATA "/dives/test48.xml", SUBSURFACE_TEST_DATA "/dives/gps-import.xml" };
+	struct divelog log;
+	for (const QString &file: files)
+		QCOMPARE(parse_file(qPrintable(file), &log), 0);
+	divelog.append(std::move(log));
+	QCOMPARE(save_dives("./testparsefilestags1.ssrf"), 0);
+	clear_dive_file_data();
+
+	QCOMPARE(parse_files(files, &divelog), 0);
+	QCOMPARE(save_dives("./testparsefilestags2.ssrf"), 0);
+
+	QStringList tags;
+	for (struct tag_entry *entry = g_tag_list; entry; entry = entry->next)
+		tags.append(entry->tag->name);
+	QCOMPARE(tags.removeDuplicates(), 0);
+	QSet<int> ids;
+	for (int i = 0; i < divelog.dives->nr; ++i)
+		ids.insert(divelog.dives->dives[i]->id);
+	QCOMPARE(ids.size(), divelog.dives->nr);
+	clear_dive_file_data();
+
+	FILE_COMPARE("./testparsefilestags2.ssrf",
+		     "./testparsefilestags1.ssrf");
+}
+
+void TestParse::testStylesheetCache()
+{
+	/*
+	 * a stylesheet is compiled once and the cached copy gives the same
+	 * result, also after flushing the cache
+	 */
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/TestDiveDivingLog5.08.uddf", &divelog), 0);
+	QCOMPARE(save_dives("./teststylesheetcache1.ssrf"), 0);
+	clear_dive_file_data();
+
+	xsltStylesheetPtr xslt = get_cached_stylesheet("uddf.xslt");
+	QVERIFY(xslt != NULL);
+	QCOMPARE(get_cached_stylesheet("uddf.xslt"), xslt);
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/TestDiveDivingLog5.08.uddf", &divelog), 0);
+	QCOMPARE(save_dives("./teststylesheetcache2.ssrf"), 0);
+	clear_dive_file_data();
+	FILE_COMPARE("./teststylesheetcache1.ssrf",
+		     "./teststylesheetcache2.ssrf");
+
+	flush_stylesheet_cache();
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/TestDiveDivingLog5.08.uddf", &divelog), 0);
+	QCOMPARE(save_dives("./teststylesheetcache3.ssrf"), 0);
+	clear_dive_file_data();
+	FILE_COMPARE("./teststylesheetcache1.ssrf",
+		     "./teststylesheetcache3.ssrf");
+}
+
 int TestParse::parseCSVmanual(int units, std::string file)
 {
 	verbose = 1;
@@ -20,10 +20,18 @@ private slots:
 
 	void testParseDM4();
 	void testParseDM5();
+	void testParseShearwater();
 	void testParseHUDC();
+	void testParseCSVNative();
+	void testParseCSVNativeHeader();
 	void testParseNewFormat();
 	void testParseDLD();
+	void testMapFile();
 	void testParseMerge();
+	void testParseFiles();
+	void testParseFilesWithTags();
+	void testDeferredCns();
+	void testStylesheetCache();
 
 	int parseCSVmanual(int, std::string);
 	void exportSubsurfaceCSV();
@@ -6,12 +6,16 @@
 #include "core/trip.h"
 #include "core/file.h"
 #include "core/git-access.h"
+#include "core/import-csv.h"
+#include "core/xmlparams.h"
 #include "core/settings/qPrefProxy.h"
 #include "core/settings/qPrefCloudStorage.h"
 #include <QFile>
 #include <QDebug>
 #include <QNetworkProxy>
+#include <QTextStream>
 #include "QTextCodec"
+#include <math.h>
 
 #define LARGE_TEST_REPO "https://github.com/Subsurface/large-anonymous-sample-data"
 
@@ -86,4 +90,69 @@ void TestParsePerformance::parseGit()
 	}
 }
 
+// Write a Seabear style profile like dives/TestDiveSeabearHUDC.csv with the given number of samples
+static QString writeCSVProfile(int samples)
+{
+	QString fileName = QString("./testparseperformance%1.csv").arg(samples);
+	QFile f(fileName);
+	if (!f.open(QIODevice::WriteOnly))
+		return QString();
+	QTextStream out(&f);
+	out << "Time;Depth;NDT;TTS;Ceiling;Temperature;Tank pressure\n";
+	for (int i = 0; i < samples; ++i)
+		out << i * 2 << ";" << QString::number(30.0 * fabs(sin(i / 5000.0)), 'f', 1) << ";"
+		    << 200 - i % 200 << ";" << i % 30 << ";0;" << 25 - i % 7 << ";" << 200 - i / 1000 << "\n";
+	return fileName;
+}
+
+static void setupCSVParams(xml_params &params)
+{
+	xml_params_add(&params, "date", "20230115");
+	xml_params_add(&params, "time", "11230");
+	xml_params_add_int(&params, "timeField", 0);
+	xml_params_add_int(&params, "depthField", 1);
+	xml_params_add_int(&params, "ndlField", 2);
+	xml_params_add_int(&params, "ttsField", 3);
+	xml_params_add_int(&params, "tempField", 5);
+	xml_params_add_int(&params, "pressureField", 6);
+	xml_params_add_int(&params, "separatorIndex", 2);
+	xml_params_add_int(&params, "units", 0);
+}
+
+// The XSLT runs out of stack for much longer profiles, therefore
+// compare both ways of importing on a profile of 5000 samples.
+void TestParsePerformance::parseCSV()
+{
+	QString fileName = writeCSVProfile(5000);
+	xml_params params;
+	setupCSVParams(params);
+
+	QBENCHMARK {
+		QCOMPARE(parse_csv_file(qPrintable(fileName), &params, "csv", &divelog), 0);
+	}
+}
+
+void TestParsePerformance::parseCSVXslt()
+{
+	QString fileName = writeCSVProfile(5000);
+	xml_params params;
+	setupCSVParams(params);
+
+	QBENCHMARK {
+		QCOMPARE(parse_csv_file_xslt(qPrintable(fileName), &params, "csv", &divelog), 0);
+	}
+}
+
+void TestParsePerformance::parseLargeCSV()
+{
+	QString fileName = writeCSVProfile(100000);
+	xml_params params;
+	setupCSVParams(params);
+
+	QBENCHMARK {
+		QCOMPARE(parse_csv_file(qPrintable(fileName), &params, "csv", &divelog), 0);
+	}
+	QCOMPARE(divelog.dives->dives[0]->dc.samples, 100000);
+}
+
 QTEST_GUILESS_MAIN(TestParsePerformance)
@@ -13,6 +13,9 @@ private slots:
 
 	void parseSsrf();
 	void parseGit();
+	void parseCSV();
+	void parseCSVXslt();
+	void parseLargeCSV();
 };
 
 #endif